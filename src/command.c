@@ -0,0 +1,46 @@
+#include "command.h"
+
+SynthError command_queue_init( CommandQueue *queue, SynthArena *arena, uint32_t capacity ) {
+    if ( !queue || !arena ) return SYNTH_ERROR_NULL_PTR;
+    if ( capacity == 0 || ( capacity & ( capacity - 1 ) ) ) return SYNTH_ERROR_INVALID_PARAM;
+
+    queue->commands = (SynthCommand *) arena_alloc_aligned(
+      arena, sizeof( SynthCommand ) * capacity, COMMAND_CACHE_LINE
+    );
+    if ( !queue->commands ) return SYNTH_ERROR_ARENA_FULL;
+
+    queue->mask       = capacity - 1;
+    queue->cachedTail = 0;
+    queue->cachedHead = 0;
+    synth_atomic_store( &queue->head, 0 );
+    synth_atomic_store( &queue->tail, 0 );
+    return SYNTH_ACK;
+}
+
+bool command_queue_push( CommandQueue *queue, const SynthCommand *command ) {
+    uint64_t tail = synth_atomic_load( &queue->tail );    // only this thread writes tail
+
+    // refresh the consumer position only when the cached one says the ring is full
+    if ( tail - queue->cachedHead > queue->mask ) {
+        queue->cachedHead = synth_atomic_load( &queue->head );
+        if ( tail - queue->cachedHead > queue->mask ) return false;
+    }
+
+    queue->commands[tail & queue->mask] = *command;
+    synth_atomic_store( &queue->tail, tail + 1 );    // publish the filled slot
+    return true;
+}
+
+const SynthCommand *command_queue_peek( CommandQueue *queue ) {
+    uint64_t head = synth_atomic_load( &queue->head );    // only this thread writes head
+    if ( head == queue->cachedTail ) {
+        queue->cachedTail = synth_atomic_load( &queue->tail );
+        if ( head == queue->cachedTail ) return NULL;
+    }
+    return &queue->commands[head & queue->mask];
+}
+
+void command_queue_pop( CommandQueue *queue ) {
+    uint64_t head = synth_atomic_load( &queue->head );
+    synth_atomic_store( &queue->head, head + 1 );    // hand the slot back to the producer
+}
@@ -0,0 +1,88 @@
+/**
+ * @file
+ * @brief wait-free single-producer single-consumer queue of timestamped synth commands
+ *
+ * The control thread pushes commands stamped with the sample frame they should take effect at;
+ * the render thread drains the ones that are due at the start of each block and splits the block
+ * at any timestamp that falls inside it, so commands land on the exact sample. Neither side ever
+ * blocks or locks. Commands must be pushed in non-decreasing time order.
+ */
+
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include "synth.h"
+
+#include <stdalign.h>
+
+#define COMMAND_CACHE_LINE 64
+
+// kinds of commands the render thread understands
+typedef enum {
+    SYNTH_CMD_NOTE_ON,
+    SYNTH_CMD_NOTE_OFF,
+    SYNTH_CMD_PITCH_BEND,
+    SYNTH_CMD_MASTER_VOLUME
+} SynthCommandType;
+
+// a single timestamped command
+typedef struct {
+    uint64_t         time;    // sample frame to apply at, SYNTH_TIME_NOW for the next block
+    SynthCommandType type;
+    uint32_t         note;    // note handle for note on, note off and pitch bend
+    BaseWaveform     waveform;
+    float            frequency;
+    float            pitch;       // note index in the tuning, negative to use frequency
+    float            value;       // note amplitude, bend in semitones or master volume
+    Envelope         envelope;    // envelope of a note on
+    uint8_t          priority;    // steal priority of a note on
+} SynthCommand;
+
+struct CommandQueue {
+    SynthCommand *commands;
+    uint32_t      mask;    // capacity - 1
+
+    // consumer side, on its own cache line
+    alignas( COMMAND_CACHE_LINE ) SynthAtomic head;
+    uint64_t cachedTail;
+
+    // producer side, on its own cache line
+    alignas( COMMAND_CACHE_LINE ) SynthAtomic tail;
+    uint64_t cachedHead;
+};
+
+/**
+ * @brief Carve a command queue out of an arena
+ *
+ * @param queue queue to initialize
+ * @param arena arena backing the command ring
+ * @param capacity number of slots, must be a power of two
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR, SYNTH_ERROR_INVALID_PARAM or SYNTH_ERROR_ARENA_FULL
+ */
+SynthError          command_queue_init( CommandQueue *queue, SynthArena *arena, uint32_t capacity );
+
+/**
+ * @brief Push a command, producer side only
+ *
+ * @param queue queue to push to
+ * @param command command to copy into the queue
+ * @return true if queued, false if the queue is full
+ */
+bool                command_queue_push( CommandQueue *queue, const SynthCommand *command );
+
+/**
+ * @brief Look at the oldest pending command without removing it, consumer side only
+ *
+ * @param queue queue to read
+ * @return the command, or NULL if the queue is empty
+ */
+const SynthCommand *command_queue_peek( CommandQueue *queue );
+
+/**
+ * @brief Remove the command returned by the last command_queue_peek(), consumer side only
+ *
+ * @param queue queue to pop from
+ */
+void                command_queue_pop( CommandQueue *queue );
+
+#endif
@@ -0,0 +1,132 @@
+#include "driver.h"
+
+#ifndef _WIN32
+  #include <sys/mman.h>
+#endif
+
+/*****************
+ * RENDER THREAD *
+ ****************/
+// audio_render() source: time one synth render against the period deadline
+static void driver_pull( void *user, float *buffer, uint32_t frames ) {
+    AudioDriver *driver = (AudioDriver *) user;
+    double       start  = audio_clock();
+    synth_process_buffer( driver->synth, buffer, (int) frames );
+    double elapsed = audio_clock() - start;
+
+    // one writer, so plain loads and stores are enough for the maximum
+    uint64_t nanoseconds = (uint64_t) ( elapsed * 1e9 );
+    synth_atomic_store( &driver->lastNanoseconds, nanoseconds );
+    synth_atomic_fetch_add( &driver->totalNanoseconds, nanoseconds );
+    if ( nanoseconds > synth_atomic_load( &driver->maxNanoseconds ) ) {
+        synth_atomic_store( &driver->maxNanoseconds, nanoseconds );
+    }
+    synth_atomic_fetch_add( &driver->periods, 1 );
+    if ( elapsed * driver->audio->sampleRate > frames ) {
+        synth_atomic_fetch_add( &driver->late, 1 );
+    }
+}
+
+static void driver_loop( void *arg ) {
+    AudioDriver  *driver = (AudioDriver *) arg;
+    AudioContext *audio  = driver->audio;
+    while ( synth_atomic_load( &driver->running ) ) {
+        if ( audio_render( audio, driver_pull, driver, (uint32_t) audio->bufferSize ) !=
+             SYNTH_ACK ) {
+            synth_atomic_store( &driver->failed, 1 );
+            return;
+        }
+        synth_atomic_store( &driver->underruns, audio->latency.xruns );
+        synth_atomic_store(
+          &driver->latencyNanoseconds, (uint64_t) ( audio->latency.delaySeconds * 1e9 )
+        );
+    }
+}
+
+/******************
+ * MEMORY LOCKING *
+ *****************/
+#ifdef _WIN32
+// only the synth's own memory can be locked without raising the working set limits
+static bool driver_lock( AudioDriver *driver ) {
+    return VirtualLock( driver->synth->arena.buffer, driver->synth->arena.size ) != 0;
+}
+
+static void driver_unlock( AudioDriver *driver ) {
+    VirtualUnlock( driver->synth->arena.buffer, driver->synth->arena.size );
+}
+#else
+// wavetables, thread stacks and the device buffers all have to stay resident, not just the arena
+static bool driver_lock( AudioDriver *driver ) {
+    (void) driver;
+    return mlockall( MCL_CURRENT | MCL_FUTURE ) == 0;
+}
+
+static void driver_unlock( AudioDriver *driver ) {
+    (void) driver;
+    munlockall();
+}
+#endif
+
+/**********
+ * DRIVER *
+ *********/
+SynthError audio_driver_start(
+  AudioDriver *driver, Synthesizer *synth, const DriverConfig *config
+) {
+    if ( !driver || !synth ) return SYNTH_ERROR_NULL_PTR;
+    DriverConfig settings = { 0 };
+    if ( config ) settings = *config;
+    if ( settings.priority == 0 ) settings.priority = DRIVER_PRIORITY;
+    if ( settings.audio.channels == 0 ) settings.audio.channels = synth->channels;
+    if ( settings.audio.sampleRate == 0 ) {
+        settings.audio.sampleRate = (uint32_t) synth->outputRate;
+    }
+
+    memset( driver, 0, sizeof( AudioDriver ) );
+    driver->synth = synth;
+    driver->audio = audio_open( &settings.audio );
+    if ( !driver->audio ) return SYNTH_ERROR_INIT_FAILED;
+    driver->periodSeconds = (double) driver->audio->bufferSize / driver->audio->sampleRate;
+    driver->locked        = !settings.skipMemoryLock && driver_lock( driver );
+
+    synth->audio = driver->audio;
+    synth_atomic_store( &driver->running, 1 );
+    if ( !synth_thread_start( &driver->thread, driver_loop, driver, settings.priority ) ) {
+        synth->audio = NULL;
+        if ( driver->locked ) driver_unlock( driver );
+        audio_close( driver->audio );
+        return SYNTH_ERROR_INIT_FAILED;
+    }
+    return SYNTH_ACK;
+}
+
+SynthError audio_driver_stats( AudioDriver *driver, DriverStats *stats ) {
+    if ( !driver || !stats ) return SYNTH_ERROR_NULL_PTR;
+    uint64_t periods         = synth_atomic_load( &driver->periods );
+    stats->periods           = periods;
+    stats->underruns         = synth_atomic_load( &driver->underruns );
+    stats->late              = synth_atomic_load( &driver->late );
+    stats->periodSeconds     = driver->periodSeconds;
+    stats->lastRenderSeconds = (double) synth_atomic_load( &driver->lastNanoseconds ) * 1e-9;
+    stats->maxRenderSeconds  = (double) synth_atomic_load( &driver->maxNanoseconds ) * 1e-9;
+    stats->meanRenderSeconds =
+      periods ? (double) synth_atomic_load( &driver->totalNanoseconds ) * 1e-9 / periods : 0.0;
+    stats->headroom =
+      driver->periodSeconds > 0.0 ? 1.0 - stats->maxRenderSeconds / driver->periodSeconds : 0.0;
+    stats->latencySeconds = (double) synth_atomic_load( &driver->latencyNanoseconds ) * 1e-9;
+    stats->realtime       = driver->thread.realtime;
+    stats->locked         = driver->locked;
+    stats->failed         = synth_atomic_load( &driver->failed ) != 0;
+    return SYNTH_ACK;
+}
+
+void audio_driver_stop( AudioDriver *driver ) {
+    if ( !driver || !driver->audio ) return;
+    synth_atomic_store( &driver->running, 0 );
+    synth_thread_join( &driver->thread );
+    if ( driver->locked ) driver_unlock( driver );
+    driver->synth->audio = NULL;
+    audio_close( driver->audio );
+    driver->audio = NULL;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file
+ * @brief pull-model audio driver, a realtime thread that renders the synth into a device
+ *
+ * Instead of the application pushing buffers with audio_write(), the driver owns a render thread
+ * that blocks on the device and pulls one period at a time out of synth_process_buffer(). The
+ * device rotates through `periods` buffers (ALSA ring periods, waveOut headers or the loopback
+ * buffer), so a render can run late by up to periods - 1 periods before the device runs dry.
+ *
+ * The thread asks for SCHED_FIFO, or time critical priority on Windows, and memory is locked so
+ * page faults never stall it. If either is refused the driver still runs and its stats say so.
+ * Control threads keep talking to the synth through its command queue while the driver runs.
+ */
+
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include "synth_platform.h"
+
+#define DRIVER_PRIORITY 80    // default SCHED_FIFO priority of the render thread
+
+typedef struct {
+    AudioConfig audio;             // device to open, periods sets the rotation depth
+    int         priority;          // SCHED_FIFO priority, 0 for DRIVER_PRIORITY, < 0 for normal
+    bool        skipMemoryLock;    // false, the default, keeps the process resident, see mlockall()
+} DriverConfig;
+
+// render thread health, safe to read while the driver runs
+typedef struct {
+    uint64_t periods;              // periods rendered
+    uint64_t underruns;            // times the device ran dry
+    uint64_t late;                 // renders that took longer than a period
+    double   periodSeconds;        // time budget of one render
+    double   lastRenderSeconds;
+    double   meanRenderSeconds;
+    double   maxRenderSeconds;
+    double   headroom;             // 1 - maxRenderSeconds / periodSeconds, negative when late
+    double   latencySeconds;       // last measured render to speaker delay
+    bool     realtime;             // the thread got its realtime priority
+    bool     locked;               // memory is locked
+    bool     failed;               // the device failed and the thread stopped
+} DriverStats;
+
+typedef struct {
+    Synthesizer  *synth;
+    AudioContext *audio;
+    SynthThread   thread;
+    double        periodSeconds;
+    bool          locked;
+
+    // written by the render thread
+    SynthAtomic running;
+    SynthAtomic failed;
+    SynthAtomic periods;
+    SynthAtomic underruns;
+    SynthAtomic late;
+    SynthAtomic lastNanoseconds;
+    SynthAtomic totalNanoseconds;
+    SynthAtomic maxNanoseconds;
+    SynthAtomic latencyNanoseconds;
+} AudioDriver;
+
+/**
+ * @brief Open a device and start rendering a synth into it from a realtime thread
+ *
+ * @param driver driver to start
+ * @param synth synthesizer to render, attached as synth->audio while the driver runs
+ * @param config device and thread settings, NULL or zeroed fields for the defaults
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_INIT_FAILED
+ */
+SynthError audio_driver_start(
+  AudioDriver *driver, Synthesizer *synth, const DriverConfig *config
+);
+
+/**
+ * @brief Read the render thread's statistics
+ *
+ * @param driver running or stopped driver
+ * @param stats filled with the statistics
+ * @return SYNTH_ACK or SYNTH_ERROR_NULL_PTR
+ */
+SynthError audio_driver_stats( AudioDriver *driver, DriverStats *stats );
+
+/**
+ * @brief Stop the render thread, let the device play out and close it
+ *
+ * @param driver driver to stop
+ */
+void       audio_driver_stop( AudioDriver *driver );
+
+#endif
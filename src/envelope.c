@@ -0,0 +1,167 @@
+#include "envelope.h"
+
+// segment length in samples, at least one so every segment lands on its target
+static inline uint32_t envelope_samples( float seconds, float sampleRate ) {
+    float samples = seconds * sampleRate + 0.5f;
+    if ( !( samples >= 1.0f ) ) return 1;    // also catches NaN
+    if ( samples >= 4294967040.0f ) return ENVELOPE_HOLD - 1;
+    return (uint32_t) samples;
+}
+
+// set up a segment that moves from the current level to target in samples
+static void envelope_segment(
+  VoicePool *pool, uint32_t v, EnvelopeStage stage, float target, uint32_t samples,
+  EnvelopeCurve curve
+) {
+    float level           = pool->envLevel[v];
+    pool->envStage[v]     = (uint8_t) stage;
+    pool->envRemaining[v] = samples;
+    if ( curve == ENVELOPE_CURVE_EXPONENTIAL ) {
+        // the distance to the target shrinks 80 dB over the full segment time
+        float multiplier       = powf( ENVELOPE_SILENCE, 1.0f / (float) samples );
+        pool->envMultiplier[v] = multiplier;
+        pool->envOffset[v]     = target * ( 1.0f - multiplier );
+    } else {
+        pool->envMultiplier[v] = 1.0f;
+        pool->envOffset[v]     = ( target - level ) / (float) samples;
+    }
+}
+
+// hold the current level until something else happens
+static void envelope_hold( VoicePool *pool, uint32_t v, EnvelopeStage stage, float level ) {
+    pool->envStage[v]      = (uint8_t) stage;
+    pool->envLevel[v]      = level;
+    pool->envMultiplier[v] = 1.0f;
+    pool->envOffset[v]     = 0.0f;
+    pool->envRemaining[v]  = ENVELOPE_HOLD;
+}
+
+static void envelope_release( VoicePool *pool, uint32_t v, float sampleRate ) {
+    const Envelope *env   = &pool->voices[v].env;
+    float           level = pool->envLevel[v];
+    if ( level <= ENVELOPE_SILENCE ) {
+        envelope_hold( pool, v, ENVELOPE_IDLE, 0.0f );
+        return;
+    }
+
+    uint32_t samples = envelope_samples( env->release, sampleRate );
+    envelope_segment( pool, v, ENVELOPE_RELEASE, 0.0f, samples, env->curve );
+    if ( env->curve == ENVELOPE_CURVE_EXPONENTIAL ) {
+        // silence comes sooner from below full scale and later from above, end the segment there
+        float fraction        = logf( ENVELOPE_SILENCE / level ) / logf( ENVELOPE_SILENCE );
+        pool->envRemaining[v] = envelope_samples( (float) samples * fraction, 1.0f );
+    }
+}
+
+// land the finished segment on its target and start the next one
+static void envelope_advance( VoicePool *pool, uint32_t v, float sampleRate ) {
+    const Envelope *env     = &pool->voices[v].env;
+    float           peak    = pool->amplitude[v];
+    float           sustain = peak * env->sustain;
+    switch ( (EnvelopeStage) pool->envStage[v] ) {
+        case ENVELOPE_ATTACK:
+            pool->envLevel[v] = peak;
+            envelope_segment(
+              pool, v, ENVELOPE_DECAY, sustain, envelope_samples( env->decay, sampleRate ),
+              env->curve
+            );
+            break;
+        case ENVELOPE_DECAY:
+            // a note that decays to silence is done even while its key is held
+            envelope_hold(
+              pool, v, sustain > ENVELOPE_SILENCE ? ENVELOPE_SUSTAIN : ENVELOPE_IDLE,
+              sustain > ENVELOPE_SILENCE ? sustain : 0.0f
+            );
+            break;
+        case ENVELOPE_RELEASE: envelope_hold( pool, v, ENVELOPE_IDLE, 0.0f ); break;
+        case ENVELOPE_IDLE:
+        case ENVELOPE_SUSTAIN: break;
+    }
+}
+
+SynthError envelope_validate( const Envelope *envelope ) {
+    if ( !envelope ) return SYNTH_ERROR_NULL_PTR;
+    if ( !( envelope->attack >= 0.0f ) || !( envelope->decay >= 0.0f ) ||
+         !( envelope->release >= 0.0f ) || !( envelope->sustain >= 0.0f ) ||
+         envelope->sustain > 1.0f ) {
+        return SYNTH_ERROR_INVALID_PARAM;
+    }
+    if ( envelope->curve != ENVELOPE_CURVE_LINEAR &&
+         envelope->curve != ENVELOPE_CURVE_EXPONENTIAL ) {
+        return SYNTH_ERROR_INVALID_PARAM;
+    }
+    return SYNTH_ACK;
+}
+
+void envelope_note_on( VoicePool *pool, uint32_t voice, float sampleRate ) {
+    const Envelope *env = &pool->voices[voice].env;
+    envelope_segment(
+      pool, voice, ENVELOPE_ATTACK, pool->amplitude[voice],
+      envelope_samples( env->attack, sampleRate ), ENVELOPE_CURVE_LINEAR
+    );
+}
+
+void envelope_note_off( VoicePool *pool, uint32_t voice, float sampleRate ) {
+    if ( pool->envStage[voice] == ENVELOPE_IDLE ) return;
+    envelope_release( pool, voice, sampleRate );
+}
+
+void envelope_fade( VoicePool *pool, uint32_t voice, float sampleRate ) {
+    if ( pool->envStage[voice] == ENVELOPE_IDLE ) return;
+    pool->gate[voice] = 0;
+    envelope_segment(
+      pool, voice, ENVELOPE_RELEASE, 0.0f, envelope_samples( ENVELOPE_FADE, sampleRate ),
+      ENVELOPE_CURVE_LINEAR
+    );
+}
+
+void envelope_render(
+  VoicePool *pool, EnvelopeKernel kernel, const uint32_t *voices, uint32_t count, float *gain,
+  int stride, int length, float sampleRate
+) {
+    float spare[SYNTH_BLOCK_SIZE];    // row of the unused lanes in the last group
+
+    for ( uint32_t base = 0; base < count; base += RENDER_ENVELOPE_LANES ) {
+        uint32_t lanes = count - base < RENDER_ENVELOPE_LANES ? count - base
+                                                              : RENDER_ENVELOPE_LANES;
+        float    level[RENDER_ENVELOPE_LANES];
+        float    multiplier[RENDER_ENVELOPE_LANES];
+        float    offset[RENDER_ENVELOPE_LANES];
+        for ( uint32_t k = 0; k < RENDER_ENVELOPE_LANES; k++ ) {
+            uint32_t v    = k < lanes ? voices[base + k] : VOICE_NONE;
+            level[k]      = v != VOICE_NONE ? pool->envLevel[v] : 0.0f;
+            multiplier[k] = v != VOICE_NONE ? pool->envMultiplier[v] : 1.0f;
+            offset[k]     = v != VOICE_NONE ? pool->envOffset[v] : 0.0f;
+        }
+
+        // run every lane up to the nearest segment end, then switch that lane's segment
+        for ( int position = 0; position < length; ) {
+            uint32_t run = (uint32_t) ( length - position );
+            for ( uint32_t k = 0; k < lanes; k++ ) {
+                uint32_t remaining = pool->envRemaining[voices[base + k]];
+                if ( remaining < run ) run = remaining;
+            }
+
+            float *at[RENDER_ENVELOPE_LANES];
+            for ( uint32_t k = 0; k < RENDER_ENVELOPE_LANES; k++ ) {
+                at[k] = k < lanes ? gain + (size_t) ( base + k ) * stride + position : spare;
+            }
+            kernel( level, multiplier, offset, at, (int) run );
+            position += (int) run;
+
+            for ( uint32_t k = 0; k < lanes; k++ ) {
+                uint32_t v = voices[base + k];
+                if ( pool->envRemaining[v] == ENVELOPE_HOLD ) continue;
+                pool->envRemaining[v] -= run;
+                if ( pool->envRemaining[v] != 0 ) continue;
+
+                envelope_advance( pool, v, sampleRate );
+                level[k]      = pool->envLevel[v];
+                multiplier[k] = pool->envMultiplier[v];
+                offset[k]     = pool->envOffset[v];
+            }
+        }
+
+        for ( uint32_t k = 0; k < lanes; k++ ) pool->envLevel[voices[base + k]] = level[k];
+    }
+}
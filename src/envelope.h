@@ -0,0 +1,97 @@
+/**
+ * @file
+ * @brief block based ADSR envelopes, evaluated for many voices at once
+ *
+ * An envelope is a chain of segments. Each segment is the recurrence
+ * level = level * multiplier + offset, with the multiplier and offset worked out once when the
+ * segment starts: a multiplier of 1 gives a straight line, anything below 1 an exponential
+ * approach to offset / (1 - multiplier). Only segment starts pay for a powf or logf, every sample
+ * in between is one multiply-add, run for RENDER_ENVELOPE_LANES voices at a time by the envelope
+ * kernel of the selected RenderKernels.
+ *
+ * Every segment knows how many samples it lasts. A block is cut at the first segment end inside
+ * it, the ending segment lands exactly on its target, the next one starts on the following sample,
+ * and the rest of the block runs on. A release that reaches silence leaves the voice idle so the
+ * renderer can retire it.
+ */
+
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include "render.h"
+#include "voice.h"
+
+#define ENVELOPE_SILENCE 1e-4f         // -80 dB, a release ends and a voice retires below this
+#define ENVELOPE_HOLD    UINT32_MAX    // remaining samples of a segment that does not end
+#define ENVELOPE_CHUNK   64            // voices the renderer evaluates per envelope_render()
+#define ENVELOPE_FADE    0.005f        // seconds a stolen voice ramps down over
+
+typedef enum {
+    ENVELOPE_IDLE,       // silent, the voice can be retired
+    ENVELOPE_ATTACK,
+    ENVELOPE_DECAY,
+    ENVELOPE_SUSTAIN,    // holds until note off
+    ENVELOPE_RELEASE
+} EnvelopeStage;
+
+/**
+ * @brief Check envelope settings
+ *
+ * @param envelope settings to check
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_INVALID_PARAM
+ */
+SynthError envelope_validate( const Envelope *envelope );
+
+/**
+ * @brief Start the attack of a voice from whatever level it is at, render thread only
+ *
+ * The voice's Voice.env and amplitude must already be set. A stolen voice rises from its current
+ * level instead of jumping to zero.
+ *
+ * @param pool pool the voice belongs to
+ * @param voice voice slot
+ * @param sampleRate sample rate in Hz
+ */
+void       envelope_note_on( VoicePool *pool, uint32_t voice, float sampleRate );
+
+/**
+ * @brief Start the release of a voice from whatever level it is at, render thread only
+ *
+ * @param pool pool the voice belongs to
+ * @param voice voice slot
+ * @param sampleRate sample rate in Hz
+ */
+void       envelope_note_off( VoicePool *pool, uint32_t voice, float sampleRate );
+
+/**
+ * @brief Ramp a stolen voice straight down to silence over ENVELOPE_FADE, render thread only
+ *
+ * Long enough not to click, short enough to free the voice's slot for the next steal soon.
+ *
+ * @param pool pool the voice belongs to
+ * @param voice voice slot
+ * @param sampleRate sample rate in Hz
+ */
+void       envelope_fade( VoicePool *pool, uint32_t voice, float sampleRate );
+
+/**
+ * @brief Render the gains of a list of voices for one span, render thread only
+ *
+ * Voices whose release reaches silence inside the span are left in ENVELOPE_IDLE, their row
+ * holds the tail of the release followed by zeros.
+ *
+ * @param pool pool the voices belong to
+ * @param kernel envelope kernel from the selected RenderKernels
+ * @param voices voice slots, count entries
+ * @param count number of voices
+ * @param gain destination, row k of voice k starts at gain + k * stride
+ * @param stride distance between rows in floats, at least length
+ * @param length number of samples, at most SYNTH_BLOCK_SIZE
+ * @param sampleRate sample rate in Hz
+ */
+void       envelope_render(
+  VoicePool *pool, EnvelopeKernel kernel, const uint32_t *voices, uint32_t count, float *gain,
+  int stride, int length, float sampleRate
+);
+
+#endif
@@ -0,0 +1,53 @@
+#include "fft.h"
+
+#include <math.h>
+
+void fft_complex( float *re, float *im, int length, bool inverse ) {
+    // bit reversal permutation
+    for ( int i = 1, j = 0; i < length; i++ ) {
+        int bit = length >> 1;
+        for ( ; j & bit; bit >>= 1 ) j ^= bit;
+        j ^= bit;
+        if ( i < j ) {
+            float tr = re[i];
+            float ti = im[i];
+            re[i]    = re[j];
+            im[i]    = im[j];
+            re[j]    = tr;
+            im[j]    = ti;
+        }
+    }
+
+    // butterflies, twiddles computed in double to keep large transforms accurate
+    for ( int size = 2; size <= length; size <<= 1 ) {
+        double angle = ( inverse ? 2.0 : -2.0 ) * 3.14159265358979323846 / size;
+        double wr    = cos( angle );
+        double wi    = sin( angle );
+        for ( int start = 0; start < length; start += size ) {
+            double cr = 1.0;
+            double ci = 0.0;
+            for ( int k = 0; k < size / 2; k++ ) {
+                int   a   = start + k;
+                int   b   = a + size / 2;
+                float br  = (float) ( re[b] * cr - im[b] * ci );
+                float bi  = (float) ( re[b] * ci + im[b] * cr );
+                re[b]     = re[a] - br;
+                im[b]     = im[a] - bi;
+                re[a]    += br;
+                im[a]    += bi;
+
+                double nr = cr * wr - ci * wi;
+                ci        = cr * wi + ci * wr;
+                cr        = nr;
+            }
+        }
+    }
+
+    if ( inverse ) {
+        float scale = 1.0f / (float) length;
+        for ( int i = 0; i < length; i++ ) {
+            re[i] *= scale;
+            im[i] *= scale;
+        }
+    }
+}
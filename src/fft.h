@@ -0,0 +1,24 @@
+/**
+ * @file
+ * @brief small radix-2 fft used for offline spectral work (table building, analysis)
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+#include <stdbool.h>
+
+/**
+ * @brief In-place complex radix-2 FFT
+ *
+ * Not realtime safe in the sense of being cheap; intended for table construction and analysis.
+ * The inverse transform is scaled by 1/length so forward followed by inverse is the identity.
+ *
+ * @param re real parts, length entries
+ * @param im imaginary parts, length entries
+ * @param length transform size, must be a power of two
+ * @param inverse true for the inverse transform
+ */
+void fft_complex( float *re, float *im, int length, bool inverse );
+
+#endif
@@ -0,0 +1,592 @@
+#include "midi.h"
+
+#include "tuning.h"
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#define MIDI_HEADER_BYTES 14    // "MThd", length, format, tracks, division
+#define MIDI_CHUNK_BYTES  8     // chunk id and length
+
+static inline uint32_t midi_u32( const uint8_t *p ) {
+    return (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 8 | p[3];
+}
+
+static inline uint16_t midi_u16( const uint8_t *p ) { return (uint16_t) ( p[0] << 8 | p[1] ); }
+
+// variable length quantity of at most four bytes, false if it runs past end
+static inline bool midi_vlq( const uint8_t **cursor, const uint8_t *end, uint32_t *value ) {
+    const uint8_t *p = *cursor;
+    uint32_t       v = 0;
+    for ( int i = 0; i < 4; i++ ) {
+        if ( p >= end ) return false;
+        uint8_t byte = *p++;
+        v            = v << 7 | ( byte & 0x7F );
+        if ( !( byte & 0x80 ) ) {
+            *cursor = p;
+            *value  = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**************
+ * TRACK HEAP *
+ *************/
+static inline bool midi_before( const MidiFile *file, uint16_t a, uint16_t b ) {
+    uint64_t ta = file->tracks[a].tick, tb = file->tracks[b].tick;
+    return ta < tb || ( ta == tb && a < b );
+}
+
+static void midi_sift_down( MidiFile *file, uint32_t i ) {
+    uint16_t *heap = file->heap;
+    for ( ;; ) {
+        uint32_t least = i, left = 2 * i + 1, right = left + 1, size = file->heapSize;
+        if ( left < size && midi_before( file, heap[left], heap[least] ) ) least = left;
+        if ( right < size && midi_before( file, heap[right], heap[least] ) ) least = right;
+        if ( least == i ) return;
+        uint16_t swap = heap[i];
+        heap[i]       = heap[least];
+        heap[least]   = swap;
+        i             = least;
+    }
+}
+
+// read the delta time in front of a track's next event, false when the track is over
+static bool midi_track_advance( MidiFile *file, MidiTrack *track ) {
+    uint32_t delta;
+    if ( track->cursor >= track->end ) return false;
+    if ( !midi_vlq( &track->cursor, track->end, &delta ) ) {
+        file->errors++;
+        return false;
+    }
+    track->tick += delta;
+    return true;
+}
+
+/***********
+ * READING *
+ **********/
+// decode the event at a track's cursor and move past it, false if it runs past the chunk
+static bool midi_track_decode( MidiTrack *track, MidiEvent *event ) {
+    const uint8_t *p   = track->cursor;
+    const uint8_t *end = track->end;
+    if ( p >= end ) return false;
+
+    uint8_t status = *p;
+    if ( status & 0x80 ) {
+        p++;
+    } else if ( track->running ) {
+        status = track->running;    // running status, p is already at the first data byte
+    } else {
+        return false;
+    }
+    event->status  = status;
+    event->length  = 0;
+    event->payload = NULL;
+
+    if ( status < MIDI_SYSEX ) {
+        // program change and channel pressure carry one data byte, the rest two
+        uint32_t bytes = ( status & 0xE0 ) == 0xC0 ? 1 : 2;
+        if ( (size_t) ( end - p ) < bytes ) return false;
+        event->data[0]  = p[0] & 0x7F;
+        event->data[1]  = bytes == 2 ? p[1] & 0x7F : 0;
+        track->running  = status;
+        track->cursor   = p + bytes;
+        return true;
+    }
+
+    // SysEx and meta events cancel running status and carry a length prefixed payload
+    track->running = 0;
+    if ( status == MIDI_META ) {
+        if ( p >= end ) return false;
+        event->data[0] = *p++;
+    } else if ( status != MIDI_SYSEX && status != MIDI_SYSEX_ESCAPE ) {
+        return false;    // realtime and system common bytes do not belong in a file
+    }
+    uint32_t length;
+    if ( !midi_vlq( &p, end, &length ) || (size_t) ( end - p ) < length ) return false;
+    event->length  = length;
+    event->payload = p;
+    track->cursor  = p + length;
+    return true;
+}
+
+void midi_file_rewind( MidiFile *file ) {
+    size_t         header = MIDI_CHUNK_BYTES + (size_t) midi_u32( file->data + 4 );
+    const uint8_t *p      = file->data + ( header < file->size ? header : file->size );
+    const uint8_t *end    = file->data + file->size;
+    uint16_t       t      = 0;
+    file->heapSize        = 0;
+
+    // chunks are walked again rather than remembered, the header sizes them all
+    while ( t < file->numTracks && (size_t) ( end - p ) >= MIDI_CHUNK_BYTES ) {
+        uint32_t length = midi_u32( p + 4 );
+        bool     track  = memcmp( p, "MTrk", 4 ) == 0;
+        p              += MIDI_CHUNK_BYTES;
+        if ( length > (size_t) ( end - p ) ) length = (uint32_t) ( end - p );
+        if ( track ) {
+            MidiTrack *cursor = &file->tracks[t];
+            cursor->cursor    = p;
+            cursor->end       = p + length;
+            cursor->tick      = 0;
+            cursor->running   = 0;
+            if ( midi_track_advance( file, cursor ) ) file->heap[file->heapSize++] = t;
+            t++;
+        }
+        p += length;
+    }
+    for ( uint32_t i = file->heapSize / 2; i-- > 0; ) midi_sift_down( file, i );
+}
+
+// read the header and set up the cursors, the mapping fields are left to the caller
+static SynthError midi_file_index( MidiFile *file, const uint8_t *data, size_t size ) {
+    file->data = data;
+    file->size = size;
+
+    if ( size < MIDI_HEADER_BYTES || memcmp( data, "MThd", 4 ) != 0 || midi_u32( data + 4 ) < 6 ) {
+        return SYNTH_ERROR_INVALID_PARAM;
+    }
+    file->format    = midi_u16( data + 8 );
+    file->numTracks = midi_u16( data + 10 );
+    file->division  = midi_u16( data + 12 );
+    if ( file->format > 1 || file->numTracks == 0 || file->division == 0 ) {
+        return SYNTH_ERROR_INVALID_PARAM;
+    }
+
+    // the cursors and the heap are the only allocation, reading never allocates
+    file->tracks = (MidiTrack *) malloc(
+      ( sizeof( MidiTrack ) + sizeof( uint16_t ) ) * file->numTracks
+    );
+    if ( !file->tracks ) return SYNTH_ERROR_OOM;
+    file->heap = (uint16_t *) ( file->tracks + file->numTracks );
+    midi_file_rewind( file );
+    return SYNTH_ACK;
+}
+
+SynthError midi_file_load( MidiFile *file, const uint8_t *data, size_t size ) {
+    if ( !file || !data ) return SYNTH_ERROR_NULL_PTR;
+    memset( file, 0, sizeof( *file ) );
+    return midi_file_index( file, data, size );
+}
+
+SynthError midi_file_open( MidiFile *file, const char *path ) {
+    if ( !file || !path ) return SYNTH_ERROR_NULL_PTR;
+    memset( file, 0, sizeof( *file ) );
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(
+      path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL
+    );
+    if ( handle == INVALID_HANDLE_VALUE ) return SYNTH_ERROR_IO;
+    LARGE_INTEGER size;
+    if ( !GetFileSizeEx( handle, &size ) ) size.QuadPart = -1;
+    if ( size.QuadPart <= 0 ) {
+        CloseHandle( handle );
+        return size.QuadPart == 0 ? SYNTH_ERROR_INVALID_PARAM : SYNTH_ERROR_IO;
+    }
+    file->mapping = CreateFileMappingA( handle, NULL, PAGE_READONLY, 0, 0, NULL );
+    CloseHandle( handle );
+    if ( !file->mapping ) return SYNTH_ERROR_IO;
+    const uint8_t *data = (const uint8_t *) MapViewOfFile( file->mapping, FILE_MAP_READ, 0, 0, 0 );
+    if ( !data ) {
+        CloseHandle( file->mapping );
+        return SYNTH_ERROR_IO;
+    }
+    size_t bytes = (size_t) size.QuadPart;
+#else
+    int fd = open( path, O_RDONLY );
+    if ( fd < 0 ) return SYNTH_ERROR_IO;
+    struct stat info;
+    if ( fstat( fd, &info ) != 0 ) info.st_size = -1;
+    if ( info.st_size <= 0 ) {
+        close( fd );
+        return info.st_size == 0 ? SYNTH_ERROR_INVALID_PARAM : SYNTH_ERROR_IO;
+    }
+    size_t bytes = (size_t) info.st_size;
+    void  *data  = mmap( NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if ( data == MAP_FAILED ) return SYNTH_ERROR_IO;
+    madvise( data, bytes, MADV_SEQUENTIAL );    // read once front to back, per track
+#endif
+
+    file->mapped   = true;
+    SynthError err = midi_file_index( file, (const uint8_t *) data, bytes );
+    if ( err != SYNTH_ACK ) midi_file_close( file );
+    return err;
+}
+
+void midi_file_close( MidiFile *file ) {
+    if ( !file ) return;
+    if ( file->mapped && file->data ) {
+#ifdef _WIN32
+        UnmapViewOfFile( file->data );
+        CloseHandle( file->mapping );
+#else
+        munmap( (void *) file->data, file->size );
+#endif
+    }
+    free( file->tracks );
+    memset( file, 0, sizeof( *file ) );
+}
+
+bool midi_file_next( MidiFile *file, MidiEvent *event ) {
+    while ( file->heapSize > 0 ) {
+        uint16_t   t     = file->heap[0];
+        MidiTrack *track = &file->tracks[t];
+        event->tick      = track->tick;
+        event->track     = t;
+        bool       valid = midi_track_decode( track, event );
+        bool       end   = !valid || ( event->status == MIDI_META &&
+                                   event->data[0] == MIDI_META_END_OF_TRACK );
+        if ( !valid ) file->errors++;
+
+        // the track takes its place in the heap again at its next event's tick
+        if ( end || !midi_track_advance( file, track ) ) {
+            file->heap[0] = file->heap[--file->heapSize];
+        }
+        midi_sift_down( file, 0 );
+        if ( valid ) return true;
+    }
+    return false;
+}
+
+/************
+ * CHANNELS *
+ ***********/
+void midi_channels_init( MidiChannels *channels, Synthesizer *synth ) {
+    memset( channels, 0, sizeof( *channels ) );
+    channels->synth = synth;
+    for ( int c = 0; c < MIDI_CHANNELS; c++ ) {
+        channels->volume[c] = 100;    // the General MIDI power-on volume
+        for ( int k = 0; k < MIDI_KEYS; k++ ) channels->notes[c][k] = MIDI_NO_NOTE;
+    }
+}
+
+// the frame a command asked for at time can be queued at without breaking the queue's time order
+static uint64_t midi_channels_time( const MidiChannels *channels, uint64_t time ) {
+    if ( time == SYNTH_TIME_NOW ) time = synth_frame_time( channels->synth );
+    return time > channels->latest ? time : channels->latest;
+}
+
+// release a channel's key if it sounds, false if the command queue is full
+static bool midi_note_off( MidiChannels *channels, uint64_t time, int channel, int key ) {
+    int note = channels->notes[channel][key];
+    if ( note == MIDI_NO_NOTE ) return true;
+    if ( synth_release_note_at( channels->synth, time, note ) != SYNTH_ACK ) return false;
+    channels->notes[channel][key] = MIDI_NO_NOTE;
+    channels->commands++;
+    return true;
+}
+
+static bool midi_channel_off( MidiChannels *channels, uint64_t time, int channel ) {
+    for ( int k = 0; k < MIDI_KEYS; k++ ) {
+        if ( !midi_note_off( channels, time, channel, k ) ) return false;
+    }
+    return true;
+}
+
+static bool midi_note_on(
+  MidiChannels *channels, uint64_t time, int channel, int key, int velocity
+) {
+    Synthesizer *synth = channels->synth;
+
+    // a key struck again while it sounds is released first, like a piano
+    if ( !midi_note_off( channels, time, channel, key ) ) return false;
+    float amplitude = MIDI_NOTE_GAIN * (float) velocity / 127.0f *
+                      (float) channels->volume[channel] / 127.0f;
+    int   note;
+    if ( key >= MIDI_KEY_A0 ) {
+        note = synth_trigger_pitch_at( synth, time, (float) ( key - MIDI_KEY_A0 ), amplitude );
+    } else {
+        // below the tuning table, so by frequency
+        float semitones = (float) ( key - MIDI_KEY_A0 - BASE_INDICE );
+        note            = synth_trigger_note_at(
+          synth, time, BASE_TUNING * tuning_ratio( semitones ), amplitude
+        );
+    }
+    if ( note < 0 ) return false;
+    channels->notes[channel][key] = note;
+    channels->commands++;
+
+    // the wheel is already off centre, the note starts bent
+    float bend = channels->bend[channel];
+    if ( bend != 0.0f && synth_bend_note_at( synth, time, note, bend ) == SYNTH_ACK ) {
+        channels->commands++;
+    }
+    return true;
+}
+
+bool midi_channels_send(
+  MidiChannels *channels, uint64_t time, uint8_t status, uint8_t data0, uint8_t data1
+) {
+    int channel = status & 0x0F;
+
+    // now is on time unless these channels still have commands waiting for a later frame
+    if ( time == SYNTH_TIME_NOW && channels->latest > synth_frame_time( channels->synth ) ) {
+        time = channels->latest;
+    }
+    channels->latest = time > channels->latest ? time : channels->latest;
+
+    switch ( status & 0xF0 ) {
+        case MIDI_NOTE_ON:
+            if ( data1 > 0 ) return midi_note_on( channels, time, channel, data0, data1 );
+            return midi_note_off( channels, time, channel, data0 );
+        case MIDI_NOTE_OFF: return midi_note_off( channels, time, channel, data0 );
+        case MIDI_CONTROL_CHANGE:
+            if ( data0 == MIDI_CC_VOLUME ) channels->volume[channel] = data1;
+            if ( data0 == MIDI_CC_ALL_SOUND_OFF || data0 == MIDI_CC_ALL_NOTES_OFF ) {
+                return midi_channel_off( channels, time, channel );
+            }
+            return true;
+        case MIDI_PITCH_BEND: {
+            int   wheel = data0 | data1 << 7;
+            float bend  = (float) ( wheel - 8192 ) / 8192.0f * MIDI_BEND_RANGE;
+            channels->bend[channel] = bend;
+            for ( int k = 0; k < MIDI_KEYS; k++ ) {
+                int note = channels->notes[channel][k];
+                if ( note == MIDI_NO_NOTE ) continue;
+                // a bend lost to a full queue is not retried, the next one supersedes it
+                if ( synth_bend_note_at( channels->synth, time, note, bend ) == SYNTH_ACK ) {
+                    channels->commands++;
+                }
+            }
+            return true;
+        }
+        default: return true;
+    }
+}
+
+void midi_channels_release( MidiChannels *channels, uint64_t time ) {
+    time             = midi_channels_time( channels, time );
+    channels->latest = time;
+    for ( int c = 0; c < MIDI_CHANNELS; c++ ) midi_channel_off( channels, time, c );
+}
+
+/*************
+ * SEQUENCER *
+ ************/
+// seconds per tick at a tempo, SMPTE division ignores the tempo
+static double midi_seconds_per_tick( const MidiFile *file, uint32_t tempo ) {
+    if ( file->division & 0x8000 ) {
+        int fps = -(int8_t) ( file->division >> 8 );    // 24, 25, 29 (for 29.97) or 30
+        return 1.0 / ( ( fps == 29 ? 29.97 : (double) fps ) * ( file->division & 0xFF ) );
+    }
+    return (double) tempo * 1e-6 / (double) file->division;
+}
+
+static inline uint64_t midi_frame( const MidiSequencer *sequencer, uint64_t tick ) {
+    double frame = sequencer->tempoFrame +
+                   (double) ( tick - sequencer->tempoTick ) * sequencer->framesPerTick;
+    return sequencer->start + (uint64_t) llround( frame );
+}
+
+SynthError midi_sequencer_init(
+  MidiSequencer *sequencer, MidiFile *file, Synthesizer *synth, uint64_t start
+) {
+    if ( !sequencer || !file || !synth ) return SYNTH_ERROR_NULL_PTR;
+    if ( ( file->division & 0x8000 ) && ( file->division & 0xFF ) == 0 ) {
+        return SYNTH_ERROR_INVALID_PARAM;
+    }
+    memset( sequencer, 0, sizeof( *sequencer ) );
+    midi_channels_init( &sequencer->channels, synth );
+    sequencer->file          = file;
+    sequencer->start         = start;
+    sequencer->framesPerTick = midi_seconds_per_tick( file, MIDI_TEMPO ) * synth->sampleRate;
+    return SYNTH_ACK;
+}
+
+// restart the tick to frame mapping at a tempo change
+static void midi_tempo( MidiSequencer *sequencer, const MidiEvent *event ) {
+    const uint8_t *p         = event->payload;
+    uint32_t       tempo     = (uint32_t) p[0] << 16 | (uint32_t) p[1] << 8 | p[2];
+    double         ticks     = (double) ( event->tick - sequencer->tempoTick );
+    sequencer->tempoFrame   += ticks * sequencer->framesPerTick;
+    sequencer->tempoTick     = event->tick;
+    sequencer->framesPerTick = midi_seconds_per_tick( sequencer->file, tempo ) *
+                               sequencer->channels.synth->sampleRate;
+}
+
+uint32_t midi_sequencer_schedule( MidiSequencer *sequencer, uint64_t until ) {
+    if ( !sequencer || sequencer->finished ) return 0;
+    uint64_t before = sequencer->channels.commands;
+    for ( ;; ) {
+        if ( !sequencer->hasPending ) {
+            if ( !midi_file_next( sequencer->file, &sequencer->pending ) ) {
+                sequencer->finished = true;
+                break;
+            }
+            sequencer->hasPending = true;
+            sequencer->events++;
+        }
+        const MidiEvent *event = &sequencer->pending;
+        uint64_t         time  = midi_frame( sequencer, event->tick );
+        if ( time >= until ) break;
+        if ( event->status < MIDI_SYSEX ) {
+            bool sent = midi_channels_send(
+              &sequencer->channels, time, event->status, event->data[0], event->data[1]
+            );
+            if ( !sent ) break;    // queue is full
+        } else if ( event->status == MIDI_META && event->data[0] == MIDI_META_TEMPO &&
+                    event->length == 3 ) {
+            midi_tempo( sequencer, event );
+        }
+        sequencer->hasPending = false;
+    }
+    return (uint32_t) ( sequencer->channels.commands - before );
+}
+
+void midi_sequencer_stop( MidiSequencer *sequencer, uint64_t time ) {
+    if ( sequencer ) midi_channels_release( &sequencer->channels, time );
+}
+
+/***************
+ * BYTE STREAM *
+ **************/
+void midi_decoder_init( MidiDecoder *decoder ) { memset( decoder, 0, sizeof( *decoder ) ); }
+
+// data bytes of each system common status, -1 for the undefined F4 and F5 and a stray F7
+static const int8_t midi_common_bytes[8] = { 0, 1, 2, 1, -1, -1, 0, -1 };
+
+static inline MidiMessage *midi_message( MidiMessage *message, uint8_t status ) {
+    memset( message, 0, sizeof( *message ) );
+    message->status = status;
+    return message;
+}
+
+// the SysEx bytes seen since piece as one message
+static void midi_sysex_piece(
+  MidiDecoder *decoder, MidiMessage *message, const uint8_t *piece, size_t length, uint8_t last
+) {
+    midi_message( message, MIDI_SYSEX );
+    message->sysex   = ( decoder->first ? MIDI_SYSEX_FIRST : 0 ) | last;
+    message->length  = (uint32_t) length;
+    message->payload = piece;
+    decoder->first   = false;
+    if ( last ) decoder->sysex = false;
+}
+
+uint32_t midi_decode(
+  MidiDecoder *decoder, const uint8_t *bytes, size_t count, size_t *consumed,
+  MidiMessage *messages, uint32_t capacity
+) {
+    uint32_t n     = 0;
+    size_t   i     = 0;
+    size_t   piece = 0;    // start of the SysEx bytes not yet passed on
+
+    while ( i < count && n < capacity ) {
+        uint8_t byte = bytes[i];
+
+        // the common case: a whole two byte channel message under running status
+        if ( decoder->status < MIDI_SYSEX && decoder->need == 2 && decoder->have == 0 &&
+             i + 1 < count && ( ( byte | bytes[i + 1] ) & 0x80 ) == 0 ) {
+            MidiMessage *message = midi_message( &messages[n++], decoder->status );
+            message->data[0]     = byte;
+            message->data[1]     = bytes[i + 1];
+            i                   += 2;
+            continue;
+        }
+
+        if ( byte >= MIDI_CLOCK ) {
+            // realtime bytes go out at once and leave everything else as it was
+            if ( decoder->sysex && piece < i ) {
+                midi_sysex_piece( decoder, &messages[n++], bytes + piece, i - piece, 0 );
+                piece = i;
+                continue;
+            }
+            if ( byte == 0xF9 || byte == 0xFD ) {
+                decoder->dropped++;
+            } else {
+                midi_message( &messages[n++], byte );
+            }
+            piece = ++i;
+            continue;
+        }
+
+        if ( decoder->sysex ) {
+            if ( byte < 0x80 ) {
+                while ( ++i < count && bytes[i] < 0x80 ) {}    // payload runs to the next status
+            } else {
+                // F7 ends the message, any other status cuts it short and is decoded next
+                uint8_t last = byte == MIDI_SYSEX_ESCAPE ? MIDI_SYSEX_LAST
+                                                         : MIDI_SYSEX_LAST | MIDI_SYSEX_CUT;
+                midi_sysex_piece( decoder, &messages[n++], bytes + piece, i - piece, last );
+                if ( byte == MIDI_SYSEX_ESCAPE ) i++;
+            }
+            continue;
+        }
+
+        i++;
+        if ( byte < 0x80 ) {
+            if ( !decoder->status ) {
+                decoder->dropped++;
+                continue;
+            }
+            decoder->data[decoder->have++] = byte;
+            if ( decoder->have < decoder->need ) continue;
+            MidiMessage *message = midi_message( &messages[n++], decoder->status );
+            message->data[0]     = decoder->data[0];
+            message->data[1]     = decoder->need == 2 ? decoder->data[1] : 0;
+            decoder->have        = 0;
+            if ( decoder->status >= MIDI_SYSEX ) {
+                decoder->status = 0;    // system common messages leave no running status
+                decoder->need   = 0;
+            }
+        } else if ( byte < MIDI_SYSEX ) {
+            decoder->status = byte;
+            decoder->need   = ( byte & 0xE0 ) == MIDI_PROGRAM_CHANGE ? 1 : 2;
+            decoder->have   = 0;
+        } else if ( byte == MIDI_SYSEX ) {
+            decoder->status = 0;
+            decoder->need   = 0;
+            decoder->have   = 0;
+            decoder->sysex  = true;
+            decoder->first  = true;
+            piece           = i;
+        } else {
+            // system common messages cancel running status, a stray F7 is dropped with them
+            int length      = midi_common_bytes[byte & 0x07];
+            decoder->status = 0;
+            decoder->need   = 0;
+            decoder->have   = 0;
+            if ( length < 0 ) {
+                decoder->dropped++;
+            } else if ( length == 0 ) {
+                midi_message( &messages[n++], byte );
+            } else {
+                decoder->status = byte;
+                decoder->need   = (uint8_t) length;
+            }
+        }
+    }
+
+    // the rest of a SysEx goes out as a piece, or is left for the next call if there is no room
+    if ( decoder->sysex && piece < i ) {
+        if ( n < capacity ) {
+            midi_sysex_piece( decoder, &messages[n++], bytes + piece, i - piece, 0 );
+        } else {
+            i = piece;
+        }
+    }
+    *consumed = i;
+    return n;
+}
+
+uint32_t midi_channels_dispatch(
+  MidiChannels *channels, const MidiMessage *messages, uint32_t count
+) {
+    for ( uint32_t i = 0; i < count; i++ ) {
+        const MidiMessage *message = &messages[i];
+        if ( message->status >= MIDI_SYSEX ) continue;
+        bool sent = midi_channels_send(
+          channels, SYNTH_TIME_NOW, message->status, message->data[0], message->data[1]
+        );
+        if ( !sent ) return i;
+    }
+    return count;
+}
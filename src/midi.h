@@ -1,37 +1,352 @@
-// macro to force values to be within a valid range
-#define CLAMP( value, minVal, maxVal ) \
-    ( ( value ) < ( minVal ) ? ( minVal ) : ( ( value ) > ( maxVal ) ? ( maxVal ) : ( value ) #define MAX_VOICES 64
+/**
+ * @file
+ * @brief Standard MIDI File reader and a sequencer that schedules it into the synth
+ *
+ * A MidiFile memory-maps a type 0 or type 1 SMF and never copies it: events are decoded in place
+ * and SysEx and meta payloads point into the mapping. Tracks are merged into one stream in tick
+ * order by a binary min-heap of track cursors keyed by (tick, track), so events on the same tick
+ * keep the track order of the file. Opening allocates the cursors and the heap once, reading the
+ * events allocates nothing. A damaged track ends at the first event that runs past its chunk.
+ *
+ * A MidiSequencer walks that stream on the control thread and turns it into timestamped synth
+ * commands. Ticks are converted to sample frames through the tempo map as it goes by, so every
+ * note lands on its exact frame. Each call schedules everything up to a given frame, which lets
+ * the caller keep a render-ahead window of commands queued in front of the render thread. When
+ * the command queue is full the event waits for the next call.
+ *
+ * A MidiDecoder turns the raw bytes of a MIDI port into the same channel messages. It decodes a
+ * whole run of bytes per call into an array of messages, which MidiChannels plays as a batch.
+ */
+
+#ifndef MIDI_H
+#define MIDI_H
+
+#include "music.h"
+#include "synth.h"
+
+#define MIDI_CHANNELS   16
+#define MIDI_KEYS       128
+#define MIDI_KEY_A0     21        // key number of note index NOTA_MIN
+#define MIDI_TEMPO      500000    // microseconds per quarter note until a tempo event, 120 bpm
+#define MIDI_BEND_RANGE 2.0f      // semitones of a full pitch wheel
+#define MIDI_NOTE_GAIN  0.25f     // amplitude of a note at full velocity and volume
+#define MIDI_NO_NOTE    ( -1 )
+
+// status bytes, channel messages carry the channel in the low nibble
+typedef enum {
+    MIDI_NOTE_OFF         = 0x80,
+    MIDI_NOTE_ON          = 0x90,
+    MIDI_POLY_PRESSURE    = 0xA0,
+    MIDI_CONTROL_CHANGE   = 0xB0,
+    MIDI_PROGRAM_CHANGE   = 0xC0,
+    MIDI_CHANNEL_PRESSURE = 0xD0,
+    MIDI_PITCH_BEND       = 0xE0,
+    MIDI_SYSEX            = 0xF0,
+    MIDI_TIME_CODE        = 0xF1,
+    MIDI_SONG_POSITION    = 0xF2,
+    MIDI_SONG_SELECT      = 0xF3,
+    MIDI_TUNE_REQUEST     = 0xF6,
+    MIDI_SYSEX_ESCAPE     = 0xF7,    // end of SysEx on the wire
+    MIDI_CLOCK            = 0xF8,    // first of the realtime bytes
+    MIDI_META             = 0xFF     // system reset on the wire
+} MidiStatus;
+
+// meta event types the sequencer reads
+typedef enum {
+    MIDI_META_END_OF_TRACK = 0x2F,
+    MIDI_META_TEMPO        = 0x51
+} MidiMetaType;
+
+// controllers the sequencer reads
+typedef enum {
+    MIDI_CC_VOLUME        = 7,
+    MIDI_CC_ALL_SOUND_OFF = 120,
+    MIDI_CC_ALL_NOTES_OFF = 123
+} MidiController;
+
+// one decoded event, valid while its file is open
+typedef struct {
+    uint64_t       tick;       // absolute time in ticks
+    uint16_t       track;      // chunk the event came from
+    uint8_t        status;     // with running status resolved
+    uint8_t        data[2];    // channel message data bytes, the meta type in data[0]
+    uint32_t       length;     // bytes of payload, SysEx and meta events only
+    const uint8_t *payload;    // points into the mapped file
+} MidiEvent;
+
+// read position in one track chunk
+typedef struct {
+    const uint8_t *cursor;     // status or data of the next event, past its delta time
+    const uint8_t *end;        // end of the chunk
+    uint64_t       tick;       // time of the next event
+    uint8_t        running;    // running status
+} MidiTrack;
+
+typedef struct {
+    const uint8_t *data;    // whole file
+    size_t         size;
+    bool           mapped;    // data is a mapping owned by the file
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+    uint16_t   format;       // 0 or 1
+    uint16_t   numTracks;
+    uint16_t   division;     // ticks per quarter, or SMPTE frames and ticks per frame
+    MidiTrack *tracks;
+    uint16_t  *heap;         // tracks with events left, ordered by (tick, track)
+    uint32_t   heapSize;
+    uint64_t   errors;       // tracks cut short by a damaged event
+} MidiFile;
+
+// what a synth is playing on behalf of the 16 channels of one MIDI source
+typedef struct {
+    Synthesizer *synth;
+    int          notes[MIDI_CHANNELS][MIDI_KEYS];    // sounding note handle, or MIDI_NO_NOTE
+    float        bend[MIDI_CHANNELS];                // semitones
+    uint8_t      volume[MIDI_CHANNELS];              // controller 7
+    uint64_t     commands;                           // commands queued
+    uint64_t     latest;                             // frame of the latest command queued
+} MidiChannels;
+
+// state of a file being scheduled into a synth
+typedef struct {
+    MidiFile    *file;
+    MidiChannels channels;
+    uint64_t     start;            // synth frame of tick 0
+    double       framesPerTick;    // at the current tempo
+    uint64_t     tempoTick;        // tick the current tempo began at
+    double       tempoFrame;       // frame the current tempo began at
+    MidiEvent    pending;          // next event, not yet scheduled
+    bool         hasPending;
+    bool         finished;         // every event has been scheduled
+    uint64_t     events;           // events read from the file
+} MidiSequencer;
+
+/**
+ * @brief Map a file and index its track chunks, not realtime safe
+ *
+ * @param file file to open
+ * @param path path of a type 0 or type 1 Standard MIDI File
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR, SYNTH_ERROR_IO, SYNTH_ERROR_INVALID_PARAM if it is not
+ * an SMF, or SYNTH_ERROR_OOM
+ */
+SynthError midi_file_open( MidiFile *file, const char *path );
+
+/**
+ * @brief Index a file already in memory, which must outlive the MidiFile, not realtime safe
+ *
+ * @param file file to open
+ * @param data bytes of the file
+ * @param size size of data
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR, SYNTH_ERROR_INVALID_PARAM or SYNTH_ERROR_OOM
+ */
+SynthError midi_file_load( MidiFile *file, const uint8_t *data, size_t size );
+
+/**
+ * @brief Unmap a file and free its cursors
+ *
+ * @param file file to close, may be NULL
+ */
+void       midi_file_close( MidiFile *file );
+
+/**
+ * @brief Go back to the first event of every track
+ *
+ * @param file open file
+ */
+void       midi_file_rewind( MidiFile *file );
+
+/**
+ * @brief Read the next event of the merged stream
+ *
+ * @param file open file
+ * @param event filled with the event
+ * @return false once every track has ended
+ */
+bool       midi_file_next( MidiFile *file, MidiEvent *event );
+
+/**
+ * @brief Start scheduling a file from its first event, not realtime safe
+ *
+ * @param sequencer sequencer to set up
+ * @param file open file, rewound
+ * @param synth synthesizer the commands go to
+ * @param start synth frame tick 0 plays at
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_INVALID_PARAM for SMPTE time of zero
+ */
+SynthError midi_sequencer_init(
+  MidiSequencer *sequencer, MidiFile *file, Synthesizer *synth, uint64_t start
+);
+
+/**
+ * @brief Queue every event due before a frame, control thread only
+ *
+ * Keeping `until` a render-ahead window past synth_frame_time() keeps the render thread fed.
+ * Allocates nothing.
+ *
+ * @param sequencer running sequencer
+ * @param until first synth frame not to schedule yet
+ * @return commands queued
+ */
+uint32_t   midi_sequencer_schedule( MidiSequencer *sequencer, uint64_t until );
+
+/**
+ * @brief Release every sounding note at a frame, control thread only
+ *
+ * The releases go in behind everything already scheduled, so SYNTH_TIME_NOW means the current
+ * synth frame or the last frame scheduled, whichever is later, as does any earlier frame: a stop
+ * takes effect once the render thread has played the window queued so far.
+ *
+ * @param sequencer running sequencer
+ * @param time synth frame of the release, or SYNTH_TIME_NOW
+ */
+void       midi_sequencer_stop( MidiSequencer *sequencer, uint64_t time );
+
+/**
+ * @brief Start from silence on every channel
+ *
+ * @param channels channels to set up
+ * @param synth synthesizer the commands go to
+ */
+void       midi_channels_init( MidiChannels *channels, Synthesizer *synth );
+
+/**
+ * @brief Play one channel message, control thread only
+ *
+ * Note on, note off, pitch bend, volume and the all notes off controllers are played, other
+ * messages are ignored. A message cut short by a full queue can be sent again.
+ *
+ * SYNTH_TIME_NOW plays at the start of the next block, unless these channels have queued commands
+ * for a later frame, then it plays at the latest of those so the message cannot overtake them.
+ *
+ * @param channels channel state
+ * @param time synth frame of the message, or SYNTH_TIME_NOW
+ * @param status status byte, channel in the low nibble
+ * @param data0 first data byte
+ * @param data1 second data byte, 0 for one byte messages
+ * @return false if the command queue filled up
+ */
+bool       midi_channels_send(
+  MidiChannels *channels, uint64_t time, uint8_t status, uint8_t data0, uint8_t data1
+);
+
+/**
+ * @brief Release every sounding note, control thread only
+ *
+ * SYNTH_TIME_NOW and any frame before the latest command queued become the later of
+ * synth_frame_time() and that frame, so the queue stays in time order.
+ *
+ * @param channels channel state
+ * @param time synth frame of the release, or SYNTH_TIME_NOW
+ */
+void       midi_channels_release( MidiChannels *channels, uint64_t time );
+
+/***************
+ * BYTE STREAM *
+ **************/
+// flags of a SysEx piece, a message can arrive in several
+#define MIDI_SYSEX_FIRST 0x01    // the piece starts the message
+#define MIDI_SYSEX_LAST  0x02    // the piece ends the message
+#define MIDI_SYSEX_CUT   0x04    // ended by a status byte other than F7
+
+// one message decoded from a MIDI 1.0 byte stream
+typedef struct {
+    uint8_t        status;     // with running status resolved, MIDI_SYSEX for a SysEx piece
+    uint8_t        data[2];    // data bytes, 0 past the ones the status takes
+    uint8_t        sysex;      // MIDI_SYSEX_* flags of a SysEx piece
+    uint32_t       length;     // bytes of a SysEx piece
+    const uint8_t *payload;    // SysEx bytes without F0 and F7, points into the decoded bytes
+} MidiMessage;
+
+// wire protocol state carried from one run of bytes to the next
+typedef struct {
+    uint8_t  status;     // message being assembled, or the running status, 0 for none
+    uint8_t  need;       // data bytes the status takes
+    uint8_t  have;       // data bytes collected
+    uint8_t  data[2];
+    bool     sysex;      // inside a SysEx message
+    bool     first;      // no piece of the SysEx message has gone out yet
+    uint64_t dropped;    // data bytes without a status, stray F7s and undefined status bytes
+} MidiDecoder;
 
-#define MAX_VOICES 64
+/**
+ * @brief Start decoding a stream, with no running status
+ *
+ * @param decoder decoder to set up
+ */
+void       midi_decoder_init( MidiDecoder *decoder );
 
+/**
+ * @brief Decode a run of bytes from a MIDI port into messages
+ *
+ * Running status, system common messages, SysEx and realtime bytes anywhere in the stream,
+ * including inside other messages, are handled as MIDI 1.0 specifies. A message may be split
+ * across runs. SysEx is passed through in pieces that point into `bytes`, a realtime byte inside
+ * a SysEx splits it. Decoding stops early when `messages` is full; the bytes not consumed must be
+ * passed again. Allocates nothing, realtime safe.
+ *
+ * @param decoder stream state
+ * @param bytes bytes from the port
+ * @param count number of bytes
+ * @param consumed set to the number of bytes decoded
+ * @param messages destination, capacity entries
+ * @param capacity size of messages
+ * @return messages written
+ */
+uint32_t   midi_decode(
+  MidiDecoder *decoder, const uint8_t *bytes, size_t count, size_t *consumed,
+  MidiMessage *messages, uint32_t capacity
+);
+
+/**
+ * @brief Play a batch of decoded messages now, control thread only
+ *
+ * Channel messages go through midi_channels_send() at SYNTH_TIME_NOW, the rest are skipped.
+ * They take the synth's queue for commands due now and play at the start of the next block,
+ * ahead of anything a sequencer has scheduled for later frames, so live input is not held back
+ * by a render-ahead window. Keep live input on channels of its own: on a sequencer's channels a
+ * message waits for the last frame those channels scheduled.
+ *
+ * @param channels channel state
+ * @param messages decoded messages
+ * @param count number of messages
+ * @return messages played, fewer than count if the command queue filled up
+ */
+uint32_t   midi_channels_dispatch(
+  MidiChannels *channels, const MidiMessage *messages, uint32_t count
+);
+
+/****************
+ * NOTE HELPERS *
+ ***************/
 /** struct that contains note data   **/
 typedef struct {
-    NoteName name;          // 0-107
-    int      octave;        // 0-8
-    float    frequency;     // TODO: implement frequency calculation
-    int      volume;        // 0-127
-    int      velocity;      // 0-127
-    int      pitch;         // 0-127
-    int      modulation;    // 0-127
+    NotaNomen name;          // 0-107
+    int       octave;        // 0-8
+    float     frequency;     // TODO: implement frequency calculation
+    int       volume;        // 0-127
+    int       velocity;      // 0-127
+    int       pitch;         // 0-127
+    int       modulation;    // 0-127
 } NoteData;
 
 // convert from 'musical' note to note index
-static int note_to_index( const NoteData *nd ) {
+static inline int note_to_index( const NoteData *nd ) {
     int index = nd->octave * 12 + (int) nd->name;
     return CLAMP( index, 0, 107 );
 }
 
 /**
- * @brief [TODO:description]
+ * @brief Split a note index into its name and octave
  *
- * @param index [TODO:parameter]
- * @return [TODO:return]
+ * @param index note index, clamped to 0-107
+ * @return note with name and octave set
  */
-static NoteData index_to_note( int index ) {
+static inline NoteData index_to_note( int index ) {
     index = CLAMP( index, 0, 107 );
     NoteData nd;
     nd.octave = index / 12;
-    nd.name   = (NoteName) ( index % 12 );
+    nd.name   = (NotaNomen) ( index % 12 );
     return nd;
 }
 
@@ -45,8 +360,8 @@ typedef struct {
 } MidiNote;
 
 // create a midi note from parameters
-static MidiNote create_midi_note(
-  NoteName name, int octave, int volume, int velocity, int modulation, int pitch
+static inline MidiNote create_midi_note(
+  NotaNomen name, int octave, int volume, int velocity, int modulation, int pitch
 ) {
     MidiNote midiNote;
     midiNote.noteData.name   = name;
@@ -57,3 +372,5 @@ static MidiNote create_midi_note(
     midiNote.pitch           = CLAMP( pitch, 0, 127 );
     return midiNote;
 }
+
+#endif
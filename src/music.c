@@ -0,0 +1,592 @@
+#include "music.h"
+
+#include "synth.h"
+#include "tuning.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+// shift a 12-bit pitch-class set up by root semitones, wrapping at the octave
+#define MUSIC_ROTATE( mask, root )                                                                \
+    ( ( ( ( mask ) << ( root ) ) | ( ( mask ) >> ( DIAPASON - ( root ) ) ) ) & 0xFFF )
+
+// a pitch-class set on each of the 12 roots, C first
+#define MUSIC_ROOTS( mask )                                                                       \
+    {                                                                                             \
+        MUSIC_ROTATE( mask, 0 ), MUSIC_ROTATE( mask, 1 ), MUSIC_ROTATE( mask, 2 ),                \
+        MUSIC_ROTATE( mask, 3 ), MUSIC_ROTATE( mask, 4 ), MUSIC_ROTATE( mask, 5 ),                \
+        MUSIC_ROTATE( mask, 6 ), MUSIC_ROTATE( mask, 7 ), MUSIC_ROTATE( mask, 8 ),                \
+        MUSIC_ROTATE( mask, 9 ), MUSIC_ROTATE( mask, 10 ), MUSIC_ROTATE( mask, 11 )               \
+    }
+
+// intervals of a chord above its root
+typedef struct {
+    int count;
+    int intervals[MAX_CHORD_NOTES];
+} ChordaForma;
+
+/**********
+ * TABLES *
+ *********/
+// everything below is a constant expression, there is nothing to build at startup
+
+// semitones above the tonic of each degree, the major scale rotated to start on the mode's degree
+static const int scalae_gradus[MODUS_COUNT][7] = {
+  [IONIAN]     = { 0, 2, 4, 5, 7, 9, 11 },
+  [DORIAN]     = { 0, 2, 3, 5, 7, 9, 10 },
+  [PHRYGIAN]   = { 0, 1, 3, 5, 7, 8, 10 },
+  [LYDIAN]     = { 0, 2, 4, 6, 7, 9, 11 },
+  [MIXOLYDIAN] = { 0, 2, 4, 5, 7, 9, 10 },
+  [AEOLIAN]    = { 0, 2, 3, 5, 7, 8, 10 },
+  [LOCRIAN]    = { 0, 1, 3, 5, 6, 8, 10 },
+};
+
+static const uint16_t scalae_masks[MODUS_COUNT][DIAPASON] = {
+  [IONIAN]     = MUSIC_ROOTS( 0xAB5 ),
+  [DORIAN]     = MUSIC_ROOTS( 0x6AD ),
+  [PHRYGIAN]   = MUSIC_ROOTS( 0x5AB ),
+  [LYDIAN]     = MUSIC_ROOTS( 0xAD5 ),
+  [MIXOLYDIAN] = MUSIC_ROOTS( 0x6B5 ),
+  [AEOLIAN]    = MUSIC_ROOTS( 0x5AD ),
+  [LOCRIAN]    = MUSIC_ROOTS( 0x56B ),
+};
+
+static const ChordaForma chorda_formae[QUALITAS_COUNT][EXTENSIO_COUNT] = {
+  [MAJOR] = {
+    [SEVENTH]    = { 4, { 0, 4, 7, 10 } },
+    [MAJ7TH]     = { 4, { 0, 4, 7, 11 } },
+    [NINTH]      = { 5, { 0, 4, 7, 10, 14 } },
+    [ELEVENTH]   = { 6, { 0, 4, 7, 10, 14, 17 } },
+    [THIRTEENTH] = { 7, { 0, 4, 7, 10, 14, 17, 21 } },
+    [TRIAD]      = { 3, { 0, 4, 7 } },
+  },
+  [MINOR] = {
+    [SEVENTH]    = { 4, { 0, 3, 7, 10 } },
+    [MAJ7TH]     = { 4, { 0, 3, 7, 11 } },
+    [NINTH]      = { 5, { 0, 3, 7, 10, 14 } },
+    [ELEVENTH]   = { 6, { 0, 3, 7, 10, 14, 17 } },
+    [THIRTEENTH] = { 7, { 0, 3, 7, 10, 14, 17, 21 } },
+    [TRIAD]      = { 3, { 0, 3, 7 } },
+  },
+  [DIMINISHED] = {
+    [SEVENTH]    = { 4, { 0, 3, 6, 9 } },
+    [MAJ7TH]     = { 4, { 0, 3, 6, 11 } },
+    [NINTH]      = { 5, { 0, 3, 6, 9, 14 } },
+    [ELEVENTH]   = { 6, { 0, 3, 6, 9, 14, 17 } },
+    [THIRTEENTH] = { 7, { 0, 3, 6, 9, 14, 17, 21 } },
+    [TRIAD]      = { 3, { 0, 3, 6 } },
+  },
+  [AUGMENTED] = {
+    [SEVENTH]    = { 4, { 0, 4, 8, 10 } },
+    [MAJ7TH]     = { 4, { 0, 4, 8, 11 } },
+    [NINTH]      = { 5, { 0, 4, 8, 10, 14 } },
+    [ELEVENTH]   = { 6, { 0, 4, 8, 10, 14, 17 } },
+    [THIRTEENTH] = { 7, { 0, 4, 8, 10, 14, 17, 21 } },
+    [TRIAD]      = { 3, { 0, 4, 8 } },
+  },
+  [SUS2] = {
+    [SEVENTH]    = { 4, { 0, 2, 7, 10 } },
+    [MAJ7TH]     = { 4, { 0, 2, 7, 11 } },
+    [NINTH]      = { 5, { 0, 2, 7, 10, 14 } },
+    [ELEVENTH]   = { 6, { 0, 2, 7, 10, 14, 17 } },
+    [THIRTEENTH] = { 7, { 0, 2, 7, 10, 14, 17, 21 } },
+    [TRIAD]      = { 3, { 0, 2, 7 } },
+  },
+  [SUS4] = {
+    [SEVENTH]    = { 4, { 0, 5, 7, 10 } },
+    [MAJ7TH]     = { 4, { 0, 5, 7, 11 } },
+    [NINTH]      = { 5, { 0, 5, 7, 10, 14 } },
+    [ELEVENTH]   = { 6, { 0, 5, 7, 10, 14, 17 } },
+    [THIRTEENTH] = { 7, { 0, 5, 7, 10, 14, 17, 21 } },
+    [TRIAD]      = { 3, { 0, 5, 7 } },
+  },
+};
+
+static const uint16_t chorda_masks[QUALITAS_COUNT][EXTENSIO_COUNT][DIAPASON] = {
+  [MAJOR] = {
+    [SEVENTH]    = MUSIC_ROOTS( 0x491 ),
+    [MAJ7TH]     = MUSIC_ROOTS( 0x891 ),
+    [NINTH]      = MUSIC_ROOTS( 0x495 ),
+    [ELEVENTH]   = MUSIC_ROOTS( 0x4B5 ),
+    [THIRTEENTH] = MUSIC_ROOTS( 0x6B5 ),
+    [TRIAD]      = MUSIC_ROOTS( 0x091 ),
+  },
+  [MINOR] = {
+    [SEVENTH]    = MUSIC_ROOTS( 0x489 ),
+    [MAJ7TH]     = MUSIC_ROOTS( 0x889 ),
+    [NINTH]      = MUSIC_ROOTS( 0x48D ),
+    [ELEVENTH]   = MUSIC_ROOTS( 0x4AD ),
+    [THIRTEENTH] = MUSIC_ROOTS( 0x6AD ),
+    [TRIAD]      = MUSIC_ROOTS( 0x089 ),
+  },
+  [DIMINISHED] = {
+    [SEVENTH]    = MUSIC_ROOTS( 0x249 ),
+    [MAJ7TH]     = MUSIC_ROOTS( 0x849 ),
+    [NINTH]      = MUSIC_ROOTS( 0x24D ),
+    [ELEVENTH]   = MUSIC_ROOTS( 0x26D ),
+    [THIRTEENTH] = MUSIC_ROOTS( 0x26D ),
+    [TRIAD]      = MUSIC_ROOTS( 0x049 ),
+  },
+  [AUGMENTED] = {
+    [SEVENTH]    = MUSIC_ROOTS( 0x511 ),
+    [MAJ7TH]     = MUSIC_ROOTS( 0x911 ),
+    [NINTH]      = MUSIC_ROOTS( 0x515 ),
+    [ELEVENTH]   = MUSIC_ROOTS( 0x535 ),
+    [THIRTEENTH] = MUSIC_ROOTS( 0x735 ),
+    [TRIAD]      = MUSIC_ROOTS( 0x111 ),
+  },
+  [SUS2] = {
+    [SEVENTH]    = MUSIC_ROOTS( 0x485 ),
+    [MAJ7TH]     = MUSIC_ROOTS( 0x885 ),
+    [NINTH]      = MUSIC_ROOTS( 0x485 ),
+    [ELEVENTH]   = MUSIC_ROOTS( 0x4A5 ),
+    [THIRTEENTH] = MUSIC_ROOTS( 0x6A5 ),
+    [TRIAD]      = MUSIC_ROOTS( 0x085 ),
+  },
+  [SUS4] = {
+    [SEVENTH]    = MUSIC_ROOTS( 0x4A1 ),
+    [MAJ7TH]     = MUSIC_ROOTS( 0x8A1 ),
+    [NINTH]      = MUSIC_ROOTS( 0x4A5 ),
+    [ELEVENTH]   = MUSIC_ROOTS( 0x4A5 ),
+    [THIRTEENTH] = MUSIC_ROOTS( 0x6A5 ),
+    [TRIAD]      = MUSIC_ROOTS( 0x0A1 ),
+  },
+};
+
+// root position shapes by pitch-class set in a perfect hash, slot (mask * MUSIC_SHAPE_HASH) >> 26,
+// so naming a set takes one probe per candidate root. Shapes that spell the same set, a sus2 ninth
+// and a sus2 seventh, are kept as the one with fewer notes. temp/bench_chorda.c checks the table
+// against chorda_formae and prints it again when a shape changes.
+#define MUSIC_SHAPE_HASH  0x58D07675u
+#define MUSIC_SHAPE_SLOTS 64
+
+typedef struct {
+    uint16_t mask;         // root position pitch-class set, 0 in an empty slot
+    uint8_t  quality;      // Qualitas
+    uint8_t  extension;    // Extensio
+} ChordaSignum;
+
+static const ChordaSignum chorda_signa[MUSIC_SHAPE_SLOTS] = {
+  [2]  = { 0x889, MINOR, MAJ7TH },
+  [3]  = { 0x4B5, MAJOR, ELEVENTH },
+  [5]  = { 0x735, AUGMENTED, THIRTEENTH },
+  [7]  = { 0x4A1, SUS4, SEVENTH },
+  [8]  = { 0x6A5, SUS2, THIRTEENTH },
+  [9]  = { 0x085, SUS2, TRIAD },
+  [11] = { 0x48D, MINOR, NINTH },
+  [14] = { 0x911, AUGMENTED, MAJ7TH },
+  [17] = { 0x4AD, MINOR, ELEVENTH },
+  [19] = { 0x091, MAJOR, TRIAD },
+  [20] = { 0x049, DIMINISHED, TRIAD },
+  [21] = { 0x24D, DIMINISHED, NINTH },
+  [22] = { 0x515, AUGMENTED, NINTH },
+  [23] = { 0x8A1, SUS4, MAJ7TH },
+  [25] = { 0x485, SUS2, SEVENTH },
+  [28] = { 0x26D, DIMINISHED, ELEVENTH },
+  [29] = { 0x535, AUGMENTED, ELEVENTH },
+  [32] = { 0x4A5, SUS4, NINTH },
+  [33] = { 0x089, MINOR, TRIAD },
+  [35] = { 0x491, MAJOR, SEVENTH },
+  [42] = { 0x885, SUS2, MAJ7TH },
+  [43] = { 0x6B5, MAJOR, THIRTEENTH },
+  [45] = { 0x111, AUGMENTED, TRIAD },
+  [50] = { 0x489, MINOR, SEVENTH },
+  [52] = { 0x891, MAJOR, MAJ7TH },
+  [53] = { 0x849, DIMINISHED, MAJ7TH },
+  [54] = { 0x0A1, SUS4, TRIAD },
+  [57] = { 0x6AD, MINOR, THIRTEENTH },
+  [60] = { 0x495, MAJOR, NINTH },
+  [61] = { 0x249, DIMINISHED, SEVENTH },
+  [62] = { 0x511, AUGMENTED, SEVENTH },
+};
+
+/*********
+ * NOTES *
+ ********/
+// a note some semitones above a note, s % 12 and s / 12 looked up for the intervals in the tables
+static inline Nota music_above( const Nota *n, int semitones ) {
+    static const struct {
+        uint8_t nome;
+        uint8_t diapason;
+    } gradus[3 * DIAPASON] = {
+      { 0, 0 }, { 1, 0 }, { 2, 0 }, { 3, 0 }, { 4, 0 }, { 5, 0 },
+      { 6, 0 }, { 7, 0 }, { 8, 0 }, { 9, 0 }, { 10, 0 }, { 11, 0 },
+      { 0, 1 }, { 1, 1 }, { 2, 1 }, { 3, 1 }, { 4, 1 }, { 5, 1 },
+      { 6, 1 }, { 7, 1 }, { 8, 1 }, { 9, 1 }, { 10, 1 }, { 11, 1 },
+      { 0, 2 }, { 1, 2 }, { 2, 2 }, { 3, 2 }, { 4, 2 }, { 5, 2 },
+      { 6, 2 }, { 7, 2 }, { 8, 2 }, { 9, 2 }, { 10, 2 }, { 11, 2 }
+    };
+    int  s = (int) n->nome + semitones;    // at most B plus a thirteenth
+    Nota above;
+    above.nome     = (NotaNomen) gradus[s].nome;
+    above.diapason = n->diapason + gradus[s].diapason;
+    return above;
+}
+
+int nota_to_indice( const Nota *n ) {
+    int indice = n->diapason * DIAPASON + (int) n->nome - (int) A;    // A0 is index 0
+    return CLAMP( indice, NOTA_MIN, NOTA_MAX );
+}
+
+Nota indice_to_nota( int indice ) {
+    indice = CLAMP( indice, NOTA_MIN, NOTA_MAX ) + (int) A;
+    Nota n;
+    n.nome     = (NotaNomen) ( indice % DIAPASON );
+    n.diapason = indice / DIAPASON;
+    return n;
+}
+
+float nota_frequency( int indiceNota, float baseTuning, int baseIndice, float semiTone ) {
+    indiceNota = CLAMP( indiceNota, NOTA_MIN, NOTA_MAX );
+    return baseTuning * tuning_ratio( (float) ( indiceNota - baseIndice ) + semiTone );
+}
+
+/**********
+ * SCALES *
+ *********/
+void generate_modal_intervals( Modus modus, int *intervals ) {
+    const int *gradus = scalae_gradus[CLAMP( modus, IONIAN, LOCRIAN )];
+    for ( int i = 0; i < 6; i++ ) intervals[i] = gradus[i + 1] - gradus[i];
+    intervals[6] = DIAPASON - gradus[6];
+}
+
+void generate_scalae( const Nota *tonic, Modus modus, Scalae *scalae ) {
+    modus             = CLAMP( modus, IONIAN, LOCRIAN );
+    const int *gradus = scalae_gradus[modus];
+    scalae->tonic     = *tonic;
+    scalae->modus     = modus;
+    for ( int i = 0; i < 7; i++ ) scalae->notas[i] = music_above( tonic, gradus[i] );
+}
+
+uint16_t scalae_mask( NotaNomen tonic, Modus modus ) {
+    return scalae_masks[CLAMP( modus, IONIAN, LOCRIAN )][CLAMP( tonic, C, B )];
+}
+
+/**********
+ * CHORDS *
+ *********/
+void consortium_intervalla(
+  Qualitas quality, Extensio extension, int *intervals, int *num_intervals
+) {
+    const ChordaForma *forma = &chorda_formae[CLAMP( quality, MAJOR, SUS4 )]
+                                             [CLAMP( extension, SEVENTH, TRIAD )];
+    for ( int i = 0; i < forma->count; i++ ) intervals[i] = forma->intervals[i];
+    *num_intervals = forma->count;
+}
+
+void generate_chorda( const Nota *root, Qualitas quality, Extensio extension, Chorda *chord ) {
+    quality                  = CLAMP( quality, MAJOR, SUS4 );
+    extension                = CLAMP( extension, SEVENTH, TRIAD );
+    const ChordaForma *forma = &chorda_formae[quality][extension];
+    chord->root              = *root;
+    chord->quality           = quality;
+    chord->extension         = extension;
+    chord->inversion         = false;
+    chord->inversion_grade   = 0;
+    chord->num_notes         = forma->count;
+    for ( int i = 0; i < forma->count; i++ ) {
+        chord->notas[i] = music_above( root, forma->intervals[i] );
+    }
+}
+
+uint16_t chorda_mask( NotaNomen root, Qualitas quality, Extensio extension ) {
+    return chorda_masks[CLAMP( quality, MAJOR, SUS4 )][CLAMP( extension, SEVENTH, TRIAD )]
+                       [CLAMP( root, C, B )];
+}
+
+/******************
+ * IDENTIFICATION *
+ *****************/
+// pitch classes of a set of notes, the lowest note of each and the bass, false for no notes
+static bool music_spell(
+  const Nota *notas, int num_notes, uint16_t *mask, int *bass, int *lowest
+) {
+    int low = INT_MAX;
+    *mask   = 0;
+    *bass   = 0;
+    for ( int i = 0; i < num_notes; i++ ) {
+        int pitch = notas[i].diapason * DIAPASON + (int) notas[i].nome;
+        int nome  = notas[i].nome;
+        *mask    |= (uint16_t) ( 1u << nome );
+        if ( lowest && pitch < lowest[nome] ) lowest[nome] = pitch;
+        if ( pitch < low ) {
+            low   = pitch;
+            *bass = nome;
+        }
+    }
+    return num_notes > 0;
+}
+
+bool identify_chorda_mask(
+  uint16_t mask, NotaNomen bass, NotaNomen *root, Qualitas *quality, Extensio *extension,
+  int *inversion_grade
+) {
+    mask &= 0xFFF;
+    if ( (unsigned) bass >= DIAPASON || !( mask >> bass & 1 ) ) return false;
+
+    for ( int step = 0; step < DIAPASON; step++ ) {
+        int r = ( (int) bass + step ) % DIAPASON;
+        if ( !( mask >> r & 1 ) ) continue;
+
+        // turn the set so r sits on C and look the shape up
+        uint32_t            shape  = MUSIC_ROTATE( (uint32_t) mask, DIAPASON - r );
+        const ChordaSignum *signum = &chorda_signa[( shape * MUSIC_SHAPE_HASH ) >> 26];
+        if ( signum->mask != shape ) continue;
+
+        const ChordaForma *forma = &chorda_formae[signum->quality][signum->extension];
+        int                above = ( (int) bass - r + DIAPASON ) % DIAPASON;
+        int                grade = 0;
+        while ( forma->intervals[grade] % DIAPASON != above ) grade++;
+        *root            = (NotaNomen) r;
+        *quality         = (Qualitas) signum->quality;
+        *extension       = (Extensio) signum->extension;
+        *inversion_grade = grade;
+        return true;
+    }
+    return false;
+}
+
+void identify_chorda( const Nota *notas, int num_notes, Chorda *chorda ) {
+    int       lowest[DIAPASON] = { INT_MAX, INT_MAX, INT_MAX, INT_MAX, INT_MAX, INT_MAX,
+                                   INT_MAX, INT_MAX, INT_MAX, INT_MAX, INT_MAX, INT_MAX };
+    uint16_t  mask;
+    int       bass, grade;
+    NotaNomen root;
+    Qualitas  quality;
+    Extensio  extension;
+    chorda->num_notes = 0;
+    if ( !music_spell( notas, num_notes, &mask, &bass, lowest ) ) return;
+    if ( !identify_chorda_mask( mask, (NotaNomen) bass, &root, &quality, &extension, &grade ) ) {
+        return;
+    }
+
+    const ChordaForma *forma = &chorda_formae[quality][extension];
+    chorda->quality          = quality;
+    chorda->extension        = extension;
+    chorda->inversion        = grade > 0;
+    chorda->inversion_grade  = grade;
+    chorda->num_notes        = forma->count;
+    for ( int i = 0; i < forma->count; i++ ) {
+        int pitch                 = lowest[( root + forma->intervals[i] ) % DIAPASON];
+        chorda->notas[i].nome     = (NotaNomen) ( pitch % DIAPASON );
+        chorda->notas[i].diapason = pitch / DIAPASON;
+    }
+    chorda->root = chorda->notas[0];
+}
+
+bool est_chorda( const Nota *notas, int num_notes ) {
+    uint16_t  mask;
+    int       bass, grade;
+    NotaNomen root;
+    Qualitas  quality;
+    Extensio  extension;
+    return music_spell( notas, num_notes, &mask, &bass, NULL ) &&
+           identify_chorda_mask( mask, (NotaNomen) bass, &root, &quality, &extension, &grade );
+}
+
+/************
+ * VOICINGS *
+ ***********/
+#define MUSIC_VOCES_THREADS 16                 // search threads at most, the caller's included
+#define MUSIC_VOCES_KEYS    ( NOTA_MAX + 1 )    // keys on the keyboard, also no limit in semitones
+
+// one search, shared by its threads and read only once they run
+typedef struct {
+    VocesCallback callback;
+    void         *user;
+    Chorda        chord;                       // quality, extension and root to copy
+    uint16_t      tones;                       // pitch classes to place
+    int           position[DIAPASON];          // index in the chord's notes of each of them
+    int           low;
+    int           high;
+    int           span;
+    int           spacing;
+    int           bassSpacing;
+    int           maxMotion;
+    uint8_t       basses;
+    int           motion[MUSIC_VOCES_KEYS];    // semitones to the nearest previous note
+    int           least[1 << DIAPASON];        // least motion left for each set still to place
+    SynthAtomic   next;                        // next bass key to claim
+    SynthAtomic   stop;                        // a callback returned false
+} VocesSearch;
+
+typedef struct {
+    VocesSearch *search;
+    SynthThread  thread;
+    uint32_t     index;
+    uint64_t     found;
+    Chorda       voicing;    // built up voice by voice, from the bass
+} VocesWorker;
+
+static void voces_set( VocesWorker *worker, int voice, int key, int nome ) {
+    worker->voicing.notas[voice].nome     = (NotaNomen) nome;
+    worker->voicing.notas[voice].diapason = ( key + A ) / DIAPASON;
+    if ( nome == (int) worker->search->chord.root.nome ) {
+        worker->voicing.root = worker->voicing.notas[voice];
+    }
+}
+
+// place the voices above last, top being the highest key the span allows, false to stop
+static bool voces_place(
+  VocesWorker *worker, int voice, int last, uint16_t left, int motion, int top
+) {
+    VocesSearch *search = worker->search;
+    if ( !left ) {
+        if ( synth_atomic_load( &search->stop ) ) return false;
+        worker->found++;
+        if ( search->callback( search->user, worker->index, &worker->voicing, motion ) ) {
+            return true;
+        }
+        synth_atomic_store( &search->stop, 1 );
+        return false;
+    }
+
+    int gap = voice == 1 ? search->bassSpacing : search->spacing;
+    int end = last + gap < top ? last + gap : top;
+    for ( int key = last + 1; key <= end; key++ ) {
+        int      nome  = ( key + A ) % DIAPASON;
+        int      moved = motion + search->motion[key];
+        uint16_t rest  = left & ~( 1u << nome );
+        if ( !( left >> nome & 1 ) || moved + search->least[rest] > search->maxMotion ) continue;
+
+        // within an octave of top, every pitch class still to come has to fit below it
+        if ( key + DIAPASON > top ) {
+            uint32_t above = MUSIC_ROTATE( (uint32_t) rest, ( DIAPASON - nome ) % DIAPASON );
+            int      far   = DIAPASON - 1;
+            while ( far > 0 && !( above >> far & 1 ) ) far--;
+            if ( key + far > top ) continue;
+        }
+
+        voces_set( worker, voice, key, nome );
+        if ( !voces_place( worker, voice + 1, key, rest, moved, top ) ) return false;
+    }
+    return true;
+}
+
+// every voicing over one bass key
+static bool voces_bass( VocesWorker *worker, int key ) {
+    VocesSearch *search = worker->search;
+    int          nome   = ( key + A ) % DIAPASON;
+    uint16_t rest   = search->tones & ~( 1u << nome );
+    if ( !( search->tones >> nome & 1 ) || !( search->basses >> search->position[nome] & 1 ) ||
+         search->motion[key] + search->least[rest] > search->maxMotion ) {
+        return true;
+    }
+    worker->voicing.inversion_grade = search->position[nome];
+    worker->voicing.inversion       = search->position[nome] > 0;
+    voces_set( worker, 0, key, nome );
+    int top = key + search->span < search->high ? key + search->span : search->high;
+    return voces_place( worker, 1, key, rest, search->motion[key], top );
+}
+
+static void voces_main( void *arg ) {
+    VocesWorker *worker = (VocesWorker *) arg;
+    VocesSearch *search = worker->search;
+    uint64_t     key;
+    while ( ( key = synth_atomic_fetch_add( &search->next, 1 ) ) <= (uint64_t) search->high ) {
+        if ( !voces_bass( worker, (int) key ) ) return;
+    }
+}
+
+// a limit of zero is no limit
+static int voces_limit( int limit, int none ) { return limit > 0 ? limit : none; }
+
+uint64_t chorda_voces_quaere(
+  const Chorda *chorda, const VocesLimites *limits, VocesCallback callback, void *user
+) {
+    VocesLimites whole = { 0 };
+    VocesSearch  search;
+    VocesWorker  workers[MUSIC_VOCES_THREADS];
+    if ( !limits ) limits = &whole;
+
+    search.callback    = callback;
+    search.user        = user;
+    search.chord       = *chorda;
+    search.tones       = 0;
+    search.low         = CLAMP( limits->low, NOTA_MIN, NOTA_MAX );
+    search.high        = limits->high > 0 ? CLAMP( limits->high, search.low, NOTA_MAX ) : NOTA_MAX;
+    search.span        = voces_limit( limits->maxSpan, MUSIC_VOCES_KEYS );
+    search.spacing     = voces_limit( limits->maxSpacing, MUSIC_VOCES_KEYS );
+    search.bassSpacing = voces_limit( limits->maxBassSpacing, MUSIC_VOCES_KEYS );
+    search.maxMotion   = voces_limit( limits->maxMotion, INT_MAX );
+    search.basses      = limits->basses ? limits->basses : 0xFF;
+
+    // a pitch class the chord doubles is voiced once, at its first note
+    int count = 0;
+    for ( int i = 0; i < CLAMP( chorda->num_notes, 0, MAX_CHORD_NOTES ); i++ ) {
+        int nome = CLAMP( chorda->notas[i].nome, C, B );
+        if ( search.tones >> nome & 1 ) continue;
+        search.tones          |= (uint16_t) ( 1u << nome );
+        search.position[nome]  = i;
+        count++;
+    }
+    if ( count == 0 ) return 0;
+    search.chord.num_notes = count;
+
+    for ( int key = 0; key < MUSIC_VOCES_KEYS; key++ ) {
+        int nearest = limits->previous && limits->numPrevious > 0 ? INT_MAX : 0;
+        for ( int i = 0; limits->previous && i < limits->numPrevious; i++ ) {
+            int moved = abs( key - nota_to_indice( &limits->previous[i] ) );
+            if ( moved < nearest ) nearest = moved;
+        }
+        search.motion[key] = nearest;
+    }
+
+    // a bound for the motion still to come: each pitch class on its closest key in range
+    int closest[DIAPASON];
+    for ( int nome = 0; nome < DIAPASON; nome++ ) closest[nome] = INT_MAX / DIAPASON;
+    for ( int key = search.low; key <= search.high; key++ ) {
+        int nome = ( key + A ) % DIAPASON;
+        if ( search.motion[key] < closest[nome] ) closest[nome] = search.motion[key];
+    }
+    search.least[0] = 0;
+    for ( int set = 1; set < 1 << DIAPASON; set++ ) {
+        int nome = 0;
+        while ( !( set >> nome & 1 ) ) nome++;
+        search.least[set] = search.least[set & ( set - 1 )] + closest[nome];
+    }
+    synth_atomic_store( &search.next, (uint64_t) search.low );
+    synth_atomic_store( &search.stop, 0 );
+
+    // the caller is worker 0, a thread that will not start leaves its share to the others
+    uint32_t threads = CLAMP( limits->threads, 1u, (uint32_t) MUSIC_VOCES_THREADS );
+    uint32_t started = 1;
+    for ( uint32_t t = 0; t < threads; t++ ) {
+        workers[t].search  = &search;
+        workers[t].index   = t;
+        workers[t].found   = 0;
+        workers[t].voicing = search.chord;
+    }
+    while ( started < threads &&
+            synth_thread_start( &workers[started].thread, voces_main, &workers[started], -1 ) ) {
+        started++;
+    }
+    voces_main( &workers[0] );
+
+    uint64_t found = workers[0].found;
+    for ( uint32_t t = 1; t < started; t++ ) {
+        synth_thread_join( &workers[t].thread );
+        found += workers[t].found;
+    }
+    return found;
+}
+
+typedef struct {
+    Chorda *voces;
+    int     capacity;
+    int     count;
+} VocesList;
+
+static bool voces_collect( void *user, uint32_t thread, const Chorda *voicing, int motion ) {
+    VocesList *list = (VocesList *) user;
+    (void) thread;
+    (void) motion;
+    list->voces[list->count++] = *voicing;
+    return list->count < list->capacity;
+}
+
+void chorda_voces( const Chorda *chorda, Chorda *voces, int *num_voces ) {
+    VocesList list = { voces, *num_voces, 0 };
+    if ( list.capacity > 0 ) chorda_voces_quaere( chorda, NULL, voces_collect, &list );
+    *num_voces = list.count;
+}
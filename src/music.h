@@ -6,6 +6,10 @@
 #ifndef MUSIC_H
 #define MUSIC_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #define CLAMP( value, minVal, maxVal )                                                            \
     ( ( value ) < ( minVal ) ? ( minVal ) : ( ( value ) > ( maxVal ) ? ( maxVal ) : ( value ) ) )
 
@@ -49,6 +53,7 @@ typedef enum {
     MIXOLYDIAN,
     AEOLIAN,
     LOCRIAN,
+    MODUS_COUNT
 } Modus;
 
 /* scale definition  */
@@ -65,16 +70,19 @@ typedef enum {
     DIMINISHED,    // diminitus
     AUGMENTED,     // auctus
     SUS2,          // suspensus
-    SUS4
+    SUS4,
+    QUALITAS_COUNT
 } Qualitas;
 
 /* list of chord extensions */
 typedef enum {
     SEVENTH,    // septima
     MAJ7TH,
-    NINTH,        // nona
-    ELEVENTH,     // undecima
-    THIRTEENTH    // tertiadecima
+    NINTH,         // nona
+    ELEVENTH,      // undecima
+    THIRTEENTH,    // tertiadecima
+    TRIAD,         // no extension, the bare triad
+    EXTENSIO_COUNT
 } Extensio;
 
 /* chord definition */
@@ -88,76 +96,170 @@ typedef struct {
     int      num_notes;
 } Chorda;
 
+/* limits a voicing search prunes by, zero for none */
+typedef struct {
+    int         low;               // lowest note index
+    int         high;              // highest note index, 0 for NOTA_MAX
+    int         maxSpan;           // semitones from the bass to the top voice
+    int         maxSpacing;        // semitones between neighbouring upper voices
+    int         maxBassSpacing;    // semitones between the bass and the voice above it
+    uint8_t     basses;            // bit n lets the chord's nth note take the bass, 0 for any
+    const Nota *previous;          // voicing to lead from
+    int         numPrevious;
+    int         maxMotion;         // semitones all voices may move from previous together
+    uint32_t    threads;           // search threads, 0 or 1 searches on the calling thread
+} VocesLimites;
+
+/**
+ * @brief Called with each voicing a search finds
+ *
+ * @param user pointer given to chorda_voces_quaere()
+ * @param thread index of the search thread, below VocesLimites.threads
+ * @param voicing the chord's notes in ascending order, inversion_grade names the one in the bass
+ * @param motion semitones from each note to the nearest note of the previous voicing, summed
+ * @return false to stop the search
+ */
+typedef bool ( *VocesCallback )( void *user, uint32_t thread, const Chorda *voicing, int motion );
+
 /**
  * @brief Converts from note 'name' to note 'index'
  *
- * @param n [TODO:parameter]
- * @return [TODO:return]
+ * @param n note, octaves counted from C as in scientific pitch notation
+ * @return note index, NOTA_MIN for A0, clamped to NOTA_MIN-NOTA_MAX
  */
-int   nota_to_indice( const Nota *n );
+int      nota_to_indice( const Nota *n );
 
 /**
  * @brief Converts from note 'index' to note 'name'
  *
- * @param indice [TODO:parameter]
- * @return [TODO:return]
+ * @param indice note index, clamped to NOTA_MIN-NOTA_MAX
+ * @return note name and octave
  */
-Nota  indice_to_nota( int indice );
+Nota     indice_to_nota( int indice );
 
 /**
  * @brief Calculate the frequency of a given note by its index and the tuning base frequency
  *
- * @param indiceNota [TODO:parameter]
- * @param BASE_TUNING [TODO:parameter]
- * @param BASE_INDICE [TODO:parameter]
- * @param semiTone [TODO:parameter]
- * @return [TODO:return]
+ * @param indiceNota index of the note
+ * @param baseTuning frequency of the reference note, usually BASE_TUNING
+ * @param baseIndice index of the reference note, usually BASE_INDICE
+ * @param semiTone fractional offset in semitones, e.g. a pitch bend
+ * @return frequency in Hz
  */
-float nota_frequency( int indiceNota, float (BASE_TUNING), int BASE_INDICE, float semiTone );
+float    nota_frequency( int indiceNota, float baseTuning, int baseIndice, float semiTone );
 
 /**
  * @brief Calculate the intervals of a given mode
  *
- * @param modus [TODO:parameter]
- * @param intervals [TODO:parameter]
+ * @param modus mode
+ * @param intervals filled with the 7 steps in semitones between consecutive degrees
  */
-void  generate_modal_intervals( Modus modus, int *intervals );
+void     generate_modal_intervals( Modus modus, int *intervals );
 
-// returns the notes within a scale given the tonic and a mode
 /**
  * @brief Returns the notes within a scale given the tonic and a mode
  *
- * @param tonic [TODO:parameter]
- * @param modus [TODO:parameter]
- * @param scalae [TODO:parameter]
+ * Looked up in tables built at compile time, no intervals are computed per call.
+ *
+ * @param tonic first degree of the scale
+ * @param modus mode
+ * @param scalae filled with the tonic, mode and 7 ascending notes starting at the tonic
+ */
+void     generate_scalae( const Nota *tonic, Modus modus, Scalae *scalae );
+
+/**
+ * @brief Pitch classes of a scale
+ *
+ * @param tonic tonic of the scale
+ * @param modus mode
+ * @return bit n set for pitch class n, C = bit 0
  */
-void  generate_scalae( const Nota *tonic, Modus modus, Scalae *scalae );
+uint16_t scalae_mask( NotaNomen tonic, Modus modus );
 
 /**
  * @brief Construct a chord from root note and quality
+ *
+ * The notes stack upwards from the root in root position. Looked up in tables built at compile
+ * time, no intervals are computed per call.
+ *
+ * @param root lowest note of the chord
+ * @param quality triad quality
+ * @param extension notes above the triad, TRIAD for none
+ * @param chord filled with the chord
+ */
+void     generate_chorda( const Nota *root, Qualitas quality, Extensio extension, Chorda *chord );
+
+/**
+ * @brief Pitch classes of a chord
+ *
+ * @param root root of the chord
+ * @param quality triad quality
+ * @param extension notes above the triad, TRIAD for none
+ * @return bit n set for pitch class n, C = bit 0
  */
-void  generate_chorda( const Nota *root, Qualitas quality, Extensio extension, Chorda *chord );
+uint16_t chorda_mask( NotaNomen root, Qualitas quality, Extensio extension );
+
+/**
+ * @brief Name the chord a pitch-class set spells
+ *
+ * Every note of the chord has to be there and nothing else, doublings do not matter. The bass is
+ * tried as the root first, then the other pitch classes going up from it. When a set spells more
+ * than one chord shape on the same root, the one with fewer notes wins.
+ *
+ * @param mask pitch classes, bit n for pitch class n, C = bit 0
+ * @param bass pitch class of the lowest note
+ * @param root set to the root
+ * @param quality set to the triad quality
+ * @param extension set to the extension, TRIAD for none
+ * @param inversion_grade set to the position of the bass in consortium_intervalla(), 0 for root
+ * position
+ * @return false if the set is no chord, the outputs are then left alone
+ */
+bool     identify_chorda_mask(
+  uint16_t mask, NotaNomen bass, NotaNomen *root, Qualitas *quality, Extensio *extension,
+  int *inversion_grade
+);
 
 /**
  * @brief Identify a chord from a set of notes
+ *
+ * The notes may come in any order and octave, see identify_chorda_mask() for what counts as a
+ * chord.
+ *
+ * @param notas notes sounding
+ * @param num_notes number of notes
+ * @param chorda filled with the chord, one note per chord tone in the order of
+ * consortium_intervalla(), each the lowest given note of its pitch class; num_notes is 0 if the
+ * notes are no chord
  */
-void  identify_chorda( const Nota *notas, int num_notes, Chorda *chorda );
+void     identify_chorda( const Nota *notas, int num_notes, Chorda *chorda );
 
 /**
  * @brief Convert chord to string representation (e.g., "Cmaj7")
  */
-void  consortium_to_string( const Chorda *chorda, char *str, size_t size );
+void     consortium_to_string( const Chorda *chorda, char *str, size_t size );
 
 /**
- *
  * @brief Get intervals for a given chord quality
+ *
+ * A seventh is minor except on a diminished triad, where it is diminished, and for MAJ7TH. Ninth,
+ * eleventh and thirteenth chords stack every extension below them on the seventh.
+ *
+ * @param quality triad quality
+ * @param extension notes above the triad, TRIAD for none
+ * @param intervals filled with up to MAX_CHORD_NOTES semitones above the root, ascending
+ * @param num_intervals set to the number of intervals, the root's 0 included
  */
-void  consortium_intervalla(
+void     consortium_intervalla(
    Qualitas quality, Extensio extension, int *intervals, int *num_intervals
  );
 
 /**
  * @brief Check if a set of notes forms a valid chord
+ *
+ * @param notas notes sounding, in any order and octave
+ * @param num_notes number of notes
+ * @return true if identify_chorda() would name them
  */
 bool est_chorda( const Nota *notas, int num_notes );
 
@@ -166,8 +268,35 @@ bool est_chorda( const Nota *notas, int num_notes );
  */
 void invert_chorda( Chorda *chorda, int inversion_grade );
 
+/**
+ * @brief Stream the voicings of a chord within limits
+ *
+ * A voicing puts each pitch class of the chord on exactly one key, so a 13th chord over the whole
+ * keyboard has some sixteen million of them. They are built from the bass up and a branch is cut
+ * as soon as it leaves the range, spans or spaces too wide, or can no longer stay within the
+ * motion allowed from the previous voicing, so what is pruned is never visited. Each bass key is a
+ * job; with several threads they are claimed in turn and the callback is called from all of them
+ * at once, in no particular order. On one thread the voicings come in ascending order, bass first.
+ *
+ * @param chorda chord to voice, only the pitch classes of its notes count
+ * @param limits what to prune, NULL for the whole keyboard
+ * @param callback called with each voicing
+ * @param user passed to callback
+ * @return number of voicings passed to callback
+ */
+uint64_t chorda_voces_quaere(
+  const Chorda *chorda, const VocesLimites *limits, VocesCallback callback, void *user
+);
+
 /**
  * @brief Get all possible voicings of a chord
+ *
+ * The first num_voces voicings of chorda_voces_quaere() over the whole keyboard, on the calling
+ * thread.
+ *
+ * @param chorda chord to voice
+ * @param voces filled with the voicings
+ * @param num_voces capacity of voces, set to the number of voicings written
  */
 void chorda_voces( const Chorda *chorda, Chorda *voces, int *num_voces );
 
@@ -0,0 +1,238 @@
+#include "notecache.h"
+
+#include "music.h"
+
+#define NOTECACHE_MAX_FRAMES ( NOTECACHE_SLOT_BYTES / 2 )    // pcm16, the smallest sample
+
+/*********
+ * INDEX *
+ ********/
+static uint64_t notecache_key(
+  int note, BaseWaveform type, uint32_t sampleRate, SampleFormat format
+) {
+    return (uint64_t) sampleRate << 32 | (uint64_t) type << 12 | (uint64_t) format << 8 |
+           (uint64_t) note;
+}
+
+static uint32_t notecache_home( const NoteCache *cache, uint64_t key ) {
+    return (uint32_t) ( ( key * 0x9E3779B97F4A7C15ull ) >> 32 ) & cache->indexMask;
+}
+
+// position of a key in the index, or of the empty entry it would go in
+static uint32_t notecache_probe( const NoteCache *cache, uint64_t key ) {
+    uint32_t at = notecache_home( cache, key );
+    while ( cache->index[at] && cache->slots[cache->index[at] - 1].key != key ) {
+        at = ( at + 1 ) & cache->indexMask;
+    }
+    return at;
+}
+
+// empties an index entry and moves later entries of its probe run back into the gap, so a probe
+// never stops short of a key
+static void notecache_erase( NoteCache *cache, uint32_t hole ) {
+    uint32_t mask = cache->indexMask;
+    for ( uint32_t at = ( hole + 1 ) & mask; cache->index[at]; at = ( at + 1 ) & mask ) {
+        uint32_t home = notecache_home( cache, cache->slots[cache->index[at] - 1].key );
+        if ( ( ( at - home ) & mask ) >= ( ( at - hole ) & mask ) ) {
+            cache->index[hole] = cache->index[at];
+            hole               = at;
+        }
+    }
+    cache->index[hole] = 0;
+}
+
+/*******
+ * LRU *
+ ******/
+static void notecache_unlink( NoteCache *cache, uint32_t slot ) {
+    NoteCacheSlot *s = &cache->slots[slot];
+    if ( s->newer != NOTECACHE_NONE ) cache->slots[s->newer].older = s->older;
+    else cache->newest = s->older;
+    if ( s->older != NOTECACHE_NONE ) cache->slots[s->older].newer = s->newer;
+    else cache->oldest = s->newer;
+}
+
+static void notecache_push( NoteCache *cache, uint32_t slot ) {
+    NoteCacheSlot *s = &cache->slots[slot];
+    s->newer         = NOTECACHE_NONE;
+    s->older         = cache->newest;
+    if ( cache->newest != NOTECACHE_NONE ) cache->slots[cache->newest].newer = slot;
+    else cache->oldest = slot;
+    cache->newest = slot;
+}
+
+// a slot that never held a loop, else the least recently used one nobody holds
+static uint32_t notecache_victim( NoteCache *cache ) {
+    if ( cache->used < cache->numSlots ) return cache->used++;
+    uint32_t slot = cache->oldest;
+    while ( slot != NOTECACHE_NONE && cache->slots[slot].holds > 0 ) {
+        slot = cache->slots[slot].newer;
+    }
+    if ( slot == NOTECACHE_NONE ) return NOTECACHE_NONE;
+
+    notecache_erase( cache, notecache_probe( cache, cache->slots[slot].key ) );
+    notecache_unlink( cache, slot );
+    cache->evictions++;
+    return slot;
+}
+
+/*************
+ * RENDERING *
+ ************/
+// the loop length and cycle count whose period comes closest to the note's
+static bool notecache_fit( double period, uint32_t maxFrames, uint32_t *frames, uint32_t *cycles ) {
+    double best = 1.0;
+    for ( uint32_t c = 1; c * period + 0.5 <= maxFrames; c++ ) {
+        uint32_t length = (uint32_t) ( c * period + 0.5 );
+        double   error  = fabs( (double) length / c - period ) / period;
+        if ( error < best ) {
+            best    = error;
+            *frames = length;
+            *cycles = c;
+        }
+        if ( error == 0.0 ) break;
+    }
+    return best < 1.0;
+}
+
+static void notecache_render(
+  const WaveTable *table, float *out, uint32_t frames, uint32_t cycles
+) {
+    uint32_t     increment = (uint32_t) ( ( (uint64_t) cycles << 32 ) / frames );
+    const float *samples   = wavetable_octave_table( table, wavetable_octave( increment ) );
+    for ( uint32_t i = 0; i < frames; i++ ) {
+        // each frame's exact phase rather than an accumulated one, so the loop closes on itself
+        uint32_t phase = (uint32_t) ( ( (uint64_t) i * cycles << 32 ) / frames );
+        out[i]         = wavetable_read( samples, phase );
+    }
+}
+
+/*********
+ * CACHE *
+ ********/
+SynthError notecache_init( NoteCache *cache, size_t capacity, WaveformRegistry *waveforms ) {
+    if ( !cache ) return SYNTH_ERROR_NULL_PTR;
+    size_t slots = capacity / NOTECACHE_SLOT_BYTES;
+    if ( slots == 0 || slots >= NOTECACHE_NONE / 2 ) return SYNTH_ERROR_INVALID_PARAM;
+    uint32_t indexSize = 1;
+    while ( indexSize < slots * 2 ) indexSize <<= 1;
+
+    // everything in one allocation, every part on its own cache line
+    size_t loops   = slots * NOTECACHE_SLOT_BYTES;
+    size_t table   = slots * sizeof( NoteCacheSlot );
+    size_t index   = indexSize * sizeof( uint32_t );
+    size_t scratch = NOTECACHE_MAX_FRAMES * sizeof( float );
+    arena_init( &cache->arena, loops + table + index + scratch + 4 * 64 );
+    if ( !cache->arena.buffer ) return SYNTH_ERROR_OOM;
+    cache->samples   = (uint8_t *) arena_alloc_aligned( &cache->arena, loops, 64 );
+    cache->slots     = (NoteCacheSlot *) arena_alloc_aligned( &cache->arena, table, 64 );
+    cache->index     = (uint32_t *) arena_alloc_aligned( &cache->arena, index, 64 );
+    cache->scratch   = (float *) arena_alloc_aligned( &cache->arena, scratch, 64 );
+    memset( cache->index, 0, index );
+    cache->indexMask = indexSize - 1;
+    cache->numSlots  = (uint32_t) slots;
+    cache->used      = 0;
+    cache->newest    = NOTECACHE_NONE;
+    cache->oldest    = NOTECACHE_NONE;
+    cache->waveforms = waveforms;
+    cache->hits      = 0;
+    cache->misses    = 0;
+    cache->evictions = 0;
+    return SYNTH_ACK;
+}
+
+void notecache_destroy( NoteCache *cache ) {
+    if ( !cache ) return;
+    arena_destroy( &cache->arena );
+    cache->slots    = NULL;
+    cache->samples  = NULL;
+    cache->index    = NULL;
+    cache->scratch  = NULL;
+    cache->numSlots = 0;
+}
+
+const NoteLoop *notecache_acquire(
+  NoteCache *cache, int note, BaseWaveform type, uint32_t sampleRate, SampleFormat format
+) {
+    if ( !cache || !cache->slots || note < NOTA_MIN || note > NOTA_MAX || sampleRate == 0 ) {
+        return NULL;
+    }
+    uint32_t bytes = sample_format_bytes( format );
+    if ( bytes == 0 || type < 0 ) return NULL;
+
+    uint64_t key = notecache_key( note, type, sampleRate, format );
+    uint32_t at  = notecache_probe( cache, key );
+    if ( cache->index[at] ) {
+        uint32_t slot = cache->index[at] - 1;
+        notecache_unlink( cache, slot );
+        notecache_push( cache, slot );
+        cache->slots[slot].holds++;
+        cache->hits++;
+        return &cache->slots[slot].loop;
+    }
+
+    // everything that can fail is settled before a loop is evicted
+    double   period = sampleRate / nota_frequency( note, BASE_TUNING, BASE_INDICE, 0.0f );
+    uint32_t frames = 0, cycles = 0;
+    if ( period <= 2.0 ) return NULL;
+    if ( !notecache_fit( period, NOTECACHE_SLOT_BYTES / bytes, &frames, &cycles ) ) return NULL;
+    const WaveformSet *set   = cache->waveforms ? wavetable_registry_acquire( cache->waveforms )
+                                                : NULL;
+    const WaveTable   *table = wavetable_lookup( set, type );
+    uint32_t           slot  = table ? notecache_victim( cache ) : NOTECACHE_NONE;
+    if ( slot != NOTECACHE_NONE ) {
+        notecache_render( table, cache->scratch, frames, cycles );
+    }
+    if ( set ) wavetable_registry_release( cache->waveforms, set );
+    if ( slot == NOTECACHE_NONE ) return NULL;
+
+    NoteCacheSlot *s       = &cache->slots[slot];
+    uint8_t       *samples = cache->samples + (size_t) slot * NOTECACHE_SLOT_BYTES;
+    render_select_kernels()->pcm[format]( samples, cache->scratch, frames, 1, NULL );
+    s->key            = key;
+    s->loop.samples   = samples;
+    s->loop.frames    = frames;
+    s->loop.cycles    = cycles;
+    s->loop.format    = format;
+    s->loop.frequency = (float) ( (double) sampleRate * cycles / frames );
+    s->holds          = 1;
+    cache->index[notecache_probe( cache, key )] = slot + 1;
+    notecache_push( cache, slot );
+    cache->misses++;
+    return &s->loop;
+}
+
+void notecache_release( NoteCache *cache, const NoteLoop *loop ) {
+    if ( !cache || !loop ) return;
+    // the loop is the slot's own, handed out by address
+    NoteCacheSlot *s = (NoteCacheSlot *) ( (uintptr_t) loop - offsetof( NoteCacheSlot, loop ) );
+    if ( s->holds > 0 ) s->holds--;
+}
+
+int notecache_warm(
+  NoteCache *cache, BaseWaveform type, uint32_t sampleRate, SampleFormat format
+) {
+    if ( !cache ) return 0;
+    int cached = 0;
+    for ( int note = NOTA_MIN; note <= NOTA_MAX && cached < (int) cache->numSlots; note++ ) {
+        const NoteLoop *loop = notecache_acquire( cache, note, type, sampleRate, format );
+        if ( !loop ) continue;
+        notecache_release( cache, loop );
+        cached++;
+    }
+    return cached;
+}
+
+void notecache_play( const NoteLoop *loop, void *out, uint32_t frames, uint32_t *position ) {
+    uint32_t bytes = sample_format_bytes( loop->format );
+    uint8_t *to    = (uint8_t *) out;
+    uint32_t at    = *position % loop->frames;
+    while ( frames > 0 ) {
+        uint32_t run = loop->frames - at < frames ? loop->frames - at : frames;
+        memcpy( to, (const uint8_t *) loop->samples + (size_t) at * bytes, (size_t) run * bytes );
+        to     += (size_t) run * bytes;
+        frames -= run;
+        at      = at + run == loop->frames ? 0 : at + run;
+    }
+    *position = at;
+}
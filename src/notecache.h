@@ -0,0 +1,138 @@
+/**
+ * @file
+ * @brief pre-rendered looped notes, held in one arena with least recently used eviction
+ *
+ * A NoteLoop is a whole number of cycles of one note of one waveform, rendered from its
+ * band-limited tables at one sample rate and converted to one sample format, so playing it is a
+ * copy. The loop length and cycle count are the pair that best fits the note's period into a slot,
+ * which keeps the pitch within a quarter of a cent without any interpolation on playback.
+ *
+ * Every loop lives in a fixed size slot of a single arena allocated up front, so the cache never
+ * allocates after notecache_init() and never fragments. Loops are rendered the first time they
+ * are asked for. Once every slot is taken, asking for a new one evicts the least recently used
+ * loop nobody holds; a held loop is never evicted, so a voice can keep playing from it. The cache
+ * is not thread safe: it belongs to the control thread, and a loop it hands out may be read from
+ * any thread until released.
+ */
+
+#ifndef NOTECACHE_H
+#define NOTECACHE_H
+
+#include "render.h"
+#include "wavetable.h"
+
+#define NOTECACHE_SLOT_BYTES ( 32 * 1024 )    // one loop, 8192 float32 frames up to 16384 pcm16
+#define NOTECACHE_NONE       UINT32_MAX       // no slot
+
+/*******************
+ * DATA STRUCTURES *
+ ******************/
+// a looped note, frames samples in format that go round without a seam
+typedef struct {
+    const void  *samples;
+    uint32_t     frames;
+    uint32_t     cycles;    // whole cycles in the loop
+    SampleFormat format;
+    float        frequency;    // pitch the loop plays at, sampleRate * cycles / frames
+} NoteLoop;
+
+typedef struct {
+    uint64_t key;    // note, waveform, sample rate and format
+    NoteLoop loop;
+    uint32_t newer;    // least recently used order, NOTECACHE_NONE at the ends
+    uint32_t older;
+    uint32_t holds;    // notecache_acquire() calls not yet released
+} NoteCacheSlot;
+
+typedef struct {
+    SynthArena        arena;    // slots, index and every loop's samples
+    NoteCacheSlot    *slots;
+    uint8_t          *samples;    // NOTECACHE_SLOT_BYTES per slot
+    uint32_t         *index;      // open addressed by key, slot + 1, 0 for empty
+    float            *scratch;    // a loop before it is converted to its format
+    uint32_t          indexMask;
+    uint32_t          numSlots;
+    uint32_t          used;    // slots that ever held a loop, the first ones
+    uint32_t          newest;
+    uint32_t          oldest;
+    WaveformRegistry *waveforms;    // custom waveforms to render from, NULL for base only
+    uint64_t          hits;
+    uint64_t          misses;
+    uint64_t          evictions;
+} NoteCache;
+
+/*************
+ * FUNCTIONS *
+ ************/
+/**
+ * @brief Allocate the arena and an empty cache, not realtime safe
+ *
+ * @param cache cache to initialize
+ * @param capacity bytes of loops to hold at most, a multiple of NOTECACHE_SLOT_BYTES is used
+ * @param waveforms registry custom waveforms are rendered from, NULL for base waveforms only
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR, SYNTH_ERROR_INVALID_PARAM for less than one slot or
+ * SYNTH_ERROR_OOM
+ */
+SynthError      notecache_init( NoteCache *cache, size_t capacity, WaveformRegistry *waveforms );
+
+/**
+ * @brief Release the arena, no loop of the cache may be read afterwards
+ *
+ * @param cache cache to destroy
+ */
+void            notecache_destroy( NoteCache *cache );
+
+/**
+ * @brief Get a note's loop and hold it, rendering it first if it is not cached
+ *
+ * A hit is a hash lookup. A miss renders the loop into a free slot or the least recently used
+ * one nobody holds.
+ *
+ * @param cache cache to look in
+ * @param note note index, NOTA_MIN to NOTA_MAX, tuned to BASE_TUNING
+ * @param type base or custom waveform
+ * @param sampleRate sample rate in Hz
+ * @param format sample format of the loop
+ * @return the loop, valid until notecache_release(); NULL if a parameter is invalid, the note is
+ * not below nyquist, its period does not fit a slot or every slot is held
+ */
+const NoteLoop *notecache_acquire(
+  NoteCache *cache, int note, BaseWaveform type, uint32_t sampleRate, SampleFormat format
+);
+
+/**
+ * @brief Let a loop from notecache_acquire() be evicted again
+ *
+ * @param cache cache the loop came from
+ * @param loop loop to release
+ */
+void            notecache_release( NoteCache *cache, const NoteLoop *loop );
+
+/**
+ * @brief Render every note of a waveform ahead of time
+ *
+ * Renders at most as many notes as the cache has slots, lowest first, so none evicts another.
+ *
+ * @param cache cache to fill
+ * @param type base or custom waveform
+ * @param sampleRate sample rate in Hz
+ * @param format sample format of the loops
+ * @return number of notes cached
+ */
+int             notecache_warm(
+  NoteCache *cache, BaseWaveform type, uint32_t sampleRate, SampleFormat format
+);
+
+/**
+ * @brief Copy frames of a loop, going round it as often as needed
+ *
+ * @param loop loop to play
+ * @param out destination, frames samples in the loop's format
+ * @param frames number of frames to copy
+ * @param position frame of the loop to start at, updated to where the copy stopped
+ */
+void            notecache_play(
+  const NoteLoop *loop, void *out, uint32_t frames, uint32_t *position
+);
+
+#endif
@@ -0,0 +1,275 @@
+#include "offline.h"
+
+#include <fcntl.h>
+#include <time.h>
+
+#ifdef _WIN32
+  #include <io.h>
+  #include <sys/stat.h>
+  #define OFFLINE_OPEN_FLAGS ( _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY )
+  #define offline_open( path, flags ) _open( ( path ), ( flags ), _S_IREAD | _S_IWRITE )
+  #define offline_write( fd, data, size ) _write( ( fd ), ( data ), (unsigned int) ( size ) )
+  #define offline_seek( fd, offset ) _lseeki64( ( fd ), ( offset ), SEEK_SET )
+  #define offline_close _close
+#else
+  #include <unistd.h>
+  #define OFFLINE_OPEN_FLAGS ( O_WRONLY | O_CREAT | O_TRUNC )
+  #define offline_open( path, flags ) open( ( path ), ( flags ), 0644 )
+  #define offline_write( fd, data, size ) write( ( fd ), ( data ), ( size ) )
+  #define offline_seek( fd, offset ) lseek( ( fd ), ( offset ), SEEK_SET )
+  #define offline_close close
+#endif
+
+#define OFFLINE_WAV_HEADER 44      // canonical RIFF/WAVE header with a single fmt and data chunk
+#define OFFLINE_STAGING    1024    // most channels, a frame that straddles the buffer end is staged
+
+/**********************
+ * BUFFERS AND HEADER *
+ *********************/
+static void *offline_alloc( size_t size ) {
+#ifdef _WIN32
+    return _aligned_malloc( size, OFFLINE_DIRECT_ALIGN );
+#else
+    void *buffer = NULL;
+    return posix_memalign( &buffer, OFFLINE_DIRECT_ALIGN, size ) == 0 ? buffer : NULL;
+#endif
+}
+
+static void offline_free( void *buffer ) {
+#ifdef _WIN32
+    _aligned_free( buffer );
+#else
+    free( buffer );
+#endif
+}
+
+static void put_u16( uint8_t *out, uint16_t value ) {
+    out[0] = (uint8_t) value;
+    out[1] = (uint8_t) ( value >> 8 );
+}
+
+static void put_u32( uint8_t *out, uint32_t value ) {
+    put_u16( out, (uint16_t) value );
+    put_u16( out + 2, (uint16_t) ( value >> 16 ) );
+}
+
+// RIFF sizes are 32 bit, a longer file keeps the maximum and relies on readers ignoring it
+static void wav_header( uint8_t *out, const AudioFileOptions *options, uint64_t dataBytes ) {
+    uint32_t sampleBytes = sample_format_bytes( options->format );
+    uint32_t blockAlign  = sampleBytes * options->channels;
+    uint32_t limit       = UINT32_MAX - OFFLINE_WAV_HEADER;
+    uint32_t data        = dataBytes > limit ? limit : (uint32_t) dataBytes;
+
+    memcpy( out, "RIFF", 4 );
+    put_u32( out + 4, data + OFFLINE_WAV_HEADER - 8 );
+    memcpy( out + 8, "WAVEfmt ", 8 );
+    put_u32( out + 16, 16 );
+    put_u16( out + 20, options->format == SAMPLE_FORMAT_FLOAT32 ? 3 : 1 );    // float or pcm
+    put_u16( out + 22, options->channels );
+    put_u32( out + 24, options->sampleRate );
+    put_u32( out + 28, options->sampleRate * blockAlign );
+    put_u16( out + 32, (uint16_t) blockAlign );
+    put_u16( out + 34, (uint16_t) ( sampleBytes * 8 ) );
+    memcpy( out + 36, "data", 4 );
+    put_u32( out + 40, data );
+}
+
+// write all of data, retrying short writes
+static SynthError offline_write_all( int fd, const uint8_t *data, size_t size ) {
+    while ( size ) {
+        long written = (long) offline_write( fd, data, size );
+        if ( written <= 0 ) return SYNTH_ERROR_IO;
+        data += written;
+        size -= (size_t) written;
+    }
+    return SYNTH_ACK;
+}
+
+// turn O_DIRECT off before a write that is not a whole number of aligned blocks
+static void offline_leave_direct( AudioFileWriter *writer ) {
+#if defined( __linux__ ) && defined( O_DIRECT )
+    if ( writer->direct ) {
+        fcntl( writer->fd, F_SETFL, fcntl( writer->fd, F_GETFL ) & ~O_DIRECT );
+        writer->direct = false;
+    }
+#else
+    (void) writer;
+#endif
+}
+
+static SynthError offline_flush( AudioFileWriter *writer ) {
+    if ( writer->bufferUsed == 0 ) return SYNTH_ACK;
+    if ( writer->bufferUsed % OFFLINE_DIRECT_ALIGN ) offline_leave_direct( writer );
+    SynthError err     = offline_write_all( writer->fd, writer->buffer, writer->bufferUsed );
+    writer->bufferUsed = 0;
+    return err;
+}
+
+/**********
+ * WRITER *
+ *********/
+SynthError audio_file_open(
+  AudioFileWriter *writer, const char *path, const AudioFileOptions *options
+) {
+    if ( !writer || !path || !options ) return SYNTH_ERROR_NULL_PTR;
+    if ( sample_format_bytes( options->format ) == 0 || options->channels == 0 ||
+         options->channels > OFFLINE_STAGING || options->sampleRate == 0 ) {
+        return SYNTH_ERROR_INVALID_PARAM;
+    }
+
+    memset( writer, 0, sizeof( *writer ) );
+    writer->options = *options;
+    writer->convert = render_select_kernels()->pcm[options->format];
+
+    // whole aligned blocks so every full buffer can go out through O_DIRECT
+    size_t align       = OFFLINE_DIRECT_ALIGN;
+    size_t size        = options->bufferSize ? options->bufferSize : OFFLINE_BUFFER_SIZE;
+    size               = ( size + align - 1 ) & ~( align - 1 );
+    writer->buffer     = (uint8_t *) offline_alloc( size );
+    writer->bufferSize = size;
+    if ( !writer->buffer ) return SYNTH_ERROR_OOM;
+
+    int flags = OFFLINE_OPEN_FLAGS;
+#if defined( __linux__ ) && defined( O_DIRECT )
+    if ( options->direct ) flags |= O_DIRECT;
+#endif
+    writer->fd = offline_open( path, flags );
+    if ( writer->fd < 0 && ( flags != OFFLINE_OPEN_FLAGS ) ) {
+        writer->fd = offline_open( path, OFFLINE_OPEN_FLAGS );    // filesystem refused O_DIRECT
+        flags      = OFFLINE_OPEN_FLAGS;
+    }
+    if ( writer->fd < 0 ) {
+        offline_free( writer->buffer );
+        writer->buffer = NULL;
+        return SYNTH_ERROR_IO;
+    }
+    writer->direct = flags != OFFLINE_OPEN_FLAGS;
+
+    // the header goes out with the first buffer, it is rewritten with the real sizes on close
+    if ( !options->raw ) {
+        wav_header( writer->buffer, options, 0 );
+        writer->headerBytes = OFFLINE_WAV_HEADER;
+        writer->bufferUsed  = OFFLINE_WAV_HEADER;
+    }
+    return SYNTH_ACK;
+}
+
+// convert straight into the buffer, writing it out each time it fills
+static SynthError audio_file_append(
+  AudioFileWriter *writer, const float *in, uint64_t count, uint32_t spread
+) {
+    PcmDither *dither = writer->options.dither ? &writer->dither : NULL;
+    size_t     bytes  = (size_t) spread * sample_format_bytes( writer->options.format );
+    while ( count ) {
+        size_t   space = writer->bufferSize - writer->bufferUsed;
+        uint64_t fit   = space / bytes < count ? space / bytes : count;
+        if ( fit > UINT32_MAX ) fit = UINT32_MAX;
+        if ( fit ) {
+            uint8_t *out = writer->buffer + writer->bufferUsed;
+            writer->convert( out, in, (uint32_t) fit, spread, dither );
+            writer->bufferUsed += (size_t) fit * bytes;
+            writer->dataBytes  += (uint64_t) fit * bytes;
+            in                 += fit;
+            count              -= fit;
+        } else {
+            // the next sample straddles the end of the buffer, convert it aside and split it
+            uint8_t staging[OFFLINE_STAGING * 4];
+            writer->convert( staging, in, 1, spread, dither );
+            memcpy( writer->buffer + writer->bufferUsed, staging, space );
+            writer->bufferUsed = writer->bufferSize;
+            SynthError err     = offline_flush( writer );
+            if ( err != SYNTH_ACK ) return err;
+            memcpy( writer->buffer, staging + space, bytes - space );
+            writer->bufferUsed  = bytes - space;
+            writer->dataBytes  += bytes;
+            in++;
+            count--;
+        }
+        if ( writer->bufferUsed == writer->bufferSize ) {
+            SynthError err = offline_flush( writer );
+            if ( err != SYNTH_ACK ) return err;
+        }
+    }
+    return SYNTH_ACK;
+}
+
+SynthError audio_file_write( AudioFileWriter *writer, const float *samples, uint32_t frames ) {
+    if ( !writer || !writer->buffer || !samples ) return SYNTH_ERROR_NULL_PTR;
+    SynthError err = audio_file_append(
+      writer, samples, (uint64_t) frames * writer->options.channels, 1
+    );
+    if ( err == SYNTH_ACK ) writer->frames += frames;
+    return err;
+}
+
+SynthError audio_file_write_mono( AudioFileWriter *writer, const float *samples, uint32_t frames ) {
+    if ( !writer || !writer->buffer || !samples ) return SYNTH_ERROR_NULL_PTR;
+    SynthError err = audio_file_append( writer, samples, frames, writer->options.channels );
+    if ( err == SYNTH_ACK ) writer->frames += frames;
+    return err;
+}
+
+SynthError audio_file_close( AudioFileWriter *writer ) {
+    if ( !writer ) return SYNTH_ERROR_NULL_PTR;
+    if ( !writer->buffer ) return SYNTH_ACK;
+
+    SynthError err = offline_flush( writer );
+    if ( err == SYNTH_ACK && !writer->options.raw ) {
+        uint8_t header[OFFLINE_WAV_HEADER];
+        wav_header( header, &writer->options, writer->dataBytes );
+        offline_leave_direct( writer );
+        if ( offline_seek( writer->fd, 0 ) != 0 ) err = SYNTH_ERROR_IO;
+        else err = offline_write_all( writer->fd, header, OFFLINE_WAV_HEADER );
+    }
+
+    if ( offline_close( writer->fd ) != 0 && err == SYNTH_ACK ) err = SYNTH_ERROR_IO;
+    offline_free( writer->buffer );
+    writer->buffer = NULL;
+    writer->fd     = -1;
+    return err;
+}
+
+/*************
+ * RENDERING *
+ ************/
+static double offline_now( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+SynthError synth_render_offline(
+  Synthesizer *synth, AudioFileWriter *writer, uint64_t frames, OfflineCallback callback,
+  void *user, OfflineStats *stats
+) {
+    if ( !synth || !writer || !writer->buffer ) return SYNTH_ERROR_NULL_PTR;
+
+    uint16_t channels = writer->options.channels;
+    float   *mono     = (float *) malloc( sizeof( float ) * OFFLINE_CHUNK_FRAMES );
+    if ( !mono ) return SYNTH_ERROR_OOM;
+
+    SynthError err   = SYNTH_ACK;
+    double     start = offline_now();
+    for ( uint64_t done = 0; done < frames && err == SYNTH_ACK; ) {
+        uint32_t count = frames - done < OFFLINE_CHUNK_FRAMES ? (uint32_t) ( frames - done )
+                                                              : OFFLINE_CHUNK_FRAMES;
+        if ( callback ) {
+            callback( user, synth, synth->frame, (uint32_t) synth_render_frames( synth, count ) );
+        }
+        synth_process_buffer( synth, mono, (int) count );
+        err   = audio_file_write_mono( writer, mono, count );
+        done += count;
+    }
+    double elapsed = offline_now() - start;
+    free( mono );
+
+    if ( stats ) {
+        stats->frames         = frames;
+        stats->bytes          = (uint64_t) frames * channels *
+                       sample_format_bytes( writer->options.format );
+        stats->audioSeconds   = (double) frames / (double) writer->options.sampleRate;
+        stats->renderSeconds  = elapsed;
+        stats->realtimeFactor = elapsed > 0.0 ? stats->audioSeconds / elapsed : 0.0;
+    }
+    return err;
+}
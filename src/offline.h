@@ -0,0 +1,130 @@
+/**
+ * @file
+ * @brief faster than realtime rendering to WAV or raw PCM files
+ *
+ * The offline renderer drives synth_process_buffer with no audio device attached and streams the
+ * mix through an AudioFileWriter. The writer converts into one large buffer and hands it to the
+ * kernel a megabyte at a time, optionally with O_DIRECT on Linux so gigabytes of output do not
+ * churn the page cache. Samples are written little-endian, which is the host order on every
+ * platform we build for.
+ */
+
+#ifndef OFFLINE_H
+#define OFFLINE_H
+
+#include "render.h"
+
+#define OFFLINE_BUFFER_SIZE  ( 1 << 20 )    // default bytes converted per write
+#define OFFLINE_DIRECT_ALIGN 4096           // buffer and write alignment O_DIRECT needs
+#define OFFLINE_CHUNK_FRAMES 4096           // frames rendered between writer calls
+
+typedef struct {
+    SampleFormat format;
+    uint16_t     channels;
+    uint32_t     sampleRate;
+    bool         raw;           // headerless PCM instead of WAV
+    bool         direct;        // bypass the page cache with O_DIRECT where supported
+    size_t       bufferSize;    // bytes per write, 0 for OFFLINE_BUFFER_SIZE
+    bool         dither;        // TPDF dither on 16 and 24 bit output
+} AudioFileOptions;
+
+typedef struct {
+    AudioFileOptions options;
+    int              fd;
+    uint8_t         *buffer;
+    size_t           bufferSize;
+    size_t           bufferUsed;
+    uint64_t         frames;          // frames written so far
+    uint64_t         dataBytes;       // bytes of sample data written so far
+    uint32_t         headerBytes;     // size of the WAV header in front of the data
+    bool             direct;          // O_DIRECT is active
+    PcmKernel        convert;         // kernel for options.format
+    PcmDither        dither;
+} AudioFileWriter;
+
+// result of an offline render
+typedef struct {
+    uint64_t frames;
+    uint64_t bytes;             // bytes of sample data written
+    double   audioSeconds;      // length of the rendered audio
+    double   renderSeconds;     // wall clock time taken
+    double   realtimeFactor;    // audioSeconds / renderSeconds
+} OfflineStats;
+
+/**
+ * @brief Called before every chunk of an offline render to schedule upcoming commands
+ *
+ * The span is in the frames command times count, at the synth's render rate, and the spans of
+ * successive calls follow on from each other without a gap or an overlap.
+ *
+ * @param user pointer given to synth_render_offline()
+ * @param synth synthesizer being rendered
+ * @param frame first frame of the chunk about to be rendered, as synth_frame_time() counts it
+ * @param frames number of frames at the render rate the chunk renders
+ */
+typedef void ( *OfflineCallback )(
+  void *user, Synthesizer *synth, uint64_t frame, uint32_t frames
+);
+
+/**
+ * @brief Create a file and write its WAV header
+ *
+ * @param writer writer to initialize
+ * @param path file to create or truncate
+ * @param options encoding and buffering options, at most OFFLINE_STAGING channels
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR, SYNTH_ERROR_INVALID_PARAM, SYNTH_ERROR_OOM or
+ * SYNTH_ERROR_IO
+ */
+SynthError audio_file_open(
+  AudioFileWriter *writer, const char *path, const AudioFileOptions *options
+);
+
+/**
+ * @brief Convert and append interleaved float frames, clipping to [-1, 1] for PCM formats
+ *
+ * @param writer open writer
+ * @param samples frames * channels interleaved samples
+ * @param frames number of frames
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_IO
+ */
+SynthError audio_file_write( AudioFileWriter *writer, const float *samples, uint32_t frames );
+
+/**
+ * @brief Convert and append a mono signal, copied to every channel in the same pass
+ *
+ * @param writer open writer
+ * @param samples one sample per frame
+ * @param frames number of frames
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_IO
+ */
+SynthError audio_file_write_mono( AudioFileWriter *writer, const float *samples, uint32_t frames );
+
+/**
+ * @brief Flush the remaining samples, fill in the WAV sizes and close the file
+ *
+ * @param writer writer to close, always released even on error
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_IO
+ */
+SynthError audio_file_close( AudioFileWriter *writer );
+
+/**
+ * @brief Render frames of the synth's mix into a file as fast as the cpu allows
+ *
+ * Commands are timed in the synth's own frames, as synth_frame_time() counts them at the render
+ * rate, which carry on from wherever the synth stood when the render began rather than from 0.
+ * The mono mix is copied to every channel of the writer.
+ *
+ * @param synth synthesizer to render, not attached to an audio device
+ * @param writer open writer
+ * @param frames number of frames to write, at the output rate
+ * @param callback called before each chunk to queue commands, may be NULL
+ * @param user passed to callback
+ * @param stats filled with the realtime factor and sizes, may be NULL
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_IO
+ */
+SynthError synth_render_offline(
+  Synthesizer *synth, AudioFileWriter *writer, uint64_t frames, OfflineCallback callback,
+  void *user, OfflineStats *stats
+);
+
+#endif
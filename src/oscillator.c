@@ -0,0 +1,215 @@
+#include "oscillator.h"
+
+#define OSC_PHASE_SCALE ( 1.0f / 4294967296.0f )    // 32 bit phase to cycles
+#define OSC_PI          3.14159265358979323846     // PI is a float
+
+// integral of the correction kernel from -inf to -a samples, a >= 0
+static inline float blep_tail( float a, BlepOrder order ) {
+    if ( order == OSC_BLEP_2POINT ) {
+        float b = 1.0f - a;
+        return 0.5f * b * b;
+    }
+    if ( a < 1.0f ) {
+        float a2 = a * a;
+        return 0.5f + ( -4.0f * a + 2.0f * a2 * a - 0.75f * a2 * a2 ) * ( 1.0f / 6.0f );
+    }
+    float b = 2.0f - a;
+    return b * b * b * b * ( 1.0f / 24.0f );
+}
+
+// band-limited minus ideal unit step, r(x) at x = n / OSC_SINC_OVERSAMPLE samples after the step;
+// r is odd, so x >= 0 is enough, and it is 0 from OSC_SINC_HALF on
+static float osc_sinc_residual[OSC_SINC_HALF * OSC_SINC_OVERSAMPLE + 2];
+static bool  osc_sinc_ready = false;
+
+// integrate a blackman windowed sinc low pass at OSC_SINC_CUTOFF into the residual table
+static void osc_sinc_build( void ) {
+    enum { POINTS = 2 * OSC_SINC_HALF * OSC_SINC_OVERSAMPLE + 1 };
+    static double kernel[POINTS];
+    double        sum = 0.0;
+    for ( int n = 0; n < POINTS; n++ ) {
+        double t      = (double) ( n - POINTS / 2 ) / OSC_SINC_OVERSAMPLE;    // samples
+        double w      = 2.0 * OSC_SINC_CUTOFF;
+        double sinc   = t == 0.0 ? w : sin( OSC_PI * w * t ) / ( OSC_PI * t );
+        double x      = (double) n / ( POINTS - 1 );
+        double window = 0.42 - 0.5 * cos( 2.0 * OSC_PI * x ) + 0.08 * cos( 4.0 * OSC_PI * x );
+        kernel[n]     = sinc * window;
+        sum          += kernel[n];
+    }
+
+    // r(x) = -(area of the kernel past x), summed back from the far end with the trapezoid rule
+    double tail = 0.0;
+    for ( int n = POINTS - 1; n >= POINTS / 2; n-- ) {
+        osc_sinc_residual[n - POINTS / 2] = (float) -tail;
+        if ( n > POINTS / 2 ) tail += 0.5 * ( kernel[n] + kernel[n - 1] ) / sum;
+    }
+    osc_sinc_residual[POINTS / 2 + 1] = 0.0f;    // guard for x rounding up to OSC_SINC_HALF
+    osc_sinc_ready = true;
+}
+
+// r(x) for 0 <= x < OSC_SINC_HALF samples
+static inline float osc_sinc_at( float x ) {
+    float    at   = x * OSC_SINC_OVERSAMPLE;
+    uint32_t n    = (uint32_t) at;
+    float    frac = at - (float) n;
+    return osc_sinc_residual[n] + frac * ( osc_sinc_residual[n + 1] - osc_sinc_residual[n] );
+}
+
+// correction for a unit upward step at phase edge every period samples, from every step within
+// OSC_SINC_HALF samples on either side
+static inline float osc_sinc_blep( uint32_t phase, uint32_t edge, float period ) {
+    float after = (float) ( phase - edge ) * OSC_PHASE_SCALE * period;    // samples since a step
+    float blep  = 0.0f;
+    for ( float x = after; x < OSC_SINC_HALF; x += period ) blep += osc_sinc_at( x );
+    for ( float x = period - after; x < OSC_SINC_HALF; x += period ) blep -= osc_sinc_at( x );
+    return blep;
+}
+
+// correction for a unit upward step at phase edge, added to the naive waveform
+static inline float osc_blep(
+  uint32_t phase, uint32_t edge, float dt, float reach, BlepOrder order
+) {
+    float after  = (float) ( phase - edge ) * OSC_PHASE_SCALE;    // cycles since the step
+    float before = (float) ( edge - phase ) * OSC_PHASE_SCALE;    // cycles until the next one
+    float blep   = 0.0f;
+    if ( after < reach ) blep -= blep_tail( after / dt, order );
+    if ( before < reach && before > 0.0f ) blep += blep_tail( before / dt, order );
+    return blep;
+}
+
+// square, pulse and saw with every step replaced by a windowed sinc one
+static void osc_render_sinc( Oscillator *osc, float *out, int length ) {
+    uint32_t phase     = osc->phase;
+    uint32_t increment = osc->phaseIncrement;
+    float    period    = 4294967296.0f / (float) increment;    // samples per cycle
+
+    if ( osc->waveform == WAVEFORM_SAW ) {
+        for ( int i = 0; i < length; i++ ) {
+            float naive  = 2.0f * (float) phase * OSC_PHASE_SCALE - 1.0f;
+            out[i]       = naive - 2.0f * osc_sinc_blep( phase, 0, period );
+            phase       += increment;
+        }
+    } else {
+        uint32_t edge = (uint32_t) ( (double) osc->pulseWidth * 4294967296.0 );
+        for ( int i = 0; i < length; i++ ) {
+            float naive  = phase < edge ? 1.0f : -1.0f;
+            float rise   = osc_sinc_blep( phase, 0, period );
+            float fall   = osc_sinc_blep( phase, edge, period );
+            out[i]       = naive + 2.0f * ( rise - fall );
+            phase       += increment;
+        }
+    }
+    osc->phase = phase;
+}
+
+// table-free square, pulse and saw, corrected around every step
+static void osc_render_polyblep( Oscillator *osc, float *out, int length ) {
+    uint32_t  phase     = osc->phase;
+    uint32_t  increment = osc->phaseIncrement;
+    float     dt        = (float) increment * OSC_PHASE_SCALE;
+    float     reach     = osc->blepOrder == OSC_BLEP_4POINT ? 2.0f * dt : dt;
+    BlepOrder order     = osc->blepOrder;
+
+    if ( increment == 0 ) reach = 0.0f;    // no motion, no steps to smooth
+    if ( increment != 0 && order == OSC_BLEP_SINC ) {
+        osc_render_sinc( osc, out, length );
+        return;
+    }
+    if ( osc->waveform == WAVEFORM_SAW ) {
+        for ( int i = 0; i < length; i++ ) {
+            // ramps up from -1 and drops by 2 at the wrap
+            float naive  = 2.0f * (float) phase * OSC_PHASE_SCALE - 1.0f;
+            out[i]       = naive - 2.0f * osc_blep( phase, 0, dt, reach, order );
+            phase       += increment;
+        }
+    } else {
+        // high until the pulse width, rises by 2 at the wrap and falls by 2 at the width
+        uint32_t edge = (uint32_t) ( (double) osc->pulseWidth * 4294967296.0 );
+        for ( int i = 0; i < length; i++ ) {
+            float naive  = phase < edge ? 1.0f : -1.0f;
+            float rise   = osc_blep( phase, 0, dt, reach, order );
+            float fall   = osc_blep( phase, edge, dt, reach, order );
+            out[i]       = naive + 2.0f * ( rise - fall );
+            phase       += increment;
+        }
+    }
+    osc->phase = phase;
+}
+
+SynthError osc_init( Oscillator *osc, BaseWaveform type, float sampleRate ) {
+    if ( !osc ) return SYNTH_ERROR_NULL_PTR;
+    if ( sampleRate <= 0.0f ) return SYNTH_ERROR_INVALID_PARAM;
+    osc->table = wavetable_get( type );
+    if ( !osc->table ) return SYNTH_ERROR_INVALID_PARAM;
+
+    osc->mode              = OSC_MODE_WAVETABLE;
+    osc->waveform          = type;
+    osc->blepOrder         = OSC_BLEP_2POINT;
+    osc->pulseWidth        = 0.5f;
+    osc->phase             = 0;
+    osc->phaseFraction     = 0;
+    osc->phaseIncrement    = 0;
+    osc->incrementFraction = 0;
+    osc->frequency         = 0.0f;
+    osc->sampleRate        = sampleRate;
+    return SYNTH_ACK;
+}
+
+SynthError osc_init_polyblep(
+  Oscillator *osc, BaseWaveform type, BlepOrder order, float sampleRate
+) {
+    if ( !osc ) return SYNTH_ERROR_NULL_PTR;
+    if ( type != WAVEFORM_SQUARE && type != WAVEFORM_SAW ) return SYNTH_ERROR_INVALID_PARAM;
+    if ( sampleRate <= 0.0f ) return SYNTH_ERROR_INVALID_PARAM;
+    if ( order == OSC_BLEP_SINC && !osc_sinc_ready ) osc_sinc_build();
+
+    osc->mode              = OSC_MODE_POLYBLEP;
+    osc->waveform          = type;
+    osc->blepOrder         = order;
+    osc->pulseWidth        = 0.5f;
+    osc->table             = NULL;
+    osc->phase             = 0;
+    osc->phaseFraction     = 0;
+    osc->phaseIncrement    = 0;
+    osc->incrementFraction = 0;
+    osc->frequency         = 0.0f;
+    osc->sampleRate        = sampleRate;
+    return SYNTH_ACK;
+}
+
+void osc_set_pulse_width( Oscillator *osc, float width ) {
+    if ( !osc ) return;
+    osc->pulseWidth = width < 0.01f ? 0.01f : width > 0.99f ? 0.99f : width;
+}
+
+void osc_set_frequency( Oscillator *osc, float frequency ) {
+    if ( !osc ) return;
+    osc->frequency = frequency;
+    osc_increment( frequency, osc->sampleRate, &osc->phaseIncrement, &osc->incrementFraction );
+}
+
+void osc_set_phase( Oscillator *osc, float phase ) {
+    if ( !osc ) return;
+    phase              -= floorf( phase );
+    osc->phase          = (uint32_t) ( (double) phase * 4294967296.0 );
+    osc->phaseFraction  = 0;
+}
+
+void osc_render( Oscillator *osc, float *out, int length ) {
+    if ( !osc || !out || length <= 0 ) return;
+    if ( osc->mode == OSC_MODE_POLYBLEP ) osc_render_polyblep( osc, out, length );
+    else wavetable_render( osc->table, out, length, &osc->phase, osc->phaseIncrement );
+    osc_carry( &osc->phase, &osc->phaseFraction, osc->incrementFraction, (uint32_t) length );
+}
+
+void osc_advance( Oscillator *osc, uint64_t samples ) {
+    if ( !osc ) return;
+    osc->phase += (uint32_t) ( samples * osc->phaseIncrement );    // wraps mod 2^32 exactly
+
+    // split so incrementFraction * chunk fits in 64 bits
+    while ( samples ) {
+        uint32_t chunk = samples > UINT32_MAX ? UINT32_MAX : (uint32_t) samples;
+        osc_carry( &osc->phase, &osc->phaseFraction, osc->incrementFraction, chunk );
+        samples -= chunk;
+    }
+}
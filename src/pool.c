@@ -0,0 +1,103 @@
+#include "pool.h"
+
+// the free list link lives in the first bytes of every free slot
+#define POOL_NEXT( slot ) ( *(void **) ( slot ) )
+
+// index of a slot, or capacity if the pointer is not a slot of this pool
+static uint32_t pool_index( const SynthPool *pool, const void *object ) {
+    const uint8_t *p = (const uint8_t *) object;
+    if ( p < pool->slots ) return pool->capacity;
+    size_t offset = (size_t) ( p - pool->slots );
+    if ( offset % pool->stride != 0 ) return pool->capacity;
+    size_t index = offset / pool->stride;
+    return index < pool->capacity ? (uint32_t) index : pool->capacity;
+}
+
+#ifdef SYNTH_DEBUG
+// true if nothing has written to a free slot since it was poisoned, the link is skipped
+static bool pool_poison_intact( const SynthPool *pool, const uint8_t *slot ) {
+    for ( size_t i = sizeof( void * ); i < pool->objectSize; i++ ) {
+        if ( slot[i] != POOL_POISON_FREE ) return false;
+    }
+    return true;
+}
+#endif
+
+SynthError pool_init(
+  SynthPool *pool, SynthArena *arena, size_t objectSize, size_t align, uint32_t capacity
+) {
+    if ( !pool || !arena ) return SYNTH_ERROR_NULL_PTR;
+    if ( align == 0 ) align = SYNTH_ARENA_ALIGN;
+    if ( align < sizeof( void * ) ) align = sizeof( void * );    // slots must hold the link
+    if ( objectSize == 0 || capacity == 0 || ( align & ( align - 1 ) ) ) {
+        return SYNTH_ERROR_INVALID_PARAM;
+    }
+
+    if ( objectSize < sizeof( void * ) ) objectSize = sizeof( void * );
+    pool->objectSize = objectSize;
+    pool->stride     = ( objectSize + align - 1 ) & ~( align - 1 );
+    pool->capacity   = capacity;
+    pool->slots      = (uint8_t *) arena_alloc_aligned( arena, pool->stride * capacity, align );
+    if ( !pool->slots ) return SYNTH_ERROR_ARENA_FULL;
+
+#ifdef SYNTH_DEBUG
+    pool->live = (uint8_t *) arena_alloc( arena, capacity );
+    if ( !pool->live ) return SYNTH_ERROR_ARENA_FULL;
+    pool->corrupted = 0;
+#endif
+
+    pool_reset( pool );
+    return SYNTH_ACK;
+}
+
+void *pool_alloc( SynthPool *pool ) {
+    if ( !pool || !pool->freeHead ) return NULL;
+    uint8_t *slot  = (uint8_t *) pool->freeHead;
+    pool->freeHead = POOL_NEXT( slot );
+    pool->numFree--;
+
+#ifdef SYNTH_DEBUG
+    if ( !pool_poison_intact( pool, slot ) ) {
+        fprintf( stderr, "pool: slot %p was written after it was freed\n", (void *) slot );
+        pool->corrupted++;
+    }
+    pool->live[pool_index( pool, slot )] = 1;
+    memset( slot, POOL_POISON_NEW, pool->objectSize );
+#endif
+    return slot;
+}
+
+SynthError pool_free( SynthPool *pool, void *object ) {
+    if ( !pool ) return SYNTH_ERROR_NULL_PTR;
+    if ( !object ) return SYNTH_ACK;
+    uint32_t index = pool_index( pool, object );
+    if ( index == pool->capacity ) return SYNTH_ERROR_INVALID_PARAM;
+
+#ifdef SYNTH_DEBUG
+    if ( !pool->live[index] ) return SYNTH_ERROR_INVALID_PARAM;    // double free
+    pool->live[index] = 0;
+    memset( object, POOL_POISON_FREE, pool->objectSize );
+#endif
+
+    POOL_NEXT( object ) = pool->freeHead;
+    pool->freeHead      = object;
+    pool->numFree++;
+    return SYNTH_ACK;
+}
+
+void pool_reset( SynthPool *pool ) {
+    if ( !pool || !pool->slots ) return;
+
+    // chain the slots in address order so fresh allocations walk memory forwards
+    pool->freeHead = NULL;
+    for ( uint32_t i = pool->capacity; i-- > 0; ) {
+        uint8_t *slot = pool->slots + (size_t) i * pool->stride;
+#ifdef SYNTH_DEBUG
+        memset( slot, POOL_POISON_FREE, pool->objectSize );
+        pool->live[i] = 0;
+#endif
+        POOL_NEXT( slot ) = pool->freeHead;
+        pool->freeHead    = slot;
+    }
+    pool->numFree = pool->capacity;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file
+ * @brief fixed-size object pool carved from a SynthArena
+ *
+ * For objects that come and go during playback: event nodes, modulation routings, per-voice effect
+ * state. Every slot is carved from the arena once at init and free slots are chained through their
+ * own first bytes, so allocating and freeing are O(1) and never call malloc. A pool has a single
+ * owner thread; give each thread its own pool.
+ *
+ * Build with SYNTH_DEBUG defined to poison freed slots, check them for writes after free when they
+ * are handed out again, counting them in `corrupted`, and reject double frees.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include "synth.h"
+
+#define POOL_CACHE_LINE  64
+#define POOL_POISON_FREE 0xDD    // pattern left in freed slots in SYNTH_DEBUG builds
+#define POOL_POISON_NEW  0xCD    // pattern in freshly allocated slots in SYNTH_DEBUG builds
+
+typedef struct {
+    uint8_t *slots;       // capacity slots of stride bytes
+    void    *freeHead;    // first free slot, each free slot stores the next one
+    size_t   objectSize;
+    size_t   stride;      // objectSize rounded up to the alignment
+    uint32_t capacity;
+    uint32_t numFree;
+#ifdef SYNTH_DEBUG
+    uint8_t *live;         // 1 for every slot that is handed out
+    uint32_t corrupted;    // slots found written after they were freed
+#endif
+} SynthPool;
+
+/**
+ * @brief Carve a pool of fixed-size slots out of an arena
+ *
+ * @param pool pool to initialize
+ * @param arena arena backing the slots
+ * @param objectSize size of one object in bytes
+ * @param align power of two alignment of every slot, POOL_CACHE_LINE keeps objects from sharing
+ * cache lines, 0 means SYNTH_ARENA_ALIGN
+ * @param capacity number of slots
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR, SYNTH_ERROR_INVALID_PARAM or SYNTH_ERROR_ARENA_FULL
+ */
+SynthError pool_init(
+  SynthPool *pool, SynthArena *arena, size_t objectSize, size_t align, uint32_t capacity
+);
+
+/**
+ * @brief Take a free slot
+ *
+ * @param pool pool to allocate from
+ * @return uninitialized slot, or NULL if the pool is exhausted
+ */
+void      *pool_alloc( SynthPool *pool );
+
+/**
+ * @brief Return a slot to the pool
+ *
+ * @param pool pool the slot came from
+ * @param object slot from pool_alloc(), NULL is ignored
+ * @return SYNTH_ACK, or SYNTH_ERROR_INVALID_PARAM if the pointer is not a slot of this pool (or,
+ * in SYNTH_DEBUG builds, is already free)
+ */
+SynthError pool_free( SynthPool *pool, void *object );
+
+/**
+ * @brief Free every slot at once
+ *
+ * @param pool pool to reset
+ */
+void       pool_reset( SynthPool *pool );
+
+// typed helpers, e.g. SynthEvent *event = POOL_NEW( &events, SynthEvent );
+#define POOL_INIT( pool, arena, type, align, capacity )                                           \
+    pool_init( ( pool ), ( arena ), sizeof( type ), ( align ), ( capacity ) )
+#define POOL_NEW( pool, type ) ( (type *) pool_alloc( pool ) )
+
+#endif
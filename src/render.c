@@ -0,0 +1,737 @@
+#include "render.h"
+
+#include "wavetable.h"
+
+#ifdef _MSC_VER
+  #define RENDER_INLINE __forceinline
+#else
+  #define RENDER_INLINE inline __attribute__( ( always_inline ) )
+#endif
+
+#ifdef RENDER_X86
+  #include <immintrin.h>
+  #ifdef _MSC_VER
+    #include <intrin.h>
+    #define RENDER_TARGET( isa )
+  #else
+    #define RENDER_TARGET( isa ) __attribute__( ( target( isa ) ) )
+  #endif
+#endif
+
+/*******************
+ * PCM CONVERSION *
+ ******************/
+// full scale of each integer format and the float range that rounds to valid codes
+typedef struct {
+    float scale;
+    float min;
+    float max;
+    bool  dither;    // +-1 LSB is audible, at 32 bit it would be lost in float precision anyway
+} PcmRange;
+
+static const PcmRange pcm_ranges[SAMPLE_FORMAT_COUNT] = {
+  [SAMPLE_FORMAT_PCM16] = { 32767.0f, -32768.0f, 32767.0f, true },
+  [SAMPLE_FORMAT_PCM24] = { 8388607.0f, -8388608.0f, 8388607.0f, true },
+  // 2^31 - 1 rounds to 2^31 in float, so the top is the largest float below it
+  [SAMPLE_FORMAT_PCM32] = { 2147483647.0f, -2147483648.0f, 2147483520.0f, false },
+};
+
+uint32_t sample_format_bytes( SampleFormat format ) {
+    switch ( format ) {
+        case SAMPLE_FORMAT_PCM16: return 2;
+        case SAMPLE_FORMAT_PCM24: return 3;
+        case SAMPLE_FORMAT_PCM32:
+        case SAMPLE_FORMAT_FLOAT32: return 4;
+        default: return 0;
+    }
+}
+
+// noise is a hash of the output position rather than a running generator, so vector kernels
+// reproduce the scalar stream lane for lane
+static inline uint32_t pcm_hash( uint32_t x ) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// the two 16 bit halves of a hash are two uniform values, their sum is triangular in (-1, 1)
+static inline float pcm_tpdf( uint32_t hash ) {
+    return (float) ( (int32_t) ( hash & 0xFFFF ) + (int32_t) ( hash >> 16 ) - 65535 ) *
+           ( 1.0f / 65536.0f );
+}
+
+// round half to even like cvtps2dq without a libm call: adding 1.5 * 2^52 in double leaves the
+// integer in the low mantissa bits, exactly for anything a 32 bit code can hold
+static inline int32_t pcm_round( float y ) {
+    double   d    = (double) y + 6755399441055744.0;    // 1.5 * 2^52
+    uint64_t bits;
+    memcpy( &bits, &d, sizeof( bits ) );
+    return (int32_t) (uint32_t) bits;
+}
+
+static inline float pcm_scaled( float x, const PcmRange *range ) {
+    x = x < -1.0f ? -1.0f : x;
+    x = x > 1.0f ? 1.0f : x;
+    return x * range->scale;
+}
+
+static inline float pcm_clip( float y, const PcmRange *range ) {
+    y = y < range->min ? range->min : y;
+    return y > range->max ? range->max : y;
+}
+
+static inline void pcm_store( uint8_t *out, uint32_t o, int32_t v, SampleFormat format ) {
+    if ( format == SAMPLE_FORMAT_PCM16 ) {
+        int16_t s = (int16_t) v;
+        memcpy( out + o * 2, &s, 2 );
+    } else if ( format == SAMPLE_FORMAT_PCM24 ) {
+        out[o * 3]     = (uint8_t) v;
+        out[o * 3 + 1] = (uint8_t) ( v >> 8 );
+        out[o * 3 + 2] = (uint8_t) ( v >> 16 );
+    } else {
+        memcpy( out + o * 4, &v, 4 );
+    }
+}
+
+// convert output samples [first, total), the scalar kernels and the tail of the vector kernels;
+// format is a constant in every caller, so only the branches of one format are left
+static RENDER_INLINE void pcm_convert_from(
+  uint8_t *out, const float *in, uint32_t first, uint32_t total, uint32_t spread, uint32_t base,
+  bool noise, SampleFormat format
+) {
+    const PcmRange *range = &pcm_ranges[format];
+    uint32_t        o     = first;
+
+    // the rest of the copies of the source sample the first output belongs to
+    for ( ; o < total && o % spread != 0; o++ ) {
+        float x = in[o / spread];
+        if ( format == SAMPLE_FORMAT_FLOAT32 ) {
+            memcpy( out + o * 4, &x, 4 );
+            continue;
+        }
+        float y = pcm_scaled( x, range ) + ( noise ? pcm_tpdf( pcm_hash( base + o ) ) : 0.0f );
+        pcm_store( out, o, pcm_round( pcm_clip( y, range ) ), format );
+    }
+
+    // then whole source samples, each test made once per call rather than per sample
+    const float *x = in + o / spread;
+    if ( format == SAMPLE_FORMAT_FLOAT32 ) {
+        for ( ; o < total; o += spread, x++ ) {
+            for ( uint32_t c = 0; c < spread; c++ ) memcpy( out + ( o + c ) * 4, x, 4 );
+        }
+    } else if ( noise ) {
+        for ( ; o < total; o += spread, x++ ) {
+            float y = pcm_scaled( *x, range );
+            for ( uint32_t c = 0; c < spread; c++ ) {
+                float dithered = y + pcm_tpdf( pcm_hash( base + o + c ) );
+                pcm_store( out, o + c, pcm_round( pcm_clip( dithered, range ) ), format );
+            }
+        }
+    } else {
+        // clamped to +-1 and scaled, 16 and 24 bit codes are already in range
+        for ( ; o < total; o += spread, x++ ) {
+            float   y = pcm_scaled( *x, range );
+            int32_t v = pcm_round( range->scale > range->max ? pcm_clip( y, range ) : y );
+            for ( uint32_t c = 0; c < spread; c++ ) pcm_store( out, o + c, v, format );
+        }
+    }
+}
+
+// one kernel per format around a format generic body, forced inline so the format tests fold away
+#define PCM_KERNEL( target, name, body, format )                                                  \
+    target static void name(                                                                      \
+      void *out, const float *in, uint32_t count, uint32_t spread, PcmDither *dither              \
+    ) {                                                                                           \
+        body( (uint8_t *) out, in, count, spread, dither, format );                               \
+        if ( dither ) dither->position += count * spread;                                         \
+    }
+
+/******************
+ * SCALAR KERNELS *
+ *****************/
+static void mix_voice_scalar(
+  float *out, const float *table, uint32_t *phase, uint32_t increment, const float *gain,
+  int length
+) {
+    uint32_t p = *phase;
+    for ( int i = 0; i < length; i++ ) {
+        out[i] += wavetable_read( table, p ) * gain[i];
+        p      += increment;
+    }
+    *phase = p;
+}
+
+static void envelope_scalar(
+  float *level, const float *multiplier, const float *offset, float *const *gain, int length
+) {
+    for ( int k = 0; k < RENDER_ENVELOPE_LANES; k++ ) {
+        float  l   = level[k];
+        float  m   = multiplier[k];
+        float  o   = offset[k];
+        float *row = gain[k];
+        for ( int i = 0; i < length; i++ ) {
+            row[i] = l;
+            l      = l * m + o;
+        }
+        level[k] = l;
+    }
+}
+
+static inline float fir_dot_scalar( const float *a, const float *b, uint32_t taps ) {
+    float sum = 0.0f;
+    for ( uint32_t i = 0; i < taps; i++ ) sum += a[i] * b[i];
+    return sum;
+}
+
+// the phase stepping every FIR kernel shares, around a kernel's own dot product
+#define FIR_KERNEL( target, name, dot, finish )                                                   \
+    target static uint32_t name(                                                                  \
+      float *out, uint32_t count, const float *in, const FirBank *bank, uint32_t *phase           \
+    ) {                                                                                           \
+        const float *start = in;                                                                  \
+        uint32_t     p     = *phase;                                                              \
+        for ( uint32_t i = 0; i < count; i++ ) {                                                  \
+            out[i]  = dot( bank->coeffs + (size_t) p * bank->taps, in, bank->taps );              \
+            in     += bank->whole;                                                                \
+            p      += bank->fraction;                                                             \
+            if ( p >= bank->phases ) {                                                            \
+                p -= bank->phases;                                                                \
+                in++;                                                                             \
+            }                                                                                     \
+        }                                                                                         \
+        finish;                                                                                   \
+        *phase = p;                                                                               \
+        return (uint32_t) ( in - start );                                                         \
+    }
+
+FIR_KERNEL(, fir_scalar, fir_dot_scalar, (void) 0 )
+
+static RENDER_INLINE void pcm_scalar(
+  uint8_t *out, const float *in, uint32_t count, uint32_t spread, const PcmDither *dither,
+  SampleFormat format
+) {
+    bool     noise = dither && pcm_ranges[format].dither;
+    uint32_t base  = dither ? dither->seed + dither->position : 0;
+    uint32_t total = count * spread;
+
+    // mono and stereo get loops of their own with the copies unrolled
+    if ( spread == 1 ) pcm_convert_from( out, in, 0, total, 1, base, noise, format );
+    else if ( spread == 2 ) pcm_convert_from( out, in, 0, total, 2, base, noise, format );
+    else pcm_convert_from( out, in, 0, total, spread, base, noise, format );
+}
+
+PCM_KERNEL(, pcm16_scalar, pcm_scalar, SAMPLE_FORMAT_PCM16 )
+PCM_KERNEL(, pcm24_scalar, pcm_scalar, SAMPLE_FORMAT_PCM24 )
+PCM_KERNEL(, pcm32_scalar, pcm_scalar, SAMPLE_FORMAT_PCM32 )
+PCM_KERNEL(, float32_scalar, pcm_scalar, SAMPLE_FORMAT_FLOAT32 )
+
+static const RenderKernels kernels_scalar = {
+  "scalar", mix_voice_scalar, envelope_scalar, fir_scalar,
+  { pcm16_scalar, pcm24_scalar, pcm32_scalar, float32_scalar }
+};
+
+#ifdef RENDER_X86
+/****************
+ * SSE2 KERNELS *
+ ***************/
+RENDER_TARGET( "sse2" )
+static void mix_voice_sse2(
+  float *out, const float *table, uint32_t *phase, uint32_t increment, const float *gain,
+  int length
+) {
+    uint32_t p     = *phase;
+    __m128i  lanes = _mm_set_epi32(
+      (int) ( p + 3 * increment ), (int) ( p + 2 * increment ), (int) ( p + increment ), (int) p
+    );
+    __m128i step  = _mm_set1_epi32( (int) ( 4 * increment ) );
+    __m128i mask  = _mm_set1_epi32( (int) WAVETABLE_FRAC_MASK );
+    __m128  scale = _mm_set1_ps( WAVETABLE_FRAC_SCALE );
+    int     i     = 0;
+
+    for ( ; i + 4 <= length; i += 4 ) {
+        // no gather before avx2, so the two taps are fetched per lane
+        uint32_t index[4];
+        _mm_storeu_si128( (__m128i *) index, _mm_srli_epi32( lanes, WAVETABLE_FRAC_BITS ) );
+        __m128 a = _mm_set_ps(
+          table[index[3]], table[index[2]], table[index[1]], table[index[0]]
+        );
+        __m128 b = _mm_set_ps(
+          table[index[3] + 1], table[index[2] + 1], table[index[1] + 1], table[index[0] + 1]
+        );
+        __m128 frac   = _mm_mul_ps( _mm_cvtepi32_ps( _mm_and_si128( lanes, mask ) ), scale );
+        __m128 sample = _mm_add_ps( a, _mm_mul_ps( _mm_sub_ps( b, a ), frac ) );
+        __m128 mixed  = _mm_add_ps(
+          _mm_loadu_ps( out + i ), _mm_mul_ps( sample, _mm_loadu_ps( gain + i ) )
+        );
+        _mm_storeu_ps( out + i, mixed );
+        lanes = _mm_add_epi32( lanes, step );
+    }
+
+    *phase = p + (uint32_t) i * increment;
+    mix_voice_scalar( out + i, table, phase, increment, gain + i, length - i );
+}
+
+RENDER_TARGET( "sse2" )
+static void envelope_sse2(
+  float *level, const float *multiplier, const float *offset, float *const *gain, int length
+) {
+    for ( int h = 0; h < RENDER_ENVELOPE_LANES; h += 4 ) {
+        __m128        l   = _mm_loadu_ps( level + h );
+        __m128        m   = _mm_loadu_ps( multiplier + h );
+        __m128        o   = _mm_loadu_ps( offset + h );
+        float *const *row = gain + h;
+        int           i   = 0;
+
+        // four samples of four voices, transposed so each voice's row gets one store
+        for ( ; i + 4 <= length; i += 4 ) {
+            __m128 s0 = l;
+            __m128 s1 = l = _mm_add_ps( _mm_mul_ps( l, m ), o );
+            __m128 s2 = l = _mm_add_ps( _mm_mul_ps( l, m ), o );
+            __m128 s3 = l = _mm_add_ps( _mm_mul_ps( l, m ), o );
+            l             = _mm_add_ps( _mm_mul_ps( l, m ), o );
+            _MM_TRANSPOSE4_PS( s0, s1, s2, s3 );
+            _mm_storeu_ps( row[0] + i, s0 );
+            _mm_storeu_ps( row[1] + i, s1 );
+            _mm_storeu_ps( row[2] + i, s2 );
+            _mm_storeu_ps( row[3] + i, s3 );
+        }
+        for ( ; i < length; i++ ) {
+            float lanes[4];
+            _mm_storeu_ps( lanes, l );
+            for ( int k = 0; k < 4; k++ ) row[k][i] = lanes[k];
+            l = _mm_add_ps( _mm_mul_ps( l, m ), o );
+        }
+        _mm_storeu_ps( level + h, l );
+    }
+}
+
+// 32 bit multiply without sse4.1: even and odd lanes through the 64 bit multiplier
+RENDER_TARGET( "sse2" )
+static inline __m128i pcm_mullo_sse2( __m128i a, __m128i b ) {
+    __m128i even = _mm_mul_epu32( a, b );
+    __m128i odd  = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ) );
+    return _mm_unpacklo_epi32(
+      _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ),
+      _mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 ) )
+    );
+}
+
+// pcm_tpdf( pcm_hash( position ) ) for four positions
+RENDER_TARGET( "sse2" )
+static inline __m128 pcm_tpdf_sse2( __m128i x ) {
+    x = _mm_xor_si128( x, _mm_srli_epi32( x, 16 ) );
+    x = pcm_mullo_sse2( x, _mm_set1_epi32( 0x7FEB352D ) );
+    x = _mm_xor_si128( x, _mm_srli_epi32( x, 15 ) );
+    x = pcm_mullo_sse2( x, _mm_set1_epi32( (int) 0x846CA68Bu ) );
+    x = _mm_xor_si128( x, _mm_srli_epi32( x, 16 ) );
+    __m128i sum = _mm_sub_epi32(
+      _mm_add_epi32( _mm_and_si128( x, _mm_set1_epi32( 0xFFFF ) ), _mm_srli_epi32( x, 16 ) ),
+      _mm_set1_epi32( 65535 )
+    );
+    return _mm_mul_ps( _mm_cvtepi32_ps( sum ), _mm_set1_ps( 1.0f / 65536.0f ) );
+}
+
+// the source samples of output samples o to o + 3
+RENDER_TARGET( "sse2" )
+static inline __m128 pcm_load_sse2( const float *in, uint32_t o, uint32_t spread ) {
+    if ( spread == 1 ) return _mm_loadu_ps( in + o );
+    if ( spread == 2 ) {
+        __m128 pair = _mm_castpd_ps( _mm_load_sd( (const double *) ( in + o / 2 ) ) );
+        return _mm_unpacklo_ps( pair, pair );
+    }
+    return _mm_setr_ps(
+      in[o / spread], in[( o + 1 ) / spread], in[( o + 2 ) / spread], in[( o + 3 ) / spread]
+    );
+}
+
+// integer codes of output samples o to o + 3
+RENDER_TARGET( "sse2" )
+static RENDER_INLINE __m128i pcm_codes_sse2(
+  __m128 x, uint32_t o, __m128i lanes, bool noise, SampleFormat format
+) {
+    const PcmRange *range = &pcm_ranges[format];
+    __m128          y     = _mm_mul_ps(
+      _mm_min_ps( _mm_max_ps( x, _mm_set1_ps( -1.0f ) ), _mm_set1_ps( 1.0f ) ),
+      _mm_set1_ps( range->scale )
+    );
+    if ( noise ) {
+        y = _mm_add_ps( y, pcm_tpdf_sse2( _mm_add_epi32( lanes, _mm_set1_epi32( (int) o ) ) ) );
+    }
+    // clamped to +-1 and scaled, 16 and 24 bit codes are already in range without noise
+    if ( noise || range->scale > range->max ) {
+        y = _mm_min_ps( _mm_max_ps( y, _mm_set1_ps( range->min ) ), _mm_set1_ps( range->max ) );
+    }
+    return _mm_cvtps_epi32( y );
+}
+
+// the vector part of a conversion, forced inline so every spread and dither case is a loop of its
+// own with no tests left in it
+RENDER_TARGET( "sse2" )
+static RENDER_INLINE uint32_t pcm_span_sse2(
+  uint8_t *out, const float *in, uint32_t limit, uint32_t spread, __m128i lanes, bool noise,
+  SampleFormat format
+) {
+    uint32_t o = 0;
+    if ( format == SAMPLE_FORMAT_PCM16 ) {
+        // eight at a time to fill a whole register of 16 bit codes
+        for ( ; o + 8 <= limit; o += 8 ) {
+            __m128i v0 = pcm_codes_sse2( pcm_load_sse2( in, o, spread ), o, lanes, noise, format );
+            __m128i v1 = pcm_codes_sse2(
+              pcm_load_sse2( in, o + 4, spread ), o + 4, lanes, noise, format
+            );
+            _mm_storeu_si128( (__m128i *) ( out + o * 2 ), _mm_packs_epi32( v0, v1 ) );
+        }
+        return o;
+    }
+    for ( ; o + 4 <= limit; o += 4 ) {
+        __m128 x = pcm_load_sse2( in, o, spread );
+        if ( format == SAMPLE_FORMAT_FLOAT32 ) {
+            _mm_storeu_ps( (float *) out + o, x );
+            continue;
+        }
+        __m128i v = pcm_codes_sse2( x, o, lanes, noise, format );
+        if ( format == SAMPLE_FORMAT_PCM24 ) {
+            int32_t lane[4];
+            _mm_storeu_si128( (__m128i *) lane, v );
+            for ( int k = 0; k < 4; k++ ) memcpy( out + ( o + k ) * 3, &lane[k], 4 );
+        } else {
+            _mm_storeu_si128( (__m128i *) ( out + o * 4 ), v );
+        }
+    }
+    return o;
+}
+
+RENDER_TARGET( "sse2" )
+static RENDER_INLINE void pcm_sse2(
+  uint8_t *out, const float *in, uint32_t count, uint32_t spread, const PcmDither *dither,
+  SampleFormat format
+) {
+    bool     noise = dither && pcm_ranges[format].dither;
+    uint32_t base  = dither ? dither->seed + dither->position : 0;
+    uint32_t total = count * spread;
+    __m128i  lanes = _mm_add_epi32( _mm_set1_epi32( (int) base ), _mm_setr_epi32( 0, 1, 2, 3 ) );
+
+    // packed 24 bit stores spill a byte into the next sample, so leave the last two to the tail
+    uint32_t limit = format == SAMPLE_FORMAT_PCM24 ? ( total > 2 ? total - 2 : 0 ) : total;
+    uint32_t o;
+    if ( spread == 1 && noise ) o = pcm_span_sse2( out, in, limit, 1, lanes, true, format );
+    else if ( spread == 1 ) o = pcm_span_sse2( out, in, limit, 1, lanes, false, format );
+    else if ( spread == 2 && noise ) o = pcm_span_sse2( out, in, limit, 2, lanes, true, format );
+    else if ( spread == 2 ) o = pcm_span_sse2( out, in, limit, 2, lanes, false, format );
+    else o = pcm_span_sse2( out, in, limit, spread, lanes, noise, format );
+    pcm_convert_from( out, in, o, total, spread, base, noise, format );
+}
+
+// two sums of four lanes, so consecutive multiply-adds do not wait on each other
+RENDER_TARGET( "sse2" )
+static inline float fir_dot_sse2( const float *a, const float *b, uint32_t taps ) {
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    for ( uint32_t i = 0; i < taps; i += 8 ) {
+        s0 = _mm_add_ps( s0, _mm_mul_ps( _mm_load_ps( a + i ), _mm_loadu_ps( b + i ) ) );
+        s1 = _mm_add_ps( s1, _mm_mul_ps( _mm_load_ps( a + i + 4 ), _mm_loadu_ps( b + i + 4 ) ) );
+    }
+    s0 = _mm_add_ps( s0, s1 );
+    s0 = _mm_add_ps( s0, _mm_movehl_ps( s0, s0 ) );
+    s0 = _mm_add_ss( s0, _mm_shuffle_ps( s0, s0, 1 ) );
+    return _mm_cvtss_f32( s0 );
+}
+
+FIR_KERNEL( RENDER_TARGET( "sse2" ), fir_sse2, fir_dot_sse2, (void) 0 )
+
+PCM_KERNEL( RENDER_TARGET( "sse2" ), pcm16_sse2, pcm_sse2, SAMPLE_FORMAT_PCM16 )
+PCM_KERNEL( RENDER_TARGET( "sse2" ), pcm24_sse2, pcm_sse2, SAMPLE_FORMAT_PCM24 )
+PCM_KERNEL( RENDER_TARGET( "sse2" ), pcm32_sse2, pcm_sse2, SAMPLE_FORMAT_PCM32 )
+PCM_KERNEL( RENDER_TARGET( "sse2" ), float32_sse2, pcm_sse2, SAMPLE_FORMAT_FLOAT32 )
+
+static const RenderKernels kernels_sse2 = {
+  "sse2", mix_voice_sse2, envelope_sse2, fir_sse2,
+  { pcm16_sse2, pcm24_sse2, pcm32_sse2, float32_sse2 }
+};
+
+/****************
+ * AVX2 KERNELS *
+ ***************/
+RENDER_TARGET( "avx2,fma" )
+static void mix_voice_avx2(
+  float *out, const float *table, uint32_t *phase, uint32_t increment, const float *gain,
+  int length
+) {
+    uint32_t p     = *phase;
+    __m256i  lanes = _mm256_add_epi32(
+      _mm256_set1_epi32( (int) p ),
+      _mm256_mullo_epi32(
+        _mm256_set1_epi32( (int) increment ), _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 )
+      )
+    );
+    __m256i step  = _mm256_set1_epi32( (int) ( 8 * increment ) );
+    __m256i mask  = _mm256_set1_epi32( (int) WAVETABLE_FRAC_MASK );
+    __m256  scale = _mm256_set1_ps( WAVETABLE_FRAC_SCALE );
+    int     i     = 0;
+
+    for ( ; i + 8 <= length; i += 8 ) {
+        // taps are fetched per lane, microcode mitigations make vgatherdps slower than this
+        uint32_t index[8];
+        _mm256_storeu_si256( (__m256i *) index, _mm256_srli_epi32( lanes, WAVETABLE_FRAC_BITS ) );
+        __m256 a = _mm256_setr_ps(
+          table[index[0]], table[index[1]], table[index[2]], table[index[3]], table[index[4]],
+          table[index[5]], table[index[6]], table[index[7]]
+        );
+        __m256 b = _mm256_setr_ps(
+          table[index[0] + 1], table[index[1] + 1], table[index[2] + 1], table[index[3] + 1],
+          table[index[4] + 1], table[index[5] + 1], table[index[6] + 1], table[index[7] + 1]
+        );
+        __m256 frac = _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_and_si256( lanes, mask ) ), scale );
+        __m256 sample = _mm256_fmadd_ps( _mm256_sub_ps( b, a ), frac, a );
+        __m256 mixed  = _mm256_fmadd_ps(
+          sample, _mm256_loadu_ps( gain + i ), _mm256_loadu_ps( out + i )
+        );
+        _mm256_storeu_ps( out + i, mixed );
+        lanes = _mm256_add_epi32( lanes, step );
+    }
+
+    // the callers are built without vex encoding, leave the upper halves clean for them
+    _mm256_zeroupper();
+    *phase = p + (uint32_t) i * increment;
+    mix_voice_scalar( out + i, table, phase, increment, gain + i, length - i );
+}
+
+RENDER_TARGET( "avx2,fma" )
+static void envelope_avx2(
+  float *level, const float *multiplier, const float *offset, float *const *gain, int length
+) {
+    __m256 l = _mm256_loadu_ps( level );
+    __m256 m = _mm256_loadu_ps( multiplier );
+    __m256 o = _mm256_loadu_ps( offset );
+    int    i = 0;
+
+    // four samples of eight voices, each 128 bit half transposed into four voice rows
+    for ( ; i + 4 <= length; i += 4 ) {
+        __m256 s0 = l;
+        __m256 s1 = l = _mm256_fmadd_ps( l, m, o );
+        __m256 s2 = l = _mm256_fmadd_ps( l, m, o );
+        __m256 s3 = l = _mm256_fmadd_ps( l, m, o );
+        l             = _mm256_fmadd_ps( l, m, o );
+
+        __m128 a0 = _mm256_castps256_ps128( s0 ), b0 = _mm256_extractf128_ps( s0, 1 );
+        __m128 a1 = _mm256_castps256_ps128( s1 ), b1 = _mm256_extractf128_ps( s1, 1 );
+        __m128 a2 = _mm256_castps256_ps128( s2 ), b2 = _mm256_extractf128_ps( s2, 1 );
+        __m128 a3 = _mm256_castps256_ps128( s3 ), b3 = _mm256_extractf128_ps( s3, 1 );
+        _MM_TRANSPOSE4_PS( a0, a1, a2, a3 );
+        _MM_TRANSPOSE4_PS( b0, b1, b2, b3 );
+        _mm_storeu_ps( gain[0] + i, a0 );
+        _mm_storeu_ps( gain[1] + i, a1 );
+        _mm_storeu_ps( gain[2] + i, a2 );
+        _mm_storeu_ps( gain[3] + i, a3 );
+        _mm_storeu_ps( gain[4] + i, b0 );
+        _mm_storeu_ps( gain[5] + i, b1 );
+        _mm_storeu_ps( gain[6] + i, b2 );
+        _mm_storeu_ps( gain[7] + i, b3 );
+    }
+    for ( ; i < length; i++ ) {
+        float lanes[RENDER_ENVELOPE_LANES];
+        _mm256_storeu_ps( lanes, l );
+        for ( int k = 0; k < RENDER_ENVELOPE_LANES; k++ ) gain[k][i] = lanes[k];
+        l = _mm256_fmadd_ps( l, m, o );
+    }
+    _mm256_storeu_ps( level, l );
+    _mm256_zeroupper();
+}
+
+// pcm_tpdf( pcm_hash( position ) ) for eight positions
+RENDER_TARGET( "avx2" )
+static inline __m256 pcm_tpdf_avx2( __m256i x ) {
+    x = _mm256_xor_si256( x, _mm256_srli_epi32( x, 16 ) );
+    x = _mm256_mullo_epi32( x, _mm256_set1_epi32( 0x7FEB352D ) );
+    x = _mm256_xor_si256( x, _mm256_srli_epi32( x, 15 ) );
+    x = _mm256_mullo_epi32( x, _mm256_set1_epi32( (int) 0x846CA68Bu ) );
+    x = _mm256_xor_si256( x, _mm256_srli_epi32( x, 16 ) );
+    __m256i sum = _mm256_sub_epi32(
+      _mm256_add_epi32(
+        _mm256_and_si256( x, _mm256_set1_epi32( 0xFFFF ) ), _mm256_srli_epi32( x, 16 )
+      ),
+      _mm256_set1_epi32( 65535 )
+    );
+    return _mm256_mul_ps( _mm256_cvtepi32_ps( sum ), _mm256_set1_ps( 1.0f / 65536.0f ) );
+}
+
+// the source samples of output samples o to o + 7
+RENDER_TARGET( "avx2" )
+static inline __m256 pcm_load_avx2( const float *in, uint32_t o, uint32_t spread ) {
+    if ( spread == 1 ) return _mm256_loadu_ps( in + o );
+    if ( spread == 2 ) {
+        __m256 four = _mm256_castps128_ps256( _mm_loadu_ps( in + o / 2 ) );
+        return _mm256_permutevar8x32_ps( four, _mm256_setr_epi32( 0, 0, 1, 1, 2, 2, 3, 3 ) );
+    }
+    return _mm256_setr_ps(
+      in[o / spread], in[( o + 1 ) / spread], in[( o + 2 ) / spread], in[( o + 3 ) / spread],
+      in[( o + 4 ) / spread], in[( o + 5 ) / spread], in[( o + 6 ) / spread],
+      in[( o + 7 ) / spread]
+    );
+}
+
+// integer codes of output samples o to o + 7; no fma here, a fused multiply-add would round
+// differently from the other kernels
+RENDER_TARGET( "avx2" )
+static RENDER_INLINE __m256i pcm_codes_avx2(
+  __m256 x, uint32_t o, __m256i lanes, bool noise, SampleFormat format
+) {
+    const PcmRange *range = &pcm_ranges[format];
+    __m256          y     = _mm256_mul_ps(
+      _mm256_min_ps( _mm256_max_ps( x, _mm256_set1_ps( -1.0f ) ), _mm256_set1_ps( 1.0f ) ),
+      _mm256_set1_ps( range->scale )
+    );
+    if ( noise ) {
+        y = _mm256_add_ps(
+          y, pcm_tpdf_avx2( _mm256_add_epi32( lanes, _mm256_set1_epi32( (int) o ) ) )
+        );
+    }
+    if ( noise || range->scale > range->max ) {
+        y = _mm256_min_ps(
+          _mm256_max_ps( y, _mm256_set1_ps( range->min ) ), _mm256_set1_ps( range->max )
+        );
+    }
+    return _mm256_cvtps_epi32( y );
+}
+
+// the vector part of a conversion, a loop of its own for every spread and dither case like
+// pcm_span_sse2()
+RENDER_TARGET( "avx2" )
+static RENDER_INLINE uint32_t pcm_span_avx2(
+  uint8_t *out, const float *in, uint32_t limit, uint32_t spread, __m256i lanes, bool noise,
+  SampleFormat format
+) {
+    // the low three bytes of every lane, packed to the front of each 128 bit half
+    __m256i pack24 = _mm256_setr_epi8(
+      0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1, 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13,
+      14, -1, -1, -1, -1
+    );
+    uint32_t o = 0;
+    if ( format == SAMPLE_FORMAT_PCM16 ) {
+        // sixteen at a time to fill a whole register of 16 bit codes, packs works per half
+        for ( ; o + 16 <= limit; o += 16 ) {
+            __m256i v0 = pcm_codes_avx2( pcm_load_avx2( in, o, spread ), o, lanes, noise, format );
+            __m256i v1 = pcm_codes_avx2(
+              pcm_load_avx2( in, o + 8, spread ), o + 8, lanes, noise, format
+            );
+            __m256i packed = _mm256_permute4x64_epi64(
+              _mm256_packs_epi32( v0, v1 ), _MM_SHUFFLE( 3, 1, 2, 0 )
+            );
+            _mm256_storeu_si256( (__m256i *) ( out + o * 2 ), packed );
+        }
+        return o;
+    }
+    for ( ; o + 8 <= limit; o += 8 ) {
+        __m256 x = pcm_load_avx2( in, o, spread );
+        if ( format == SAMPLE_FORMAT_FLOAT32 ) {
+            _mm256_storeu_ps( (float *) out + o, x );
+            continue;
+        }
+        __m256i v = pcm_codes_avx2( x, o, lanes, noise, format );
+        if ( format == SAMPLE_FORMAT_PCM24 ) {
+            __m256i packed = _mm256_shuffle_epi8( v, pack24 );
+            _mm_storeu_si128( (__m128i *) ( out + o * 3 ), _mm256_castsi256_si128( packed ) );
+            _mm_storeu_si128(
+              (__m128i *) ( out + o * 3 + 12 ), _mm256_extracti128_si256( packed, 1 )
+            );
+        } else {
+            _mm256_storeu_si256( (__m256i *) ( out + o * 4 ), v );
+        }
+    }
+    return o;
+}
+
+RENDER_TARGET( "avx2" )
+static RENDER_INLINE void pcm_avx2(
+  uint8_t *out, const float *in, uint32_t count, uint32_t spread, const PcmDither *dither,
+  SampleFormat format
+) {
+    bool     noise = dither && pcm_ranges[format].dither;
+    uint32_t base  = dither ? dither->seed + dither->position : 0;
+    uint32_t total = count * spread;
+    __m256i  lanes = _mm256_add_epi32(
+      _mm256_set1_epi32( (int) base ), _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 )
+    );
+
+    // packed 24 bit stores spill four bytes past the vector, so leave the last two to the tail
+    uint32_t limit = format == SAMPLE_FORMAT_PCM24 ? ( total > 2 ? total - 2 : 0 ) : total;
+    uint32_t o;
+    if ( spread == 1 && noise ) o = pcm_span_avx2( out, in, limit, 1, lanes, true, format );
+    else if ( spread == 1 ) o = pcm_span_avx2( out, in, limit, 1, lanes, false, format );
+    else if ( spread == 2 && noise ) o = pcm_span_avx2( out, in, limit, 2, lanes, true, format );
+    else if ( spread == 2 ) o = pcm_span_avx2( out, in, limit, 2, lanes, false, format );
+    else o = pcm_span_avx2( out, in, limit, spread, lanes, noise, format );
+    _mm256_zeroupper();
+    pcm_convert_from( out, in, o, total, spread, base, noise, format );
+}
+
+RENDER_TARGET( "avx2,fma" )
+static inline float fir_dot_avx2( const float *a, const float *b, uint32_t taps ) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    for ( uint32_t i = 0; i < taps; i += 16 ) {
+        s0 = _mm256_fmadd_ps( _mm256_load_ps( a + i ), _mm256_loadu_ps( b + i ), s0 );
+        s1 = _mm256_fmadd_ps( _mm256_load_ps( a + i + 8 ), _mm256_loadu_ps( b + i + 8 ), s1 );
+    }
+    s0       = _mm256_add_ps( s0, s1 );
+    __m128 s = _mm_add_ps( _mm256_castps256_ps128( s0 ), _mm256_extractf128_ps( s0, 1 ) );
+    s        = _mm_add_ps( s, _mm_movehl_ps( s, s ) );
+    s        = _mm_add_ss( s, _mm_shuffle_ps( s, s, 1 ) );
+    return _mm_cvtss_f32( s );
+}
+
+FIR_KERNEL( RENDER_TARGET( "avx2,fma" ), fir_avx2, fir_dot_avx2, _mm256_zeroupper() )
+
+PCM_KERNEL( RENDER_TARGET( "avx2" ), pcm16_avx2, pcm_avx2, SAMPLE_FORMAT_PCM16 )
+PCM_KERNEL( RENDER_TARGET( "avx2" ), pcm24_avx2, pcm_avx2, SAMPLE_FORMAT_PCM24 )
+PCM_KERNEL( RENDER_TARGET( "avx2" ), pcm32_avx2, pcm_avx2, SAMPLE_FORMAT_PCM32 )
+PCM_KERNEL( RENDER_TARGET( "avx2" ), float32_avx2, pcm_avx2, SAMPLE_FORMAT_FLOAT32 )
+
+static const RenderKernels kernels_avx2 = {
+  "avx2", mix_voice_avx2, envelope_avx2, fir_avx2,
+  { pcm16_avx2, pcm24_avx2, pcm32_avx2, float32_avx2 }
+};
+
+/****************
+ * CPU DISPATCH *
+ ***************/
+static bool cpu_supports( const char *isa ) {
+  #ifdef _MSC_VER
+    int info[4];
+    __cpuid( info, 1 );
+    if ( strcmp( isa, "sse2" ) == 0 ) return ( info[3] & ( 1 << 26 ) ) != 0;
+    // avx2 also needs fma and the os saving ymm state
+    bool fma     = ( info[2] & ( 1 << 12 ) ) != 0;
+    bool osxsave = ( info[2] & ( 1 << 27 ) ) != 0;
+    if ( !fma || !osxsave || ( _xgetbv( 0 ) & 6 ) != 6 ) return false;
+    __cpuidex( info, 7, 0 );
+    return ( info[1] & ( 1 << 5 ) ) != 0;
+  #else
+    __builtin_cpu_init();
+    if ( strcmp( isa, "sse2" ) == 0 ) return __builtin_cpu_supports( "sse2" );
+    return __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" );
+  #endif
+}
+#endif
+
+const RenderKernels *render_get_kernels( const char *name ) {
+    if ( !name ) return NULL;
+    if ( strcmp( name, "scalar" ) == 0 ) return &kernels_scalar;
+#ifdef RENDER_X86
+    if ( strcmp( name, "sse2" ) == 0 && cpu_supports( "sse2" ) ) return &kernels_sse2;
+    if ( strcmp( name, "avx2" ) == 0 && cpu_supports( "avx2" ) ) return &kernels_avx2;
+#endif
+    return NULL;
+}
+
+const RenderKernels *render_select_kernels( void ) {
+    static const RenderKernels *selected = NULL;
+    if ( selected ) return selected;
+
+    const RenderKernels *kernels = render_get_kernels( "avx2" );
+    if ( !kernels ) kernels = render_get_kernels( "sse2" );
+    if ( !kernels ) kernels = &kernels_scalar;
+    selected = kernels;
+    return selected;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file
+ * @brief block renderer, mixes voices into the output one SYNTH_BLOCK_SIZE block at a time
+ *
+ * The inner loop of every voice (phase advance, wavetable lookup, gain and the sum into the mix)
+ * lives in a kernel, as does the envelope recurrence, which steps several voices in SIMD lanes,
+ * the polyphase filter of the resampler, and the conversion of the finished mix to the sample
+ * format of a device or file. Scalar, SSE2
+ * and AVX2 builds of the kernels are compiled side by side and the best set for the running cpu
+ * is picked once at startup, so no special compiler flags are needed.
+ */
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "synth.h"
+
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __i386__ ) || defined( _M_IX86 )
+  #define RENDER_X86
+#endif
+
+#define RENDER_ENVELOPE_LANES 8     // voices stepped together by an envelope kernel
+#define RENDER_FIR_ALIGN      16    // filter taps come in multiples of this
+
+// encoding of the samples in a file or device buffer, always little-endian
+typedef enum {
+    SAMPLE_FORMAT_PCM16,
+    SAMPLE_FORMAT_PCM24,    // packed, 3 bytes per sample
+    SAMPLE_FORMAT_PCM32,
+    SAMPLE_FORMAT_FLOAT32,
+    SAMPLE_FORMAT_COUNT
+} SampleFormat;
+
+// position in the stream of triangular dither noise, zero initialized is a valid start
+typedef struct {
+    uint32_t seed;        // picks one of 2^32 noise streams
+    uint32_t position;    // output samples dithered so far
+} PcmDither;
+
+// polyphase filter bank stepped through by a FIR kernel, see resample.h
+typedef struct {
+    const float *coeffs;      // phases rows of taps, each row in input order, oldest first
+    uint32_t     taps;        // multiple of RENDER_FIR_ALIGN
+    uint32_t     phases;      // interpolation factor
+    uint32_t     whole;       // input samples every output moves on by, decimation / phases
+    uint32_t     fraction;    // and the phases left over, decimation % phases
+} FirBank;
+
+/**
+ * @brief Mix one voice into a block
+ *
+ * @param out block to accumulate into
+ * @param table octave table from wavetable_octave_table()
+ * @param phase phase accumulator, updated in place
+ * @param increment phase increment per sample
+ * @param gain per-sample gain, length entries
+ * @param length number of samples, at most SYNTH_BLOCK_SIZE
+ */
+typedef void ( *VoiceMixKernel )(
+  float *out, const float *table, uint32_t *phase, uint32_t increment, const float *gain,
+  int length
+);
+
+/**
+ * @brief Step RENDER_ENVELOPE_LANES envelope segments side by side
+ *
+ * Each lane writes its level to its own gain row, then moves to level * multiplier + offset for
+ * the next sample, which covers linear (multiplier 1) and exponential segments alike.
+ *
+ * @param level level of each lane at the first sample, updated in place
+ * @param multiplier per-sample multiplier of each lane
+ * @param offset per-sample offset of each lane
+ * @param gain destination row of each lane, length entries each
+ * @param length number of samples, at most SYNTH_BLOCK_SIZE
+ */
+typedef void ( *EnvelopeKernel )(
+  float *level, const float *multiplier, const float *offset, float *const *gain, int length
+);
+
+/**
+ * @brief Convert float samples to a sample format in one pass
+ *
+ * Each input sample is written `spread` times in a row, which interleaves a mono mix into every
+ * channel of a frame. Integer formats clip to [-1, 1], scale, add TPDF dither of +-1 LSB (16 and
+ * 24 bit only), round to nearest and saturate. SAMPLE_FORMAT_FLOAT32 only interleaves. Every
+ * kernel set produces the same bytes, dither included.
+ *
+ * @param out destination, count * spread samples
+ * @param in source samples, count entries
+ * @param count number of source samples
+ * @param spread copies of each source sample, the channel count for a mono mix, 1 for a copy
+ * @param dither noise stream, advanced by count * spread, NULL for no dither
+ */
+typedef void ( *PcmKernel )(
+  void *out, const float *in, uint32_t count, uint32_t spread, PcmDither *dither
+);
+
+/**
+ * @brief Run a polyphase filter over a block of outputs
+ *
+ * Each output is the dot product of the bank row for the current phase with `taps` inputs.
+ * Between outputs the phase moves on by fraction and the window by whole samples, plus one more
+ * whenever the phase wraps around.
+ *
+ * @param out destination, count entries
+ * @param count number of outputs
+ * @param in first input of the window of the first output
+ * @param bank filter bank
+ * @param phase phase of the first output, advanced past the last one
+ * @return input samples the window moved on by
+ */
+typedef uint32_t ( *FirKernel )(
+  float *out, uint32_t count, const float *in, const FirBank *bank, uint32_t *phase
+);
+
+// kernel set chosen for the running cpu
+struct RenderKernels {
+    const char    *name;
+    VoiceMixKernel mix_voice;
+    EnvelopeKernel envelope;
+    FirKernel      fir;
+    PcmKernel      pcm[SAMPLE_FORMAT_COUNT];    // indexed by SampleFormat
+};
+
+/**
+ * @brief Select the fastest kernels the cpu supports
+ *
+ * The choice is made once and cached, later calls return the same set.
+ *
+ * @return kernel set, never NULL
+ */
+const RenderKernels *render_select_kernels( void );
+
+/**
+ * @brief Get a specific kernel set, used to compare kernels against each other
+ *
+ * @param name "scalar", "sse2" or "avx2"
+ * @return kernel set, or NULL if unknown or unsupported by this cpu
+ */
+const RenderKernels *render_get_kernels( const char *name );
+
+/**
+ * @brief Bytes one sample takes in a format
+ *
+ * @param format sample format
+ * @return size in bytes, 0 for an invalid format
+ */
+uint32_t             sample_format_bytes( SampleFormat format );
+
+/**
+ * @brief Fill a gain buffer with a linear ramp
+ *
+ * @param gain destination, length entries
+ * @param from gain at the first sample
+ * @param to gain reached after the last sample
+ * @param length number of samples
+ */
+static inline void   render_gain_ramp( float *gain, float from, float to, int length ) {
+    float step = ( to - from ) / (float) length;
+    for ( int i = 0; i < length; i++ ) gain[i] = from + step * (float) ( i + 1 );
+}
+
+#endif
@@ -0,0 +1,231 @@
+#include "resample.h"
+
+#define RESAMPLE_PI 3.14159265358979323846    // PI is a float, too coarse for 140 dB
+
+// filter length and stopband attenuation of each quality
+typedef struct {
+    uint32_t taps;           // per phase when not decimating, a multiple of RENDER_FIR_ALIGN
+    double   attenuation;    // stopband attenuation in dB
+} ResamplePreset;
+
+static const ResamplePreset resample_presets[RESAMPLE_QUALITY_COUNT] = {
+  [RESAMPLE_QUALITY_FAST]     = { 32, 70.0 },
+  [RESAMPLE_QUALITY_STANDARD] = { 64, 96.0 },
+  [RESAMPLE_QUALITY_HIGH]     = { 128, 120.0 },
+  [RESAMPLE_QUALITY_BEST]     = { 256, 140.0 },
+};
+
+static uint32_t resample_gcd( uint32_t a, uint32_t b ) {
+    while ( b ) {
+        uint32_t t = a % b;
+        a          = b;
+        b          = t;
+    }
+    return a;
+}
+
+/**********
+ * DESIGN *
+ *********/
+// zeroth order modified Bessel function of the first kind, by its power series
+static double resample_bessel_i0( double x ) {
+    double sum = 1.0, term = 1.0, half = x * 0.5;
+    for ( int k = 1; term > sum * 1e-16; k++ ) {
+        term *= ( half / k ) * ( half / k );
+        sum  += term;
+    }
+    return sum;
+}
+
+// Kaiser's beta for a stopband attenuation in dB
+static double resample_kaiser_beta( double attenuation ) {
+    if ( attenuation > 50.0 ) return 0.1102 * ( attenuation - 8.7 );
+    if ( attenuation > 21.0 ) {
+        return 0.5842 * pow( attenuation - 21.0, 0.4 ) + 0.07886 * ( attenuation - 21.0 );
+    }
+    return 0.0;
+}
+
+// windowed sinc of length taps * phases, dealt out into one row per phase in input order
+static void resample_design( Resampler *resampler, float *coeffs, double cutoff, double beta ) {
+    uint32_t taps   = resampler->bank.taps;
+    uint32_t phases = resampler->bank.phases;
+    double   length = (double) taps * phases;
+    double   centre = ( length - 1.0 ) * 0.5;
+    double   norm   = 1.0 / resample_bessel_i0( beta );
+
+    for ( uint32_t p = 0; p < phases; p++ ) {
+        float *row = coeffs + (size_t) p * taps;
+        double sum = 0.0;
+        for ( uint32_t j = 0; j < taps; j++ ) {
+            // tap j of phase p weighs input i - j, so it lands at the far end of the row
+            double k      = (double) p + (double) j * phases - centre;
+            double x      = 2.0 * cutoff * k;
+            double sinc   = x == 0.0 ? 1.0 : sin( RESAMPLE_PI * x ) / ( RESAMPLE_PI * x );
+            double r      = k / centre;
+            double window = resample_bessel_i0( beta * sqrt( fmax( 0.0, 1.0 - r * r ) ) ) * norm;
+            row[taps - 1 - j]  = (float) ( sinc * window );
+            sum               += sinc * window;
+        }
+        for ( uint32_t j = 0; j < taps; j++ ) row[j] = (float) ( row[j] / sum );
+    }
+}
+
+SynthError resampler_init(
+  Resampler *resampler, uint32_t inRate, uint32_t outRate, ResampleQuality quality
+) {
+    if ( !resampler ) return SYNTH_ERROR_NULL_PTR;
+    if ( inRate == 0 || outRate == 0 || (uint32_t) quality >= RESAMPLE_QUALITY_COUNT ) {
+        return SYNTH_ERROR_INVALID_PARAM;
+    }
+    uint32_t gcd        = resample_gcd( inRate, outRate );
+    uint32_t phases     = outRate / gcd;
+    uint32_t decimation = inRate / gcd;
+    if ( phases > RESAMPLE_MAX_PHASES ) return SYNTH_ERROR_INVALID_PARAM;
+
+    // decimating narrows the passband by M / L, the filter grows by as much to keep its slope
+    const ResamplePreset *preset = &resample_presets[quality];
+    uint64_t              taps   = preset->taps;
+    if ( decimation > phases ) taps = ( taps * decimation + phases - 1 ) / phases;
+    taps = ( taps + RENDER_FIR_ALIGN - 1 ) / RENDER_FIR_ALIGN * RENDER_FIR_ALIGN;
+    if ( taps * phases > UINT32_MAX / sizeof( float ) ) return SYNTH_ERROR_INVALID_PARAM;
+
+    memset( resampler, 0, sizeof( *resampler ) );
+    resampler->inRate        = inRate;
+    resampler->outRate       = outRate;
+    resampler->quality       = quality;
+    resampler->fir           = render_select_kernels()->fir;
+    resampler->bank.taps     = (uint32_t) taps;
+    resampler->bank.phases   = phases;
+    resampler->bank.whole    = decimation / phases;
+    resampler->bank.fraction = decimation % phases;
+    resampler->capacity      = (uint32_t) taps + RESAMPLE_BLOCK;
+
+    size_t coeffs  = sizeof( float ) * (size_t) taps * phases;
+    size_t history = sizeof( float ) * resampler->capacity;
+    arena_init( &resampler->arena, coeffs + history + 2 * RENDER_FIR_ALIGN * sizeof( float ) );
+    float *bank = (float *) arena_alloc_aligned(
+      &resampler->arena, coeffs, RENDER_FIR_ALIGN * sizeof( float )
+    );
+    resampler->history = (float *) arena_alloc_aligned(
+      &resampler->arena, history, RENDER_FIR_ALIGN * sizeof( float )
+    );
+    if ( !bank || !resampler->history ) {
+        arena_destroy( &resampler->arena );
+        return SYNTH_ERROR_OOM;
+    }
+
+    // Kaiser: a filter of N taps at beta for A dB falls over (A - 7.95) / (2.285 * 2 pi * N), an
+    // estimate that comes up about 5 dB short at these lengths, so the slope is given a fifth more
+    double rate       = (double) inRate * phases;    // rate of the zero-stuffed input
+    double nyquist    = 0.5 * ( inRate < outRate ? inRate : outRate );
+    double slope      = 2.285 * 2.0 * RESAMPLE_PI * (double) taps;
+    double transition = 1.2 * ( preset->attenuation - 7.95 ) / slope * (double) inRate;
+    if ( transition > nyquist ) transition = nyquist;
+    resampler->stopband = (float) nyquist;
+    resampler->passband = (float) ( nyquist - transition );
+    resample_design(
+      resampler, bank, ( nyquist - 0.5 * transition ) / rate,
+      resample_kaiser_beta( preset->attenuation )
+    );
+    resampler->bank.coeffs = bank;
+
+    // the filter is centred taps / 2 inputs behind the newest input it reads
+    resampler->latency = ( (double) taps * phases - 1.0 ) / ( 2.0 * phases ) * outRate / inRate;
+    resampler_reset( resampler );
+    return SYNTH_ACK;
+}
+
+void resampler_destroy( Resampler *resampler ) {
+    if ( resampler ) arena_destroy( &resampler->arena );
+}
+
+void resampler_reset( Resampler *resampler ) {
+    // a window of silence in front of the first input
+    uint32_t lead = resampler->bank.taps - 1;
+    memset( resampler->history, 0, sizeof( float ) * lead );
+    resampler->filled = lead;
+    resampler->next   = 0;
+    resampler->phase  = 0;
+}
+
+/*************
+ * STREAMING *
+ ************/
+// outputs whose whole window is in the history
+static uint32_t resampler_ready( const Resampler *resampler ) {
+    const FirBank *bank = &resampler->bank;
+    if ( resampler->filled < resampler->next + bank->taps ) return 0;
+    uint64_t starts = resampler->filled - resampler->next - bank->taps + 1;
+    uint64_t span   = starts * bank->phases;
+    if ( span <= resampler->phase ) return 0;
+    uint64_t step  = (uint64_t) bank->whole * bank->phases + bank->fraction;
+    uint64_t ready = ( span - resampler->phase + step - 1 ) / step;
+    return ready > UINT32_MAX ? UINT32_MAX : (uint32_t) ready;
+}
+
+// inputs still missing for the window of output frames - 1 from now
+static uint32_t resampler_needed( const Resampler *resampler, uint32_t frames ) {
+    const FirBank *bank   = &resampler->bank;
+    uint64_t       step   = (uint64_t) bank->whole * bank->phases + bank->fraction;
+    uint64_t       offset = ( resampler->phase + (uint64_t) ( frames - 1 ) * step ) / bank->phases;
+    uint64_t       end    = resampler->next + offset + bank->taps;
+    uint64_t       space  = resampler->capacity - resampler->filled;
+    if ( end <= resampler->filled ) return 0;
+    return end - resampler->filled < space ? (uint32_t) ( end - resampler->filled )
+                                           : (uint32_t) space;
+}
+
+void resampler_pull(
+  Resampler *resampler, float *out, uint32_t frames, ResampleSource source, void *user
+) {
+    while ( frames > 0 ) {
+        uint32_t ready = resampler_ready( resampler );
+        if ( ready == 0 ) {
+            // slide the window to the front, then ask for what the rest of the outputs need
+            float   *history = resampler->history;
+            uint32_t keep    = resampler->filled - resampler->next;
+            memmove( history, history + resampler->next, sizeof( float ) * keep );
+            resampler->filled = keep;
+            resampler->next   = 0;
+
+            uint32_t need = resampler_needed( resampler, frames );
+            if ( need > RESAMPLE_BLOCK ) need = RESAMPLE_BLOCK;
+            source( user, history + keep, need );
+            resampler->filled += need;
+            continue;
+        }
+
+        uint32_t count   = ready < frames ? ready : frames;
+        resampler->next += resampler->fir(
+          out, count, resampler->history + resampler->next, &resampler->bank, &resampler->phase
+        );
+        out    += count;
+        frames -= count;
+    }
+}
+
+// the bookkeeping of resampler_pull() on a copy, without the source or the filter
+uint64_t resampler_inputs( const Resampler *resampler, uint32_t frames ) {
+    Resampler      state = *resampler;
+    const FirBank *bank  = &state.bank;
+    uint64_t       total = 0;
+    while ( frames > 0 ) {
+        uint32_t ready = resampler_ready( &state );
+        if ( ready == 0 ) {
+            state.filled -= state.next;
+            state.next    = 0;
+            uint32_t need = resampler_needed( &state, frames );
+            if ( need > RESAMPLE_BLOCK ) need = RESAMPLE_BLOCK;
+            state.filled += need;
+            total        += need;
+            continue;
+        }
+        uint32_t count    = ready < frames ? ready : frames;
+        uint64_t position = state.phase + (uint64_t) count * bank->fraction;
+        state.next       += count * bank->whole + (uint32_t) ( position / bank->phases );
+        state.phase       = (uint32_t) ( position % bank->phases );
+        frames           -= count;
+    }
+    return total;
+}
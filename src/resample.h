@@ -0,0 +1,105 @@
+/**
+ * @file
+ * @brief polyphase sample rate converter with Kaiser windowed sinc filters
+ *
+ * The rates are reduced to a ratio of interpolation L over decimation M. Conceptually the input is
+ * stuffed with L - 1 zeros, low-pass filtered and every M-th sample kept; the polyphase form only
+ * evaluates the kept outputs, each one a dot product of one filter phase with `taps` inputs. The
+ * prototype filter is a sinc windowed by a Kaiser window whose beta gives the preset's stopband
+ * attenuation. The stopband starts at the lower of the two Nyquist frequencies, so nothing above
+ * it aliases back louder than the attenuation, and the passband ends one transition width below.
+ * Decimating widens the filter by M / L taps to keep the same transition width relative to the
+ * output. Every phase is normalised to unity gain at DC.
+ *
+ * Output is pulled: the resampler asks a source for exactly the input the requested outputs need,
+ * so a synth can render at its own rate inside a device callback. The dot products run on the
+ * FIR kernel of the selected RenderKernels.
+ */
+
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include "render.h"
+
+#define RESAMPLE_MAX_PHASES 8192    // largest L, 11025 Hz to 384 kHz needs 5120
+#define RESAMPLE_BLOCK      1024    // input frames asked of the source at most per call
+
+/**
+ * @brief Produce input frames for the resampler
+ *
+ * @param user pointer given to resampler_pull()
+ * @param buffer destination, frames entries
+ * @param frames number of frames to produce, at most RESAMPLE_BLOCK
+ */
+typedef void ( *ResampleSource )( void *user, float *buffer, uint32_t frames );
+
+struct Resampler {
+    SynthArena      arena;        // coefficients and history
+    FirBank         bank;
+    FirKernel       fir;
+    uint32_t        inRate;
+    uint32_t        outRate;
+    ResampleQuality quality;
+    float           passband;     // highest frequency passed flat in Hz
+    float           stopband;     // lowest frequency attenuated fully in Hz
+    double          latency;      // output frames from an input to the output centred on it
+    float          *history;      // inputs the next outputs read, oldest first
+    uint32_t        capacity;     // history entries, taps + RESAMPLE_BLOCK
+    uint32_t        filled;       // history entries holding input
+    uint32_t        next;         // history index of the next output's window
+    uint32_t        phase;        // filter phase of the next output
+};
+
+/**
+ * @brief Design the filter bank for a rate pair, not realtime safe
+ *
+ * @param resampler resampler to set up
+ * @param inRate input rate in Hz
+ * @param outRate output rate in Hz
+ * @param quality filter preset
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR, SYNTH_ERROR_INVALID_PARAM if the reduced ratio needs
+ * more than RESAMPLE_MAX_PHASES phases, or SYNTH_ERROR_OOM
+ */
+SynthError resampler_init(
+  Resampler *resampler, uint32_t inRate, uint32_t outRate, ResampleQuality quality
+);
+
+/**
+ * @brief Free the filter bank and history
+ *
+ * @param resampler resampler to free, may be NULL
+ */
+void       resampler_destroy( Resampler *resampler );
+
+/**
+ * @brief Forget the input seen so far, the next output starts from silence
+ *
+ * @param resampler resampler to reset
+ */
+void       resampler_reset( Resampler *resampler );
+
+/**
+ * @brief Produce output frames, pulling exactly the input they need from a source
+ *
+ * Takes no locks and allocates nothing.
+ *
+ * @param resampler resampler to run
+ * @param out destination, frames entries
+ * @param frames number of output frames
+ * @param source called for input whenever the history runs short
+ * @param user passed to source
+ */
+void       resampler_pull(
+  Resampler *resampler, float *out, uint32_t frames, ResampleSource source, void *user
+);
+
+/**
+ * @brief Count the input frames the next resampler_pull() of a number of outputs will ask for
+ *
+ * @param resampler resampler to query, left unchanged
+ * @param frames number of output frames
+ * @return input frames the source will be asked for
+ */
+uint64_t   resampler_inputs( const Resampler *resampler, uint32_t frames );
+
+#endif
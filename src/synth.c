@@ -1,21 +1,623 @@
-float generate_sample( WaveformType wf, float phase ) {
-    switch ( wf ) {
-        case WAVEFORM_SINE: return sinf( phase );
-        case WAVEFORM_SQUARE:
-            return ( sinf( phase ) >= 0.0f ) ? 1.0f : -1.0f;             // revisit implementation
-        case WAVEFORM_SAW: return 2.0f * fmodf( phase, 1.0f ) - 1.0f;    // revisit implementation
-        case WAVEFORM_TRIANGLE:
-            return 2.0f * fabsf( 2.0f * fmodf( phase, 1.0f ) - 1.0f ) -
-                   1.0f;    // revisit implementation
-    }
-    return 0.0f;
-}
-
-// compute the frequency of a note from parameters
-static float
-  compute_frequency( int noteIndex, float baseFrequency, int baseIndex, float pitchOffset ) {
-    int   clampedIndex     = CLAMP( noteIndex, 0, 107 );
-    float semitoneDistance = (float) ( clampedIndex - baseIndex ) + pitchOffset;
-    float freq             = baseFrequency * powf( 2.0f, semitoneDistance / 12.0f );
-    return freq;
+#include "synth.h"
+
+#include "command.h"
+#include "envelope.h"
+#include "oscillator.h"
+#include "render.h"
+#include "resample.h"
+#include "tuning.h"
+#include "voice.h"
+#include "wavetable.h"
+#include "workers.h"
+
+float get_sample( Synthesizer *synth, BaseWaveform type, float phase ) {
+    if ( type < 0 ) return 0.0f;
+    if ( type < WAVEFORM_COUNT ) return waveform_functions[type]( phase );
+    if ( !synth ) return 0.0f;
+
+    const WaveformSet *set    = wavetable_registry_acquire( synth->waveforms );
+    uint32_t           index  = (uint32_t) type - WAVEFORM_COUNT;
+    float              sample = 0.0f;
+    if ( index < set->count && set->slots[index].entry.func ) {
+        sample = set->slots[index].entry.func( phase );
+    } else if ( index < set->count ) {
+        // borrowed tables have no generator, their fullest octave stands in for it
+        phase  = phase - floorf( phase );
+        sample = wavetable_read( set->slots[index].table->samples,
+                                 (uint32_t) ( (double) phase * 4294967296.0 ) );
+    }
+    wavetable_registry_release( synth->waveforms, set );
+    return sample;
+}
+
+BaseWaveform register_custom_waveform(
+  Synthesizer *synth, WaveformFunction func, const char *name
+) {
+    if ( !synth ) return INVALID_WAVEFORM;
+    return wavetable_registry_add( synth->waveforms, func, name );
+}
+
+void generate_waveform(
+  float *buffer, int length, BaseWaveform type, float frequency, float sample_rate
+) {
+    Oscillator osc;
+    if ( osc_init( &osc, type, sample_rate ) != SYNTH_ACK ) {
+        memset( buffer, 0, sizeof( float ) * length );
+        return;
+    }
+    osc_set_frequency( &osc, frequency );
+    osc_render( &osc, buffer, length );
+}
+
+void generateTone( short *buffer, int numSamples, float frequency ) {
+    Oscillator osc;
+    float      block[SYNTH_BLOCK_SIZE];
+    if ( osc_init( &osc, WAVEFORM_SINE, SAMPLE_RATE ) != SYNTH_ACK ) {
+        memset( buffer, 0, sizeof( short ) * numSamples );
+        return;
+    }
+    osc_set_frequency( &osc, frequency );
+    for ( int offset = 0; offset < numSamples; offset += SYNTH_BLOCK_SIZE ) {
+        int length = numSamples - offset < SYNTH_BLOCK_SIZE ? numSamples - offset
+                                                            : SYNTH_BLOCK_SIZE;
+        osc_render( &osc, block, length );
+        for ( int i = 0; i < length; i++ ) buffer[offset + i] = (short) ( 32767.0f * block[i] );
+    }
+}
+
+SynthError synth_init( Synthesizer *synth, uint32_t maxVoices, uint8_t channels ) {
+    if ( !synth ) return SYNTH_ERROR_NULL_PTR;    // check for invalid parameters
+    if ( maxVoices == 0 ) return SYNTH_ERROR_INVALID_PARAM;
+
+    arena_init( &synth->arena, SYNTH_ARENA_SIZE );    // initialize memory arena
+    if ( !synth->arena.buffer ) return SYNTH_ERROR_OOM;
+
+    // the render thread's scratch space, so block temporaries never touch the shared arena
+    SynthError err = arena_child( &synth->arena, &synth->scratch, SYNTH_SCRATCH_SIZE );
+    if ( err != SYNTH_ACK ) return err;
+
+    // allocate the voice pool, its arrays are carved from the same arena
+    synth->voices = (VoicePool *) arena_alloc( &synth->arena, sizeof( VoicePool ) );
+    if ( !synth->voices ) return SYNTH_ERROR_OOM;    // check for out of memory
+    err = voice_pool_init( synth->voices, &synth->arena, maxVoices );
+    if ( err != SYNTH_ACK ) return err;
+
+    // control thread to render thread command queue
+    synth->commands = (CommandQueue *) arena_alloc_aligned(
+      &synth->arena, sizeof( CommandQueue ), COMMAND_CACHE_LINE
+    );
+    if ( !synth->commands ) return SYNTH_ERROR_OOM;    // check for out of memory
+    err = command_queue_init( synth->commands, &synth->arena, SYNTH_QUEUE_SIZE );
+    if ( err != SYNTH_ACK ) return err;
+    synth->live = (CommandQueue *) arena_alloc_aligned(
+      &synth->arena, sizeof( CommandQueue ), COMMAND_CACHE_LINE
+    );
+    if ( !synth->live ) return SYNTH_ERROR_OOM;    // check for out of memory
+    err = command_queue_init( synth->live, &synth->arena, SYNTH_QUEUE_SIZE );
+    if ( err != SYNTH_ACK ) return err;
+
+    synth->tuning = (Tuning *) arena_alloc( &synth->arena, sizeof( Tuning ) );
+    if ( !synth->tuning ) return SYNTH_ERROR_OOM;    // check for out of memory
+    err = tuning_init( synth->tuning, BASE_TUNING, BASE_INDICE, SAMPLE_RATE );
+    if ( err != SYNTH_ACK ) return err;
+
+    // at most one entry per voice in an index of at least twice as many, so it never fills up
+    uint32_t handles = 2;
+    while ( handles < 2 * maxVoices ) handles <<= 1;
+    synth->noteVoices = (uint32_t *) arena_alloc( &synth->arena, sizeof( uint32_t ) * handles );
+    if ( !synth->noteVoices ) return SYNTH_ERROR_OOM;    // check for out of memory
+    synth->pitchVoices = (uint32_t *) arena_alloc( &synth->arena, sizeof( uint32_t ) * handles );
+    if ( !synth->pitchVoices ) return SYNTH_ERROR_OOM;    // check for out of memory
+    for ( uint32_t n = 0; n < handles; n++ ) {
+        synth->noteVoices[n]  = VOICE_NONE;
+        synth->pitchVoices[n] = VOICE_NONE;
+    }
+    synth->noteMask = handles - 1;
+
+    // custom waveforms, their tables are allocated as they are registered
+    synth->waveforms =
+      (WaveformRegistry *) arena_alloc( &synth->arena, sizeof( WaveformRegistry ) );
+    if ( !synth->waveforms ) return SYNTH_ERROR_OOM;    // check for out of memory
+    err = wavetable_registry_init( synth->waveforms, &synth->arena );
+    if ( err != SYNTH_ACK ) return err;
+
+    // render the base wavetables up front so the audio thread never builds them
+    if ( wavetable_init_defaults() != SYNTH_ACK ) return SYNTH_ERROR_OOM;
+
+    synth->maxVoices          = maxVoices;
+    synth->masterVolume       = 1.0f;
+    synth->masterGain         = 1.0f;
+    synth->sampleRate         = SAMPLE_RATE;
+    synth->outputRate         = SAMPLE_RATE;
+    synth->resampler          = NULL;
+    synth->waveform           = WAVEFORM_SINE;
+    synth->envelope           = (Envelope) { 0.005f, 0.1f, 0.8f, 0.2f, ENVELOPE_CURVE_EXPONENTIAL };
+    synth->priority           = 0;
+    synth->kernels            = render_select_kernels();
+    synth->workers            = NULL;
+    synth->liveWaveforms      = NULL;
+    synth->frame              = 0;
+    synth->nextNote           = 0;
+    synth_atomic_store( &synth->frameTime, 0 );
+
+    // the audio device is opened and attached separately, see synth_platform.h
+    synth->audio    = NULL;
+    synth->channels = channels;
+
+    return SYNTH_ACK;
+}
+
+void synth_destroy( Synthesizer *synth ) {
+    if ( !synth ) return;
+    workers_destroy( synth->workers );
+    resampler_destroy( synth->resampler );
+    free( synth->resampler );
+    wavetable_registry_destroy( synth->waveforms );
+    arena_destroy( &synth->arena );
+    synth->workers   = NULL;
+    synth->resampler = NULL;
+    synth->waveforms = NULL;
+}
+
+// render thread: set a voice's phase increment from its pitch or frequency and bend
+static void synth_tune_voice( Synthesizer *synth, uint32_t v ) {
+    VoicePool *pool  = synth->voices;
+    Voice     *voice = &pool->voices[v];
+    if ( voice->pitch >= 0.0f ) {
+        const TuningTable *table = tuning_acquire( synth->tuning );
+        float              pitch = voice->pitch + voice->bend;
+        voice->frequency         = tuning_frequency( table, pitch );
+        tuning_increment( table, pitch, &pool->phaseIncrement[v], &pool->incrementFraction[v] );
+        tuning_release( synth->tuning, table );
+        return;
+    }
+    float frequency = voice->bend != 0.0f ? voice->frequency * tuning_ratio( voice->bend )
+                                          : voice->frequency;
+    osc_increment(
+      frequency, synth->sampleRate, &pool->phaseIncrement[v], &pool->incrementFraction[v]
+    );
+}
+
+// render thread: the voice playing a note handle, the voice's own note is what identifies it
+static uint32_t synth_note_find( const Synthesizer *synth, uint32_t note ) {
+    const Voice *voices = synth->voices->voices;
+    for ( uint32_t at = note & synth->noteMask; synth->noteVoices[at] != VOICE_NONE;
+          at = ( at + 1 ) & synth->noteMask ) {
+        if ( voices[synth->noteVoices[at]].note == note ) return synth->noteVoices[at];
+    }
+    return VOICE_NONE;
+}
+
+// render thread: index a voice under its note handle, false if every entry is taken, which only
+// voices released behind the index's back can cause
+static bool synth_note_insert( Synthesizer *synth, uint32_t v ) {
+    uint32_t at = synth->voices->voices[v].note & synth->noteMask;
+    for ( uint32_t probes = 0; probes <= synth->noteMask; probes++ ) {
+        if ( synth->noteVoices[at] == VOICE_NONE ) {
+            synth->noteVoices[at] = v;
+            return true;
+        }
+        at = ( at + 1 ) & synth->noteMask;
+    }
+    return false;
+}
+
+// render thread: drop a voice from the index before it is freed or reused, moving later entries
+// of its probe run back into the gap so a search never stops short of a live note
+static void synth_note_erase( Synthesizer *synth, uint32_t v ) {
+    const Voice *voices = synth->voices->voices;
+    uint32_t     mask   = synth->noteMask;
+    uint32_t     hole   = voices[v].note & mask;
+    while ( synth->noteVoices[hole] != v ) {
+        if ( synth->noteVoices[hole] == VOICE_NONE ) return;    // not indexed
+        hole = ( hole + 1 ) & mask;
+    }
+    for ( uint32_t at = ( hole + 1 ) & mask; synth->noteVoices[at] != VOICE_NONE;
+          at = ( at + 1 ) & mask ) {
+        uint32_t home = voices[synth->noteVoices[at]].note & mask;
+        if ( ( ( at - home ) & mask ) >= ( ( at - hole ) & mask ) ) {
+            synth->noteVoices[hole] = synth->noteVoices[at];
+            hole                    = at;
+        }
+    }
+    synth->noteVoices[hole] = VOICE_NONE;
+}
+
+// render thread: entry of pitchVoices for the pitch of a note on, hashed as pitch or frequency
+static uint32_t synth_pitch_slot( const Synthesizer *synth, const SynthCommand *command ) {
+    float    key = command->pitch >= 0.0f ? command->pitch : -command->frequency;
+    uint32_t bits;
+    memcpy( &bits, &key, sizeof( bits ) );
+    bits ^= bits >> 16;
+    bits *= 0x45D9F3Bu;
+    bits ^= bits >> 16;
+    return bits & synth->noteMask;
+}
+
+// render thread: whether a voice from pitchVoices still sounds the pitch of a note on, entries
+// are overwritten on collisions and go stale as voices are stolen or retired
+static bool synth_same_note( const VoicePool *pool, uint32_t v, const SynthCommand *command ) {
+    if ( v >= pool->capacity || pool->heapSlot[v] == VOICE_NONE ) return false;
+    const Voice *voice = &pool->voices[v];
+    if ( command->pitch >= 0.0f ) return voice->pitch == command->pitch;
+    return voice->pitch < 0.0f && voice->frequency == command->frequency;
+}
+
+// render thread: apply a single command at the current frame
+static void synth_apply_command( Synthesizer *synth, const SynthCommand *command ) {
+    VoicePool *pool = synth->voices;
+    switch ( command->type ) {
+        case SYNTH_CMD_NOTE_ON: {
+            uint32_t *same = &synth->pitchVoices[synth_pitch_slot( synth, command )];
+            uint32_t  v    = *same;
+            if ( pool->policy == VOICE_STEAL_SAME_NOTE && synth_same_note( pool, v, command ) ) {
+                // the pitch already sounds, start it over on its voice instead of doubling it
+                synth_note_erase( synth, v );
+                voice_pool_retrigger( pool, v );
+            } else if ( ( v = voice_pool_alloc( pool ) ) != VOICE_NONE ) {
+                pool->envLevel[v]      = 0.0f;
+                pool->phase[v]         = 0;
+                pool->phaseFraction[v] = 0;
+            } else {
+                v = voice_pool_victim( pool );
+                synth_note_erase( synth, v );
+                if ( pool->numFree > 0 ) {
+                    // out of voices, the victim fades out in a spare slot while the note starts
+                    // from silence in another
+                    envelope_fade( pool, v, synth->sampleRate );
+                    voice_pool_fade( pool, v );
+                    v                      = voice_pool_alloc( pool );
+                    pool->envLevel[v]      = 0.0f;
+                    pool->phase[v]         = 0;
+                    pool->phaseFraction[v] = 0;
+                } else {
+                    // every spare slot is still fading, take the victim over where its phase
+                    // and level are so it does not jump
+                    voice_pool_retrigger( pool, v );
+                }
+            }
+            pool->waveform[v]         = command->waveform;
+            pool->amplitude[v]        = command->value;
+            pool->gate[v]             = 1;
+            pool->voices[v].note      = command->note;
+            pool->voices[v].frequency = command->frequency;
+            pool->voices[v].pitch     = command->pitch;
+            pool->voices[v].bend      = 0.0f;
+            pool->voices[v].env       = command->envelope;
+            pool->voices[v].priority  = command->priority;
+            synth_tune_voice( synth, v );
+            envelope_note_on( pool, v, synth->sampleRate );
+            voice_pool_update( pool, v );
+            *same = v;
+            if ( !synth_note_insert( synth, v ) ) voice_pool_release( pool, v );
+            break;
+        }
+        case SYNTH_CMD_NOTE_OFF: {
+            // none if the voice was stolen or retired since the note started
+            uint32_t v = synth_note_find( synth, command->note );
+            if ( v != VOICE_NONE ) {
+                pool->gate[v] = 0;
+                envelope_note_off( pool, v, synth->sampleRate );
+            }
+            break;
+        }
+        case SYNTH_CMD_PITCH_BEND: {
+            uint32_t v = synth_note_find( synth, command->note );
+            if ( v != VOICE_NONE ) {
+                pool->voices[v].bend = command->value;
+                synth_tune_voice( synth, v );
+            }
+            break;
+        }
+        case SYNTH_CMD_MASTER_VOLUME: synth->masterVolume = command->value; break;
+    }
+}
+
+// WorkerTask: envelope a group of live voices, then mix each of them with its gain row
+static void synth_render_group(
+  void *user, uint32_t group, float *partial, float *gain, int length
+) {
+    Synthesizer   *synth     = (Synthesizer *) user;
+    VoiceMixKernel mix_voice = synth->kernels->mix_voice;
+    VoicePool     *pool      = synth->voices;
+    uint32_t       base      = group * WORKERS_GROUP_VOICES;
+    uint32_t       count     = pool->numActive - base;
+    if ( count > WORKERS_GROUP_VOICES ) count = WORKERS_GROUP_VOICES;
+    envelope_render(
+      pool, synth->kernels->envelope, pool->active + base, count, gain, SYNTH_BLOCK_SIZE, length,
+      synth->sampleRate
+    );
+    for ( uint32_t k = 0; k < count; k++ ) {
+        uint32_t         v     = pool->active[base + k];
+        const WaveTable *table = wavetable_lookup( synth->liveWaveforms, pool->waveform[v] );
+        if ( !table ) {
+            pool->envStage[v] = ENVELOPE_IDLE;
+            continue;
+        }
+        mix_voice(
+          partial, wavetable_octave_table( table, wavetable_octave( pool->phaseIncrement[v] ) ),
+          &pool->phase[v], pool->phaseIncrement[v], gain + k * SYNTH_BLOCK_SIZE, length
+        );
+        osc_carry( &pool->phase[v], &pool->phaseFraction[v], pool->incrementFraction[v], length );
+    }
+}
+
+// render thread: mix every live voice into a span of at most SYNTH_BLOCK_SIZE samples
+static void synth_render_span( Synthesizer *synth, float *out, int length ) {
+    VoicePool *pool   = synth->voices;
+    uint32_t   groups = ( pool->numActive + WORKERS_GROUP_VOICES - 1 ) / WORKERS_GROUP_VOICES;
+
+    // one set of custom waveforms for the whole span, whichever thread mixes a voice
+    synth->liveWaveforms = wavetable_registry_acquire( synth->waveforms );
+    workers_render(
+      synth->workers, &synth->scratch, synth_render_group, synth, groups, out, length
+    );
+    wavetable_registry_release( synth->waveforms, synth->liveWaveforms );
+    synth->liveWaveforms = NULL;
+
+    // retire the voices that went silent; a retired voice is replaced by the last one in the list
+    for ( uint32_t a = 0; a < pool->numActive; ) {
+        uint32_t v = pool->active[a];
+        if ( pool->envStage[v] == ENVELOPE_IDLE ) {
+            synth_note_erase( synth, v );
+            voice_pool_release( pool, v );
+            continue;
+        }
+        if ( pool->policy == VOICE_STEAL_QUIETEST ) voice_pool_update( pool, v );
+        a++;
+    }
+
+    // master volume changes ramp across the span to avoid clicks
+    if ( synth->masterGain != synth->masterVolume ) {
+        ArenaMark mark = arena_mark( &synth->scratch );
+        float    *gain = (float *) arena_alloc( &synth->scratch, sizeof( float ) * length );
+        if ( !gain ) return;
+        render_gain_ramp( gain, synth->masterGain, synth->masterVolume, length );
+        for ( int i = 0; i < length; i++ ) out[i] *= gain[i];
+        synth->masterGain = synth->masterVolume;
+        arena_rewind( &synth->scratch, mark );
+    } else if ( synth->masterGain != 1.0f ) {
+        for ( int i = 0; i < length; i++ ) out[i] *= synth->masterGain;
+    }
+}
+
+// render thread: render at the render rate, a block at a time
+static void synth_render_blocks( Synthesizer *synth, float *buffer, int numSamples ) {
+    for ( int offset = 0; offset < numSamples; offset += SYNTH_BLOCK_SIZE ) {
+        int    length = numSamples - offset < SYNTH_BLOCK_SIZE ? numSamples - offset
+                                                               : SYNTH_BLOCK_SIZE;
+        float *out    = buffer + offset;
+        memset( out, 0, sizeof( float ) * length );
+
+        // commands for now go ahead of everything queued for a later frame
+        const SynthCommand *live = command_queue_peek( synth->live );
+        while ( live ) {
+            synth_apply_command( synth, live );
+            command_queue_pop( synth->live );
+            live = command_queue_peek( synth->live );
+        }
+
+        // split the block at every command timestamp that falls inside it
+        for ( int position = 0; position < length; ) {
+            uint64_t            now     = synth->frame + (uint64_t) position;
+            const SynthCommand *command = command_queue_peek( synth->commands );
+            while ( command && command->time <= now ) {
+                synth_apply_command( synth, command );
+                command_queue_pop( synth->commands );
+                command = command_queue_peek( synth->commands );
+            }
+
+            int end = length;
+            if ( command && command->time < synth->frame + (uint64_t) length ) {
+                end = (int) ( command->time - synth->frame );
+            }
+            synth_render_span( synth, out + position, end - position );
+            position = end;
+        }
+
+        synth->frame += (uint64_t) length;
+        synth_atomic_store( &synth->frameTime, synth->frame );
+    }
+}
+
+// ResampleSource: the resampler asks for exactly the render rate frames it needs
+static void synth_render_source( void *user, float *buffer, uint32_t frames ) {
+    synth_render_blocks( (Synthesizer *) user, buffer, (int) frames );
+}
+
+void synth_process_buffer( Synthesizer *synth, float *buffer, int numSamples ) {
+    if ( !synth || !buffer ) return;
+    if ( synth->resampler ) {
+        if ( numSamples <= 0 ) return;
+        resampler_pull(
+          synth->resampler, buffer, (uint32_t) numSamples, synth_render_source, synth
+        );
+        return;
+    }
+    synth_render_blocks( synth, buffer, numSamples );
+}
+
+uint64_t synth_frame_time( Synthesizer *synth ) {
+    return synth ? synth_atomic_load( &synth->frameTime ) : 0;
+}
+
+uint64_t synth_render_frames( const Synthesizer *synth, uint32_t frames ) {
+    if ( !synth || !synth->resampler ) return frames;
+    return resampler_inputs( synth->resampler, frames );
+}
+
+// control thread: queue a command, those for now on a queue of their own
+static bool synth_push( Synthesizer *synth, const SynthCommand *command ) {
+    CommandQueue *queue = command->time == SYNTH_TIME_NOW ? synth->live : synth->commands;
+    return command_queue_push( queue, command );
+}
+
+int synth_trigger_note_at( Synthesizer *synth, uint64_t time, float frequency, float amplitude ) {
+    if ( !synth ) return SYNTH_ERROR_NULL_PTR;
+    if ( frequency <= 0.0f ) return SYNTH_ERROR_INVALID_PARAM;
+
+    // handles stay non-negative so they can share the return value with error codes
+    uint32_t     note    = synth->nextNote & 0x7FFFFFFFu;
+    SynthCommand command = {
+      .time      = time,
+      .type      = SYNTH_CMD_NOTE_ON,
+      .note      = note,
+      .waveform  = synth->waveform,
+      .frequency = frequency,
+      .pitch     = -1.0f,
+      .value     = amplitude,
+      .envelope  = synth->envelope,
+      .priority  = synth->priority,
+    };
+    if ( !synth_push( synth, &command ) ) return SYNTH_ERROR_BUFFER_OVERFLOW;
+    synth->nextNote++;
+    return (int) note;
+}
+
+int synth_trigger_pitch_at( Synthesizer *synth, uint64_t time, float pitch, float amplitude ) {
+    if ( !synth ) return SYNTH_ERROR_NULL_PTR;
+    if ( !( pitch >= 0.0f ) ) return SYNTH_ERROR_INVALID_PARAM;
+
+    uint32_t     note    = synth->nextNote & 0x7FFFFFFFu;
+    SynthCommand command = {
+      .time     = time,
+      .type     = SYNTH_CMD_NOTE_ON,
+      .note     = note,
+      .waveform = synth->waveform,
+      .pitch    = pitch,
+      .value    = amplitude,
+      .envelope = synth->envelope,
+      .priority = synth->priority,
+    };
+    if ( !synth_push( synth, &command ) ) return SYNTH_ERROR_BUFFER_OVERFLOW;
+    synth->nextNote++;
+    return (int) note;
+}
+
+SynthError synth_bend_note_at( Synthesizer *synth, uint64_t time, int note, float semitones ) {
+    if ( !synth ) return SYNTH_ERROR_NULL_PTR;
+    if ( note < 0 ) return SYNTH_ERROR_INVALID_PARAM;
+
+    SynthCommand command = {
+      .time  = time,
+      .type  = SYNTH_CMD_PITCH_BEND,
+      .note  = (uint32_t) note,
+      .value = semitones,
+    };
+    if ( !synth_push( synth, &command ) ) return SYNTH_ERROR_BUFFER_OVERFLOW;
+    return SYNTH_ACK;
+}
+
+SynthError synth_set_waveform( Synthesizer *synth, BaseWaveform type ) {
+    if ( !synth ) return SYNTH_ERROR_NULL_PTR;
+    const WaveformSet *set   = wavetable_registry_acquire( synth->waveforms );
+    bool               known = wavetable_lookup( set, type ) != NULL;
+    wavetable_registry_release( synth->waveforms, set );
+    if ( !known ) return SYNTH_ERROR_INVALID_PARAM;
+    synth->waveform = type;
+    return SYNTH_ACK;
+}
+
+SynthError synth_set_envelope( Synthesizer *synth, const Envelope *envelope ) {
+    if ( !synth ) return SYNTH_ERROR_NULL_PTR;
+    SynthError err = envelope_validate( envelope );
+    if ( err != SYNTH_ACK ) return err;
+    synth->envelope = *envelope;
+    return SYNTH_ACK;
+}
+
+SynthError synth_set_note_priority( Synthesizer *synth, uint8_t priority ) {
+    if ( !synth ) return SYNTH_ERROR_NULL_PTR;
+    synth->priority = priority;
+    return SYNTH_ACK;
+}
+
+SynthError synth_set_steal_policy( Synthesizer *synth, VoiceStealPolicy policy ) {
+    if ( !synth ) return SYNTH_ERROR_NULL_PTR;
+    return voice_pool_set_policy( synth->voices, policy );
+}
+
+SynthError synth_set_threads( Synthesizer *synth, uint32_t threads, int priority ) {
+    if ( !synth ) return SYNTH_ERROR_NULL_PTR;
+    if ( threads == 0 || threads > WORKERS_MAX_THREADS ) return SYNTH_ERROR_INVALID_PARAM;
+    workers_destroy( synth->workers );
+    synth->workers = NULL;
+    if ( threads == 1 ) return SYNTH_ACK;
+    synth->workers = workers_create( threads, synth->voices->capacity, priority );
+    return synth->workers ? SYNTH_ACK : SYNTH_ERROR_INIT_FAILED;
+}
+
+void synth_silence( Synthesizer *synth ) {
+    if ( !synth ) return;
+    VoicePool *pool = synth->voices;
+    while ( pool->numActive ) voice_pool_release( pool, pool->active[0] );
+    for ( uint32_t n = 0; n <= synth->noteMask; n++ ) synth->noteVoices[n] = VOICE_NONE;
+}
+
+SynthError synth_set_sample_rate(
+  Synthesizer *synth, uint32_t renderRate, uint32_t outputRate, ResampleQuality quality
+) {
+    if ( !synth ) return SYNTH_ERROR_NULL_PTR;
+    if ( renderRate == 0 || outputRate == 0 ) return SYNTH_ERROR_INVALID_PARAM;
+
+    // build the new resampler before anything changes, so a failure leaves the synth as it was
+    Resampler *resampler = NULL;
+    if ( renderRate != outputRate ) {
+        resampler = (Resampler *) malloc( sizeof( Resampler ) );
+        if ( !resampler ) return SYNTH_ERROR_OOM;
+        SynthError err = resampler_init( resampler, renderRate, outputRate, quality );
+        if ( err != SYNTH_ACK ) {
+            free( resampler );
+            return err;
+        }
+    }
+
+    // the same reference pitch, with increments for the new render rate
+    const TuningTable *table      = tuning_acquire( synth->tuning );
+    float              baseTuning = table->baseTuning;
+    int                baseIndex  = table->baseIndex;
+    tuning_release( synth->tuning, table );
+    tuning_retune( synth->tuning, baseTuning, baseIndex, (float) renderRate );
+
+    resampler_destroy( synth->resampler );
+    free( synth->resampler );
+    synth->resampler  = resampler;
+    synth->sampleRate = (float) renderRate;
+    synth->outputRate = (float) outputRate;
+    for ( uint32_t a = 0; a < synth->voices->numActive; a++ ) {
+        synth_tune_voice( synth, synth->voices->active[a] );
+    }
+    return SYNTH_ACK;
+}
+
+SynthError synth_retune( Synthesizer *synth, float baseTuning, int baseIndex ) {
+    if ( !synth ) return SYNTH_ERROR_NULL_PTR;
+    return tuning_retune( synth->tuning, baseTuning, baseIndex, synth->sampleRate );
+}
+
+int synth_trigger_note( Synthesizer *synth, float frequency, float amplitude ) {
+    return synth_trigger_note_at( synth, SYNTH_TIME_NOW, frequency, amplitude );
+}
+
+SynthError synth_release_note_at( Synthesizer *synth, uint64_t time, int note ) {
+    if ( !synth ) return SYNTH_ERROR_NULL_PTR;
+    if ( note < 0 ) return SYNTH_ERROR_INVALID_PARAM;
+
+    SynthCommand command = { .time = time, .type = SYNTH_CMD_NOTE_OFF, .note = (uint32_t) note };
+    if ( !synth_push( synth, &command ) ) return SYNTH_ERROR_BUFFER_OVERFLOW;
+    return SYNTH_ACK;
+}
+
+void synth_release_note( Synthesizer *synth, int voiceIndex ) {
+    synth_release_note_at( synth, SYNTH_TIME_NOW, voiceIndex );
+}
+
+void synth_set_master_volume( Synthesizer *synth, float volume ) {
+    if ( !synth ) return;
+    SynthCommand command = {
+      .time  = SYNTH_TIME_NOW,
+      .type  = SYNTH_CMD_MASTER_VOLUME,
+      .value = volume,
+    };
+    synth_push( synth, &command );
 }
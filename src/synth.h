@@ -8,31 +8,16 @@
 #define SYNTH_H
 
 // top level includes
-#include <cstdint>
-#include <cstdlib>
 #include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-// platform identification
+// platform headers the atomics below need, audio backends live in synth_platform.h
 #ifdef _WIN32
   #include <windows.h>
-  #define AUDIO_API_WINDOWS
-  #include <mmeapi.h>
-  #include <mmsystem.h>
-  #ifdef _MSC_VER
-    #pragma comment( lib, "winm.lib" )
-  #endif
-extern HWAVEOUT hWaveOut;
-extern WAVEHDR  waveHeader;
-#elif __LINUX__
-  #define AUDIO_API_ALSA
-  #include <alsa/asoundlib.h>
-  #include <pthread.h>
-#elif __APPLE__
-  #define AUDIO_API_COREAUDIO
-  #include <AudioUnit/AudioUnit.h>
-  #include <pthread.h>
 #endif
 
 /******************
@@ -47,7 +32,8 @@ typedef enum SynthError {
     SYNTH_ERROR_INIT_FAILED         = -5,
     SYNTH_ERROR_EXCEEDED_MAX_VOICES = -6,
     SYNTH_ERROR_VOICE_NOT_FOUND     = -7,
-    SYNTH_ERROR_ARENA_FULL          = -8
+    SYNTH_ERROR_ARENA_FULL          = -8,
+    SYNTH_ERROR_IO                  = -9
 } SynthError;
 
 /*************
@@ -55,125 +41,384 @@ typedef enum SynthError {
  ************/
 #define PI                 3.14159265358979323846f
 #define SAMPLE_RATE        44100
-#define BIT_RATE           16
+#define BIT_RATE           16    // device bit depth when the config leaves it to the backend
 #define MAX_VOICES         64
 #define BUFFER_SIZE        ( SAMPLE_RATE * 2 )
-#define MAX_BASE_WAVEFORMS 16
+#define SYNTH_WAVEFORMS    1024    // custom waveforms one synthesizer can register
+#define SYNTH_BLOCK_SIZE   64      // samples rendered per voice between state updates
+#define SYNTH_QUEUE_SIZE   1024    // pending control commands, power of two
+#define SYNTH_TIME_NOW     0       // command timestamp meaning "at the start of the next block"
+
+/***********
+ * ATOMICS *
+ **********/
+// 64 bit atomic shared between the control and audio threads, pointers are stored as uintptr_t
+#if defined( _MSC_VER ) && !defined( __clang__ )
+typedef volatile LONG64 SynthAtomic;
+
+static inline uint64_t synth_atomic_load( SynthAtomic *atom ) {
+    return (uint64_t) InterlockedOr64( atom, 0 );
+}
+
+static inline void synth_atomic_store( SynthAtomic *atom, uint64_t value ) {
+    InterlockedExchange64( atom, (LONG64) value );
+}
+
+static inline uint64_t synth_atomic_fetch_add( SynthAtomic *atom, uint64_t value ) {
+    return (uint64_t) InterlockedExchangeAdd64( atom, (LONG64) value );
+}
+
+static inline bool synth_atomic_cas( SynthAtomic *atom, uint64_t *expected, uint64_t desired ) {
+    LONG64 seen = InterlockedCompareExchange64( atom, (LONG64) desired, (LONG64) *expected );
+    if ( (uint64_t) seen == *expected ) return true;
+    *expected = (uint64_t) seen;
+    return false;
+}
+
+// full barrier, orders an earlier store before a later load
+static inline void synth_atomic_fence( void ) { MemoryBarrier(); }
+#else
+  #include <stdatomic.h>
+typedef _Atomic uint64_t SynthAtomic;
+
+static inline uint64_t synth_atomic_load( SynthAtomic *atom ) {
+    return atomic_load_explicit( atom, memory_order_acquire );
+}
+
+static inline void synth_atomic_store( SynthAtomic *atom, uint64_t value ) {
+    atomic_store_explicit( atom, value, memory_order_release );
+}
+
+static inline uint64_t synth_atomic_fetch_add( SynthAtomic *atom, uint64_t value ) {
+    return atomic_fetch_add_explicit( atom, value, memory_order_acq_rel );
+}
+
+static inline bool synth_atomic_cas( SynthAtomic *atom, uint64_t *expected, uint64_t desired ) {
+    return atomic_compare_exchange_weak_explicit(
+      atom, expected, desired, memory_order_acq_rel, memory_order_acquire
+    );
+}
+
+// full barrier, orders an earlier store before a later load
+static inline void synth_atomic_fence( void ) { atomic_thread_fence( memory_order_seq_cst ); }
+#endif
+
+// give up the rest of the time slice while waiting on another thread
+#ifdef _WIN32
+static inline void synth_yield( void ) { SwitchToThread(); }
+#else
+  #include <sched.h>
+static inline void synth_yield( void ) { sched_yield(); }
+#endif
+
+// two copies of something render threads read and one control thread replaces: a reader counts
+// itself into the live copy and never waits, the writer fills the spare copy once the last reader
+// that got in before the previous swap has left it, which is at most one block, then swaps
+typedef struct {
+    SynthAtomic current;       // index of the live copy
+    SynthAtomic readers[2];    // render threads inside each copy
+} SynthSwap;
+
+static inline void synth_swap_init( SynthSwap *swap ) {
+    synth_atomic_store( &swap->current, 0 );
+    synth_atomic_store( &swap->readers[0], 0 );
+    synth_atomic_store( &swap->readers[1], 0 );
+}
+
+// index of the live copy, control thread only
+static inline uint64_t synth_swap_live( SynthSwap *swap ) {
+    return synth_atomic_load( &swap->current );
+}
+
+// reader: count in to the live copy and return its index
+static inline uint64_t synth_swap_enter( SynthSwap *swap ) {
+    for ( ;; ) {
+        uint64_t index = synth_atomic_load( &swap->current );
+        synth_atomic_fetch_add( &swap->readers[index], 1 );
+        synth_atomic_fence();
+
+        // the copy may have been swapped out between the load and the count, try again
+        if ( synth_atomic_load( &swap->current ) == index ) return index;
+        synth_atomic_fetch_add( &swap->readers[index], UINT64_MAX );
+    }
+}
+
+// reader: count out of a copy synth_swap_enter() returned
+static inline void synth_swap_leave( SynthSwap *swap, uint64_t index ) {
+    synth_atomic_fetch_add( &swap->readers[index], UINT64_MAX );
+}
+
+// writer: wait until no reader is left in the spare copy and return its index to fill
+static inline uint64_t synth_swap_spare( SynthSwap *swap ) {
+    uint64_t spare = synth_atomic_load( &swap->current ) ^ 1;
+    synth_atomic_fence();
+    while ( synth_atomic_load( &swap->readers[spare] ) != 0 ) synth_yield();
+    return spare;
+}
+
+// writer: make the filled spare copy the live one
+static inline void synth_swap_publish( SynthSwap *swap, uint64_t spare ) {
+    synth_atomic_store( &swap->current, spare );
+    synth_atomic_fence();
+}
+
+/***********
+ * THREADS *
+ **********/
+#ifndef _WIN32
+  #include <pthread.h>
+#endif
+
+typedef void ( *SynthThreadEntry )( void *arg );
+
+// audio thread: the render thread of a driver or a render worker
+typedef struct {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    SynthThreadEntry entry;
+    void            *arg;
+    bool             realtime;    // the thread got its realtime priority
+} SynthThread;
+
+#ifdef _WIN32
+static inline DWORD WINAPI synth_thread_main( LPVOID thread ) {
+    ( (SynthThread *) thread )->entry( ( (SynthThread *) thread )->arg );
+    return 0;
+}
+#else
+static inline void *synth_thread_main( void *thread ) {
+    ( (SynthThread *) thread )->entry( ( (SynthThread *) thread )->arg );
+    return NULL;
+}
+#endif
+
+/**
+ * @brief Start a thread, asking for realtime scheduling first
+ *
+ * Realtime means SCHED_FIFO at the given priority, or THREAD_PRIORITY_TIME_CRITICAL on Windows.
+ * When that is refused, usually for lack of permission, the thread runs at normal priority and
+ * thread->realtime is left false.
+ *
+ * @param thread thread to start, must stay put until synth_thread_join()
+ * @param entry thread function
+ * @param arg passed to entry
+ * @param priority SCHED_FIFO priority, negative for a normal thread
+ * @return true if the thread is running
+ */
+static inline bool synth_thread_start(
+  SynthThread *thread, SynthThreadEntry entry, void *arg, int priority
+) {
+    thread->entry    = entry;
+    thread->arg      = arg;
+    thread->realtime = false;
+#ifdef _WIN32
+    thread->handle = CreateThread( NULL, 0, synth_thread_main, thread, CREATE_SUSPENDED, NULL );
+    if ( !thread->handle ) return false;
+    thread->realtime =
+      priority >= 0 && SetThreadPriority( thread->handle, THREAD_PRIORITY_TIME_CRITICAL );
+    ResumeThread( thread->handle );
+    return true;
+#else
+    if ( priority >= 0 ) {
+        pthread_attr_t     attr;
+        struct sched_param param = { .sched_priority = priority };
+        pthread_attr_init( &attr );
+        pthread_attr_setinheritsched( &attr, PTHREAD_EXPLICIT_SCHED );
+        pthread_attr_setschedpolicy( &attr, SCHED_FIFO );
+        pthread_attr_setschedparam( &attr, &param );
+        thread->realtime = pthread_create( &thread->handle, &attr, synth_thread_main, thread ) == 0;
+        pthread_attr_destroy( &attr );
+        if ( thread->realtime ) return true;
+    }
+    return pthread_create( &thread->handle, NULL, synth_thread_main, thread ) == 0;
+#endif
+}
+
+// wait for a thread started by synth_thread_start() to return
+static inline void synth_thread_join( SynthThread *thread ) {
+#ifdef _WIN32
+    WaitForSingleObject( thread->handle, INFINITE );
+    CloseHandle( thread->handle );
+#else
+    pthread_join( thread->handle, NULL );
+#endif
+}
 
 /****************
  * MEMORY ARENA *
  ***************/
 #define SYNTH_ARENA_SIZE   1024 * 1024    // 1MB
 #define SYNTH_ARENA_ALIGN  8
+#define SYNTH_SCRATCH_SIZE 64 * 1024    // per-thread scratch carved from the synth arena
 
+// bump allocator; allocation is a lock-free compare-and-swap on the offset
+typedef struct {
+    uint8_t    *buffer;
+    size_t      size;
+    SynthAtomic used;        // bump offset
+    SynthAtomic peak;        // high-water mark of used
+    SynthAtomic failures;    // allocations refused because the arena was full
+    bool        owned;       // buffer was malloc'd by arena_init, not carved from a parent
+} SynthArena;
+
+// position in an arena to rewind scratch allocations to
+typedef uint64_t ArenaMark;
+
+// usage report, see arena_stats()
 typedef struct {
-    uint8_t *buffer;
     size_t   size;
     size_t   used;
-#if defined(__linux__) ||  defined(__APPLE__)
-    pthread_mutex_t mutex;
-#elif defined( _WIN32 )
-    CRITICAL_SECTION mutex;
-#endif
-} SynthArena;
+    size_t   peak;
+    uint64_t failures;
+} ArenaStats;
 
 /**
- * @brief [TODO:description]
+ * @brief Initialize an arena backed by a fresh heap buffer
  *
- * @param arena [TODO:parameter]
- * @param size [TODO:parameter]
+ * @param arena arena to initialize
+ * @param size capacity in bytes
  */
 static inline void arena_init( SynthArena *arena, size_t size ) {
     if ( !arena ) return;
     arena->buffer = (uint8_t *) malloc( size );
-    arena->size   = size;
-    arena->used   = 0;
-#if defined( __linux__ ) || defined( __APPLE__ )
-    pthread_mutex_init( &arena->mutex, NULL );
-#elif defined( _WIN32 )
-    InitializeCriticalSection( &arena->mutex );
-#endif
+    arena->size   = arena->buffer ? size : 0;
+    arena->owned  = true;
+    synth_atomic_store( &arena->used, 0 );
+    synth_atomic_store( &arena->peak, 0 );
+    synth_atomic_store( &arena->failures, 0 );
 }
 
 /**
- * @brief [TODO:description]
+ * @brief Allocate from the arena with a stricter alignment than SYNTH_ARENA_ALIGN
+ *
+ * Safe to call from several threads at once and never blocks, a racing allocation only costs a
+ * retry of the compare-and-swap.
  *
- * @param arena [TODO:parameter]
+ * @param arena arena to allocate from
+ * @param size number of bytes
+ * @param align power of two alignment of the returned pointer
+ * @return aligned pointer, or NULL if the arena is full
  */
-static inline void arena_lock( SynthArena *arena ) {
-#if defined( __linux__ ) || defined( __APPLE__ )
-    pthread_mutex_lock( &arena->mutex );
-#elif defined( _WIN32 )
-    EnterCriticalSection( &arena->mutex );
-#endif
+static inline void *arena_alloc_aligned( SynthArena *arena, size_t size, size_t align ) {
+    if ( !arena || !arena->buffer ) return NULL;
+    size = ( size + SYNTH_ARENA_ALIGN - 1 ) & ~( SYNTH_ARENA_ALIGN - 1 );    // align size
+
+    uint64_t used = synth_atomic_load( &arena->used );
+    uint64_t next;
+    size_t   padding;
+    do {
+        uintptr_t base = (uintptr_t) ( arena->buffer + used );
+        padding        = ( align - ( base & ( align - 1 ) ) ) & ( align - 1 );
+        next           = used + padding + size;
+
+        // if the arena is full, return NULL
+        if ( next > arena->size ) {
+            synth_atomic_fetch_add( &arena->failures, 1 );
+            return NULL;
+        }
+    } while ( !synth_atomic_cas( &arena->used, &used, next ) );
+
+    // raise the high-water mark, losing the race to a bigger value is fine
+    uint64_t peak = synth_atomic_load( &arena->peak );
+    while ( peak < next && !synth_atomic_cas( &arena->peak, &peak, next ) ) {}
+
+    return arena->buffer + used + padding;
 }
 
 /**
- * @brief [TODO:description]
+ * @brief Allocate from the arena
  *
- * @param arena [TODO:parameter]
+ * @param arena arena to allocate from
+ * @param size number of bytes
+ * @return pointer aligned to SYNTH_ARENA_ALIGN, or NULL if the arena is full
  */
-static inline void arena_unlock( SynthArena *arena ) {
-#if defined( __linux__ ) || defined( __APPLE__ )
-    pthread_mutex_unlock( &arena->mutex );
-#elif defined( _WIN32 )
-    LeaveCriticalSection( &arena->mutex );
-#endif
+static inline void *arena_alloc( SynthArena *arena, size_t size ) {
+    return arena_alloc_aligned( arena, size, SYNTH_ARENA_ALIGN );
 }
 
 /**
- * @brief [TODO:description]
+ * @brief Carve a child arena out of a parent
+ *
+ * Give each thread its own child so their allocations never contend; the child's memory goes
+ * back to the parent only when the parent is reset.
  *
- * @param arena [TODO:parameter]
- * @param size [TODO:parameter]
+ * @param parent arena to carve from
+ * @param child arena to initialize
+ * @param size capacity of the child in bytes
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_ARENA_FULL
  */
-static inline void *arena_alloc( SynthArena *arena, size_t size ) {
-    // if the arena is not initialized or the buffer is NULL, return NULL
-    if ( !arena || !arena->buffer ) return NULL;
-    arena_lock( arena );                                                     // lock the arena
-    size = ( size + SYNTH_ARENA_ALIGN - 1 ) & ~( SYNTH_ARENA_ALIGN - 1 );    // align size
-
-    // if the arena is full, return NULL
-    if ( arena->used + size > arena->size ) {
-        arena_unlock( arena );    // unlock the arena
-        return NULL;
-    }
+static inline SynthError arena_child( SynthArena *parent, SynthArena *child, size_t size ) {
+    if ( !parent || !child ) return SYNTH_ERROR_NULL_PTR;
+    child->buffer = (uint8_t *) arena_alloc_aligned( parent, size, 64 );
+    if ( !child->buffer ) return SYNTH_ERROR_ARENA_FULL;
+    child->size  = size;
+    child->owned = false;
+    synth_atomic_store( &child->used, 0 );
+    synth_atomic_store( &child->peak, 0 );
+    synth_atomic_store( &child->failures, 0 );
+    return SYNTH_ACK;
+}
 
-    void *ptr    = arena->buffer + arena->used;    // get the pointer
-    arena->used += size;                           // update the used size
+/**
+ * @brief Remember the current position of a scratch arena
+ *
+ * @param arena arena owned by the calling thread
+ * @return mark to hand to arena_rewind()
+ */
+static inline ArenaMark arena_mark( SynthArena *arena ) {
+    return synth_atomic_load( &arena->used );
+}
 
-    arena_unlock( arena );    // unlock the arena
-    return ptr;               // return the pointer
+/**
+ * @brief Free everything allocated since a mark
+ *
+ * Only valid on an arena no other thread allocates from, typically a per-thread child.
+ *
+ * @param arena arena owned by the calling thread
+ * @param mark position from arena_mark()
+ */
+static inline void arena_rewind( SynthArena *arena, ArenaMark mark ) {
+    synth_atomic_store( &arena->used, mark );
 }
 
 /**
- * @brief [TODO:description]
+ * @brief Free every allocation at once
  *
- * @param arena [TODO:parameter]
+ * @param arena arena to reset, no other thread may be allocating from it
  */
 static inline void arena_reset( SynthArena *arena ) {
     if ( !arena ) return;
-    arena_lock( arena );
-    arena->used = 0;
-    arena_unlock( arena );
+    synth_atomic_store( &arena->used, 0 );
+}
+
+/**
+ * @brief Report the arena's size, current use and high-water mark
+ *
+ * @param arena arena to inspect
+ * @param stats filled with the current numbers
+ */
+static inline void arena_stats( SynthArena *arena, ArenaStats *stats ) {
+    if ( !arena || !stats ) return;
+    stats->size     = arena->size;
+    stats->used     = (size_t) synth_atomic_load( &arena->used );
+    stats->peak     = (size_t) synth_atomic_load( &arena->peak );
+    stats->failures = synth_atomic_load( &arena->failures );
 }
 
 /**
- * @brief [TODO:description]
+ * @brief Release the arena's buffer if it owns one
  *
- * @param arena [TODO:parameter]
+ * @param arena arena to destroy
  */
 static inline void arena_destroy( SynthArena *arena ) {
     if ( !arena ) return;
-#if defined( __linux__ ) || defined( __APPLE__ )
-    pthread_mutex_destroy( &arena->mutex );
-#elif defined( _WIN32 )
-    DeleteCriticalSection( &arena->mutex );
-#endif
-    free( arena->buffer );
+    if ( arena->owned ) free( arena->buffer );
     arena->buffer = NULL;
     arena->size   = 0;
-    arena->used   = 0;
+    synth_atomic_store( &arena->used, 0 );
 }
 
 /*******************************
@@ -192,112 +437,127 @@ typedef enum {
 // function pointer type for waveform generation
 typedef float ( *WaveformFunction )( float phase );
 
-// ADSR envelope
+// shape of the decay and release segments of an envelope
+typedef enum {
+    ENVELOPE_CURVE_LINEAR,
+    ENVELOPE_CURVE_EXPONENTIAL    // falls 80 dB over the segment time, then lands on the target
+} EnvelopeCurve;
+
+// ADSR envelope settings, times in seconds
 typedef struct {
-    bool    isActive;
-    uint8_t attack;
-    uint8_t decay;
-    uint8_t sustain;
-    uint8_t release;
-    uint8_t currentLevel;
-    float   currentTime;
+    float         attack;     // linear rise from the current level to the note amplitude
+    float         decay;      // fall from the note amplitude to the sustain level
+    float         sustain;    // level while the note is held, fraction of the note amplitude
+    float         release;    // fall to silence after the note is released
+    EnvelopeCurve curve;      // shape of decay and release
 } Envelope;
 
-// voice structure
+// resampler filter length against stopband attenuation, see resample.h
+typedef enum {
+    RESAMPLE_QUALITY_FAST,        // 32 taps, 70 dB
+    RESAMPLE_QUALITY_STANDARD,    // 64 taps, 96 dB
+    RESAMPLE_QUALITY_HIGH,        // 128 taps, 120 dB
+    RESAMPLE_QUALITY_BEST,        // 256 taps, 140 dB, float coefficients end near 138
+    RESAMPLE_QUALITY_COUNT
+} ResampleQuality;
+
+// which voice a note takes once every voice is playing, see voice.h
+typedef enum {
+    VOICE_STEAL_OLDEST,       // the voice started longest ago
+    VOICE_STEAL_QUIETEST,     // the lowest live envelope level, an attack counts at its peak
+    VOICE_STEAL_SAME_NOTE,    // retrigger a voice already playing the pitch, else the oldest
+    VOICE_STEAL_PRIORITY,     // the lowest synth_set_note_priority(), the oldest among equals
+    VOICE_STEAL_COUNT
+} VoiceStealPolicy;
+
+// cold per-voice data, the fields read every block live in the VoicePool arrays
 typedef struct {
-    bool         active;
-    BaseWaveform waveform;
-    float        frequency;
-    float        phase;
-    float        phaseIncrement;
-    Envelope     env;
+    uint32_t note;    // handle returned by synth_trigger_note
+    float    frequency;
+    float    pitch;       // note index from synth_trigger_pitch_at, negative for a raw frequency
+    float    bend;        // semitones from synth_bend_note_at
+    Envelope env;         // settings the note was triggered with
+    uint64_t started;     // order the voice was last triggered in, smaller is older
+    uint8_t  priority;    // from synth_set_note_priority(), lower is stolen first
 } Voice;
 
-// custom waveform registration
+// a registered custom waveform
 typedef struct {
     BaseWaveform     type;
-    WaveformFunction func;
+    WaveformFunction func;    // NULL for tables loaded ready made
     const char      *name;
 } WaveformEntry;
 
-// platform context for synthesizer implementation
+// audio device, see synth_platform.h
 typedef struct AudioContext AudioContext;
 
-// main synthesizer structure
-typedef struct {
-    Voice         *voices;
-    uint8_t        maxVoices;
-    uint8_t        numActiveVoices;
-    float          masterVolume;
-    float          sampleRate;
-    AudioContext  *audio;
-    SynthArena     arena;
-    WaveformEntry *customWaveforms;
-    uint8_t        numCustomWaveforms;
-#if defined( __linux__ ) || defined( __APPLE__ )
-    pthread_mutex_t mutex;
-#elif defined( _WIN32 )
-    CRITICAL_SECTION mutex;
-#endif
-} Synthesizer;
+// block render kernels selected for the running cpu
+typedef struct RenderKernels RenderKernels;
 
-/***********************************
- * PLATFORM SPECIFIC AUDIO CONTEXT *
- **********************************/
+// structure-of-arrays voice storage
+typedef struct VoicePool VoicePool;
 
-#ifdef AUDIO_API_WINDOWS
-typedef struct {
-    HWAVEOUT hwaveOut;
-    WAVEHDR  waveHeader;
-    int16_t *buffer;
-    size_t   bufferSize;
-} WindowsAudioContext;
-
-struct AudioContext {
-    WindowsAudioContext platform;
-    uint32_t            sampleRate;
-    uint8_t             channels;
-};
+// single-producer single-consumer queue of timestamped commands
+typedef struct CommandQueue CommandQueue;
 
-#elif defined( AUDIO_API_ALSA )
-typedef struct {
-    snd_pcm_t           *handle;
-    snd_pcm_hw_params_t *params;
-    int1int16_t         *buffer;
-    size_t               bufferSize;
-} AlsaAudioContext;
-
-struct AudioContext {
-    AlsaAudioContext platform;
-    uint32_t         sampleRate;
-    uint8_t          channels;
-};
+// precomputed note frequencies and phase increments
+typedef struct Tuning Tuning;
+
+// threads that share the voice mix, see workers.h
+typedef struct RenderWorkers RenderWorkers;
+
+// polyphase sample rate converter, see resample.h
+typedef struct Resampler Resampler;
 
-#elif defined( AUDIO_API_COREAUDIO )
+// custom waveforms of a synthesizer and the snapshot the render thread reads, see wavetable.h
+typedef struct WaveformRegistry WaveformRegistry;
+typedef struct WaveformSet      WaveformSet;
+
+// main synthesizer structure
 typedef struct {
-    AudioUnit        audioUnit;
-    AudioBufferList *bufferList;
-    intint16_t      *buffer;
-    size_t           bufferSize;
-} CoreAudioContext;
-
-struct AudioContext {
-    CoreAudioContext platform;
-    uint32_t         sampleRate;
-    uint8_t          channels;
-};
-#endif
+    VoicePool           *voices;
+    uint32_t             maxVoices;
+    float                masterVolume;
+    float                masterGain;    // master volume reached at the end of the last span
+    float                sampleRate;    // rate the voices are rendered at
+    float                outputRate;    // rate synth_process_buffer() delivers
+    Resampler           *resampler;     // sampleRate to outputRate, NULL when they are equal
+    Tuning              *tuning;
+    WaveformRegistry    *waveforms;        // custom waveforms, types from WAVEFORM_COUNT up
+    const WaveformSet   *liveWaveforms;    // set the render thread holds for the current span
+    BaseWaveform         waveform;         // waveform given to newly triggered voices
+    Envelope             envelope;         // envelope given to newly triggered voices
+    uint8_t              priority;         // steal priority given to newly triggered voices
+    const RenderKernels *kernels;
+    AudioContext        *audio;       // device the synth plays on, NULL when not attached
+    uint8_t              channels;    // output channels the mono mix is copied to
+    SynthArena           arena;
+    SynthArena           scratch;    // render thread's per-block temporaries
+    RenderWorkers       *workers;    // threads sharing the mix, NULL mixes on the render thread
+
+    // control to audio thread messaging, the audio thread never takes a lock
+    CommandQueue        *commands;
+    CommandQueue        *live;          // SYNTH_TIME_NOW commands, drained ahead of commands
+    SynthAtomic          frameTime;     // first frame of the next block, published by the renderer
+    uint64_t             frame;         // renderer's private copy of frameTime
+    uint32_t             nextNote;      // next note handle, owned by the control thread
+    uint32_t            *noteVoices;    // live note handles to voice slots, owned by the renderer
+    uint32_t            *pitchVoices;   // newest voice of each hashed pitch, for same note steals
+    uint32_t             noteMask;      // noteVoices entries - 1, at least twice maxVoices
+} Synthesizer;
 
 /*****************************
  * BASIC WAVEFORM GENERATORS *
  ****************************/
-float sine_wave( float phase ) { return sinf( 2.0f * PI * phase ); }
+static inline float sine_wave( float phase ) { return sinf( 2.0f * PI * phase ); }
 
-float square_wave( float phase ) { return phase < 0.5f ? 1.0f : -1.0f; }
+static inline float square_wave( float phase ) { return phase < 0.5f ? 1.0f : -1.0f; }
 
-float saw_wave( float phase ) { return 2.0f * phase - 1.0f; }
+static inline float saw_wave( float phase ) { return 2.0f * phase - 1.0f; }
 
-float triangle_wave( float phase ) { return 2.0f * fabsf( 2.0f * phase - 1.0f ) - 1.0f; }
+static inline float triangle_wave( float phase ) {
+    return 2.0f * fabsf( 2.0f * phase - 1.0f ) - 1.0f;
+}
 
 // array of function pointers mirroring waveform enum
 static const WaveformFunction waveform_functions[WAVEFORM_COUNT] = {
@@ -307,222 +567,264 @@ static const WaveformFunction waveform_functions[WAVEFORM_COUNT] = {
 /***********************************
  * SYNTHESIZER FUNCTION PROTOTYPES *
  **********************************/
-static inline SynthError synth_init( Synthesizer *synth, uint8_t maxVoices, uint8_t channels ) {
-    if ( !synth ) return SYNTH_ERROR_NULL_PTR;    // check for invalid parameters
-
-    arena_init( &synth->arena, SYNTH_ARENA_SIZE );    // initialize memory arena
-
-    synth->voices =
-      arena_alloc( &synth->arena, maxVoices * sizeof( Voice ) );    // allocate memory for voices
-    if ( !synth->voices ) return SYNTH_ERROR_OOM;                   // check for out of memory
-
-// initialize mutex
-#ifdef defined( __linux__ ) || defined( __APPLE__ )
-    pthread_mutex_init( &synth->mutex, NULL );
-#elif defined( _WIN32 )
-    InitializeCriticalSection( &synth->mutex );
-#endif
-
-    // initialize waveform array
-    synth->customWaveforms =
-      arena_alloc( &synth->arena, sizeof( WaveformEntry ) * MAX_BASE_WAVEFORMS );
-    if ( !synth->customWaveforms ) return SYNTH_ERROR_OOM;    // check for out of memory
-
-    synth->maxVoices          = MAX_VOICES;
-    synth->numActiveVoices    = 0;
-    synth->masterVolume       = 1.0f;
-    synth->sampleRate         = SAMPLE_RATE;
-    synth->numCustomWaveforms = 0;
-
-    // initialize audio context
-    synth->audio = (AudioContext *) arena_alloc( &synth->arena, sizeof( AudioContext ) );
-    if ( !synth->audio ) return SYNTH_ERROR_OOM;    // check for out of memory
-
-    synth->audio->sampleRate = SAMPLE_RATE;
-    synth->audio->channels   = channels;
-
-    // initialize all voices
-    memset( synth->voices, 0, maxVoices * sizeof( Voice ) );
-
-    return SYNTH_ACK;
-}
-
-static short  audioBuffer[BUFFER_SIZE];
-
-AudioContext *audio_init( int sample_rate, int channels );
-void          audio_write( AudioContext *ctx, float *samples, int numSamples );
-void          audio_close( AudioContext *ctx );
-
-float         get_sample( BaseWaveform type, float phase ) {
-    if ( type < 0 || type >= WAVEFORM_COUNT ) { return 0.0f; }
-    return waveform_functions[type]( phase );
-}
-
-static WaveformEntry custom_waveforms[MAX_BASE_WAVEFORMS];
-static int           num_custom_waveforms = 0;
+/**
+ * @brief Evaluate a waveform generator directly, one call per sample
+ *
+ * This is the naive reference path; the wavetables are rendered from it and realtime code should
+ * read the tables instead.
+ *
+ * @param synth synthesizer custom waveforms are registered with, may be NULL for base waveforms
+ * @param type base or registered custom waveform
+ * @param phase normalized phase in [0, 1)
+ * @return sample in [-1, 1], or 0 for an unknown waveform
+ */
+float         get_sample( Synthesizer *synth, BaseWaveform type, float phase );
 
 /**
- * @brief [TODO:description]
+ * @brief Register a custom waveform generator with a synthesizer, control thread only
  *
- * @param func [TODO:parameter]
- * @param name [TODO:parameter]
- * @return [TODO:return]
+ * The band-limited wavetable is rendered here, once, and published to the render thread with an
+ * atomic swap; voices read the table and never call the generator. Allocates and renders, so
+ * keep it off the audio thread.
+ *
+ * @param synth synthesizer to register with
+ * @param func generator evaluated over one cycle, phase in [0, 1)
+ * @param name display name, must outlive the synthesizer
+ * @return the new waveform type, or INVALID_WAVEFORM if SYNTH_WAVEFORMS are registered already or
+ * memory ran out
  */
-BaseWaveform         register_custom_waveform( WaveformFunction func, const char *name ) {
-    if ( num_custom_waveforms >= MAX_BASE_WAVEFORMS ) return INVALID_WAVEFORM;
-    BaseWaveform new_type = (BaseWaveform) ( WAVEFORM_COUNT + num_custom_waveforms );
-    custom_waveforms[num_custom_waveforms++] = (WaveformEntry) { new_type, func, name };
-    return new_type;
-}
+BaseWaveform  register_custom_waveform(
+  Synthesizer *synth, WaveformFunction func, const char *name
+);
 
 /**
- * @brief [TODO:description]
+ * @brief Render a waveform into a buffer starting at phase zero, using the wavetable engine
  *
- * @param buffer [TODO:parameter]
- * @param length [TODO:parameter]
- * @param type [TODO:parameter]
- * @param frequency [TODO:parameter]
- * @param sample_rate [TODO:parameter]
+ * @param buffer destination buffer
+ * @param length number of samples to render
+ * @param type base waveform
+ * @param frequency oscillator frequency in Hz
+ * @param sample_rate output sample rate in Hz
  */
-inline void generate_waveform(
+void          generate_waveform(
   float *buffer, int length, BaseWaveform type, float frequency, float sample_rate
-) {
-    for ( int i = 0; i < length; i++ ) {
-        float phase = fmodf( ( frequency * i ) / sample_rate, 1.0f );
-        buffer[i]   = get_sample( type, phase );
-    }
-}
+);
 
 /**
- * @brief [TODO:description]
+ * @brief Render a 16 bit sine tone at SAMPLE_RATE starting at phase zero
  *
- * @param buffer [TODO:parameter]
- * @param numSamples [TODO:parameter]
- * @param frequency [TODO:parameter]
+ * @param buffer destination buffer
+ * @param numSamples number of samples to render
+ * @param frequency tone frequency in Hz
  */
-inline void generateTone( short *buffer, int numSamples, float frequency ) {
-    for ( int i = 0; i < numSamples; i++ ) {
-        float t   = (float) i / SAMPLE_RATE;
-        buffer[i] = (short) ( 32767.0f * sin( 2.0f * 3.14159f * frequency * t ) );
-    }
-}
+void          generateTone( short *buffer, int numSamples, float frequency );
 
 // Core synth functions
-void  synth_init( Synthesizer *synth );
+SynthError synth_init( Synthesizer *synth, uint32_t maxVoices, uint8_t channels );
 
+/**
+ * @brief Free everything a synthesizer holds, not realtime safe
+ *
+ * Call once nothing renders the synth and its audio device is detached.
+ *
+ * @param synth synthesizer from synth_init(), may be NULL
+ */
+void       synth_destroy( Synthesizer *synth );
+
+/**
+ * @brief Render and mix every active voice into a mono buffer
+ *
+ * Voices are rendered in SYNTH_BLOCK_SIZE blocks by the kernels selected for the running cpu.
+ * Queued commands are drained at the start of each block, and a block is split at any command
+ * timestamp inside it so notes start and stop on the exact sample. Each voice follows its ADSR
+ * envelope, evaluated a segment at a time, and is retired as soon as its release reaches silence.
+ * Master volume changes ramp across the rest of the span to avoid clicks. With a resampler set
+ * up by synth_set_sample_rate() the blocks are rendered at the render rate and converted.
+ * Takes no locks, render thread only.
+ *
+ * @param synth synthesizer to render
+ * @param buffer destination, overwritten
+ * @param numSamples number of samples to render at the output rate
+ */
 void  synth_process_buffer( Synthesizer *synth, float *buffer, int numSamples );
-int   synth_trigger_note( Synthesizer *synth, float frequency, float amplitude );
-void  synth_release_note( Synthesizer *synth, int voiceIndex );
-void  synth_set_master_volume( Synthesizer *synth, float volume );
-
-// Voice management
-int   synth_get_free_voice( Synthesizer *synth );
-void  synth_update_voice( Voice *voice, float deltaTime );
-
-// Audio generation
-float synth_generate_sample( BaseWaveform wf, float phase );
-
-// define platform specific AudioContexts
-#ifndef SYNTH_PLATFORM_H
-  #define SYNTH_PLATFORM_H
-
-// generic audio context
-struct AudioContext {
-    int    sampleRate;
-    int    channels;
-    size_t bufferSize;
-  #ifdef AUDIO_API_WINDOWS
-    WindowsAudioContext platformctx;
-  #elif defined( AUDIO_API_ALSA )
-    AlsaAudioContext platformctx;
-  #elif defined( AUDIO_API_COREAUDIO )
-    CoreAudioContext platformctx;
-  #endif
-};
 
-  // platform specific implementations
-  #ifdef AUDIO_API_WINDOWS
-static inline int platform_audio_init( AudioContext *ctx ) {
-    WAVEFORMATEX waveFormat = {
-      .wFormatTag      = WAVE_FORMAT_PCM,
-      .nChannels       = (WORD) ctx->channels,
-      .nSamplesPerSec  = (DWORD) ctx->sampleRate,
-      .wBitsPerSample  = (WORD) BIT_RATE,
-      .nBlockAlign     = (WORD) ( ( ctx->channels * BIT_RATE ) / 8 ),
-      .nAvgBytesPerSec = (DWORD) ctx->sampleRate * ( ctx->channels * BIT_RATE ) / 8,
-      .cbSize          = 0
-    };
-
-    if ( waveOutOpen( &ctx->platformctx.hwaveOut, WAVE_MAPPER, &waveFormat, 0, 0, CALLBACK_NULL ) !=
-         MMSYSERR_NOERROR ) {
-        return -1;
-    }
+/**
+ * @brief Queue a note to start at a given sample frame, control thread only
+ *
+ * Commands must be queued in non-decreasing time order; a frame that has already been rendered
+ * takes effect at the start of the next block. SYNTH_TIME_NOW commands have a queue of their own
+ * that is drained first, so they never wait behind commands queued for later frames: a note
+ * started at a frame should be released and bent at a frame too.
+ *
+ * @param synth synthesizer to play on
+ * @param time sample frame from synth_frame_time(), or SYNTH_TIME_NOW
+ * @param frequency note frequency in Hz
+ * @param amplitude note gain
+ * @return note handle for synth_release_note(), or a negative SynthError
+ */
+int   synth_trigger_note_at( Synthesizer *synth, uint64_t time, float frequency, float amplitude );
 
-    ctx->platformctx.buffer            = (short *) malloc( ctx->bufferSize * sizeof( short ) );
-    ctx->platformctx.bufferSize        = ctx->bufferSize;
+/**
+ * @brief Queue a note release at a given sample frame, control thread only
+ *
+ * @param synth synthesizer the note plays on
+ * @param time sample frame from synth_frame_time(), or SYNTH_TIME_NOW
+ * @param note handle returned by synth_trigger_note()
+ * @return SYNTH_ACK or a SynthError
+ */
+SynthError synth_release_note_at( Synthesizer *synth, uint64_t time, int note );
 
-    ctx->platformctx.waveHeader.lpData = (LPSTR) ctx->platformctx.buffer;
-    ctx->platformctx.waveHeader.dwBufferLength = ctx->bufferSize * sizeof( short );
-    ctx->platformctx.waveHeader.dwFlags        = 0;
+/**
+ * @brief Queue a note by its index in the synth's tuning, control thread only
+ *
+ * The frequency comes from the precomputed tuning tables, no powf on the trigger path.
+ *
+ * @param synth synthesizer to play on
+ * @param time sample frame from synth_frame_time(), or SYNTH_TIME_NOW
+ * @param pitch note index, e.g. BASE_INDICE for the reference note, may be fractional
+ * @param amplitude note gain
+ * @return note handle for synth_release_note(), or a negative SynthError
+ */
+int        synth_trigger_pitch_at(
+  Synthesizer *synth, uint64_t time, float pitch, float amplitude
+);
 
-    return 0;
-}
+/**
+ * @brief Queue a pitch bend of a playing note, control thread only
+ *
+ * @param synth synthesizer the note plays on
+ * @param time sample frame from synth_frame_time(), or SYNTH_TIME_NOW
+ * @param note handle returned by synth_trigger_note()
+ * @param semitones offset from the note's own pitch, replaces any earlier bend
+ * @return SYNTH_ACK or a SynthError
+ */
+SynthError synth_bend_note_at( Synthesizer *synth, uint64_t time, int note, float semitones );
 
-static inline void platform_audio_write( AudioContext *ctx, float *samples, int numSamples ) {
-    // convert float samples to short and write to buffer
-    for ( int i = 0; i < numSamples; i++ ) {
-        ctx->platformctx.buffer[i] = (short) ( samples[i] * 32767.0f );
-    }
+/**
+ * @brief Set the waveform of notes triggered from now on, control thread only
+ *
+ * Playing notes keep the waveform they were triggered with.
+ *
+ * @param synth synthesizer to configure
+ * @param type base waveform or one registered with register_custom_waveform()
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_INVALID_PARAM
+ */
+SynthError synth_set_waveform( Synthesizer *synth, BaseWaveform type );
 
-    waveOutPrepareHeader(
-      ctx->platformctx.hwaveOut, &ctx->platformctx.waveHeader, sizeof( WAVEHDR )
-    );
-    waveOutWrite( ctx->platformctx.hwaveOut, &ctx->platformctx.waveHeader, sizeof( WAVEHDR ) );
-}
+/**
+ * @brief Set the envelope of notes triggered from now on, control thread only
+ *
+ * Playing notes keep the envelope they were triggered with.
+ *
+ * @param synth synthesizer to configure
+ * @param envelope times in seconds and sustain level in [0, 1]
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_INVALID_PARAM
+ */
+SynthError synth_set_envelope( Synthesizer *synth, const Envelope *envelope );
 
-static inline void platform_audio_close( AudioContext *ctx ) {
-    waveOutUnprepareHeader(
-      ctx->platformctx.hwaveOut, &ctx->platformctx.waveHeader, sizeof( WAVEHDR )
-    );
-    free( ctx->platformctx.buffer );
-}
+/**
+ * @brief Set the steal priority of notes triggered from now on, control thread only
+ *
+ * Only VOICE_STEAL_PRIORITY looks at it. Playing notes keep the priority they were triggered with.
+ *
+ * @param synth synthesizer to configure
+ * @param priority 0 is stolen first, 255 last
+ * @return SYNTH_ACK or SYNTH_ERROR_NULL_PTR
+ */
+SynthError synth_set_note_priority( Synthesizer *synth, uint8_t priority );
 
-  #elif defined( AUDIO_API_ALSA )
-// ALSA implementation
-static inline int platform_audio_init( AudioContext *ctx ) { return 0; }
+/**
+ * @brief Choose which voice a note takes once maxVoices are playing, not realtime safe
+ *
+ * Call while nothing renders the synth. Whatever the policy, the victim fades out over
+ * ENVELOPE_FADE in a spare slot while the new note attacks from silence, so a steal does not
+ * click. With every spare slot still fading, the note takes the victim over from its current
+ * phase and level instead. The default is VOICE_STEAL_OLDEST.
+ *
+ * @param synth synthesizer to configure
+ * @param policy how the victim is chosen
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_INVALID_PARAM
+ */
+SynthError synth_set_steal_policy( Synthesizer *synth, VoiceStealPolicy policy );
 
-        // additonal ALSA functions...
+/**
+ * @brief Rebuild the tuning tables for a new reference pitch, control thread only
+ *
+ * Notes triggered or bent afterwards use the new tuning, playback is never interrupted.
+ *
+ * @param synth synthesizer to retune
+ * @param baseTuning frequency of the reference note in Hz, e.g. BASE_TUNING
+ * @param baseIndex index of the reference note, e.g. BASE_INDICE
+ * @return SYNTH_ACK or a SynthError
+ */
+SynthError synth_retune( Synthesizer *synth, float baseTuning, int baseIndex );
 
-  #elif defined( AUDIO_API_COREAUDIO )
-// CoreAudio implementation
-static inline int platform_audio_init( AudioContext *ctx ) { return 0; }
+/**
+ * @brief Share the voice mix between several threads, not realtime safe
+ *
+ * Call while nothing renders the synth. Voices are mixed in groups of WORKERS_GROUP_VOICES, so
+ * threads only help once more than one group is playing. The output is bit identical for every
+ * thread count. One thread stops and frees the workers.
+ *
+ * @param synth synthesizer to configure
+ * @param threads render threads including the one calling synth_process_buffer()
+ * @param priority SCHED_FIFO priority of the extra threads, negative for normal threads
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR, SYNTH_ERROR_INVALID_PARAM or SYNTH_ERROR_INIT_FAILED
+ */
+SynthError synth_set_threads( Synthesizer *synth, uint32_t threads, int priority );
 
-  // additonal CoreAudio functions...
-  #endif
+/**
+ * @brief Render the voices at one rate and deliver them at another, not realtime safe
+ *
+ * Call while nothing renders the synth. Voices are rendered at renderRate and converted to
+ * outputRate by a polyphase resampler, for example to oversample aliasing-prone voices 2x or 4x
+ * and decimate, or to render at 48 kHz for a 96 kHz device. Equal rates render straight into the
+ * output. Command times and synth_frame_time() count frames at renderRate. Sounding voices are
+ * retuned, their envelope segments keep the length they started with.
+ *
+ * @param synth synthesizer to configure
+ * @param renderRate rate the voices are rendered at in Hz
+ * @param outputRate rate of synth_process_buffer() in Hz
+ * @param quality resampler preset, ignored for equal rates
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR, SYNTH_ERROR_INVALID_PARAM or SYNTH_ERROR_OOM
+ */
+SynthError synth_set_sample_rate(
+  Synthesizer *synth, uint32_t renderRate, uint32_t outputRate, ResampleQuality quality
+);
 
-AudioContext *audio_init( int sample_rate, int channels ) {
-    AudioContext *ctx = (AudioContext *) malloc( sizeof( AudioContext ) );
-    ctx->sampleRate   = sample_rate;
-    ctx->channels     = channels;
-    ctx->bufferSize   = BUFFER_SIZE;
+/**
+ * @brief Drop every voice at once and forget the notes they played, not realtime safe
+ *
+ * Call while nothing renders the synth. Voices stop without a release, and releasing or bending a
+ * note started before the call does nothing. Queued commands are kept.
+ *
+ * @param synth synthesizer to silence
+ */
+void synth_silence( Synthesizer *synth );
 
-    if ( platform_audio_init( ctx ) != 0 ) {
-        free( ctx );
-        return NULL;
-    }
-    return ctx;
-}
+/**
+ * @brief First sample frame of the next block the render thread will produce
+ *
+ * @param synth synthesizer to query
+ * @return sample frame
+ */
+uint64_t synth_frame_time( Synthesizer *synth );
 
-void audio_write( AudioContext *ctx, float *samples, int numSamples ) {
-    platform_audio_write( ctx, samples, numSamples );
-}
+/**
+ * @brief Count the frames the next synth_process_buffer() call renders, render thread only
+ *
+ * With a resampler set these are frames at renderRate, which is what command times count;
+ * otherwise they are the output frames themselves.
+ *
+ * @param synth synthesizer to query
+ * @param frames number of output frames the call will be asked for
+ * @return frames from synth_frame_time() on that the call will render
+ */
+uint64_t synth_render_frames( const Synthesizer *synth, uint32_t frames );
 
-void audio_close( AudioContext *ctx ) {
-    if ( ctx ) {
-        platform_audio_close( ctx );
-        free( ctx );
-    }
-}
+// immediate variants of the above, applied at the start of the next block
+int  synth_trigger_note( Synthesizer *synth, float frequency, float amplitude );
+void synth_release_note( Synthesizer *synth, int voiceIndex );
+void synth_set_master_volume( Synthesizer *synth, float volume );
 
 #endif
-#endif
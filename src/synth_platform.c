@@ -0,0 +1,522 @@
+#include "synth_platform.h"
+
+#ifdef AUDIO_API_ALSA
+  #include <errno.h>
+#endif
+
+/**************
+ * CONVERSION *
+ *************/
+// PCM format of a bit depth, SAMPLE_FORMAT_COUNT for one no device takes
+static SampleFormat audio_bit_format( uint16_t bits ) {
+    switch ( bits ) {
+        case 16: return SAMPLE_FORMAT_PCM16;
+        case 24: return SAMPLE_FORMAT_PCM24;
+        case 32: return SAMPLE_FORMAT_PCM32;
+        default: return SAMPLE_FORMAT_COUNT;
+    }
+}
+
+// clip, dither and copy the mono mix to every channel of interleaved device samples
+static inline void audio_convert(
+  AudioContext *ctx, void *dst, const float *src, uint32_t frames
+) {
+    PcmDither *dither = ctx->dithered ? &ctx->dither : NULL;
+    ctx->convert( dst, src, frames, (uint32_t) ctx->channels, dither );
+}
+
+#if defined( AUDIO_API_WINDOWS )
+/***********
+ * WAVEOUT *
+ **********/
+static int platform_audio_init( AudioContext *ctx, const AudioConfig *config ) {
+    // waveOut takes 24 and 32 bit integers as plain PCM too
+    WindowsAudioContext *win        = &ctx->platformctx;
+    WORD                 bits       = (WORD) ( config->bitDepth ? config->bitDepth : BIT_RATE );
+    WAVEFORMATEX         waveFormat = {
+      .wFormatTag      = WAVE_FORMAT_PCM,
+      .nChannels       = (WORD) ctx->channels,
+      .nSamplesPerSec  = (DWORD) ctx->sampleRate,
+      .wBitsPerSample  = bits,
+      .nBlockAlign     = (WORD) ( ( ctx->channels * bits ) / 8 ),
+      .nAvgBytesPerSec = (DWORD) ctx->sampleRate * ( ctx->channels * bits ) / 8,
+      .cbSize          = 0
+    };
+    ctx->format = audio_bit_format( bits );
+
+    if ( waveOutOpen( &win->hwaveOut, WAVE_MAPPER, &waveFormat, 0, 0, CALLBACK_NULL ) !=
+         MMSYSERR_NOERROR ) {
+        return -1;
+    }
+
+    // one header per period, the device plays them in turn while we fill the next
+    win->periods    = config->periods < AUDIO_MAX_PERIODS ? config->periods : AUDIO_MAX_PERIODS;
+    win->next       = 0;
+    win->bufferSize = ctx->bufferSize * (size_t) ctx->channels * ( bits / 8 );
+    win->buffer     = (uint8_t *) malloc( win->bufferSize * win->periods );
+    if ( !win->buffer ) {
+        waveOutClose( win->hwaveOut );
+        return -1;
+    }
+    memset( win->headers, 0, sizeof( win->headers ) );
+    for ( uint32_t p = 0; p < win->periods; p++ ) {
+        win->headers[p].lpData = (LPSTR) ( win->buffer + p * win->bufferSize );
+    }
+
+    ctx->latency.periodFrames = (uint32_t) ctx->bufferSize;
+    ctx->latency.bufferFrames = (uint32_t) ( ctx->bufferSize * win->periods );
+    ctx->latency.mmap         = false;
+    return 0;
+}
+
+// wait until the device has played a header, then take it back for refilling
+static void windows_reclaim( AudioContext *ctx, WAVEHDR *header ) {
+    if ( !( header->dwFlags & WHDR_PREPARED ) ) return;
+    while ( !( header->dwFlags & WHDR_DONE ) ) Sleep( 1 );
+    waveOutUnprepareHeader( ctx->platformctx.hwaveOut, header, sizeof( WAVEHDR ) );
+}
+
+// true when no header is still queued on the device
+static bool windows_idle( const WindowsAudioContext *win ) {
+    for ( uint32_t p = 0; p < win->periods; p++ ) {
+        DWORD flags = win->headers[p].dwFlags;
+        if ( ( flags & WHDR_PREPARED ) && !( flags & WHDR_DONE ) ) return false;
+    }
+    return true;
+}
+
+static SynthError platform_audio_render(
+  AudioContext *ctx, AudioRenderCallback render, void *user, uint32_t frames
+) {
+    WindowsAudioContext *win = &ctx->platformctx;
+    while ( frames > 0 ) {
+        uint32_t count  = frames < ctx->bufferSize ? frames : (uint32_t) ctx->bufferSize;
+        WAVEHDR *header = &win->headers[win->next];
+        windows_reclaim( ctx, header );
+
+        // once primed, finding every header played means the device ran dry
+        if ( ctx->latency.frames >= ctx->latency.bufferFrames && windows_idle( win ) ) {
+            ctx->latency.xruns++;
+        }
+
+        render( user, ctx->scratch, count );
+        audio_convert( ctx, header->lpData, ctx->scratch, count );
+        header->dwBufferLength = count * (DWORD) ( win->bufferSize / ctx->bufferSize );
+        header->dwFlags        = 0;
+        waveOutPrepareHeader( win->hwaveOut, header, sizeof( WAVEHDR ) );
+        if ( waveOutWrite( win->hwaveOut, header, sizeof( WAVEHDR ) ) != MMSYSERR_NOERROR ) {
+            return SYNTH_ERROR_IO;
+        }
+        win->next            = ( win->next + 1 ) % win->periods;
+        frames              -= count;
+        ctx->latency.frames += count;
+    }
+    return SYNTH_ACK;
+}
+
+static void platform_audio_close( AudioContext *ctx ) {
+    WindowsAudioContext *win = &ctx->platformctx;
+    for ( uint32_t p = 0; p < win->periods; p++ ) windows_reclaim( ctx, &win->headers[p] );
+    waveOutClose( win->hwaveOut );
+    free( win->buffer );
+}
+
+#elif defined( AUDIO_API_ALSA )
+/********
+ * ALSA *
+ *******/
+// recover from an underrun or suspend, counting underruns
+static int alsa_recover( AudioContext *ctx, int err ) {
+    if ( err == -EPIPE ) ctx->latency.xruns++;
+    return snd_pcm_recover( ctx->platformctx.handle, err, 1 );
+}
+
+// sample how long a frame rendered now takes to reach the speaker
+static void alsa_measure( AudioContext *ctx ) {
+    snd_pcm_sframes_t delay;
+    if ( snd_pcm_delay( ctx->platformctx.handle, &delay ) < 0 || delay < 0 ) return;
+    ctx->latency.delaySeconds = (double) delay / (double) ctx->sampleRate;
+    if ( ctx->latency.delaySeconds > ctx->latency.maxDelaySeconds ) {
+        ctx->latency.maxDelaySeconds = ctx->latency.delaySeconds;
+    }
+}
+
+// negotiate access, format, rate and buffering with the device
+static int alsa_set_hw( AudioContext *ctx, const AudioConfig *config, snd_pcm_hw_params_t *hw ) {
+    AlsaAudioContext *alsa   = &ctx->platformctx;
+    snd_pcm_t        *handle = alsa->handle;
+    int               err    = snd_pcm_hw_params_any( handle, hw );
+    if ( err < 0 ) return err;
+
+    // mmap lets us render straight into the ring, plain writes are the fallback
+    alsa->mmap = snd_pcm_hw_params_set_access( handle, hw, SND_PCM_ACCESS_MMAP_INTERLEAVED ) == 0;
+    if ( !alsa->mmap ) {
+        err = snd_pcm_hw_params_set_access( handle, hw, SND_PCM_ACCESS_RW_INTERLEAVED );
+        if ( err < 0 ) return err;
+    }
+
+    // a configured depth has to be met, otherwise float takes the mix as it is and 16 bit is
+    // what every device accepts
+    static const snd_pcm_format_t formats[SAMPLE_FORMAT_COUNT] = {
+      [SAMPLE_FORMAT_PCM16]   = SND_PCM_FORMAT_S16_LE,
+      [SAMPLE_FORMAT_PCM24]   = SND_PCM_FORMAT_S24_3LE,
+      [SAMPLE_FORMAT_PCM32]   = SND_PCM_FORMAT_S32_LE,
+      [SAMPLE_FORMAT_FLOAT32] = SND_PCM_FORMAT_FLOAT_LE,
+    };
+    ctx->format = config->bitDepth ? audio_bit_format( config->bitDepth ) : SAMPLE_FORMAT_FLOAT32;
+    if ( snd_pcm_hw_params_set_format( handle, hw, formats[ctx->format] ) < 0 ) {
+        if ( config->bitDepth ) return -EINVAL;
+        ctx->format = audio_bit_format( BIT_RATE );
+        err         = snd_pcm_hw_params_set_format( handle, hw, formats[ctx->format] );
+        if ( err < 0 ) return err;
+    }
+    alsa->format = formats[ctx->format];
+
+    unsigned int      rate   = (unsigned int) ctx->sampleRate;
+    snd_pcm_uframes_t period = config->periodFrames;
+    snd_pcm_uframes_t buffer = (snd_pcm_uframes_t) config->periodFrames * config->periods;
+    if ( ( err = snd_pcm_hw_params_set_channels( handle, hw, (unsigned int) ctx->channels ) ) < 0 ||
+         ( err = snd_pcm_hw_params_set_rate_near( handle, hw, &rate, NULL ) ) < 0 ||
+         ( err = snd_pcm_hw_params_set_period_size_near( handle, hw, &period, NULL ) ) < 0 ||
+         ( err = snd_pcm_hw_params_set_buffer_size_near( handle, hw, &buffer ) ) < 0 ||
+         ( err = snd_pcm_hw_params( handle, hw ) ) < 0 ) {
+        return err;
+    }
+    snd_pcm_hw_params_get_period_size( hw, &alsa->periodFrames, NULL );
+    snd_pcm_hw_params_get_buffer_size( hw, &alsa->bufferFrames );
+    ctx->sampleRate = (int) rate;
+    return 0;
+}
+
+// start once the buffer is full, then wake up a period at a time
+static int alsa_set_sw( AudioContext *ctx, snd_pcm_sw_params_t *sw ) {
+    AlsaAudioContext *alsa   = &ctx->platformctx;
+    snd_pcm_t        *handle = alsa->handle;
+    snd_pcm_uframes_t start  = alsa->bufferFrames / alsa->periodFrames * alsa->periodFrames;
+    int               err;
+    if ( ( err = snd_pcm_sw_params_current( handle, sw ) ) < 0 ||
+         ( err = snd_pcm_sw_params_set_start_threshold( handle, sw, start ) ) < 0 ||
+         ( err = snd_pcm_sw_params_set_avail_min( handle, sw, alsa->periodFrames ) ) < 0 ) {
+        return err;
+    }
+    return snd_pcm_sw_params( handle, sw );
+}
+
+static int alsa_configure( AudioContext *ctx, const AudioConfig *config ) {
+    snd_pcm_hw_params_t *hw  = NULL;
+    snd_pcm_sw_params_t *sw  = NULL;
+    int                  err = -ENOMEM;
+    if ( snd_pcm_hw_params_malloc( &hw ) == 0 && snd_pcm_sw_params_malloc( &sw ) == 0 ) {
+        err = alsa_set_hw( ctx, config, hw );
+        if ( err >= 0 ) err = alsa_set_sw( ctx, sw );
+        if ( err >= 0 ) err = snd_pcm_prepare( ctx->platformctx.handle );
+    }
+    if ( hw ) snd_pcm_hw_params_free( hw );
+    if ( sw ) snd_pcm_sw_params_free( sw );
+    return err;
+}
+
+static int platform_audio_init( AudioContext *ctx, const AudioConfig *config ) {
+    AlsaAudioContext *alsa = &ctx->platformctx;
+    if ( snd_pcm_open( &alsa->handle, config->device, SND_PCM_STREAM_PLAYBACK, 0 ) < 0 ) return -1;
+    alsa->interleaved = NULL;
+    if ( alsa_configure( ctx, config ) < 0 ) {
+        snd_pcm_close( alsa->handle );
+        return -1;
+    }
+
+    ctx->bufferSize = alsa->periodFrames;
+    if ( !alsa->mmap ) {
+        size_t width      = (size_t) snd_pcm_format_physical_width( alsa->format ) / 8;
+        alsa->interleaved = malloc( alsa->periodFrames * (size_t) ctx->channels * width );
+        if ( !alsa->interleaved ) {
+            snd_pcm_close( alsa->handle );
+            return -1;
+        }
+    }
+
+    ctx->latency.periodFrames = (uint32_t) alsa->periodFrames;
+    ctx->latency.bufferFrames = (uint32_t) alsa->bufferFrames;
+    ctx->latency.mmap         = alsa->mmap;
+    return 0;
+}
+
+static SynthError alsa_render_writei(
+  AudioContext *ctx, AudioRenderCallback render, void *user, uint32_t frames
+) {
+    AlsaAudioContext *alsa       = &ctx->platformctx;
+    size_t            frameBytes = (size_t) ctx->channels *
+                        (size_t) snd_pcm_format_physical_width( alsa->format ) / 8;
+    while ( frames > 0 ) {
+        uint32_t count = frames < alsa->periodFrames ? frames : (uint32_t) alsa->periodFrames;
+        render( user, ctx->scratch, count );
+        audio_convert( ctx, alsa->interleaved, ctx->scratch, count );
+
+        const uint8_t    *data = (const uint8_t *) alsa->interleaved;
+        snd_pcm_uframes_t left = count;
+        while ( left > 0 ) {
+            snd_pcm_sframes_t written = snd_pcm_writei( alsa->handle, data, left );
+            if ( written < 0 ) {
+                if ( alsa_recover( ctx, (int) written ) < 0 ) return SYNTH_ERROR_IO;
+                continue;
+            }
+            data += (size_t) written * frameBytes;
+            left -= (snd_pcm_uframes_t) written;
+        }
+        frames              -= count;
+        ctx->latency.frames += count;
+    }
+    alsa_measure( ctx );
+    return SYNTH_ACK;
+}
+
+static SynthError platform_audio_render(
+  AudioContext *ctx, AudioRenderCallback render, void *user, uint32_t frames
+) {
+    AlsaAudioContext *alsa = &ctx->platformctx;
+    if ( !alsa->mmap ) return alsa_render_writei( ctx, render, user, frames );
+
+    // a mono float ring has exactly the layout the synth renders, no scratch copy needed
+    bool direct = alsa->format == SND_PCM_FORMAT_FLOAT_LE && ctx->channels == 1;
+    while ( frames > 0 ) {
+        snd_pcm_sframes_t avail = snd_pcm_avail_update( alsa->handle );
+        if ( avail < 0 ) {
+            if ( alsa_recover( ctx, (int) avail ) < 0 ) return SYNTH_ERROR_IO;
+            continue;
+        }
+
+        // wait for a period of room, or for just enough to finish
+        snd_pcm_uframes_t want = frames < alsa->periodFrames ? frames : alsa->periodFrames;
+        if ( (snd_pcm_uframes_t) avail < want ) {
+            int err;
+            if ( snd_pcm_state( alsa->handle ) == SND_PCM_STATE_PREPARED ) {
+                err = snd_pcm_start( alsa->handle );
+            } else {
+                err = snd_pcm_wait( alsa->handle, AUDIO_WAIT_MS );
+                if ( err == 0 ) return SYNTH_ERROR_IO;    // the device stopped consuming
+            }
+            if ( err < 0 && alsa_recover( ctx, err ) < 0 ) return SYNTH_ERROR_IO;
+            continue;
+        }
+
+        const snd_pcm_channel_area_t *areas;
+        snd_pcm_uframes_t             offset;
+        snd_pcm_uframes_t             count = want;
+        int err = snd_pcm_mmap_begin( alsa->handle, &areas, &offset, &count );
+        if ( err < 0 ) {
+            if ( alsa_recover( ctx, err ) < 0 ) return SYNTH_ERROR_IO;
+            continue;
+        }
+
+        // interleaved channels share the first area, count may stop short at the ring's end
+        uint8_t *ring = (uint8_t *) areas[0].addr + areas[0].first / 8 + offset * areas[0].step / 8;
+        if ( direct ) {
+            render( user, (float *) ring, (uint32_t) count );
+        } else {
+            render( user, ctx->scratch, (uint32_t) count );
+            audio_convert( ctx, ring, ctx->scratch, (uint32_t) count );
+        }
+
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit( alsa->handle, offset, count );
+        if ( committed < 0 || (snd_pcm_uframes_t) committed != count ) {
+            if ( alsa_recover( ctx, committed < 0 ? (int) committed : -EPIPE ) < 0 ) {
+                return SYNTH_ERROR_IO;
+            }
+        }
+        frames              -= (uint32_t) count;
+        ctx->latency.frames += count;
+    }
+    alsa_measure( ctx );
+    return SYNTH_ACK;
+}
+
+static void platform_audio_close( AudioContext *ctx ) {
+    snd_pcm_drain( ctx->platformctx.handle );
+    snd_pcm_close( ctx->platformctx.handle );
+    free( ctx->platformctx.interleaved );
+}
+
+#elif defined( AUDIO_API_COREAUDIO )
+/*************
+ * COREAUDIO *
+ ************/
+// not implemented yet, opening a device fails
+static int platform_audio_init( AudioContext *ctx, const AudioConfig *config ) {
+    (void) ctx;
+    (void) config;
+    return -1;
+}
+
+static SynthError platform_audio_render(
+  AudioContext *ctx, AudioRenderCallback render, void *user, uint32_t frames
+) {
+    (void) ctx;
+    (void) render;
+    (void) user;
+    (void) frames;
+    return SYNTH_ERROR_IO;
+}
+
+static void platform_audio_close( AudioContext *ctx ) { (void) ctx; }
+
+#else
+/***************
+ * NULL DEVICE *
+ **************/
+static int platform_audio_init( AudioContext *ctx, const AudioConfig *config ) {
+    ctx->latency.periodFrames = (uint32_t) ctx->bufferSize;
+    ctx->latency.bufferFrames = (uint32_t) ctx->bufferSize * config->periods;
+    ctx->latency.mmap         = false;
+    return 0;
+}
+
+// consume frames as fast as they are rendered
+static SynthError platform_audio_render(
+  AudioContext *ctx, AudioRenderCallback render, void *user, uint32_t frames
+) {
+    while ( frames > 0 ) {
+        uint32_t count = frames < ctx->bufferSize ? frames : (uint32_t) ctx->bufferSize;
+        render( user, ctx->scratch, count );
+        frames              -= count;
+        ctx->latency.frames += count;
+    }
+    return SYNTH_ACK;
+}
+
+static void platform_audio_close( AudioContext *ctx ) { (void) ctx; }
+#endif
+
+/*******************
+ * LOOPBACK DEVICE *
+ ******************/
+static SynthError loopback_render(
+  AudioContext *ctx, AudioRenderCallback render, void *user, uint32_t frames
+) {
+    LoopbackDevice *device   = &ctx->loopback;
+    double          rate     = (double) ctx->sampleRate;
+    double          capacity = (double) ctx->latency.bufferFrames;
+    while ( frames > 0 ) {
+        uint32_t count = frames < ctx->bufferSize ? frames : (uint32_t) ctx->bufferSize;
+        if ( device->running ) {
+            double buffered = (double) device->queued - ( audio_clock() - device->start ) * rate;
+            if ( buffered < 0.0 ) {
+                // ran dry: count it and fill the buffer again before the clock restarts
+                ctx->latency.xruns++;
+                device->running = false;
+                device->queued  = 0;
+            } else if ( buffered + count > capacity ) {
+                // block like a full device until there is room for this period
+                audio_sleep( ( buffered + count - capacity ) / rate );
+            }
+        }
+
+        render( user, ctx->scratch, count );
+        device->queued      += count;
+        frames              -= count;
+        ctx->latency.frames += count;
+        if ( !device->running && (double) device->queued >= capacity ) {
+            device->running = true;
+            device->start   = audio_clock();
+        }
+    }
+
+    if ( device->running ) {
+        double delay = (double) device->queued / rate - ( audio_clock() - device->start );
+        ctx->latency.delaySeconds = delay > 0.0 ? delay : 0.0;
+        if ( ctx->latency.delaySeconds > ctx->latency.maxDelaySeconds ) {
+            ctx->latency.maxDelaySeconds = ctx->latency.delaySeconds;
+        }
+    }
+    return SYNTH_ACK;
+}
+
+/*******************
+ * GENERIC DEVICES *
+ ******************/
+AudioContext *audio_open( const AudioConfig *config ) {
+    AudioConfig settings = { 0 };
+    if ( config ) settings = *config;
+    if ( !settings.device ) settings.device = AUDIO_DEVICE_DEFAULT;
+    if ( !settings.sampleRate ) settings.sampleRate = SAMPLE_RATE;
+    if ( !settings.channels ) settings.channels = 1;
+    if ( !settings.periodFrames ) settings.periodFrames = AUDIO_PERIOD_FRAMES;
+    if ( !settings.periods ) settings.periods = AUDIO_PERIODS;
+    if ( settings.periods < 2 ) return NULL;    // nothing to play while the next period renders
+    if ( settings.bitDepth && audio_bit_format( settings.bitDepth ) == SAMPLE_FORMAT_COUNT ) {
+        return NULL;
+    }
+
+    AudioContext *ctx = (AudioContext *) calloc( 1, sizeof( AudioContext ) );
+    if ( !ctx ) return NULL;
+    ctx->sampleRate = (int) settings.sampleRate;
+    ctx->channels   = settings.channels;
+    ctx->bufferSize = settings.periodFrames;
+    ctx->format     = SAMPLE_FORMAT_FLOAT32;
+    ctx->dithered   = settings.dither;
+
+    // the backend may change the rate and period to what the device supports
+    if ( strcmp( settings.device, AUDIO_DEVICE_LOOPBACK ) == 0 ) {
+        ctx->loopback.enabled     = true;
+        ctx->latency.periodFrames = settings.periodFrames;
+        ctx->latency.bufferFrames = settings.periodFrames * settings.periods;
+    } else if ( platform_audio_init( ctx, &settings ) != 0 ) {
+        free( ctx );
+        return NULL;
+    }
+    ctx->scratch = (float *) malloc( sizeof( float ) * ctx->bufferSize );
+    if ( !ctx->scratch ) {
+        if ( !ctx->loopback.enabled ) platform_audio_close( ctx );
+        free( ctx );
+        return NULL;
+    }
+
+    ctx->convert               = render_select_kernels()->pcm[ctx->format];
+    ctx->latency.format        = ctx->format;
+    ctx->latency.sampleRate    = (uint32_t) ctx->sampleRate;
+    ctx->latency.bufferSeconds = (double) ctx->latency.bufferFrames / (double) ctx->sampleRate;
+    return ctx;
+}
+
+AudioContext *audio_init( int sample_rate, int channels ) {
+    if ( sample_rate <= 0 || channels <= 0 ) return NULL;
+    AudioConfig config = {
+      .sampleRate = (uint32_t) sample_rate,
+      .channels   = (uint16_t) channels,
+    };
+    return audio_open( &config );
+}
+
+SynthError audio_render(
+  AudioContext *ctx, AudioRenderCallback render, void *user, uint32_t frames
+) {
+    if ( !ctx || !render ) return SYNTH_ERROR_NULL_PTR;
+    if ( ctx->loopback.enabled ) return loopback_render( ctx, render, user, frames );
+    return platform_audio_render( ctx, render, user, frames );
+}
+
+// audio_write() source: copy from a cursor into the device
+static void audio_copy( void *user, float *buffer, uint32_t frames ) {
+    const float **cursor = (const float **) user;
+    memcpy( buffer, *cursor, sizeof( float ) * frames );
+    *cursor += frames;
+}
+
+void audio_write( AudioContext *ctx, float *samples, int numSamples ) {
+    if ( !ctx || !samples || numSamples <= 0 ) return;
+    const float *cursor = samples;
+    audio_render( ctx, audio_copy, &cursor, (uint32_t) numSamples );
+}
+
+SynthError audio_latency( AudioContext *ctx, AudioLatency *latency ) {
+    if ( !ctx || !latency ) return SYNTH_ERROR_NULL_PTR;
+    *latency = ctx->latency;
+    return SYNTH_ACK;
+}
+
+void audio_close( AudioContext *ctx ) {
+    if ( ctx ) {
+        if ( !ctx->loopback.enabled ) platform_audio_close( ctx );
+        free( ctx->scratch );
+        free( ctx );
+    }
+}
@@ -0,0 +1,232 @@
+/**
+ * @file
+ * @brief audio device backends: ALSA on Linux, waveOut on Windows, or a null device
+ *
+ * A device is fed through audio_render(), which asks a callback for mono float frames and copies
+ * them to every channel. On ALSA the callback renders straight into the device ring through
+ * snd_pcm_mmap_begin() and snd_pcm_mmap_commit(): with a mono float device the synth writes the
+ * ring itself, otherwise one period is rendered into scratch and converted into the ring. The
+ * conversion is the selected RenderKernels PCM kernel for the device's bit depth, which clips,
+ * dithers and fans the mix out to every channel in one pass. Devices without mmap support fall
+ * back to snd_pcm_writei(). Underruns and suspends are recovered in place and counted.
+ *
+ * Define SYNTH_AUDIO_NULL to build without any audio headers; the null device then consumes
+ * frames as fast as they are rendered. For headless runs against a real ALSA stack, open the
+ * "null" device, or "file:FILE=out.raw,FORMAT=raw" to capture what the device would have played.
+ *
+ * On every platform the AUDIO_DEVICE_LOOPBACK device stands in for a sound card without touching
+ * any hardware: it consumes frames at the sample rate from a buffer of `periods` periods and
+ * counts an underrun whenever that buffer runs dry, so deadlines can be checked on a CI box.
+ */
+
+#ifndef SYNTH_PLATFORM_H
+#define SYNTH_PLATFORM_H
+
+#include "render.h"
+
+// platform identification
+#if defined( SYNTH_AUDIO_NULL )
+  #define AUDIO_API_NULL
+#elif defined( _WIN32 )
+  #define AUDIO_API_WINDOWS
+  #include <mmeapi.h>
+  #include <mmsystem.h>
+  #ifdef _MSC_VER
+    #pragma comment( lib, "winmm.lib" )
+  #endif
+#elif defined( __linux__ )
+  #define AUDIO_API_ALSA
+  #include <alsa/asoundlib.h>
+#elif defined( __APPLE__ )
+  #define AUDIO_API_COREAUDIO
+  #include <AudioUnit/AudioUnit.h>
+#else
+  #define AUDIO_API_NULL
+#endif
+
+#ifndef _WIN32
+  #include <time.h>
+#endif
+
+#define AUDIO_DEVICE_DEFAULT  "default"
+#define AUDIO_DEVICE_LOOPBACK "loopback"    // paced software device, see above
+#define AUDIO_PERIOD_FRAMES   256           // default frames per period, about 6 ms at SAMPLE_RATE
+#define AUDIO_PERIODS         3             // default periods in the device buffer
+#define AUDIO_MAX_PERIODS     16            // most periods a waveOut device rotates through
+#define AUDIO_WAIT_MS         1000          // longest wait for the device before giving up
+
+// how to open a device, zero fields take the defaults above
+typedef struct {
+    const char *device;          // backend device name, NULL for AUDIO_DEVICE_DEFAULT
+    uint32_t    sampleRate;      // 0 for SAMPLE_RATE
+    uint16_t    channels;        // 0 for mono
+    uint32_t    periodFrames;    // frames per period, the device may round it
+    uint32_t    periods;         // periods in the device buffer, at least 2, 0 for AUDIO_PERIODS
+    uint16_t    bitDepth;        // 16, 24 or 32 bit PCM, 0 lets the backend pick
+    bool        dither;          // TPDF dither on 16 and 24 bit PCM
+} AudioConfig;
+
+// what the device actually does, and the output latency measured while playing
+typedef struct {
+    uint32_t     sampleRate;
+    uint32_t     periodFrames;
+    uint32_t     bufferFrames;
+    SampleFormat format;           // samples the device takes
+    bool         mmap;             // rendering goes straight into the device ring
+    double       bufferSeconds;    // latency of a full device buffer
+    double       delaySeconds;     // last measured time from a render to the speaker
+    double       maxDelaySeconds;
+    uint64_t     frames;           // frames played so far
+    uint64_t     xruns;            // underruns recovered from
+} AudioLatency;
+
+/**
+ * @brief Fill a buffer with mono frames for the device
+ *
+ * @param user pointer given to audio_render()
+ * @param buffer destination, frames entries
+ * @param frames number of frames to produce
+ */
+typedef void ( *AudioRenderCallback )( void *user, float *buffer, uint32_t frames );
+
+// state of the AUDIO_DEVICE_LOOPBACK device
+typedef struct {
+    bool     enabled;
+    bool     running;    // the buffer filled up once and the clock is playing it
+    double   start;      // clock time frame 0 was due at the speaker
+    uint64_t queued;     // frames handed over since start
+} LoopbackDevice;
+
+// platform specific device state
+#if defined( AUDIO_API_WINDOWS )
+typedef struct {
+    HWAVEOUT hwaveOut;
+    WAVEHDR  headers[AUDIO_MAX_PERIODS];    // rotated through, one period each
+    uint32_t periods;
+    uint32_t next;          // header to fill next
+    uint8_t *buffer;        // periods back to back
+    size_t   bufferSize;    // bytes per period
+} WindowsAudioContext;
+#elif defined( AUDIO_API_ALSA )
+typedef struct {
+    snd_pcm_t        *handle;
+    snd_pcm_format_t  format;         // FLOAT_LE, S16_LE, S24_3LE or S32_LE
+    snd_pcm_uframes_t periodFrames;
+    snd_pcm_uframes_t bufferFrames;
+    bool              mmap;           // false when the device only takes snd_pcm_writei()
+    void             *interleaved;    // one period of device samples for snd_pcm_writei()
+} AlsaAudioContext;
+#elif defined( AUDIO_API_COREAUDIO )
+typedef struct {
+    AudioUnit audioUnit;
+} CoreAudioContext;
+#endif
+
+// generic audio context
+struct AudioContext {
+    int            sampleRate;
+    int            channels;
+    size_t         bufferSize;    // frames rendered per callback, one period
+    float         *scratch;       // bufferSize mono frames
+    SampleFormat   format;        // device samples, converted to by convert
+    PcmKernel      convert;
+    PcmDither      dither;
+    bool           dithered;      // config asked for dither
+    AudioLatency   latency;
+    LoopbackDevice loopback;
+#if defined( AUDIO_API_WINDOWS )
+    WindowsAudioContext platformctx;
+#elif defined( AUDIO_API_ALSA )
+    AlsaAudioContext platformctx;
+#elif defined( AUDIO_API_COREAUDIO )
+    CoreAudioContext platformctx;
+#endif
+};
+
+/*********
+ * CLOCK *
+ ********/
+// monotonic time in seconds, for pacing and deadline statistics
+static inline double audio_clock( void ) {
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter( &counter );
+    QueryPerformanceFrequency( &frequency );
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+#endif
+}
+
+static inline void audio_sleep( double seconds ) {
+    if ( seconds <= 0.0 ) return;
+#ifdef _WIN32
+    Sleep( (DWORD) ( seconds * 1e3 ) );
+#else
+    double          whole = floor( seconds );
+    struct timespec ts    = { (time_t) whole, (long) ( ( seconds - whole ) * 1e9 ) };
+    nanosleep( &ts, NULL );
+#endif
+}
+
+/**
+ * @brief Open an audio device
+ *
+ * @param config device, format and buffering, NULL for the defaults
+ * @return device, or NULL if it cannot be opened or config asks for a single period
+ */
+AudioContext *audio_open( const AudioConfig *config );
+
+/**
+ * @brief Open the default device with the default buffering
+ *
+ * @param sample_rate sample rate in Hz
+ * @param channels number of output channels
+ * @return device, or NULL if it cannot be opened
+ */
+AudioContext *audio_init( int sample_rate, int channels );
+
+/**
+ * @brief Play frames produced by a callback, blocking while the device buffer is full
+ *
+ * The callback is asked for at most one period at a time and writes into the device ring
+ * whenever the format allows.
+ *
+ * @param ctx open device
+ * @param render callback producing mono frames
+ * @param user passed to render
+ * @param frames number of frames to play
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_IO if the device failed for good
+ */
+SynthError    audio_render(
+  AudioContext *ctx, AudioRenderCallback render, void *user, uint32_t frames
+);
+
+/**
+ * @brief Play a mono buffer, blocking while the device buffer is full
+ *
+ * @param ctx open device
+ * @param samples mono samples
+ * @param numSamples number of samples
+ */
+void          audio_write( AudioContext *ctx, float *samples, int numSamples );
+
+/**
+ * @brief Report the device configuration and the latency measured so far
+ *
+ * @param ctx open device
+ * @param latency filled with the report
+ * @return SYNTH_ACK or SYNTH_ERROR_NULL_PTR
+ */
+SynthError    audio_latency( AudioContext *ctx, AudioLatency *latency );
+
+/**
+ * @brief Let queued audio finish playing, then close the device
+ *
+ * @param ctx device to close, may be NULL
+ */
+void          audio_close( AudioContext *ctx );
+
+#endif
@@ -0,0 +1,102 @@
+#include "tuning.h"
+
+#include "oscillator.h"
+
+// 2^(k/12) for the twelve semitones of an octave
+static const float tuning_semitones[DIAPASON] = {
+    1.0f,          1.05946309f, 1.12246205f, 1.18920712f, 1.25992105f, 1.33483985f,
+    1.41421356f,   1.49830708f, 1.58740105f, 1.68179283f, 1.78179744f, 1.88774863f,
+};
+
+// 2^(x/12) for x in [0, 1): a Taylor series of e^(x ln2 / 12), the next term is below 2e-9
+static inline float tuning_bend( float x ) {
+    float a = x * 0.057762265f;    // ln 2 / 12
+    return 1.0f + a * ( 1.0f + a * ( 0.5f + a * ( 1.0f / 6.0f + a * ( 1.0f / 24.0f ) ) ) );
+}
+
+float tuning_ratio( float semitones ) {
+    float whole  = floorf( semitones );
+    int   step   = (int) whole;
+    int   octave = step >= 0 ? step / DIAPASON : -( ( DIAPASON - 1 - step ) / DIAPASON );
+    int   degree = step - octave * DIAPASON;
+    return ldexpf( tuning_semitones[degree] * tuning_bend( semitones - whole ), octave );
+}
+
+SynthError tuning_table_build(
+  TuningTable *table, float baseTuning, int baseIndex, float sampleRate
+) {
+    if ( !table ) return SYNTH_ERROR_NULL_PTR;
+    if ( baseTuning <= 0.0f || sampleRate <= 0.0f ) return SYNTH_ERROR_INVALID_PARAM;
+
+    table->baseTuning = baseTuning;
+    table->baseIndex  = baseIndex;
+    table->sampleRate = sampleRate;
+    for ( int n = 0; n < TUNING_NOTES; n++ ) {
+        table->frequency[n] = baseTuning * tuning_ratio( (float) ( n - baseIndex ) );
+        osc_increment(
+          table->frequency[n], sampleRate, &table->increment[n], &table->incrementFraction[n]
+        );
+    }
+    return SYNTH_ACK;
+}
+
+SynthError tuning_init( Tuning *tuning, float baseTuning, int baseIndex, float sampleRate ) {
+    if ( !tuning ) return SYNTH_ERROR_NULL_PTR;
+    synth_swap_init( &tuning->swap );
+    return tuning_table_build( &tuning->tables[0], baseTuning, baseIndex, sampleRate );
+}
+
+SynthError tuning_retune( Tuning *tuning, float baseTuning, int baseIndex, float sampleRate ) {
+    if ( !tuning ) return SYNTH_ERROR_NULL_PTR;
+    if ( baseTuning <= 0.0f || sampleRate <= 0.0f ) return SYNTH_ERROR_INVALID_PARAM;
+
+    uint64_t spare = synth_swap_spare( &tuning->swap );
+    tuning_table_build( &tuning->tables[spare], baseTuning, baseIndex, sampleRate );
+    synth_swap_publish( &tuning->swap, spare );
+    return SYNTH_ACK;
+}
+
+const TuningTable *tuning_acquire( Tuning *tuning ) {
+    return &tuning->tables[synth_swap_enter( &tuning->swap )];
+}
+
+void tuning_release( Tuning *tuning, const TuningTable *table ) {
+    synth_swap_leave( &tuning->swap, (uint64_t) ( table - tuning->tables ) );
+}
+
+// split a pitch into a table index and a bend above it
+static inline int tuning_split( float pitch, float *bend ) {
+    if ( !( pitch > 0.0f ) ) pitch = 0.0f;    // also catches NaN
+    if ( pitch > TUNING_NOTES - 1 ) pitch = TUNING_NOTES - 1;
+    int note = (int) pitch;
+    *bend    = pitch - (float) note;
+    return note;
+}
+
+float tuning_frequency( const TuningTable *table, float pitch ) {
+    float bend;
+    int   note = tuning_split( pitch, &bend );
+    if ( bend == 0.0f ) return table->frequency[note];
+    return table->frequency[note] * tuning_bend( bend );
+}
+
+void tuning_increment(
+  const TuningTable *table, float pitch, uint32_t *increment, uint32_t *fraction
+) {
+    float bend;
+    int   note   = tuning_split( pitch, &bend );
+    *increment   = table->increment[note];
+    *fraction    = table->incrementFraction[note];
+    if ( bend == 0.0f ) return;
+
+    // scale the whole 32.32 increment, clamped below nyquist like osc_increment()
+    double scaled = ( (double) *increment + (double) *fraction * ( 1.0 / 4294967296.0 ) ) *
+                    (double) tuning_bend( bend );
+    if ( scaled >= 2147483647.0 ) {
+        *increment = 0x7FFFFFFFu;
+        *fraction  = 0;
+        return;
+    }
+    *increment = (uint32_t) scaled;
+    *fraction  = (uint32_t) ( ( scaled - (double) *increment ) * 4294967296.0 );
+}
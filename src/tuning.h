@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @brief precomputed note frequency and phase increment tables
+ *
+ * A TuningTable holds the frequency and the 32.32 phase increment of all TUNING_NOTES notes for
+ * one reference pitch, reference note and sample rate, so triggering a note is a table lookup
+ * instead of a powf. Fractional pitches for bends scale the note below by 2^(x/12), evaluated
+ * with a short polynomial that is exact to float precision.
+ *
+ * A Tuning owns two tables. Retuning builds the spare one on the control thread and swaps it in
+ * with an atomic store, the render thread only ever counts itself in and out of the table it reads
+ * and never waits. The control thread waits for the render thread to leave the spare table before
+ * rebuilding it, which is at most one block.
+ */
+
+#ifndef TUNING_H
+#define TUNING_H
+
+#include "music.h"
+#include "synth.h"
+
+#define TUNING_NOTES 128    // note indices NOTA_MIN to NOTA_MAX
+
+typedef struct {
+    float    baseTuning;    // frequency of the reference note in Hz
+    int      baseIndex;     // index of the reference note
+    float    sampleRate;
+    float    frequency[TUNING_NOTES];
+    uint32_t increment[TUNING_NOTES];            // whole phase increment per sample
+    uint32_t incrementFraction[TUNING_NOTES];    // next 32 bits of the increment
+} TuningTable;
+
+struct Tuning {
+    TuningTable tables[2];
+    SynthSwap   swap;    // which table is live and who reads each
+};
+
+/**
+ * @brief Frequency ratio of an interval, without powf
+ *
+ * @param semitones interval in semitones, may be fractional or negative
+ * @return 2^(semitones / 12)
+ */
+float              tuning_ratio( float semitones );
+
+/**
+ * @brief Fill a table for a reference pitch and sample rate
+ *
+ * @param table table to fill
+ * @param baseTuning frequency of the reference note in Hz, e.g. BASE_TUNING
+ * @param baseIndex index of the reference note, e.g. BASE_INDICE
+ * @param sampleRate sample rate the increments are computed for
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_INVALID_PARAM
+ */
+SynthError         tuning_table_build(
+  TuningTable *table, float baseTuning, int baseIndex, float sampleRate
+);
+
+/**
+ * @brief Initialize a tuning with its first table
+ *
+ * @param tuning tuning to initialize
+ * @param baseTuning frequency of the reference note in Hz
+ * @param baseIndex index of the reference note
+ * @param sampleRate sample rate in Hz
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_INVALID_PARAM
+ */
+SynthError         tuning_init( Tuning *tuning, float baseTuning, int baseIndex, float sampleRate );
+
+/**
+ * @brief Rebuild the tables and switch to them without stopping playback, control thread only
+ *
+ * @param tuning tuning to change
+ * @param baseTuning frequency of the reference note in Hz
+ * @param baseIndex index of the reference note
+ * @param sampleRate sample rate in Hz
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_INVALID_PARAM
+ */
+SynthError         tuning_retune(
+  Tuning *tuning, float baseTuning, int baseIndex, float sampleRate
+);
+
+/**
+ * @brief Get the live table for reading, never blocks
+ *
+ * @param tuning tuning to read
+ * @return the table, valid until tuning_release()
+ */
+const TuningTable *tuning_acquire( Tuning *tuning );
+
+/**
+ * @brief Stop reading a table returned by tuning_acquire()
+ *
+ * @param tuning tuning the table belongs to
+ * @param table table to release
+ */
+void               tuning_release( Tuning *tuning, const TuningTable *table );
+
+/**
+ * @brief Frequency of a possibly fractional note index
+ *
+ * @param table table to read
+ * @param pitch note index, the fraction is a bend in semitones, clamped to the table
+ * @return frequency in Hz
+ */
+float              tuning_frequency( const TuningTable *table, float pitch );
+
+/**
+ * @brief 32.32 phase increment of a possibly fractional note index
+ *
+ * @param table table to read
+ * @param pitch note index, the fraction is a bend in semitones, clamped to the table
+ * @param increment whole phase increment per sample
+ * @param fraction next 32 bits of the increment
+ */
+void               tuning_increment(
+  const TuningTable *table, float pitch, uint32_t *increment, uint32_t *fraction
+);
+
+#endif
@@ -0,0 +1,202 @@
+#include "voice.h"
+
+#include "envelope.h"
+
+// allocate one aligned per-voice array from the arena
+#define VOICE_ARRAY( arena, type, count )                                                         \
+    (type *) arena_alloc_aligned( ( arena ), sizeof( type ) * ( count ), VOICE_POOL_ALIGN )
+
+// heap order of a sounding voice under the pool's policy, the smallest key is stolen first
+static uint64_t steal_key( const VoicePool *pool, uint32_t voice ) {
+    const Voice *note = &pool->voices[voice];
+    switch ( (VoiceStealPolicy) pool->policy ) {
+        case VOICE_STEAL_QUIETEST: {
+            float    level = pool->envLevel[voice];
+            uint32_t bits;
+            // a voice still rising is about to be as loud as its peak, weigh it there
+            if ( pool->envStage[voice] == ENVELOPE_ATTACK ) level = pool->amplitude[voice];
+            if ( !( level > 0.0f ) ) level = 0.0f;
+            memcpy( &bits, &level, sizeof( bits ) );    // orders like the level when positive
+            return (uint64_t) bits << 32 | (uint32_t) note->started;
+        }
+        case VOICE_STEAL_PRIORITY: return (uint64_t) note->priority << 56 | note->started;
+        case VOICE_STEAL_OLDEST:
+        case VOICE_STEAL_SAME_NOTE:
+        case VOICE_STEAL_COUNT: break;
+    }
+    return note->started;
+}
+
+// put a voice at a heap position
+static inline void heap_place( VoicePool *pool, uint32_t slot, uint32_t voice ) {
+    pool->heap[slot]      = voice;
+    pool->heapSlot[voice] = slot;
+}
+
+// move a voice towards the top while its key is smaller than its parent's
+static void heap_up( VoicePool *pool, uint32_t slot ) {
+    uint32_t voice = pool->heap[slot];
+    uint64_t key   = pool->stealKey[voice];
+    while ( slot > 0 ) {
+        uint32_t parent = ( slot - 1 ) / 2;
+        if ( pool->stealKey[pool->heap[parent]] <= key ) break;
+        heap_place( pool, slot, pool->heap[parent] );
+        slot = parent;
+    }
+    heap_place( pool, slot, voice );
+}
+
+// move a voice towards the bottom while a child has a smaller key
+static void heap_down( VoicePool *pool, uint32_t slot ) {
+    uint32_t voice = pool->heap[slot];
+    uint64_t key   = pool->stealKey[voice];
+    for ( ;; ) {
+        uint32_t child = 2 * slot + 1;
+        if ( child >= pool->numSounding ) break;
+        if ( child + 1 < pool->numSounding &&
+             pool->stealKey[pool->heap[child + 1]] < pool->stealKey[pool->heap[child]] ) {
+            child++;
+        }
+        if ( key <= pool->stealKey[pool->heap[child]] ) break;
+        heap_place( pool, slot, pool->heap[child] );
+        slot = child;
+    }
+    heap_place( pool, slot, voice );
+}
+
+// add a voice to the sounding voices as the newest note
+static void heap_push( VoicePool *pool, uint32_t voice ) {
+    pool->voices[voice].started = pool->started++;
+    pool->stealKey[voice]       = steal_key( pool, voice );
+    heap_place( pool, pool->numSounding++, voice );
+    heap_up( pool, pool->heapSlot[voice] );
+}
+
+// take a voice out of the sounding voices, filling its place with the last one
+static void heap_remove( VoicePool *pool, uint32_t voice ) {
+    uint32_t slot         = pool->heapSlot[voice];
+    uint32_t last         = pool->heap[--pool->numSounding];
+    pool->heapSlot[voice] = VOICE_NONE;
+    if ( last == voice ) return;
+    heap_place( pool, slot, last );
+    heap_up( pool, slot );
+    heap_down( pool, pool->heapSlot[last] );
+}
+
+SynthError voice_pool_init( VoicePool *pool, SynthArena *arena, uint32_t limit ) {
+    if ( !pool || !arena ) return SYNTH_ERROR_NULL_PTR;
+    if ( limit == 0 || limit >= VOICE_NONE / 2 ) return SYNTH_ERROR_INVALID_PARAM;
+
+    uint32_t capacity       = limit + VOICE_SPARES( limit );
+
+    pool->phase             = VOICE_ARRAY( arena, uint32_t, capacity );
+    pool->phaseIncrement    = VOICE_ARRAY( arena, uint32_t, capacity );
+    pool->phaseFraction     = VOICE_ARRAY( arena, uint32_t, capacity );
+    pool->incrementFraction = VOICE_ARRAY( arena, uint32_t, capacity );
+    pool->amplitude         = VOICE_ARRAY( arena, float, capacity );
+    pool->waveform          = VOICE_ARRAY( arena, BaseWaveform, capacity );
+    pool->gate              = VOICE_ARRAY( arena, uint8_t, capacity );
+    pool->envLevel          = VOICE_ARRAY( arena, float, capacity );
+    pool->envMultiplier     = VOICE_ARRAY( arena, float, capacity );
+    pool->envOffset         = VOICE_ARRAY( arena, float, capacity );
+    pool->envRemaining      = VOICE_ARRAY( arena, uint32_t, capacity );
+    pool->envStage          = VOICE_ARRAY( arena, uint8_t, capacity );
+    pool->voices            = VOICE_ARRAY( arena, Voice, capacity );
+    pool->active            = VOICE_ARRAY( arena, uint32_t, capacity );
+    pool->activeSlot        = VOICE_ARRAY( arena, uint32_t, capacity );
+    pool->freeList          = VOICE_ARRAY( arena, uint32_t, capacity );
+    pool->heap              = VOICE_ARRAY( arena, uint32_t, capacity );
+    pool->heapSlot          = VOICE_ARRAY( arena, uint32_t, capacity );
+    pool->stealKey          = VOICE_ARRAY( arena, uint64_t, capacity );
+    if ( !pool->phase || !pool->phaseIncrement || !pool->phaseFraction ||
+         !pool->incrementFraction || !pool->amplitude || !pool->waveform || !pool->gate ||
+         !pool->envLevel || !pool->envMultiplier || !pool->envOffset || !pool->envRemaining ||
+         !pool->envStage || !pool->voices || !pool->active || !pool->activeSlot ||
+         !pool->freeList || !pool->heap || !pool->heapSlot || !pool->stealKey ) {
+        return SYNTH_ERROR_ARENA_FULL;
+    }
+
+    memset( pool->voices, 0, sizeof( Voice ) * capacity );
+    for ( uint32_t v = 0; v < capacity; v++ ) {
+        pool->phase[v]             = 0;
+        pool->phaseIncrement[v]    = 0;
+        pool->phaseFraction[v]     = 0;
+        pool->incrementFraction[v] = 0;
+        pool->amplitude[v]         = 0.0f;
+        pool->waveform[v]          = WAVEFORM_SINE;
+        pool->gate[v]              = 0;
+        pool->envLevel[v]          = 0.0f;
+        pool->envMultiplier[v]     = 1.0f;
+        pool->envOffset[v]         = 0.0f;
+        pool->envRemaining[v]      = ENVELOPE_HOLD;
+        pool->envStage[v]          = ENVELOPE_IDLE;
+        pool->activeSlot[v]        = VOICE_NONE;
+        pool->heapSlot[v]          = VOICE_NONE;
+        pool->freeList[v]          = capacity - 1 - v;    // hand out low slots first
+    }
+    pool->started     = 0;
+    pool->numSounding = 0;
+    pool->numActive   = 0;
+    pool->numFree     = capacity;
+    pool->limit       = limit;
+    pool->capacity    = capacity;
+    pool->policy      = VOICE_STEAL_OLDEST;
+    return SYNTH_ACK;
+}
+
+uint32_t voice_pool_alloc( VoicePool *pool ) {
+    if ( !pool || pool->numFree == 0 || pool->numSounding >= pool->limit ) return VOICE_NONE;
+    uint32_t voice                  = pool->freeList[--pool->numFree];
+    pool->activeSlot[voice]         = pool->numActive;
+    pool->active[pool->numActive++] = voice;
+    heap_push( pool, voice );
+    return voice;
+}
+
+void voice_pool_release( VoicePool *pool, uint32_t voice ) {
+    if ( !pool || !voice_pool_is_active( pool, voice ) ) return;
+
+    // swap the last active voice into the hole to keep the list dense
+    uint32_t slot           = pool->activeSlot[voice];
+    uint32_t last           = pool->active[--pool->numActive];
+    pool->active[slot]      = last;
+    pool->activeSlot[last]  = slot;
+    pool->activeSlot[voice] = VOICE_NONE;
+
+    if ( pool->heapSlot[voice] != VOICE_NONE ) heap_remove( pool, voice );
+    pool->gate[voice]               = 0;
+    pool->freeList[pool->numFree++] = voice;
+}
+
+void voice_pool_fade( VoicePool *pool, uint32_t voice ) {
+    if ( !pool || voice >= pool->capacity || pool->heapSlot[voice] == VOICE_NONE ) return;
+    heap_remove( pool, voice );
+}
+
+void voice_pool_retrigger( VoicePool *pool, uint32_t voice ) {
+    if ( !pool || !voice_pool_is_active( pool, voice ) ) return;
+    if ( pool->heapSlot[voice] != VOICE_NONE ) heap_remove( pool, voice );
+    heap_push( pool, voice );
+}
+
+void voice_pool_update( VoicePool *pool, uint32_t voice ) {
+    if ( !pool || voice >= pool->capacity || pool->heapSlot[voice] == VOICE_NONE ) return;
+    uint64_t key          = steal_key( pool, voice );
+    uint64_t was          = pool->stealKey[voice];
+    pool->stealKey[voice] = key;
+    if ( key < was ) heap_up( pool, pool->heapSlot[voice] );
+    else if ( key > was ) heap_down( pool, pool->heapSlot[voice] );
+}
+
+SynthError voice_pool_set_policy( VoicePool *pool, VoiceStealPolicy policy ) {
+    if ( !pool ) return SYNTH_ERROR_NULL_PTR;
+    if ( (unsigned) policy >= VOICE_STEAL_COUNT ) return SYNTH_ERROR_INVALID_PARAM;
+    pool->policy = (uint8_t) policy;
+
+    // rebuild bottom up, every key may have moved
+    for ( uint32_t slot = 0; slot < pool->numSounding; slot++ ) {
+        pool->stealKey[pool->heap[slot]] = steal_key( pool, pool->heap[slot] );
+    }
+    for ( uint32_t slot = pool->numSounding / 2; slot-- > 0; ) heap_down( pool, slot );
+    return SYNTH_ACK;
+}
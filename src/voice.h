@@ -0,0 +1,154 @@
+/**
+ * @file
+ * @brief structure-of-arrays voice pool with a dense list of active voices
+ *
+ * Fields the renderer reads every block live in their own cache-line aligned arrays, indexed by
+ * voice slot. Live slots are packed at the front of `active` so rendering walks only those, and
+ * the free slots sit on a stack. Allocation and release are O(1).
+ *
+ * Once `limit` voices sound, a new note needs a victim. The sounding voices sit in a binary
+ * min-heap ordered by the pool's VoiceStealPolicy, so the victim is always at the top and keeping
+ * the order costs O(log n) per note on, release or level update instead of a scan of every voice.
+ * The victim does not have to be cut off: voice_pool_fade() takes it out of the heap and out of
+ * the count so it can ramp down in one of the spare slots past `limit` while the new note starts
+ * in another.
+ */
+
+#ifndef VOICE_H
+#define VOICE_H
+
+#include "synth.h"
+
+#define VOICE_POOL_ALIGN      64                       // alignment of every per-voice array
+#define VOICE_NONE            UINT32_MAX               // empty slot / end of list marker
+#define VOICE_SPARES( limit ) ( ( limit ) / 4 + 1 )    // slots stolen voices fade out in
+
+struct VoicePool {
+    // hot fields, touched by the renderer every block
+    uint32_t     *phase;                // 32 bit phase accumulator
+    uint32_t     *phaseIncrement;       // phase advance per sample
+    uint32_t     *phaseFraction;        // 32.32 extension of phase, see osc_carry()
+    uint32_t     *incrementFraction;    // 32.32 extension of phaseIncrement
+    float        *amplitude;            // peak gain of the note
+    BaseWaveform *waveform;
+    uint8_t      *gate;                 // 1 while the note is held
+
+    // envelope state, see envelope.h
+    float        *envLevel;         // gain at the next sample, includes the note amplitude
+    float        *envMultiplier;    // per-sample step of the current segment:
+    float        *envOffset;        //   level = level * envMultiplier + envOffset
+    uint32_t     *envRemaining;     // samples left in the current segment
+    uint8_t      *envStage;         // EnvelopeStage
+
+    // cold per-voice data
+    Voice        *voices;
+
+    // bookkeeping
+    uint32_t     *active;        // dense list of live voice slots
+    uint32_t     *activeSlot;    // position of each voice in active, VOICE_NONE when free
+    uint32_t     *freeList;      // stack of free voice slots
+    uint32_t     *heap;          // sounding voices, the next victim first
+    uint32_t     *heapSlot;      // position of each voice in heap, VOICE_NONE when not sounding
+    uint64_t     *stealKey;      // heap order, the smallest key is stolen first
+    uint64_t      started;       // voices triggered so far, see Voice.started
+    uint32_t      numSounding;
+    uint32_t      numActive;
+    uint32_t      numFree;
+    uint32_t      limit;       // most voices sounding at once, the rest fade out stolen notes
+    uint32_t      capacity;    // slots, limit + VOICE_SPARES( limit )
+    uint8_t       policy;      // VoiceStealPolicy
+};
+
+/**
+ * @brief Carve a voice pool out of an arena
+ *
+ * On top of limit voice slots come VOICE_SPARES( limit ) for stolen voices to fade out in.
+ * The steal policy starts as VOICE_STEAL_OLDEST.
+ *
+ * @param pool pool to initialize
+ * @param arena arena that backs every array of the pool
+ * @param limit most voices sounding at once
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR, SYNTH_ERROR_INVALID_PARAM or SYNTH_ERROR_ARENA_FULL
+ */
+SynthError voice_pool_init( VoicePool *pool, SynthArena *arena, uint32_t limit );
+
+/**
+ * @brief Take a free voice slot, it becomes the newest sounding voice
+ *
+ * Set the voice's Voice.priority and envelope, then call voice_pool_update().
+ *
+ * @param pool pool to allocate from
+ * @return voice slot, or VOICE_NONE if limit voices sound or every slot is in use
+ */
+uint32_t   voice_pool_alloc( VoicePool *pool );
+
+/**
+ * @brief Return a voice slot to the pool
+ *
+ * @param pool pool the voice belongs to
+ * @param voice voice slot to release, ignored if not active
+ */
+void       voice_pool_release( VoicePool *pool, uint32_t voice );
+
+/**
+ * @brief Sounding voice the steal policy gives up first
+ *
+ * @param pool pool to steal from
+ * @return voice slot, or VOICE_NONE if no voice sounds
+ */
+static inline uint32_t voice_pool_victim( const VoicePool *pool ) {
+    return pool->numSounding ? pool->heap[0] : VOICE_NONE;
+}
+
+/**
+ * @brief Stop counting a voice as sounding, it stays active until it is released
+ *
+ * The voice is never picked as a victim again and frees its place under the limit.
+ *
+ * @param pool pool the voice belongs to
+ * @param voice active voice slot
+ */
+void       voice_pool_fade( VoicePool *pool, uint32_t voice );
+
+/**
+ * @brief Start a new note on an active voice, it becomes the newest sounding voice
+ *
+ * For a same note retrigger, or a victim that has no spare slot to fade out in. A fading voice
+ * sounds again, which the caller must have room for under the limit.
+ *
+ * @param pool pool the voice belongs to
+ * @param voice active voice slot
+ */
+void       voice_pool_retrigger( VoicePool *pool, uint32_t voice );
+
+/**
+ * @brief Move a sounding voice to its place in the steal order, O(log n)
+ *
+ * Call after Voice.priority changes and, under VOICE_STEAL_QUIETEST, after the envelope moves.
+ *
+ * @param pool pool the voice belongs to
+ * @param voice voice slot, ignored if not sounding
+ */
+void       voice_pool_update( VoicePool *pool, uint32_t voice );
+
+/**
+ * @brief Pick the steal policy and reorder the sounding voices by it
+ *
+ * @param pool pool to configure
+ * @param policy how victims are chosen
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_INVALID_PARAM
+ */
+SynthError voice_pool_set_policy( VoicePool *pool, VoiceStealPolicy policy );
+
+/**
+ * @brief Check whether a voice slot is currently in use
+ *
+ * @param pool pool the voice belongs to
+ * @param voice voice slot
+ * @return true if active
+ */
+static inline bool voice_pool_is_active( const VoicePool *pool, uint32_t voice ) {
+    return voice < pool->capacity && pool->activeSlot[voice] != VOICE_NONE;
+}
+
+#endif
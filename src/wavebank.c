@@ -0,0 +1,293 @@
+#include "wavebank.h"
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#define WAVEBANK_PRIME 0x100000001B3ull    // the 64 bit FNV prime
+
+static size_t wavebank_width( uint32_t format ) {
+    return format == WAVEBANK_INT16 ? sizeof( int16_t ) : sizeof( float );
+}
+
+static uint64_t wavebank_round( uint64_t bytes, uint64_t to ) {
+    return ( bytes + to - 1 ) / to * to;
+}
+
+uint64_t wavebank_checksum( const void *data, size_t bytes, uint64_t seed ) {
+    const uint8_t *at = (const uint8_t *) data;
+    uint64_t       h  = seed;
+    for ( size_t i = 0; i + 8 <= bytes; i += 8 ) {
+        uint64_t word;
+        memcpy( &word, at + i, 8 );
+        // both steps are invertible, so one changed word always changes the result
+        h  = ( h ^ word ) * WAVEBANK_PRIME;
+        h ^= h >> 32;
+    }
+    return h;
+}
+
+// checksum of a header with its own checksum taken as zero, then of the index after it
+static uint64_t wavebank_header_checksum( const WaveBankHeader *header, const void *index ) {
+    WaveBankHeader copy = *header;
+    copy.checksum       = 0;
+    uint64_t h          = wavebank_checksum( &copy, sizeof( copy ), 0 );
+    return wavebank_checksum( index, (size_t) header->count * sizeof( WaveBankEntry ), h );
+}
+
+/***********
+ * MAPPING *
+ **********/
+static bool wavebank_entry_valid( const WaveBankEntry *entry, const WaveBankHeader *header ) {
+    if ( entry->format >= WAVEBANK_FORMAT_COUNT ) return false;
+    if ( memchr( entry->name, 0, WAVEBANK_NAME ) == NULL ) return false;
+    if ( entry->offset % WAVEBANK_ALIGN || entry->offset < sizeof( WaveBankHeader ) ) return false;
+    uint64_t bytes = (uint64_t) entry->frames * wavebank_width( entry->format );
+    return entry->offset <= header->index && bytes <= header->index - entry->offset;
+}
+
+// everything but the samples, which only wavebank_verify() reads
+static SynthError wavebank_check( WaveBank *bank ) {
+    const WaveBankHeader *header = (const WaveBankHeader *) bank->base;
+    if ( bank->bytes < sizeof( WaveBankHeader ) ) return SYNTH_ERROR_INVALID_PARAM;
+    if ( memcmp( header->magic, WAVEBANK_MAGIC, sizeof( header->magic ) ) != 0 ) {
+        return SYNTH_ERROR_INVALID_PARAM;
+    }
+    if ( header->order != WAVEBANK_ORDER || header->version == 0 ||
+         header->version > WAVEBANK_VERSION || header->bytes != bank->bytes ) {
+        return SYNTH_ERROR_INVALID_PARAM;
+    }
+    if ( header->index % WAVEBANK_ALIGN || header->index > header->bytes ||
+         header->count > ( header->bytes - header->index ) / sizeof( WaveBankEntry ) ) {
+        return SYNTH_ERROR_INVALID_PARAM;
+    }
+    bank->entries = (const WaveBankEntry *) ( bank->base + header->index );
+    bank->count   = header->count;
+    if ( wavebank_header_checksum( header, bank->entries ) != header->checksum ) {
+        return SYNTH_ERROR_INVALID_PARAM;
+    }
+    for ( uint32_t i = 0; i < bank->count; i++ ) {
+        if ( !wavebank_entry_valid( &bank->entries[i], header ) ) return SYNTH_ERROR_INVALID_PARAM;
+    }
+    return SYNTH_ACK;
+}
+
+SynthError wavebank_open( WaveBank *bank, const char *path ) {
+    if ( !bank || !path ) return SYNTH_ERROR_NULL_PTR;
+    memset( bank, 0, sizeof( *bank ) );
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    bank->file = CreateFileA(
+      path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL
+    );
+    if ( bank->file == INVALID_HANDLE_VALUE || !GetFileSizeEx( bank->file, &size ) ||
+         size.QuadPart < (LONGLONG) sizeof( WaveBankHeader ) ) {
+        wavebank_close( bank );
+        return SYNTH_ERROR_IO;
+    }
+    bank->mapping = CreateFileMappingA( bank->file, NULL, PAGE_READONLY, 0, 0, NULL );
+    if ( bank->mapping ) {
+        bank->base = (const uint8_t *) MapViewOfFile( bank->mapping, FILE_MAP_READ, 0, 0, 0 );
+    }
+    bank->bytes   = (size_t) size.QuadPart;
+#else
+    struct stat info;
+    int         fd = open( path, O_RDONLY );
+    if ( fd < 0 ) return SYNTH_ERROR_IO;
+    if ( fstat( fd, &info ) != 0 || info.st_size < (off_t) sizeof( WaveBankHeader ) ) {
+        close( fd );
+        return SYNTH_ERROR_IO;
+    }
+    // the mapping keeps the file open
+    void *base  = mmap( NULL, (size_t) info.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    bank->base  = base == MAP_FAILED ? NULL : (const uint8_t *) base;
+    bank->bytes = (size_t) info.st_size;
+    close( fd );
+#endif
+    if ( !bank->base ) {
+        wavebank_close( bank );
+        return SYNTH_ERROR_IO;
+    }
+
+    SynthError err = wavebank_check( bank );
+    if ( err != SYNTH_ACK ) wavebank_close( bank );
+    return err;
+}
+
+void wavebank_close( WaveBank *bank ) {
+    if ( !bank ) return;
+#ifdef _WIN32
+    if ( bank->base ) UnmapViewOfFile( bank->base );
+    if ( bank->mapping ) CloseHandle( bank->mapping );
+    if ( bank->file && bank->file != INVALID_HANDLE_VALUE ) CloseHandle( bank->file );
+    bank->file    = NULL;
+    bank->mapping = NULL;
+#else
+    if ( bank->base ) munmap( (void *) bank->base, bank->bytes );
+#endif
+    bank->base    = NULL;
+    bank->bytes   = 0;
+    bank->entries = NULL;
+    bank->count   = 0;
+}
+
+SynthError wavebank_verify( const WaveBank *bank ) {
+    if ( !bank || !bank->base ) return SYNTH_ERROR_NULL_PTR;
+    for ( uint32_t i = 0; i < bank->count; i++ ) {
+        // the zeros padding an entry out are part of the file
+        const WaveBankEntry *entry = &bank->entries[i];
+        uint64_t             bytes = (uint64_t) entry->frames * wavebank_width( entry->format );
+        bytes                      = wavebank_round( bytes, 8 );
+        if ( wavebank_checksum( bank->base + entry->offset, bytes, 0 ) != entry->checksum ) {
+            return SYNTH_ERROR_INVALID_PARAM;
+        }
+    }
+    return SYNTH_ACK;
+}
+
+const WaveBankEntry *wavebank_find( const WaveBank *bank, const char *name ) {
+    if ( !bank || !bank->entries || !name ) return NULL;
+    uint32_t low = 0, high = bank->count;
+    while ( low < high ) {
+        uint32_t mid   = low + ( high - low ) / 2;
+        int      order = strncmp( name, bank->entries[mid].name, WAVEBANK_NAME );
+        if ( order == 0 ) return &bank->entries[mid];
+        if ( order < 0 ) high = mid;
+        else low = mid + 1;
+    }
+    return NULL;
+}
+
+BaseWaveform wavebank_register(
+  const WaveBank *bank, const WaveBankEntry *entry, WaveformRegistry *registry
+) {
+    if ( !bank || !entry || !registry ) return INVALID_WAVEFORM;
+    if ( entry->format != WAVEBANK_FLOAT32 || entry->frames != WAVEBANK_TABLES ) {
+        return INVALID_WAVEFORM;
+    }
+    return wavetable_registry_add_tables(
+      registry, (const float *) wavebank_samples( bank, entry ), entry->name
+    );
+}
+
+/***********
+ * WRITING *
+ **********/
+static SynthError wavebank_put( WaveBankWriter *writer, const void *data, size_t bytes ) {
+    if ( bytes && fwrite( data, 1, bytes, writer->file ) != bytes ) return SYNTH_ERROR_IO;
+    writer->bytes += bytes;
+    return SYNTH_ACK;
+}
+
+// zeros up to the next WAVEBANK_ALIGN boundary
+static SynthError wavebank_pad( WaveBankWriter *writer ) {
+    static const uint8_t zeros[WAVEBANK_ALIGN] = { 0 };
+    return wavebank_put(
+      writer, zeros, (size_t) ( wavebank_round( writer->bytes, WAVEBANK_ALIGN ) - writer->bytes )
+    );
+}
+
+SynthError wavebank_writer_open( WaveBankWriter *writer, const char *path ) {
+    if ( !writer || !path ) return SYNTH_ERROR_NULL_PTR;
+    memset( writer, 0, sizeof( *writer ) );
+    writer->file = fopen( path, "wb" );
+    if ( !writer->file ) return SYNTH_ERROR_IO;
+
+    // a zeroed header until close, so a bank that is never finished does not open
+    WaveBankHeader header;
+    memset( &header, 0, sizeof( header ) );
+    writer->error = wavebank_put( writer, &header, sizeof( header ) );
+    return writer->error;
+}
+
+SynthError wavebank_write(
+  WaveBankWriter *writer, const char *name, WaveBankFormat format, const void *samples,
+  uint32_t frames, uint32_t sampleRate, float frequency, float scale
+) {
+    if ( !writer || !name || ( !samples && frames ) ) return SYNTH_ERROR_NULL_PTR;
+    if ( !writer->file ) return SYNTH_ERROR_IO;
+    if ( writer->error != SYNTH_ACK ) return writer->error;
+    size_t length = strlen( name );
+    if ( length == 0 || length >= WAVEBANK_NAME || format < 0 || format >= WAVEBANK_FORMAT_COUNT ) {
+        return SYNTH_ERROR_INVALID_PARAM;
+    }
+    if ( writer->count == writer->capacity ) {
+        uint32_t       capacity = writer->capacity ? writer->capacity * 2 : 64;
+        WaveBankEntry *entries  = (WaveBankEntry *) realloc(
+          writer->entries, sizeof( WaveBankEntry ) * capacity
+        );
+        if ( !entries ) return writer->error = SYNTH_ERROR_OOM;
+        writer->entries  = entries;
+        writer->capacity = capacity;
+    }
+
+    WaveBankEntry *entry = &writer->entries[writer->count];
+    size_t         bytes = (size_t) frames * wavebank_width( format );
+    uint64_t       tail  = 0;
+    memset( entry, 0, sizeof( *entry ) );
+    memcpy( entry->name, name, length );
+    entry->format     = (uint32_t) format;
+    entry->sampleRate = sampleRate;
+    entry->frames     = frames;
+    entry->frequency  = frequency;
+    entry->scale      = scale;
+    entry->offset     = writer->bytes;
+    entry->checksum   = wavebank_checksum( samples, bytes / 8 * 8, 0 );
+    if ( bytes % 8 ) {
+        // the last few bytes as the zero padded word they are in the file
+        memcpy( &tail, (const uint8_t *) samples + bytes / 8 * 8, bytes % 8 );
+        entry->checksum = wavebank_checksum( &tail, 8, entry->checksum );
+    }
+
+    writer->error = wavebank_put( writer, samples, bytes );
+    if ( writer->error == SYNTH_ACK ) writer->error = wavebank_pad( writer );
+    if ( writer->error == SYNTH_ACK ) writer->count++;
+    return writer->error;
+}
+
+static int wavebank_order( const void *a, const void *b ) {
+    return strncmp(
+      ( (const WaveBankEntry *) a )->name, ( (const WaveBankEntry *) b )->name, WAVEBANK_NAME
+    );
+}
+
+SynthError wavebank_writer_close( WaveBankWriter *writer ) {
+    if ( !writer ) return SYNTH_ERROR_NULL_PTR;
+    if ( !writer->file ) return SYNTH_ERROR_IO;
+    SynthError err = writer->error;
+
+    // the index goes last, sorted for wavebank_find(), and the header over the zeroed one
+    if ( writer->count ) {
+        qsort( writer->entries, writer->count, sizeof( WaveBankEntry ), wavebank_order );
+    }
+    for ( uint32_t i = 1; err == SYNTH_ACK && i < writer->count; i++ ) {
+        if ( wavebank_order( &writer->entries[i - 1], &writer->entries[i] ) == 0 ) {
+            err = SYNTH_ERROR_INVALID_PARAM;
+        }
+    }
+    WaveBankHeader header;
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.magic, WAVEBANK_MAGIC, sizeof( header.magic ) );
+    header.version  = WAVEBANK_VERSION;
+    header.order    = WAVEBANK_ORDER;
+    header.index    = writer->bytes;
+    header.count    = writer->count;
+    header.bytes    = writer->bytes + (uint64_t) writer->count * sizeof( WaveBankEntry );
+    header.checksum = wavebank_header_checksum( &header, writer->entries );
+    if ( err == SYNTH_ACK ) {
+        err = wavebank_put( writer, writer->entries, writer->count * sizeof( WaveBankEntry ) );
+    }
+    if ( err == SYNTH_ACK && fseek( writer->file, 0, SEEK_SET ) != 0 ) err = SYNTH_ERROR_IO;
+    if ( err == SYNTH_ACK && fwrite( &header, sizeof( header ), 1, writer->file ) != 1 ) {
+        err = SYNTH_ERROR_IO;
+    }
+    if ( fclose( writer->file ) != 0 && err == SYNTH_ACK ) err = SYNTH_ERROR_IO;
+    free( writer->entries );
+    writer->file    = NULL;
+    writer->entries = NULL;
+    writer->count   = 0;
+    return err;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file
+ * @brief versioned binary waveform banks, memory mapped and read in place
+ *
+ * A bank is one file: a WaveBankHeader, every entry's samples and, last, an index of
+ * WaveBankEntry sorted by name. Samples are float32 or int16, each entry's starting on a
+ * WAVEBANK_ALIGN boundary of the file and so of the mapping, and every field and sample is
+ * little-endian, which is the host order on every platform we build for; a byte order mark in the
+ * header turns anything else away. Opening maps the file read only and checks the header and the
+ * index against the header's checksum, nothing else is read, parsed or copied: samples come
+ * straight from the mapping and the pages of an entry are faulted in the first time it is played.
+ * Every entry carries its own checksum as well, which wavebank_verify() checks on demand since it
+ * has to read the whole file.
+ *
+ * Float32 entries of WAVETABLE_OCTAVES tables of WAVETABLE_STRIDE samples are band-limited octave
+ * tables as wavetable_init() renders them and can be registered as custom waveforms without a
+ * copy. Anything else, recorded cycles and CSV dumps among it, is kept as plain samples.
+ */
+
+#ifndef WAVEBANK_H
+#define WAVEBANK_H
+
+#include "wavetable.h"
+
+#define WAVEBANK_MAGIC    "WAVEBANK"
+#define WAVEBANK_VERSION  1             // files of a later version are turned away
+#define WAVEBANK_ORDER    0x01020304    // reads back the same on a little-endian host only
+#define WAVEBANK_ALIGN    64            // of every entry's samples and the index
+#define WAVEBANK_NAME     24            // bytes of an entry's name, terminator included
+#define WAVEBANK_TABLES   ( WAVETABLE_OCTAVES * WAVETABLE_STRIDE )    // samples of octave tables
+
+/*******************
+ * DATA STRUCTURES *
+ ******************/
+// sample encodings, numbered for the file rather than the enum order
+typedef enum {
+    WAVEBANK_FLOAT32     = 0,
+    WAVEBANK_INT16       = 1,
+    WAVEBANK_FORMAT_COUNT
+} WaveBankFormat;
+
+// the first WAVEBANK_ALIGN bytes of a bank
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t order;       // WAVEBANK_ORDER as the writer stored it
+    uint64_t bytes;       // of the whole file
+    uint64_t index;       // offset of the first entry
+    uint32_t count;       // entries
+    uint32_t reserved;
+    uint64_t checksum;    // of this header with the checksum zeroed, then the index
+    uint8_t  padding[16];
+} WaveBankHeader;
+
+// one run of samples
+typedef struct {
+    char     name[WAVEBANK_NAME];    // unique, nul terminated
+    uint32_t format;                 // WaveBankFormat
+    uint32_t sampleRate;             // Hz the samples were taken at, 0 for octave tables
+    uint32_t frames;
+    float    frequency;              // Hz of the note held, 0 if none
+    float    scale;                  // int16 samples times this are in [-1, 1], 1 for float32
+    uint32_t reserved;
+    uint64_t offset;                 // of the first sample from the start of the file
+    uint64_t checksum;               // of the samples, zero padded to a multiple of 8 bytes
+} WaveBankEntry;
+
+typedef struct {
+    const uint8_t        *base;    // the mapping, base[0] is the header
+    size_t                bytes;
+    const WaveBankEntry  *entries;
+    uint32_t              count;
+#ifdef _WIN32
+    HANDLE                file;       // handles the view is made from
+    HANDLE                mapping;
+#endif
+} WaveBank;
+
+// builds a bank one entry at a time, then writes the index and header on close
+typedef struct {
+    FILE          *file;
+    WaveBankEntry *entries;
+    uint32_t       count;
+    uint32_t       capacity;
+    uint64_t       bytes;    // written so far
+    SynthError     error;    // first failure, reported on close
+} WaveBankWriter;
+
+/*************
+ * FUNCTIONS *
+ ************/
+/**
+ * @brief Checksum of a run of bytes, eight at a time
+ *
+ * @param data bytes to hash, a multiple of 8 of them
+ * @param bytes number of bytes
+ * @param seed checksum of what came before, 0 to start
+ * @return the checksum
+ */
+uint64_t             wavebank_checksum( const void *data, size_t bytes, uint64_t seed );
+
+/**
+ * @brief Map a bank and check its header and index, not realtime safe
+ *
+ * @param bank bank to open
+ * @param path file to map
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR, SYNTH_ERROR_IO if the file cannot be mapped or
+ * SYNTH_ERROR_INVALID_PARAM if it is no bank, of a later version, truncated or corrupt
+ */
+SynthError           wavebank_open( WaveBank *bank, const char *path );
+
+/**
+ * @brief Unmap a bank, nothing may read its samples afterwards
+ *
+ * @param bank bank to close, may be NULL
+ */
+void                 wavebank_close( WaveBank *bank );
+
+/**
+ * @brief Check every entry's samples against its checksum, reads the whole file
+ *
+ * @param bank open bank
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_INVALID_PARAM on the first mismatch
+ */
+SynthError           wavebank_verify( const WaveBank *bank );
+
+/**
+ * @brief Find an entry by name, a binary search of the index
+ *
+ * @param bank open bank
+ * @param name entry name
+ * @return the entry, or NULL if there is none of that name
+ */
+const WaveBankEntry *wavebank_find( const WaveBank *bank, const char *name );
+
+/**
+ * @brief Samples of an entry, in place in the mapping
+ *
+ * @param bank bank the entry is from
+ * @param entry entry of the bank
+ * @return frames samples in the entry's format, valid until wavebank_close()
+ */
+static inline const void *wavebank_samples( const WaveBank *bank, const WaveBankEntry *entry ) {
+    return bank->base + entry->offset;
+}
+
+/**
+ * @brief Register an entry of octave tables as a custom waveform, read in place
+ *
+ * @param bank open bank, must stay open as long as the registry
+ * @param entry float32 entry of WAVEBANK_TABLES frames
+ * @param registry registry to add to, control thread only
+ * @return the new waveform type, or INVALID_WAVEFORM if the entry is no octave tables or the
+ * registry is full
+ */
+BaseWaveform         wavebank_register(
+  const WaveBank *bank, const WaveBankEntry *entry, WaveformRegistry *registry
+);
+
+/**
+ * @brief Create a bank file to write entries to
+ *
+ * @param writer writer to initialize
+ * @param path file to create or truncate
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_IO
+ */
+SynthError           wavebank_writer_open( WaveBankWriter *writer, const char *path );
+
+/**
+ * @brief Append an entry, its samples padded to WAVEBANK_ALIGN
+ *
+ * @param writer open writer
+ * @param name unique name, at most WAVEBANK_NAME - 1 bytes
+ * @param format encoding of samples
+ * @param samples frames samples in format
+ * @param frames number of samples
+ * @param sampleRate Hz the samples were taken at, 0 for octave tables
+ * @param frequency Hz of the note held, 0 if none
+ * @param scale int16 samples times this are in [-1, 1], 1 for float32
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR, SYNTH_ERROR_INVALID_PARAM for a bad name or format,
+ * SYNTH_ERROR_OOM or SYNTH_ERROR_IO
+ */
+SynthError           wavebank_write(
+  WaveBankWriter *writer, const char *name, WaveBankFormat format, const void *samples,
+  uint32_t frames, uint32_t sampleRate, float frequency, float scale
+);
+
+/**
+ * @brief Write the sorted index and the header, then close the file
+ *
+ * @param writer open writer
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR, SYNTH_ERROR_INVALID_PARAM for a repeated name, or the
+ * first error of any wavebank_write() call
+ */
+SynthError           wavebank_writer_close( WaveBankWriter *writer );
+
+#endif
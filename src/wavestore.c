@@ -0,0 +1,298 @@
+#include "wavestore.h"
+
+#ifdef _MSC_VER
+  #define WAVESTORE_INLINE __forceinline
+#else
+  #define WAVESTORE_INLINE inline __attribute__( ( always_inline ) )
+#endif
+
+/************
+ * SYMMETRY *
+ ***********/
+static float wavestore_peak( const WaveTable *table ) {
+    float peak = 0.0f;
+    for ( int i = 0; i < WAVETABLE_OCTAVES * WAVETABLE_STRIDE; i++ ) {
+        peak = fmaxf( peak, fabsf( table->samples[i] ) );
+    }
+    return peak;
+}
+
+// largest |t[a(i)] - sign t[b(i)]| over every octave, the index maps given as offsets and strides
+static float wavestore_error(
+  const WaveTable *table, int count, int aStart, int aStep, int bStart, float sign
+) {
+    float worst = 0.0f;
+    for ( int octave = 0; octave < WAVETABLE_OCTAVES; octave++ ) {
+        const float *t = wavetable_octave_table( table, octave );
+        for ( int i = 0; i < count; i++ ) {
+            float error = fabsf( t[aStart + aStep * i] - sign * t[bStart + i] );
+            if ( error > worst ) worst = error;
+        }
+    }
+    return worst;
+}
+
+WaveSymmetry wavestore_symmetry( const WaveTable *table, float *mirror ) {
+    const int half      = WAVETABLE_SIZE / 2;
+    const int quarter   = WAVETABLE_SIZE / 4;
+    float     tolerance = WAVESTORE_TOLERANCE * wavestore_peak( table );
+
+    // f(x + 1/2) = -f(x), then within the first half f(1/2 - x) = s f(x), or f(1 - x) = s f(x)
+    bool halves = wavestore_error( table, half, half, 1, 0, -1.0f ) <= tolerance;
+    for ( int s = 1; s >= -1; s -= 2 ) {
+        *mirror = (float) s;
+        if ( halves && wavestore_error( table, quarter + 1, half, -1, 0, *mirror ) <= tolerance ) {
+            return WAVESTORE_QUARTER;
+        }
+    }
+    *mirror = 1.0f;
+    if ( halves ) return WAVESTORE_HALF;
+    for ( int s = 1; s >= -1; s -= 2 ) {
+        *mirror = (float) s;
+        if ( wavestore_error( table, half + 1, WAVETABLE_SIZE, -1, 0, *mirror ) <= tolerance ) {
+            return WAVESTORE_MIRROR;
+        }
+    }
+    *mirror = 1.0f;
+    return WAVESTORE_NONE;
+}
+
+/***********
+ * KERNELS *
+ **********/
+// how the pieces a symmetry cuts the cycle into are read: backwards or not, from which stored
+// index in quarter cycles and with which of the signs
+typedef struct {
+    bool    back;
+    uint8_t origin;
+    uint8_t sign;
+} WavePiece;
+
+// log2 of the number of pieces
+static const uint8_t wavestore_folds[WAVESTORE_SYMMETRY_COUNT] = { 0, 1, 1, 2 };
+
+static const WavePiece wavestore_pieces[WAVESTORE_SYMMETRY_COUNT][4] = {
+  [WAVESTORE_NONE]    = { { false, 0, 0 } },
+  [WAVESTORE_MIRROR]  = { { false, 0, 0 }, { true, 4, 1 } },
+  [WAVESTORE_HALF]    = { { false, 0, 0 }, { false, 2, 2 } },
+  [WAVESTORE_QUARTER] = { { false, 0, 0 }, { true, 2, 1 }, { false, 2, 2 }, { true, 4, 3 } },
+};
+
+#if WAVETABLE_BITS - WAVESTORE_MIN_BITS != 2
+  #error "wavestore_reads and wavestore_cache_render cover cycle lengths 9 to 11 bits"
+#endif
+
+// int16 fractions are taken to 15 bits so the interpolation stays in integers and only the result
+// is converted: the difference of two samples times the fraction fits in 31 bits
+#define WAVESTORE_INT16_FRAC 15
+
+// samples that all fall in one piece, read the way wavetable_read() reads a whole table from a
+// phase q measured from the piece's origin, then scaled by the piece's sign; the shift is a
+// constant in every instance, so it costs what wavetable_read()'s fixed shift does
+static WAVESTORE_INLINE void wavestore_run(
+  const void *samples, float *out, int count, uint32_t q, uint32_t step, float sign,
+  uint32_t shift, WaveStoreFormat format
+) {
+    const uint32_t mask = ( 1u << shift ) - 1;
+    if ( format == WAVESTORE_INT16 ) {
+        const int16_t *s    = (const int16_t *) samples;
+        const float    unit = sign / (float) ( 1u << WAVESTORE_INT16_FRAC );
+        for ( int i = 0; i < count; i++ ) {
+            size_t   index  = q >> shift;
+            int32_t  frac   = (int32_t) ( ( q & mask ) >> ( shift - WAVESTORE_INT16_FRAC ) );
+            int32_t  a      = s[index];
+            int32_t  mixed  = a * ( 1 << WAVESTORE_INT16_FRAC ) + ( s[index + 1] - a ) * frac;
+            out[i]          = (float) mixed * unit;
+            q              += step;
+        }
+        return;
+    }
+    const float *s    = (const float *) samples;
+    const float  unit = 1.0f / (float) ( 1u << shift );
+    for ( int i = 0; i < count; i++ ) {
+        size_t   index  = q >> shift;
+        float    frac   = (float) ( q & mask ) * unit;
+        float    a      = s[index];
+        out[i]          = ( a + ( s[index + 1] - a ) * frac ) * sign;
+        q              += step;
+    }
+}
+
+// the fold is worked out once per piece, inside one the store reads like a whole table; the
+// samples left in a piece may round one short but never over, and a whole cycle is never left
+// since the phase wraps onto its start. Read backwards, sample j interpolated towards j - 1 is
+// sample k of the phase (origin - p) interpolated towards k + 1, so a piece read backwards is a
+// forward read of a phase that falls
+static WAVESTORE_INLINE void wavestore_read(
+  const WaveStore *store, int octave, float *out, int length, uint32_t *phase, uint32_t increment,
+  uint32_t shift, WaveStoreFormat format
+) {
+    size_t           width   = format == WAVESTORE_INT16 ? sizeof( int16_t ) : sizeof( float );
+    const void      *samples = (const uint8_t *) store->samples + store->offset[octave] * width;
+    uint32_t         fold    = store->folds[octave];
+    const WavePiece *pieces  = wavestore_pieces[fold ? store->symmetry : WAVESTORE_NONE];
+    double           step    = 1.0 / (double) ( increment ? increment : 1 );
+    uint32_t         p       = *phase;
+
+    // indexed by the half the index is in, then whether it is read backwards
+    const float signs[4] = {
+      store->scale, store->scale * store->mirror, -store->scale, -store->scale * store->mirror
+    };
+
+    for ( int i = 0; i < length; ) {
+        uint32_t         at     = (uint32_t) ( (uint64_t) p >> ( 32 - fold ) );
+        const WavePiece *piece  = &pieces[at];
+        uint64_t         left   = ( (uint64_t) ( at + 1 ) << ( 32 - fold ) ) - p;
+        uint64_t         run    = (uint64_t) ( (double) (int64_t) ( left - 1 ) * step ) + 1;
+        int              count  = fold && run < (uint64_t) ( length - i ) ? (int) run : length - i;
+        uint32_t         origin = (uint32_t) ( (uint64_t) piece->origin << 30 );    // 4 wraps to 0
+        if ( piece->back ) {
+            wavestore_run(
+              samples, out + i, count, origin - p, 0u - increment, signs[piece->sign], shift, format
+            );
+        } else {
+            wavestore_run(
+              samples, out + i, count, p - origin, increment, signs[piece->sign], shift, format
+            );
+        }
+        p += (uint32_t) count * increment;    // wraps at one cycle
+        i += count;
+    }
+    *phase = p;
+}
+
+typedef void ( *WaveStoreRead )(
+  const WaveStore *store, int octave, float *out, int length, uint32_t *phase, uint32_t increment
+);
+
+// one reader per format and cycle length, so neither is tested per sample or per piece
+#define WAVESTORE_READ( name, format, bits )                                                      \
+    static void name(                                                                             \
+      const WaveStore *store, int octave, float *out, int length, uint32_t *phase,                \
+      uint32_t increment                                                                          \
+    ) {                                                                                           \
+        wavestore_read( store, octave, out, length, phase, increment, 32 - ( bits ), format );    \
+    }
+
+WAVESTORE_READ( read_float32_9, WAVESTORE_FLOAT32, 9 )
+WAVESTORE_READ( read_float32_10, WAVESTORE_FLOAT32, 10 )
+WAVESTORE_READ( read_float32_11, WAVESTORE_FLOAT32, 11 )
+WAVESTORE_READ( read_int16_9, WAVESTORE_INT16, 9 )
+WAVESTORE_READ( read_int16_10, WAVESTORE_INT16, 10 )
+WAVESTORE_READ( read_int16_11, WAVESTORE_INT16, 11 )
+
+// indexed by the format, then the octave's bits less WAVESTORE_MIN_BITS
+static const WaveStoreRead wavestore_reads[WAVESTORE_FORMAT_COUNT][3] = {
+  { read_float32_9, read_float32_10, read_float32_11 },
+  { read_int16_9, read_int16_10, read_int16_11 },
+};
+
+void wavestore_render(
+  const WaveStore *store, float *out, int length, uint32_t *phase, uint32_t increment
+) {
+    int octave = wavetable_octave( increment );
+    wavestore_reads[store->format][store->bits[octave] - WAVESTORE_MIN_BITS](
+      store, octave, out, length, phase, increment
+    );
+}
+
+void wavestore_decode( const WaveStore *store, int octave, float *cycle ) {
+    uint32_t bits  = store->bits[octave];
+    uint32_t phase = 0;
+
+    // one sample per step lands every read on a kept sample, so nothing is interpolated
+    wavestore_reads[store->format][bits - WAVESTORE_MIN_BITS](
+      store, octave, cycle, 1 << bits, &phase, 1u << ( 32 - bits )
+    );
+    cycle[1u << bits] = cycle[0];
+}
+
+/*********
+ * CACHE *
+ ********/
+void wavestore_cache_init( WaveStoreCache *cache, const WaveStore *store ) {
+    cache->store  = store;
+    cache->octave = -1;
+}
+
+void wavestore_cache_render(
+  WaveStoreCache *cache, float *out, int length, uint32_t *phase, uint32_t increment
+) {
+    int octave = wavetable_octave( increment );
+    if ( octave != cache->octave ) {
+        wavestore_decode( cache->store, octave, cache->cycle );
+        cache->octave = octave;
+    }
+
+    // a whole cycle, read like wavetable_read() with the shift of its length
+    const float *cycle = cache->cycle;
+    uint32_t     p     = *phase;
+    switch ( cache->store->bits[octave] ) {
+        case 9:
+            wavestore_run( cycle, out, length, p, increment, 1.0f, 23, WAVESTORE_FLOAT32 );
+            break;
+        case 10:
+            wavestore_run( cycle, out, length, p, increment, 1.0f, 22, WAVESTORE_FLOAT32 );
+            break;
+        default:
+            wavestore_run( cycle, out, length, p, increment, 1.0f, 21, WAVESTORE_FLOAT32 );
+            break;
+    }
+    *phase = p + (uint32_t) length * increment;
+}
+
+/*********
+ * STORE *
+ ********/
+SynthError wavestore_init( WaveStore *store, const WaveTable *table, WaveStoreFormat format ) {
+    if ( !store || !table || !table->samples ) return SYNTH_ERROR_NULL_PTR;
+    if ( format < 0 || format >= WAVESTORE_FORMAT_COUNT ) return SYNTH_ERROR_INVALID_PARAM;
+
+    store->symmetry = wavestore_symmetry( table, &store->mirror );
+    store->format   = format;
+    size_t width    = format == WAVESTORE_INT16 ? sizeof( int16_t ) : sizeof( float );
+    float  peak     = wavestore_peak( table );
+    store->scale    = format == WAVESTORE_INT16 && peak > 0.0f ? peak / 32767.0f : 1.0f;
+
+    // the first octaves keep every sample, each one after them half as many as the one before;
+    // one whose notes cross a piece within 1 << WAVESTORE_SHORT_RUN_BITS samples stays whole
+    uint32_t total = 0;
+    uint32_t kept[WAVETABLE_OCTAVES];
+    for ( int octave = 0; octave < WAVETABLE_OCTAVES; octave++ ) {
+        int bits = WAVETABLE_BITS;
+        if ( octave >= WAVESTORE_FULL_OCTAVES ) bits -= octave - WAVESTORE_FULL_OCTAVES + 1;
+        if ( bits < WAVESTORE_MIN_BITS ) bits = WAVESTORE_MIN_BITS;
+        int fold = wavestore_folds[store->symmetry];
+        if ( WAVETABLE_FRAC_BITS + octave + WAVESTORE_SHORT_RUN_BITS > 32 - fold ) fold = 0;
+        store->bits[octave]   = (uint8_t) bits;
+        store->folds[octave]  = (uint8_t) fold;
+        store->offset[octave] = total;
+        kept[octave]          = ( 1u << ( bits - fold ) ) + 1;    // and a guard sample
+        total                += kept[octave];
+    }
+    store->bytes   = (size_t) total * width;
+    store->samples = malloc( store->bytes );
+    if ( !store->samples ) return SYNTH_ERROR_OOM;
+
+    for ( int octave = 0; octave < WAVETABLE_OCTAVES; octave++ ) {
+        const float *t      = wavetable_octave_table( table, octave );
+        int          stride = 1 << ( WAVETABLE_BITS - store->bits[octave] );
+        for ( uint32_t j = 0; j < kept[octave]; j++ ) {
+            float    value = t[j * stride];
+            uint32_t at    = store->offset[octave] + j;
+            if ( format == WAVESTORE_INT16 ) {
+                ( (int16_t *) store->samples )[at] = (int16_t) lrintf( value / store->scale );
+            } else {
+                ( (float *) store->samples )[at] = value;
+            }
+        }
+    }
+    return SYNTH_ACK;
+}
+
+void wavestore_destroy( WaveStore *store ) {
+    if ( !store ) return;
+    free( store->samples );
+    store->samples = NULL;
+    store->bytes   = 0;
+}
@@ -0,0 +1,169 @@
+/**
+ * @file
+ * @brief compact wavetables that keep a symmetric cycle once and short octaves in few samples
+ *
+ * A WaveTable spends WAVETABLE_STRIDE floats on every octave, 90 kB per waveform. A WaveStore
+ * holds the same tables in far less by three means, each exact up to a tolerance:
+ *
+ * - Period-aware sizing. Octave k holds 1024 >> k harmonics, and linear interpolation between
+ *   samples of a band-limited cycle only needs a fixed number of samples per period of its top
+ *   harmonic. The first WAVESTORE_FULL_OCTAVES keep every sample, each octave after them half as
+ *   many as the one before, down to 1 << WAVESTORE_MIN_BITS. Every note at every sample rate
+ *   reads one of these octaves, so the store does not grow with either, unlike a table per note
+ *   of sampleRate / frequency samples.
+ * - Symmetry. A cycle with f(1 - x) = s f(x) is kept up to its middle and read backwards after
+ *   it; one with f(x + 1/2) = -f(x) is kept up to its middle and negated after it; one with both
+ *   within each half, sine, square and triangle, only up to its first quarter. Which one applies
+ *   is found from the tables themselves, so custom waveforms get it too.
+ * - Sample format. float32, or int16 against the cycle's peak for half the size again.
+ *
+ * Delta coding is left out. An oscillator starts anywhere in the cycle and interpolates between
+ * two neighbours, and a delta coded sample is the sum of every delta before it, so each read would
+ * need that prefix sum or a key sample every few deltas. It would not save much either. A delta
+ * is only smaller than an int16 sample if it fits in 8 bits, and square and saw step by the whole
+ * peak within one sample in their full octaves; only sine and triangle, already quarter cycles,
+ * would shrink further.
+ *
+ * Reading straight from a store with wavestore_render() works out once per piece of the cycle,
+ * quarter or half, where it falls in the kept part, which way it runs and the sign. It then reads
+ * the run of samples inside that piece like a whole table, in a loop specialised per format and
+ * cycle length. Within a piece that costs what wavetable_render() does, int16 included. Each piece
+ * crossed costs a loop exit, and middle notes cross one every hundred samples or so, which puts
+ * them some 5 to 25% behind the tables, int16 the most. So wavestore_render() is only as fast as
+ * the tables at low and high notes. The octaves read only by notes that leave a piece within
+ * 1 << WAVESTORE_SHORT_RUN_BITS samples are small, and kept whole.
+ *
+ * A player that needs table speed at every note reads through a WaveStoreCache instead, which
+ * decodes the octave it plays into a whole float cycle once and reads that the way
+ * wavetable_render() reads a table. The store stays the one compact copy shared by every player;
+ * each cache costs WAVETABLE_STRIDE floats, 8 kB, and a decode of up to WAVETABLE_SIZE samples
+ * whenever its note moves to another octave, so it suits a voice that holds one note for a while.
+ */
+
+#ifndef WAVESTORE_H
+#define WAVESTORE_H
+
+#include "wavetable.h"
+
+/*************
+ * CONSTANTS *
+ ************/
+#define WAVESTORE_FULL_OCTAVES   6        // kept at WAVETABLE_SIZE, then 64 samples per harmonic
+#define WAVESTORE_MIN_BITS       9        // log2 of the shortest cycle kept
+#define WAVESTORE_SHORT_RUN_BITS 3        // log2 of the fewest samples a note may spend in a piece
+#define WAVESTORE_TOLERANCE      1e-5f    // symmetry error allowed, relative to the peak
+
+/*******************
+ * DATA STRUCTURES *
+ ******************/
+// which part of the cycle is kept and how the rest is made from it
+typedef enum {
+    WAVESTORE_NONE,       // the whole cycle
+    WAVESTORE_MIRROR,     // f(1 - x) = s f(x), the first half
+    WAVESTORE_HALF,       // f(x + 1/2) = -f(x), the first half
+    WAVESTORE_QUARTER,    // both of those within a half, f(1/2 - x) = s f(x), the first quarter
+    WAVESTORE_SYMMETRY_COUNT
+} WaveSymmetry;
+
+typedef enum { WAVESTORE_FLOAT32, WAVESTORE_INT16, WAVESTORE_FORMAT_COUNT } WaveStoreFormat;
+
+typedef struct {
+    WaveSymmetry    symmetry;
+    WaveStoreFormat format;
+    float           mirror;                       // s, the sign of the reflected part
+    float           scale;                        // stored value to sample
+    uint8_t         bits[WAVETABLE_OCTAVES];      // log2 of each octave's cycle length
+    uint8_t         folds[WAVETABLE_OCTAVES];     // log2 of the pieces it is cut into, 0 whole
+    uint32_t        offset[WAVETABLE_OCTAVES];    // first stored sample of each octave
+    void           *samples;                      // every octave's kept part and a guard sample
+    size_t          bytes;                        // size of samples
+} WaveStore;
+
+// one octave of a store decoded into a whole cycle, see wavestore_cache_render()
+typedef struct {
+    const WaveStore *store;
+    int              octave;                     // octave in cycle, -1 for none yet
+    float            cycle[WAVETABLE_STRIDE];    // the cycle and a guard sample
+} WaveStoreCache;
+
+/*************
+ * FUNCTIONS *
+ ************/
+/**
+ * @brief Find the symmetry a waveform's tables have
+ *
+ * Every octave has to agree within WAVESTORE_TOLERANCE of the table's peak.
+ *
+ * @param table tables to test
+ * @param mirror set to s for WAVESTORE_MIRROR and WAVESTORE_QUARTER, 1 otherwise
+ * @return the symmetry that keeps the least, WAVESTORE_NONE if there is none
+ */
+WaveSymmetry wavestore_symmetry( const WaveTable *table, float *mirror );
+
+/**
+ * @brief Build a compact store from a waveform's tables, not realtime safe
+ *
+ * @param store store to fill
+ * @param table tables to keep
+ * @param format how samples are kept
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR, SYNTH_ERROR_INVALID_PARAM or SYNTH_ERROR_OOM
+ */
+SynthError   wavestore_init( WaveStore *store, const WaveTable *table, WaveStoreFormat format );
+
+/**
+ * @brief Release the memory held by a store
+ *
+ * @param store store to release
+ */
+void         wavestore_destroy( WaveStore *store );
+
+/**
+ * @brief Render a block from a store, advancing the phase accumulator
+ *
+ * Reads the octave wavetable_render() would and gives the same samples up to the store's
+ * tolerance, the decimation of the short octaves and int16 rounding.
+ *
+ * @param store store to read from
+ * @param out destination buffer, overwritten
+ * @param length number of samples to render
+ * @param phase phase accumulator, updated in place
+ * @param increment phase increment per sample, see wavetable_increment()
+ */
+void         wavestore_render(
+  const WaveStore *store, float *out, int length, uint32_t *phase, uint32_t increment
+);
+
+/**
+ * @brief Decode one octave of a store into a whole cycle
+ *
+ * @param store store to read from
+ * @param octave octave to decode, 0 to WAVETABLE_OCTAVES - 1
+ * @param cycle destination, (1 << store->bits[octave]) + 1 floats, the last a copy of the first
+ */
+void         wavestore_decode( const WaveStore *store, int octave, float *cycle );
+
+/**
+ * @brief Start a cache on a store with no octave decoded
+ *
+ * @param cache cache to initialize
+ * @param store store it decodes from, must outlive the cache
+ */
+void         wavestore_cache_init( WaveStoreCache *cache, const WaveStore *store );
+
+/**
+ * @brief Render a block through a cache, advancing the phase accumulator
+ *
+ * Decodes the octave wavetable_render() would read if it is not the one cached, then reads it at
+ * the cost of a table. Gives the samples wavestore_render() does.
+ *
+ * @param cache cache to read through
+ * @param out destination buffer, overwritten
+ * @param length number of samples to render
+ * @param phase phase accumulator, updated in place
+ * @param increment phase increment per sample, see wavetable_increment()
+ */
+void         wavestore_cache_render(
+  WaveStoreCache *cache, float *out, int length, uint32_t *phase, uint32_t increment
+);
+
+#endif
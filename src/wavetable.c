@@ -0,0 +1,200 @@
+#include "wavetable.h"
+
+#include "fft.h"
+
+// tables for the base waveforms, shared by every synthesizer
+static WaveTable wavetable_registry[WAVEFORM_COUNT];
+
+SynthError wavetable_init( WaveTable *table, WaveformFunction func ) {
+    if ( !table || !func ) return SYNTH_ERROR_NULL_PTR;
+
+    float *samples = (float *) malloc( sizeof( float ) * WAVETABLE_OCTAVES * WAVETABLE_STRIDE );
+    float *re      = (float *) malloc( sizeof( float ) * WAVETABLE_SIZE * 4 );
+    if ( !samples || !re ) {
+        free( samples );
+        free( re );
+        return SYNTH_ERROR_OOM;
+    }
+    float *im         = re + WAVETABLE_SIZE;
+    float *spectrumRe = im + WAVETABLE_SIZE;
+    float *spectrumIm = spectrumRe + WAVETABLE_SIZE;
+
+    // spectrum of one naive cycle, sampled halfway between the table's points so a jump on one of
+    // them is met from both sides alike and a symmetric cycle stays symmetric
+    for ( int i = 0; i < WAVETABLE_SIZE; i++ ) {
+        spectrumRe[i] = func( ( (float) i + 0.5f ) / (float) WAVETABLE_SIZE );
+        spectrumIm[i] = 0.0f;
+    }
+    fft_complex( spectrumRe, spectrumIm, WAVETABLE_SIZE, false );
+
+    // and moved back onto them by half a sample, which leaves nyquist nothing it could hold
+    for ( int bin = 0; bin < WAVETABLE_SIZE; bin++ ) {
+        int   harmonic  = bin <= WAVETABLE_SIZE / 2 ? bin : bin - WAVETABLE_SIZE;
+        float angle     = -PI * (float) harmonic / (float) WAVETABLE_SIZE;
+        float r         = spectrumRe[bin];
+        float m         = spectrumIm[bin];
+        bool  nyquist   = bin == WAVETABLE_SIZE / 2;
+        spectrumRe[bin] = nyquist ? 0.0f : r * cosf( angle ) - m * sinf( angle );
+        spectrumIm[bin] = nyquist ? 0.0f : r * sinf( angle ) + m * cosf( angle );
+    }
+
+    // rebuild each octave keeping only the harmonics that fit below its nyquist limit
+    for ( int octave = 0; octave < WAVETABLE_OCTAVES; octave++ ) {
+        int harmonics = ( WAVETABLE_SIZE / 2 ) >> octave;
+        for ( int bin = 0; bin < WAVETABLE_SIZE; bin++ ) {
+            int  harmonic = bin <= WAVETABLE_SIZE / 2 ? bin : WAVETABLE_SIZE - bin;
+            bool keep     = harmonic <= harmonics;
+            re[bin]       = keep ? spectrumRe[bin] : 0.0f;
+            im[bin]       = keep ? spectrumIm[bin] : 0.0f;
+        }
+        fft_complex( re, im, WAVETABLE_SIZE, true );
+
+        float *out = samples + (size_t) octave * WAVETABLE_STRIDE;
+        memcpy( out, re, sizeof( float ) * WAVETABLE_SIZE );
+        out[WAVETABLE_SIZE] = out[0];
+    }
+
+    free( re );
+    table->samples = samples;
+    table->func    = func;
+    return SYNTH_ACK;
+}
+
+void wavetable_destroy( WaveTable *table ) {
+    if ( !table ) return;
+    free( table->samples );
+    table->samples = NULL;
+    table->func    = NULL;
+}
+
+SynthError wavetable_init_defaults( void ) {
+    for ( int type = 0; type < WAVEFORM_COUNT; type++ ) {
+        if ( wavetable_registry[type].samples ) continue;
+        SynthError err = wavetable_init( &wavetable_registry[type], waveform_functions[type] );
+        if ( err != SYNTH_ACK ) return err;
+    }
+    return SYNTH_ACK;
+}
+
+const WaveTable *wavetable_get( BaseWaveform type ) {
+    if ( type < 0 || type >= WAVEFORM_COUNT ) return NULL;
+    if ( !wavetable_registry[type].samples ) {
+        if ( wavetable_init_defaults() != SYNTH_ACK ) return NULL;
+    }
+    return wavetable_registry[type].samples ? &wavetable_registry[type] : NULL;
+}
+
+/************
+ * REGISTRY *
+ ***********/
+static WaveformSet *wavetable_set_alloc( uint32_t count ) {
+    WaveformSet *set =
+      (WaveformSet *) malloc( sizeof( WaveformSet ) + sizeof( WaveformSlot ) * count );
+    if ( set ) set->count = count;
+    return set;
+}
+
+SynthError wavetable_registry_init( WaveformRegistry *registry, SynthArena *arena ) {
+    if ( !registry || !arena ) return SYNTH_ERROR_NULL_PTR;
+    SynthError err = POOL_INIT( &registry->tables, arena, WaveTable, 0, SYNTH_WAVEFORMS );
+    if ( err != SYNTH_ACK ) return err;
+    registry->sets[0] = wavetable_set_alloc( 0 );
+    registry->sets[1] = NULL;
+    if ( !registry->sets[0] ) return SYNTH_ERROR_OOM;
+    registry->sets[0]->index = 0;
+    synth_swap_init( &registry->swap );
+    return SYNTH_ACK;
+}
+
+void wavetable_registry_destroy( WaveformRegistry *registry ) {
+    if ( !registry ) return;
+
+    // the live set holds every table ever registered, the older one a prefix of them
+    WaveformSet *live = registry->sets[synth_swap_live( &registry->swap )];
+    for ( uint32_t i = 0; live && i < live->count; i++ ) {
+        WaveTable *table = (WaveTable *) live->slots[i].table;
+        if ( table->func ) wavetable_destroy( table );
+    }
+    pool_reset( &registry->tables );
+    free( registry->sets[0] );
+    free( registry->sets[1] );
+    registry->sets[0] = registry->sets[1] = NULL;
+}
+
+// publishes a table as the next waveform, leaving the registry as it was if the set cannot be had
+static BaseWaveform wavetable_registry_publish(
+  WaveformRegistry *registry, const WaveTable *table, WaveformFunction func, const char *name
+) {
+    WaveformSet *live = registry->sets[synth_swap_live( &registry->swap )];
+    WaveformSet *next = wavetable_set_alloc( live->count + 1 );
+    if ( !next ) return INVALID_WAVEFORM;
+    BaseWaveform type = (BaseWaveform) ( WAVEFORM_COUNT + live->count );
+    memcpy( next->slots, live->slots, sizeof( WaveformSlot ) * live->count );
+    next->slots[live->count] = (WaveformSlot) { { type, func, name }, table };
+
+    uint64_t spare = synth_swap_spare( &registry->swap );
+    free( registry->sets[spare] );
+    next->index           = (uint32_t) spare;
+    registry->sets[spare] = next;
+    synth_swap_publish( &registry->swap, spare );
+    return type;
+}
+
+BaseWaveform wavetable_registry_add(
+  WaveformRegistry *registry, WaveformFunction func, const char *name
+) {
+    if ( !registry || !func ) return INVALID_WAVEFORM;
+    if ( registry->sets[synth_swap_live( &registry->swap )]->count >= SYNTH_WAVEFORMS ) {
+        return INVALID_WAVEFORM;
+    }
+
+    // everything that can fail happens before the swap, a failure leaves the registry as it was
+    WaveTable   *table = POOL_NEW( &registry->tables, WaveTable );
+    BaseWaveform type  = INVALID_WAVEFORM;
+    if ( table && wavetable_init( table, func ) == SYNTH_ACK ) {
+        type = wavetable_registry_publish( registry, table, func, name );
+        if ( type == INVALID_WAVEFORM ) wavetable_destroy( table );
+    }
+    if ( type == INVALID_WAVEFORM ) pool_free( &registry->tables, table );
+    return type;
+}
+
+BaseWaveform wavetable_registry_add_tables(
+  WaveformRegistry *registry, const float *samples, const char *name
+) {
+    if ( !registry || !samples ) return INVALID_WAVEFORM;
+    if ( registry->sets[synth_swap_live( &registry->swap )]->count >= SYNTH_WAVEFORMS ) {
+        return INVALID_WAVEFORM;
+    }
+
+    // no generator marks tables the registry only borrows
+    WaveTable   *table = POOL_NEW( &registry->tables, WaveTable );
+    BaseWaveform type  = INVALID_WAVEFORM;
+    if ( table ) {
+        table->samples = (float *) samples;    // only ever read
+        table->func    = NULL;
+        type           = wavetable_registry_publish( registry, table, NULL, name );
+    }
+    if ( type == INVALID_WAVEFORM ) pool_free( &registry->tables, table );
+    return type;
+}
+
+const WaveformSet *wavetable_registry_acquire( WaveformRegistry *registry ) {
+    return registry->sets[synth_swap_enter( &registry->swap )];
+}
+
+void wavetable_registry_release( WaveformRegistry *registry, const WaveformSet *set ) {
+    synth_swap_leave( &registry->swap, set->index );
+}
+
+void wavetable_render(
+  const WaveTable *table, float *out, int length, uint32_t *phase, uint32_t increment
+) {
+    const float *samples = wavetable_octave_table( table, wavetable_octave( increment ) );
+    uint32_t     p       = *phase;
+    for ( int i = 0; i < length; i++ ) {
+        out[i]  = wavetable_read( samples, p );
+        p      += increment;    // wraps at one cycle
+    }
+    *phase = p;
+}
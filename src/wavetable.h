@@ -0,0 +1,253 @@
+/**
+ * @file
+ * @brief band-limited wavetable oscillator engine
+ *
+ * Every waveform is rendered once into a set of single-cycle tables, one per octave, each holding
+ * only the harmonics that stay below nyquist for the notes that read it. Playback is a 32 bit
+ * phase accumulator indexing the table with linear interpolation, so the per-sample cost is two
+ * loads and a multiply-add regardless of the waveform.
+ *
+ * The base waveforms share one set of tables. Custom waveforms belong to a synthesizer's
+ * WaveformRegistry and are rendered once when they are registered, so the render thread only ever
+ * reads tables and never calls a generator. The registry publishes its waveforms as a WaveformSet
+ * that is replaced whole on every registration: the control thread builds the new set, swaps it
+ * in with an atomic store and frees the set before it once no render thread is left inside, the
+ * same double buffering a Tuning uses. Tables themselves live until the registry is destroyed, in
+ * WaveTable slots of a SynthPool carved from the synth's arena up front.
+ * Tables can also be borrowed ready made, from a memory mapped WaveBank, and are then read in
+ * place.
+ */
+
+#ifndef WAVETABLE_H
+#define WAVETABLE_H
+
+#include "pool.h"
+#include "synth.h"
+
+/*************
+ * CONSTANTS *
+ ************/
+#define WAVETABLE_BITS       11                                 // log2 of samples per cycle
+#define WAVETABLE_SIZE       ( 1 << WAVETABLE_BITS )            // samples per cycle
+#define WAVETABLE_STRIDE     ( WAVETABLE_SIZE + 1 )             // one guard sample for lerp
+#define WAVETABLE_OCTAVES    WAVETABLE_BITS                     // 1024 harmonics down to 1
+#define WAVETABLE_FRAC_BITS  ( 32 - WAVETABLE_BITS )            // phase bits below the index
+#define WAVETABLE_FRAC_MASK  ( ( 1u << WAVETABLE_FRAC_BITS ) - 1 )
+#define WAVETABLE_FRAC_SCALE ( 1.0f / (float) ( 1u << WAVETABLE_FRAC_BITS ) )
+
+/*******************
+ * DATA STRUCTURES *
+ ******************/
+// band-limited tables for a single waveform, octave 0 holds the most harmonics
+typedef struct {
+    float           *samples;    // WAVETABLE_OCTAVES tables of WAVETABLE_STRIDE samples
+    WaveformFunction func;       // generator the tables were rendered from, NULL if borrowed
+} WaveTable;
+
+// a custom waveform and its tables
+typedef struct {
+    WaveformEntry    entry;
+    const WaveTable *table;
+} WaveformSlot;
+
+// custom waveforms as one render thread sees them, slot n holds type WAVEFORM_COUNT + n
+struct WaveformSet {
+    uint32_t     count;
+    uint32_t     index;    // which of the registry's two sets this is
+    WaveformSlot slots[];
+};
+
+struct WaveformRegistry {
+    WaveformSet *sets[2];
+    SynthSwap    swap;      // which set is live and who reads each
+    SynthPool    tables;    // WaveTable of every custom waveform, SYNTH_WAVEFORMS slots
+};
+
+/*************
+ * FUNCTIONS *
+ ************/
+/**
+ * @brief Render the band-limited octave tables for a waveform generator
+ *
+ * Samples one cycle of the generator, takes its spectrum and rebuilds each octave with the
+ * harmonics above that octave's nyquist limit removed. Allocates, so call it outside the audio
+ * thread.
+ *
+ * @param table table to fill
+ * @param func generator evaluated over one cycle, phase in [0, 1)
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR or SYNTH_ERROR_OOM
+ */
+SynthError       wavetable_init( WaveTable *table, WaveformFunction func );
+
+/**
+ * @brief Release the memory held by a wavetable
+ *
+ * @param table table to release
+ */
+void             wavetable_destroy( WaveTable *table );
+
+/**
+ * @brief Build the tables for every base waveform
+ *
+ * Idempotent; call it during startup so the audio thread never renders tables lazily.
+ *
+ * @return SYNTH_ACK or SYNTH_ERROR_OOM
+ */
+SynthError       wavetable_init_defaults( void );
+
+/**
+ * @brief Look up the tables for a base waveform
+ *
+ * Built on first use if wavetable_init_defaults() has not run yet.
+ *
+ * @param type base waveform
+ * @return the tables, or NULL if the type is no base waveform
+ */
+const WaveTable *wavetable_get( BaseWaveform type );
+
+/**
+ * @brief Initialize an empty registry, not realtime safe
+ *
+ * @param registry registry to initialize
+ * @param arena arena the WaveTable slots of all SYNTH_WAVEFORMS waveforms are carved from up front
+ * @return SYNTH_ACK, SYNTH_ERROR_NULL_PTR, SYNTH_ERROR_OOM or SYNTH_ERROR_ARENA_FULL
+ */
+SynthError       wavetable_registry_init( WaveformRegistry *registry, SynthArena *arena );
+
+/**
+ * @brief Free every set and table of a registry, not realtime safe
+ *
+ * The WaveTable slots go back to the pool, the arena they were carved from keeps them.
+ *
+ * @param registry registry nothing renders from any more, may be NULL
+ */
+void             wavetable_registry_destroy( WaveformRegistry *registry );
+
+/**
+ * @brief Render a generator's tables and publish them as a new waveform, control thread only
+ *
+ * Allocates and renders, then waits for the render thread to leave the set published before the
+ * last one, which is at most one span.
+ *
+ * @param registry registry to add to
+ * @param func generator evaluated over one cycle, phase in [0, 1)
+ * @param name display name, must outlive the registry
+ * @return the new waveform type, or INVALID_WAVEFORM if the registry is full or out of memory
+ */
+BaseWaveform     wavetable_registry_add(
+  WaveformRegistry *registry, WaveformFunction func, const char *name
+);
+
+/**
+ * @brief Publish octave tables rendered elsewhere as a new waveform, control thread only
+ *
+ * The tables are read in place and never copied or freed, as from a mapped WaveBank.
+ *
+ * @param registry registry to add to
+ * @param samples WAVETABLE_OCTAVES tables of WAVETABLE_STRIDE samples, must outlive the registry
+ * @param name display name, must outlive the registry
+ * @return the new waveform type, or INVALID_WAVEFORM if the registry is full or out of memory
+ */
+BaseWaveform     wavetable_registry_add_tables(
+  WaveformRegistry *registry, const float *samples, const char *name
+);
+
+/**
+ * @brief Get the live set for reading, never blocks
+ *
+ * @param registry registry to read
+ * @return the set, valid until wavetable_registry_release()
+ */
+const WaveformSet *wavetable_registry_acquire( WaveformRegistry *registry );
+
+/**
+ * @brief Stop reading a set returned by wavetable_registry_acquire()
+ *
+ * @param registry registry the set belongs to
+ * @param set set to release
+ */
+void             wavetable_registry_release( WaveformRegistry *registry, const WaveformSet *set );
+
+/**
+ * @brief Look up the tables for a base or custom waveform
+ *
+ * @param set acquired custom waveforms, may be NULL for base waveforms only
+ * @param type waveform type
+ * @return the tables, or NULL if the type is unknown to the set
+ */
+static inline const WaveTable *wavetable_lookup( const WaveformSet *set, BaseWaveform type ) {
+    if ( type < WAVEFORM_COUNT ) return wavetable_get( type );
+    uint32_t index = (uint32_t) type - WAVEFORM_COUNT;
+    return set && index < set->count ? set->slots[index].table : NULL;
+}
+
+/**
+ * @brief Render a block from a wavetable, advancing the phase accumulator
+ *
+ * @param table tables to read from
+ * @param out destination buffer, overwritten
+ * @param length number of samples to render
+ * @param phase phase accumulator, updated in place
+ * @param increment phase increment per sample, see wavetable_increment()
+ */
+void             wavetable_render(
+  const WaveTable *table, float *out, int length, uint32_t *phase, uint32_t increment
+);
+
+/**
+ * @brief Convert a frequency into a 32 bit phase increment
+ *
+ * @param frequency oscillator frequency in Hz
+ * @param sampleRate sample rate in Hz
+ * @return phase increment per sample, clamped below nyquist
+ */
+static inline uint32_t wavetable_increment( float frequency, float sampleRate ) {
+    double cycles = (double) frequency / (double) sampleRate;
+    if ( cycles <= 0.0 ) return 0;
+    if ( cycles >= 0.5 ) return 0x7FFFFFFFu;
+    return (uint32_t) ( cycles * 4294967296.0 );
+}
+
+/**
+ * @brief Select the octave table whose harmonics all stay below nyquist
+ *
+ * @param increment phase increment per sample
+ * @return octave index in [0, WAVETABLE_OCTAVES)
+ */
+static inline int wavetable_octave( uint32_t increment ) {
+    // octave k holds WAVETABLE_SIZE / 2 >> k harmonics, so it is safe while increment <= 2^(F + k)
+    uint32_t excess = increment > 0 ? ( increment - 1 ) >> WAVETABLE_FRAC_BITS : 0;
+    int      octave = 0;
+    while ( excess ) {
+        excess >>= 1;
+        octave++;
+    }
+    return octave < WAVETABLE_OCTAVES ? octave : WAVETABLE_OCTAVES - 1;
+}
+
+/**
+ * @brief Get a single octave table
+ *
+ * @param table tables to read from
+ * @param octave octave index from wavetable_octave()
+ * @return WAVETABLE_STRIDE samples, the last one repeating the first
+ */
+static inline const float *wavetable_octave_table( const WaveTable *table, int octave ) {
+    return table->samples + (size_t) octave * WAVETABLE_STRIDE;
+}
+
+/**
+ * @brief Read one interpolated sample from an octave table
+ *
+ * @param samples octave table from wavetable_octave_table()
+ * @param phase 32 bit phase
+ * @return interpolated sample
+ */
+static inline float wavetable_read( const float *samples, uint32_t phase ) {
+    uint32_t index = phase >> WAVETABLE_FRAC_BITS;
+    float    frac  = (float) ( phase & WAVETABLE_FRAC_MASK ) * WAVETABLE_FRAC_SCALE;
+    float    a     = samples[index];
+    return a + ( samples[index + 1] - a ) * frac;
+}
+
+#endif
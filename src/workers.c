@@ -0,0 +1,226 @@
+#include "workers.h"
+
+#define WORKERS_MAX_DEPTH 32    // partials the serial path keeps at once, one per bit of groups
+
+// the one reduction step both paths share, so their sums round identically
+static void workers_add( float *left, const float *right, int length ) {
+    for ( int i = 0; i < length; i++ ) left[i] += right[i];
+}
+
+/**********************
+ * SEMAPHORE WRAPPERS *
+ *********************/
+#ifdef _WIN32
+static bool workers_wake_init( RenderWorkers *workers ) {
+    workers->wake = CreateSemaphore( NULL, 0, WORKERS_MAX_THREADS, NULL );
+    return workers->wake != NULL;
+}
+
+static void workers_wake_post( RenderWorkers *workers, uint32_t count ) {
+    ReleaseSemaphore( workers->wake, (LONG) count, NULL );
+}
+
+static void workers_wake_wait( RenderWorkers *workers ) {
+    WaitForSingleObject( workers->wake, INFINITE );
+}
+
+static void workers_wake_destroy( RenderWorkers *workers ) { CloseHandle( workers->wake ); }
+#else
+static bool workers_wake_init( RenderWorkers *workers ) {
+    return sem_init( &workers->wake, 0, 0 ) == 0;
+}
+
+static void workers_wake_post( RenderWorkers *workers, uint32_t count ) {
+    for ( uint32_t i = 0; i < count; i++ ) sem_post( &workers->wake );
+}
+
+static void workers_wake_wait( RenderWorkers *workers ) {
+    while ( sem_wait( &workers->wake ) != 0 ) {}    // interrupted by a signal
+}
+
+static void workers_wake_destroy( RenderWorkers *workers ) { sem_destroy( &workers->wake ); }
+#endif
+
+/*******************
+ * PARALLEL RENDER *
+ ******************/
+static float *workers_partial( RenderWorkers *workers, uint32_t group ) {
+    return group ? workers->partials + (size_t) group * SYNTH_BLOCK_SIZE : workers->out;
+}
+
+// mix a group, then carry the sum up the tree for as long as this thread arrives second
+static void workers_run_group( RenderWorkers *workers, uint32_t slot, uint32_t group ) {
+    float *partial = workers_partial( workers, group );
+    if ( group ) memset( partial, 0, sizeof( float ) * workers->length );
+    workers->task(
+      workers->user, group, partial, workers->scratch + (size_t) slot * WORKERS_SCRATCH,
+      workers->length
+    );
+
+    for ( uint32_t level = 1; ( 1u << ( level - 1 ) ) < workers->groups; level++ ) {
+        uint32_t left  = group & ~( ( 1u << level ) - 1 );
+        uint32_t right = left + ( 1u << ( level - 1 ) );
+        group          = left;
+        if ( right >= workers->groups ) continue;    // no right half, pass the left one up
+
+        // every node with two halves is arrived at twice per span, so the count's parity is enough
+        SynthAtomic *arrivals = &workers->arrivals[(size_t) ( level - 1 ) * workers->maxGroups];
+        if ( synth_atomic_fetch_add( &arrivals[left], 1 ) % 2 == 0 ) return;
+        workers_add(
+          workers_partial( workers, left ), workers_partial( workers, right ), workers->length
+        );
+    }
+}
+
+// render groups from this participant's range, then steal from everyone else's
+static void workers_participate( RenderWorkers *workers, uint32_t slot ) {
+    for ( uint32_t k = 0; k < workers->participants; k++ ) {
+        WorkerRange *range = &workers->ranges[( slot + k ) % workers->participants];
+        uint64_t     group;
+        while ( ( group = synth_atomic_fetch_add( &range->next, 1 ) ) < range->end ) {
+            if ( k ) synth_atomic_fetch_add( &workers->steals, 1 );
+            workers_run_group( workers, slot, (uint32_t) group );
+        }
+    }
+}
+
+static void workers_main( void *arg ) {
+    RenderWorkers *workers = (RenderWorkers *) arg;
+    for ( ;; ) {
+        workers_wake_wait( workers );
+        if ( !synth_atomic_load( &workers->running ) ) return;
+        uint32_t slot = (uint32_t) synth_atomic_fetch_add( &workers->joined, 1 ) + 1;
+        workers_participate( workers, slot );
+        synth_atomic_fetch_add( &workers->finished, 1 );
+    }
+}
+
+/*****************
+ * SERIAL RENDER *
+ ****************/
+// the same tree, walked like a binary counter: equal sized partial sums merge as soon as they meet
+static SynthError workers_render_serial(
+  SynthArena *scratch, WorkerTask task, void *user, uint32_t groups, float *out, int length
+) {
+    float    *stack[WORKERS_MAX_DEPTH] = { out };    // partial sums, slot 0 is the output
+    uint32_t  level[WORKERS_MAX_DEPTH];              // log2 of the groups each one covers
+    uint32_t  depth = 0;
+    ArenaMark mark  = arena_mark( scratch );
+    float    *work  = (float *) arena_alloc_aligned(
+      scratch, sizeof( float ) * WORKERS_SCRATCH, WORKERS_CACHE_LINE
+    );
+    if ( !work ) return SYNTH_ERROR_ARENA_FULL;
+
+    for ( uint32_t group = 0; group < groups; group++ ) {
+        if ( depth > 0 && !stack[depth] ) {
+            stack[depth] = (float *) arena_alloc_aligned(
+              scratch, sizeof( float ) * SYNTH_BLOCK_SIZE, WORKERS_CACHE_LINE
+            );
+            if ( !stack[depth] ) {
+                arena_rewind( scratch, mark );
+                return SYNTH_ERROR_ARENA_FULL;
+            }
+        }
+        if ( depth > 0 ) memset( stack[depth], 0, sizeof( float ) * length );
+        task( user, group, stack[depth], work, length );
+
+        level[depth] = 0;
+        while ( depth > 0 && level[depth - 1] == level[depth] ) {
+            workers_add( stack[depth - 1], stack[depth], length );
+            level[--depth]++;
+        }
+        depth++;
+    }
+
+    // what is left are the nodes without a right half, folded from the right like the tree does
+    while ( depth > 1 ) {
+        depth--;
+        workers_add( stack[depth - 1], stack[depth], length );
+    }
+    arena_rewind( scratch, mark );
+    return SYNTH_ACK;
+}
+
+/***********
+ * WORKERS *
+ **********/
+RenderWorkers *workers_create( uint32_t threads, uint32_t maxVoices, int priority ) {
+    if ( threads < 2 || threads > WORKERS_MAX_THREADS || maxVoices == 0 ) return NULL;
+    RenderWorkers *workers = (RenderWorkers *) calloc( 1, sizeof( RenderWorkers ) );
+    if ( !workers ) return NULL;
+
+    workers->numThreads = threads;
+    workers->maxGroups  = ( maxVoices + WORKERS_GROUP_VOICES - 1 ) / WORKERS_GROUP_VOICES;
+    while ( ( 1u << workers->levels ) < workers->maxGroups ) workers->levels++;
+
+    // one allocation up front, plus a cache line of alignment slack for each array
+    size_t partials = sizeof( float ) * workers->maxGroups * SYNTH_BLOCK_SIZE;
+    size_t scratch  = sizeof( float ) * threads * WORKERS_SCRATCH;
+    size_t arrivals = sizeof( SynthAtomic ) * ( workers->levels + 1 ) * workers->maxGroups;
+    size_t ranges   = sizeof( WorkerRange ) * threads;
+    arena_init( &workers->arena, partials + scratch + arrivals + ranges + 4 * WORKERS_CACHE_LINE );
+    SynthArena *arena = &workers->arena;
+    workers->partials = (float *) arena_alloc_aligned( arena, partials, WORKERS_CACHE_LINE );
+    workers->scratch  = (float *) arena_alloc_aligned( arena, scratch, WORKERS_CACHE_LINE );
+    workers->arrivals = (SynthAtomic *) arena_alloc_aligned( arena, arrivals, WORKERS_CACHE_LINE );
+    workers->ranges   = (WorkerRange *) arena_alloc_aligned( arena, ranges, WORKERS_CACHE_LINE );
+    if ( !workers->ranges || !workers_wake_init( workers ) ) {
+        arena_destroy( &workers->arena );
+        free( workers );
+        return NULL;
+    }
+    for ( size_t i = 0; i < arrivals / sizeof( SynthAtomic ); i++ ) {
+        synth_atomic_store( &workers->arrivals[i], 0 );
+    }
+
+    synth_atomic_store( &workers->running, 1 );
+    for ( uint32_t t = 1; t < threads; t++ ) {
+        if ( !synth_thread_start( &workers->threads[t], workers_main, workers, priority ) ) {
+            workers->numThreads = t;
+            workers_destroy( workers );
+            return NULL;
+        }
+    }
+    return workers;
+}
+
+void workers_destroy( RenderWorkers *workers ) {
+    if ( !workers ) return;
+    synth_atomic_store( &workers->running, 0 );
+    workers_wake_post( workers, workers->numThreads - 1 );
+    for ( uint32_t t = 1; t < workers->numThreads; t++ ) synth_thread_join( &workers->threads[t] );
+    workers_wake_destroy( workers );
+    arena_destroy( &workers->arena );
+    free( workers );
+}
+
+SynthError workers_render(
+  RenderWorkers *workers, SynthArena *scratch, WorkerTask task, void *user, uint32_t groups,
+  float *out, int length
+) {
+    if ( groups == 0 ) return SYNTH_ACK;
+    if ( !workers || groups < 2 || groups > workers->maxGroups ) {
+        return workers_render_serial( scratch, task, user, groups, out, length );
+    }
+
+    // deal the groups out evenly, waking no more workers than there are groups to share
+    uint32_t helpers = groups - 1 < workers->numThreads - 1 ? groups - 1 : workers->numThreads - 1;
+    workers->task         = task;
+    workers->user         = user;
+    workers->out          = out;
+    workers->groups       = groups;
+    workers->participants = helpers + 1;
+    workers->length       = length;
+    for ( uint32_t p = 0; p <= helpers; p++ ) {
+        synth_atomic_store( &workers->ranges[p].next, (uint64_t) groups * p / ( helpers + 1 ) );
+        workers->ranges[p].end = (uint64_t) groups * ( p + 1 ) / ( helpers + 1 );
+    }
+    synth_atomic_store( &workers->joined, 0 );
+    synth_atomic_store( &workers->finished, 0 );
+    synth_atomic_fetch_add( &workers->jobs, 1 );
+
+    workers_wake_post( workers, helpers );
+    workers_participate( workers, 0 );
+    while ( synth_atomic_load( &workers->finished ) < helpers ) synth_yield();
+    return SYNTH_ACK;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file
+ * @brief render worker threads that mix voice groups in parallel with a deterministic reduction
+ *
+ * A span's live voices are cut into groups of WORKERS_GROUP_VOICES in active list order, and each
+ * group is mixed into its own partial buffer. The partials are summed pairwise up a fixed binary
+ * tree: group 0 mixes straight into the output, the node covering groups [l, l + 2^k) keeps its
+ * sum in the partial of group l, and a node without a right half passes its left half up as is.
+ * The tree only depends on the number of groups, so the mix is bit for bit the same for every
+ * thread count, including the serial path taken without workers.
+ *
+ * The render thread wakes one worker per extra group, up to the pool size, and renders alongside
+ * them. Each participant owns a contiguous range of groups and, once it is through, steals from
+ * the other ranges. A claim is a fetch-and-add on the range's counter. Tree nodes count the
+ * arrival of their children the same way: the second child to arrive adds the right partial into
+ * the left one and climbs on, the first one stops. Nothing on the render path takes a lock.
+ */
+
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include "envelope.h"
+
+#include <stdalign.h>
+
+#ifndef _WIN32
+  #include <semaphore.h>
+#endif
+
+#define WORKERS_GROUP_VOICES ENVELOPE_CHUNK    // voices per group, one envelope_render() each
+#define WORKERS_MAX_THREADS  16                // render threads, including the caller's own
+#define WORKERS_CACHE_LINE   64
+#define WORKERS_SCRATCH      ( SYNTH_BLOCK_SIZE * WORKERS_GROUP_VOICES )    // floats per group
+
+/**
+ * @brief Mix one group into a partial buffer
+ *
+ * @param user pointer given to workers_render()
+ * @param group group index
+ * @param partial zeroed destination, length samples, the group is added into it
+ * @param scratch WORKERS_SCRATCH floats owned by the calling thread
+ * @param length number of samples, at most SYNTH_BLOCK_SIZE
+ */
+typedef void ( *WorkerTask )(
+  void *user, uint32_t group, float *partial, float *scratch, int length
+);
+
+// groups dealt to one participant, claimed from the front by the owner and by thieves alike
+typedef struct {
+    alignas( WORKERS_CACHE_LINE ) SynthAtomic next;    // next group to claim
+    uint64_t end;
+} WorkerRange;
+
+struct RenderWorkers {
+    SynthArena   arena;                           // every buffer below
+    SynthThread  threads[WORKERS_MAX_THREADS];    // entry 0 stands for the render thread
+    uint32_t     numThreads;                      // including the render thread
+    uint32_t     maxGroups;
+    uint32_t     levels;                          // tree levels above the groups
+    float       *partials;                        // maxGroups rows of SYNTH_BLOCK_SIZE, 0 unused
+    float       *scratch;                         // numThreads rows of WORKERS_SCRATCH
+    SynthAtomic *arrivals;                        // levels rows of maxGroups tree node counters
+    WorkerRange *ranges;                          // one per participant
+#ifdef _WIN32
+    HANDLE wake;
+#else
+    sem_t wake;
+#endif
+
+    // current job, written by the render thread before it wakes the workers
+    WorkerTask  task;
+    void       *user;
+    float      *out;
+    uint32_t    groups;
+    uint32_t    participants;
+    int         length;
+    SynthAtomic joined;      // workers that picked the job up
+    SynthAtomic finished;    // workers done with it
+    SynthAtomic running;
+
+    // statistics
+    SynthAtomic jobs;      // spans rendered in parallel
+    SynthAtomic steals;    // groups rendered by a thread that did not own them
+};
+
+/**
+ * @brief Start a pool of render workers, not realtime safe
+ *
+ * @param threads render threads including the caller's own, 2 to WORKERS_MAX_THREADS
+ * @param maxVoices most live voices a span will have
+ * @param priority SCHED_FIFO priority of the workers, match the render thread, negative for none
+ * @return workers, or NULL if the threads or their memory cannot be had
+ */
+RenderWorkers *workers_create( uint32_t threads, uint32_t maxVoices, int priority );
+
+/**
+ * @brief Stop the workers and free them
+ *
+ * @param workers workers to stop, may be NULL
+ */
+void           workers_destroy( RenderWorkers *workers );
+
+/**
+ * @brief Mix a span's groups into the output, render thread only
+ *
+ * Without workers, or with a single group, the groups are mixed on the calling thread in the
+ * same reduction order.
+ *
+ * @param workers workers to share the groups with, may be NULL
+ * @param scratch arena for the serial path's partials and scratch
+ * @param task mixes one group
+ * @param user passed to task
+ * @param groups number of groups
+ * @param out zeroed destination, length samples
+ * @param length number of samples, at most SYNTH_BLOCK_SIZE
+ * @return SYNTH_ACK, or SYNTH_ERROR_ARENA_FULL if the serial path ran out of scratch
+ */
+SynthError     workers_render(
+  RenderWorkers *workers, SynthArena *scratch, WorkerTask task, void *user, uint32_t groups,
+  float *out, int length
+);
+
+#endif
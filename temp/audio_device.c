@@ -0,0 +1,61 @@
+// check: play a chord through an audio device and report the measured latency and xruns
+//
+// usage: audio_device [device] [seconds] [period frames] [periods]
+// Defaults to the ALSA "null" device, which runs headless; "file:FILE=/tmp/out.raw,FORMAT=raw"
+// keeps a copy of what was played. Period and periods default to AUDIO_PERIOD_FRAMES and
+// AUDIO_PERIODS.
+//
+// build: gcc -O2 -Isrc temp/audio_device.c $(ls src/*.c | grep -v main.c) -lm -lpthread -lasound
+//    or: add -DSYNTH_AUDIO_NULL and drop -lasound to use the built-in null device
+
+#include "synth_platform.h"
+
+// audio_render() source: the synth's mix
+static void render_synth( void *user, float *buffer, uint32_t frames ) {
+    synth_process_buffer( (Synthesizer *) user, buffer, (int) frames );
+}
+
+int main( int argc, char **argv ) {
+    AudioConfig config = {
+      .device       = argc > 1 ? argv[1] : "null",
+      .periodFrames = argc > 3 ? (uint32_t) atoi( argv[3] ) : 0,
+      .periods      = argc > 4 ? (uint32_t) atoi( argv[4] ) : 0,
+    };
+    double       seconds = argc > 2 ? atof( argv[2] ) : 5.0;
+    Synthesizer  synth;
+    AudioLatency latency;
+
+    AudioContext *audio = audio_open( &config );
+    if ( !audio ) {
+        printf( "cannot open %s\n", config.device );
+        return 1;
+    }
+    if ( synth_init( &synth, MAX_VOICES, 1 ) != SYNTH_ACK ) return 1;
+    synth.audio = audio;
+    for ( int i = 0; i < 4; i++ ) synth_trigger_pitch_at( &synth, 0, 57.0f + 4.0f * i, 0.2f );
+
+    // one period per call, like a realtime loop would
+    uint64_t total = (uint64_t) ( seconds * audio->sampleRate );
+    for ( uint64_t done = 0; done < total; done += audio->bufferSize ) {
+        if ( audio_render( audio, render_synth, &synth, (uint32_t) audio->bufferSize ) !=
+             SYNTH_ACK ) {
+            printf( "device failed after %llu frames\n", (unsigned long long) done );
+            break;
+        }
+    }
+
+    audio_latency( audio, &latency );
+    printf( "device          %s\n", config.device );
+    printf( "rate            %u Hz\n", latency.sampleRate );
+    printf( "period          %u frames\n", latency.periodFrames );
+    printf( "buffer          %u frames, %.2f periods, %.2f ms\n", latency.bufferFrames,
+            (double) latency.bufferFrames / latency.periodFrames, latency.bufferSeconds * 1e3 );
+    printf( "access          %s\n", latency.mmap ? "mmap" : "copy" );
+    printf( "output latency  %.2f ms, max %.2f ms\n", latency.delaySeconds * 1e3,
+            latency.maxDelaySeconds * 1e3 );
+    printf( "frames          %llu\n", (unsigned long long) latency.frames );
+    printf( "xruns           %llu\n", (unsigned long long) latency.xruns );
+    audio_close( audio );
+    arena_destroy( &synth.arena );
+    return 0;
+}
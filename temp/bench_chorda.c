@@ -0,0 +1,309 @@
+// benchmark: chord identification by pitch-class set against trying every chord
+//
+// The naive identifier spells every root, quality and extension and compares pitch-class sets.
+// For all 4096 sets and every bass the hashed identify_chorda_mask() must give the same answer,
+// which checks the perfect hash in music.c entry for entry, false positives included. Every
+// chord is then voiced in every inversion with doublings in shuffled order and named again. Last,
+// chords per second over a corpus of 10M voicings and for a 64 voice block.
+//
+// usage: ./a.out [--emit], --emit prints the table for music.c, searching a new multiplier if the
+//        current one collides
+//
+// build: gcc -O2 -Isrc temp/bench_chorda.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "music.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_CORPUS  ( 1 << 20 )    // voicings kept in memory
+#define BENCH_REPEATS 10             // passes over them, 10M chords
+#define BENCH_NAIVE   ( 1 << 18 )    // chords for the naive identifier
+#define BENCH_VOICES  64             // notes per live block
+#define BENCH_BLOCKS  1000000
+
+static const char *const quality_names[]   = { "MAJOR", "MINOR", "DIMINISHED",
+                                               "AUGMENTED", "SUS2", "SUS4" };
+static const char *const extension_names[] = { "SEVENTH",    "MAJ7TH", "NINTH", "ELEVENTH",
+                                               "THIRTEENTH", "TRIAD" };
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+static uint32_t seed = 7;
+
+static uint32_t random_below( uint32_t n ) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed % n;
+}
+
+static int shape_size( int q, int e ) {
+    int intervals[MAX_CHORD_NOTES], count;
+    consortium_intervalla( (Qualitas) q, (Extensio) e, intervals, &count );
+    return count;
+}
+
+/*********
+ * NAIVE *
+ ********/
+// every root from the bass up, every shape by size then enum order, compared as pitch-class sets
+static bool naive_identify( uint16_t mask, int bass, int *root, int *quality, int *extension ) {
+    if ( !( mask >> bass & 1 ) ) return false;
+    for ( int step = 0; step < DIAPASON; step++ ) {
+        int r = ( bass + step ) % DIAPASON;
+        if ( !( mask >> r & 1 ) ) continue;
+        for ( int size = 3; size <= MAX_CHORD_NOTES; size++ ) {
+            for ( int q = 0; q < QUALITAS_COUNT; q++ ) {
+                for ( int e = 0; e < EXTENSIO_COUNT; e++ ) {
+                    int intervals[MAX_CHORD_NOTES], count;
+                    consortium_intervalla( (Qualitas) q, (Extensio) e, intervals, &count );
+                    if ( count != size ) continue;
+                    uint16_t spelled = 0;
+                    for ( int i = 0; i < count; i++ ) {
+                        spelled |= (uint16_t) ( 1u << ( ( r + intervals[i] ) % DIAPASON ) );
+                    }
+                    if ( spelled != mask ) continue;
+                    *root      = r;
+                    *quality   = q;
+                    *extension = e;
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+/**********
+ * CHECKS *
+ *********/
+static bool check_masks( uint32_t *chords ) {
+    *chords = 0;
+    for ( uint32_t mask = 0; mask < 4096; mask++ ) {
+        for ( int bass = 0; bass < DIAPASON; bass++ ) {
+            int       r, q, e, grade;
+            NotaNomen root;
+            Qualitas  quality;
+            Extensio  extension;
+            bool      naive = naive_identify( (uint16_t) mask, bass, &r, &q, &e );
+            bool      fast  = identify_chorda_mask(
+              (uint16_t) mask, (NotaNomen) bass, &root, &quality, &extension, &grade
+            );
+            if ( naive != fast || ( naive && ( (int) root != r || (int) quality != q ||
+                                               (int) extension != e ) ) ) {
+                printf( "mask %03X bass %d: naive %d, hashed %d\n", mask, bass, naive, fast );
+                return false;
+            }
+            *chords += naive;
+        }
+    }
+    return true;
+}
+
+// every chord in every inversion, doubled and shuffled, must come back with its set and bass
+static bool check_voicings( void ) {
+    for ( int q = 0; q < QUALITAS_COUNT; q++ ) {
+        for ( int e = 0; e < EXTENSIO_COUNT; e++ ) {
+            for ( int r = 0; r < DIAPASON; r++ ) {
+                Nota   root = { (NotaNomen) r, 3 };
+                Chorda chord, named;
+                generate_chorda( &root, (Qualitas) q, (Extensio) e, &chord );
+                for ( int inversion = 0; inversion < chord.num_notes; inversion++ ) {
+                    Nota notas[3 * MAX_CHORD_NOTES];
+                    int  n = 0;
+                    // the bass an octave below everything, the rest doubled up an octave
+                    notas[n]           = chord.notas[inversion];
+                    notas[n++].diapason = 1;
+                    for ( int i = 0; i < chord.num_notes; i++ ) {
+                        notas[n++]          = chord.notas[i];
+                        notas[n]            = chord.notas[i];
+                        notas[n++].diapason += 1;
+                    }
+                    for ( int i = n - 1; i > 0; i-- ) {
+                        int  j   = (int) random_below( (uint32_t) i + 1 );
+                        Nota t   = notas[i];
+                        notas[i] = notas[j];
+                        notas[j] = t;
+                    }
+                    identify_chorda( notas, n, &named );
+                    uint16_t mask = chorda_mask( (NotaNomen) r, (Qualitas) q, (Extensio) e );
+                    bool     ok   = named.num_notes > 0 && est_chorda( notas, n ) &&
+                              chorda_mask( named.root.nome, named.quality, named.extension ) ==
+                                mask &&
+                              named.notas[named.inversion_grade].nome ==
+                                chord.notas[inversion].nome &&
+                              named.notas[named.inversion_grade].diapason == 1;
+                    if ( !ok ) {
+                        printf( "%s %s on %d, inversion %d, not named\n", quality_names[q],
+                                extension_names[e], r, inversion );
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/********
+ * EMIT *
+ *******/
+static void emit_table( void ) {
+    uint16_t masks[QUALITAS_COUNT * EXTENSIO_COUNT];
+    int      owner[QUALITAS_COUNT * EXTENSIO_COUNT], shapes = 0;
+    for ( int size = 3; size <= MAX_CHORD_NOTES; size++ ) {
+        for ( int q = 0; q < QUALITAS_COUNT; q++ ) {
+            for ( int e = 0; e < EXTENSIO_COUNT; e++ ) {
+                uint16_t mask = chorda_mask( C, (Qualitas) q, (Extensio) e );
+                bool     seen = false;
+                for ( int s = 0; s < shapes; s++ ) seen = seen || masks[s] == mask;
+                if ( shape_size( q, e ) != size || seen ) continue;
+                masks[shapes]   = mask;
+                owner[shapes++] = q * EXTENSIO_COUNT + e;
+            }
+        }
+    }
+    for ( uint32_t tries = 0; tries < 100000000; tries++ ) {
+        // the multiplier music.c has now first, so an unchanged shape set prints the same table
+        uint32_t hash = tries ? ( random_below( 0xFFFFFFFF ) << 1 ) | 1 : 0x58D07675u;
+        uint64_t used = 0;
+        int      s    = 0;
+        for ( ; s < shapes; s++ ) {
+            uint32_t slot = ( masks[s] * hash ) >> 26;
+            if ( used >> slot & 1 ) break;
+            used |= 1ull << slot;
+        }
+        if ( s < shapes ) continue;
+        printf( "#define MUSIC_SHAPE_HASH  0x%08Xu\n", hash );
+        for ( uint32_t slot = 0; slot < 64; slot++ ) {
+            for ( s = 0; s < shapes; s++ ) {
+                if ( ( ( masks[s] * hash ) >> 26 ) != slot ) continue;
+                char index[8];
+                snprintf( index, sizeof( index ), "[%u]", slot );
+                printf( "  %-4s = { 0x%03X, %s, %s },\n", index, masks[s],
+                        quality_names[owner[s] / EXTENSIO_COUNT],
+                        extension_names[owner[s] % EXTENSIO_COUNT] );
+            }
+        }
+        return;
+    }
+    printf( "no multiplier found, the table needs more slots\n" );
+}
+
+/**********
+ * TIMING *
+ *********/
+typedef struct {
+    Nota notas[MAX_CHORD_NOTES + 2];
+    int  count;
+} Voicing;
+
+// a random chord in a random inversion and octave, sometimes with a note of another chord in it
+static void random_voicing( Voicing *v ) {
+    Nota   root = { (NotaNomen) random_below( DIAPASON ), 2 + (int) random_below( 4 ) };
+    Chorda chord;
+    generate_chorda(
+      &root, (Qualitas) random_below( QUALITAS_COUNT ), (Extensio) random_below( EXTENSIO_COUNT ),
+      &chord
+    );
+    int inversion = (int) random_below( (uint32_t) chord.num_notes );
+    v->count      = 0;
+    for ( int i = 0; i < chord.num_notes; i++ ) {
+        v->notas[v->count] = chord.notas[( i + inversion ) % chord.num_notes];
+        if ( i > 0 ) v->notas[v->count].diapason += 1;
+        v->count++;
+    }
+    if ( random_below( 4 ) == 0 ) {
+        Nota stray = { (NotaNomen) random_below( DIAPASON ), 5 };
+        v->notas[v->count++] = stray;
+    }
+}
+
+static volatile uint32_t sink;
+
+static void time_corpus( const Voicing *corpus ) {
+    uint32_t named = 0;
+    double   start = now_seconds();
+    for ( int pass = 0; pass < BENCH_REPEATS; pass++ ) {
+        for ( int i = 0; i < BENCH_CORPUS; i++ ) {
+            Chorda chord;
+            identify_chorda( corpus[i].notas, corpus[i].count, &chord );
+            named += chord.num_notes > 0;
+        }
+    }
+    double hashed = now_seconds() - start;
+
+    start = now_seconds();
+    for ( int i = 0; i < BENCH_NAIVE; i++ ) {
+        uint16_t mask = 0;
+        int      bass = 0, low = 1 << 30, r, q, e;
+        for ( int n = 0; n < corpus[i].count; n++ ) {
+            int pitch  = corpus[i].notas[n].diapason * DIAPASON + corpus[i].notas[n].nome;
+            mask      |= (uint16_t) ( 1u << corpus[i].notas[n].nome );
+            if ( pitch < low ) low = pitch, bass = corpus[i].notas[n].nome;
+        }
+        named += naive_identify( mask, bass, &r, &q, &e );
+    }
+    double naive = now_seconds() - start;
+    sink         = named;
+
+    double chords = (double) BENCH_CORPUS * BENCH_REPEATS;
+    printf( "identify_chorda  %10.1f Mchords/s, %.0fM chords in %.2f s\n", chords / hashed * 1e-6,
+            chords * 1e-6, hashed );
+    printf( "naive            %10.1f Mchords/s, 10M chords would take %.1f s\n",
+            BENCH_NAIVE / naive * 1e-6, naive / BENCH_NAIVE * 1e7 );
+}
+
+// 64 voices doubling a chord over the keyboard, named once per block
+static void time_live( void ) {
+    static Nota blocks[16][BENCH_VOICES];
+    for ( int b = 0; b < 16; b++ ) {
+        Voicing v;
+        random_voicing( &v );
+        for ( int n = 0; n < BENCH_VOICES; n++ ) {
+            blocks[b][n]           = v.notas[n % v.count];
+            blocks[b][n].diapason  = 1 + n % 7;
+        }
+    }
+    uint32_t named = 0;
+    double   start = now_seconds();
+    for ( int i = 0; i < BENCH_BLOCKS; i++ ) {
+        Chorda chord;
+        identify_chorda( blocks[i & 15], BENCH_VOICES, &chord );
+        named += chord.num_notes > 0;
+    }
+    double elapsed = now_seconds() - start;
+    sink           = named;
+    printf( "%d voice block   %10.1f ns per block\n", BENCH_VOICES, elapsed / BENCH_BLOCKS * 1e9 );
+}
+
+int main( int argc, char **argv ) {
+    if ( argc > 1 && strcmp( argv[1], "--emit" ) == 0 ) {
+        emit_table();
+        return 0;
+    }
+
+    uint32_t chords;
+    bool     masks    = check_masks( &chords );
+    bool     voicings = check_voicings();
+    printf( "all 4096 sets x 12 basses match the naive identifier: %s (%u are chords)\n",
+            masks ? "yes" : "NO", chords );
+    printf( "every chord and inversion named from shuffled doubled voicings: %s\n",
+            voicings ? "yes" : "NO" );
+
+    Voicing *corpus = (Voicing *) malloc( sizeof( Voicing ) * BENCH_CORPUS );
+    for ( int i = 0; i < BENCH_CORPUS; i++ ) random_voicing( &corpus[i] );
+    time_corpus( corpus );
+    time_live();
+    free( corpus );
+    return masks && voicings ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+// benchmark: block envelopes against a per-sample update, per kernel, plus voice retirement
+//
+// Checks every kernel against a closed form ADSR (expf per sample) for accuracy and for the exact
+// sample each segment ends on, then times 256 to 4096 voices through envelope_render() and through
+// a branchy per-sample update in the style of the old synth_update_voice(). Last, a full synth
+// plays and releases a chord and the render cost is shown falling as the voices retire.
+//
+// build: gcc -O2 -Isrc temp/bench_envelope.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "envelope.h"
+
+#include <time.h>
+
+#define BENCH_VOICES  4096
+#define BENCH_SECONDS 2    // seconds of audio per timing run
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// closed form of the envelope at sample n of a note held for hold samples, for the reference
+static float reference_level( const Envelope *env, float peak, uint32_t n, uint32_t hold ) {
+    float a = roundf( env->attack * SAMPLE_RATE ), d = roundf( env->decay * SAMPLE_RATE );
+    float r = roundf( env->release * SAMPLE_RATE ), t = (float) n;
+    float s = peak * env->sustain, fall = logf( ENVELOPE_SILENCE ), level;
+    if ( t < a ) level = peak * t / a;
+    else if ( t < a + d ) level = s + ( peak - s ) * expf( fall * ( t - a ) / d );
+    else level = s;
+    if ( n < hold ) return level;
+
+    // release starts from the level reached at the hold sample
+    float from = reference_level( env, peak, hold, UINT32_MAX );
+    level      = from * expf( fall * (float) ( n - hold ) / r );
+    return level > ENVELOPE_SILENCE ? level : 0.0f;
+}
+
+// what a per-sample envelope looks like: a stage switch and an expf on every sample
+typedef struct {
+    int   stage;
+    float level, time, release;
+} NaiveEnvelope;
+
+static float naive_update( NaiveEnvelope *e, const Envelope *env, float peak, float dt ) {
+    e->time += dt;
+    switch ( e->stage ) {
+        case 0:
+            e->level = peak * e->time / env->attack;
+            if ( e->time >= env->attack ) e->stage = 1, e->time = 0.0f;
+            break;
+        case 1:
+            e->level = peak * env->sustain + peak * ( 1.0f - env->sustain ) *
+                                               expf( -9.21f * e->time / env->decay );
+            if ( e->time >= env->decay ) e->stage = 2;
+            break;
+        case 2: e->level = peak * env->sustain; break;
+        case 3:
+            e->level = e->release * expf( -9.21f * e->time / env->release );
+            if ( e->level < ENVELOPE_SILENCE ) e->stage = 4;
+            break;
+        default: e->level = 0.0f; break;
+    }
+    return e->level;
+}
+
+static void start_voices( VoicePool *pool, const Envelope *env, uint32_t count ) {
+    while ( pool->numActive ) voice_pool_release( pool, pool->active[0] );
+    for ( uint32_t i = 0; i < count; i++ ) {
+        uint32_t v          = voice_pool_alloc( pool );
+        pool->voices[v].env = *env;
+        pool->amplitude[v]  = 1.0f;
+        pool->envLevel[v]   = 0.0f;
+        envelope_note_on( pool, v, SAMPLE_RATE );
+    }
+}
+
+int main( void ) {
+    static const char *names[] = { "scalar", "sse2", "avx2" };
+    static float       gain[BENCH_VOICES * SYNTH_BLOCK_SIZE];
+    Envelope           env = { 0.01f, 0.05f, 0.5f, 0.1f, ENVELOPE_CURVE_EXPONENTIAL };
+    SynthArena         arena;
+    VoicePool          pool;
+
+    arena_init( &arena, 4 * 1024 * 1024 );
+    if ( voice_pool_init( &pool, &arena, BENCH_VOICES ) != SYNTH_ACK ) return 1;
+
+    // accuracy: one voice held for 0.2 s with odd span lengths, released, run to silence
+    uint32_t hold = SAMPLE_RATE / 5, total = hold + SAMPLE_RATE / 2;
+    printf( "%-8s %12s %14s %14s\n", "kernel", "max error", "retired at", "expected" );
+    for ( int k = 0; k < 3; k++ ) {
+        const RenderKernels *kernels = render_get_kernels( names[k] );
+        if ( !kernels ) continue;
+        start_voices( &pool, &env, 1 );
+        uint32_t v       = pool.active[0];
+        float    error   = 0.0f;
+        uint32_t retired = 0;
+        for ( uint32_t n = 0; n < total && !retired; ) {
+            int length = 1 + (int) ( n * 7919u % SYNTH_BLOCK_SIZE );    // uneven spans
+            if ( n < hold && n + (uint32_t) length > hold ) length = (int) ( hold - n );
+            if ( n == hold ) envelope_note_off( &pool, v, SAMPLE_RATE );
+            envelope_render( &pool, kernels->envelope, &v, 1, gain, SYNTH_BLOCK_SIZE, length,
+                             SAMPLE_RATE );
+            for ( int i = 0; i < length; i++ ) {
+                float expect = reference_level( &env, 1.0f, n + i, hold );
+                if ( !retired && n + i > hold && gain[i] == 0.0f ) retired = n + i;
+                if ( expect == 0.0f || retired ) continue;    // the last step snaps to silence
+                if ( fabsf( gain[i] - expect ) > error ) error = fabsf( gain[i] - expect );
+            }
+            n += (uint32_t) length;
+        }
+        float from     = reference_level( &env, 1.0f, hold, UINT32_MAX );
+        float expected = (float) hold + ceilf( env.release * SAMPLE_RATE *
+                                               logf( ENVELOPE_SILENCE / from ) /
+                                               logf( ENVELOPE_SILENCE ) );
+        printf( "%-8s %12.2e %14u %14.0f\n", names[k], error, retired, expected );
+    }
+
+    // speed: ns per voice-sample through a whole attack, decay and sustain
+    printf( "\n%-8s %8s %14s\n", "kernel", "voices", "ns/voice-smp" );
+    int blocks = BENCH_SECONDS * SAMPLE_RATE / SYNTH_BLOCK_SIZE;
+    for ( uint32_t voices = 256; voices <= BENCH_VOICES; voices *= 4 ) {
+        for ( int k = 0; k < 3; k++ ) {
+            const RenderKernels *kernels = render_get_kernels( names[k] );
+            if ( !kernels ) continue;
+            start_voices( &pool, &env, voices );
+            double start = now_seconds();
+            for ( int b = 0; b < blocks; b++ ) {
+                envelope_render( &pool, kernels->envelope, pool.active, pool.numActive, gain,
+                                 SYNTH_BLOCK_SIZE, SYNTH_BLOCK_SIZE, SAMPLE_RATE );
+            }
+            double ns = ( now_seconds() - start ) * 1e9 / ( (double) blocks * SYNTH_BLOCK_SIZE *
+                                                           voices );
+            printf( "%-8s %8u %14.3f\n", names[k], voices, ns );
+        }
+
+        static NaiveEnvelope naive[BENCH_VOICES];
+        memset( naive, 0, sizeof( naive ) );
+        double start = now_seconds();
+        for ( int b = 0; b < blocks; b++ ) {
+            for ( uint32_t v = 0; v < voices; v++ ) {
+                for ( int i = 0; i < SYNTH_BLOCK_SIZE; i++ ) {
+                    gain[v * SYNTH_BLOCK_SIZE + i] =
+                      naive_update( &naive[v], &env, 1.0f, 1.0f / SAMPLE_RATE );
+                }
+            }
+        }
+        double ns = ( now_seconds() - start ) * 1e9 / ( (double) blocks * SYNTH_BLOCK_SIZE *
+                                                       voices );
+        printf( "%-8s %8u %14.3f\n", "naive", voices, ns );
+    }
+
+    // retirement: a chord of MAX_VOICES notes, released after 0.1 s, render cost per 20 ms
+    Synthesizer synth;
+    float       out[SAMPLE_RATE / 50];
+    int         notes[MAX_VOICES];
+    if ( synth_init( &synth, MAX_VOICES, 1 ) != SYNTH_ACK ) return 1;
+    synth_set_envelope( &synth, &env );
+    for ( int i = 0; i < MAX_VOICES; i++ ) {
+        notes[i] = synth_trigger_pitch_at( &synth, 0, (float) ( 36 + i % 60 ), 1.0f / MAX_VOICES );
+    }
+    printf( "\n%8s %8s %10s\n", "ms", "voices", "us/20ms" );
+    for ( int chunk = 0; chunk < 20; chunk++ ) {
+        if ( chunk == 5 ) {
+            for ( int i = 0; i < MAX_VOICES; i++ ) {
+                synth_release_note_at( &synth, synth_frame_time( &synth ), notes[i] );
+            }
+        }
+        double start = now_seconds();
+        synth_process_buffer( &synth, out, SAMPLE_RATE / 50 );
+        printf( "%8d %8u %10.1f\n", ( chunk + 1 ) * 20, synth.voices->numActive,
+                ( now_seconds() - start ) * 1e6 );
+    }
+    arena_destroy( &synth.arena );
+    arena_destroy( &arena );
+    return 0;
+}
@@ -0,0 +1,297 @@
+// benchmark: Standard MIDI File parsing, track merging and sequencer scheduling
+//
+// Every .mid file of a corpus directory is opened through midi_file_open() and read to the end;
+// the merged stream must never go back in time and, for the generated corpus, must hold exactly
+// the events that were written. The fread row reads the same files into memory first, the way the
+// old code would have, for the cost of the copy the mapping saves. Last, the sequencer schedules
+// the files into a synth whose command queue is drained as it fills, in commands per second.
+//
+// usage: ./a.out [corpus directory], without one a type 1 corpus is generated in /tmp
+//
+// build: gcc -O2 -Isrc temp/bench_midi.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "command.h"
+#include "midi.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define BENCH_FILES    64      // generated files
+#define BENCH_TRACKS   16      // tracks per generated file
+#define BENCH_NOTES    4000    // notes per generated track
+#define BENCH_PASSES   5       // reads of the corpus per timing, the best is kept
+#define BENCH_WINDOW   4800    // frames scheduled ahead per sequencer call
+#define BENCH_PATH_MAX 1024
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/**************
+ * GENERATION *
+ *************/
+typedef struct {
+    uint8_t *data;
+    size_t   size;
+    size_t   capacity;
+} ByteBuffer;
+
+static void put( ByteBuffer *b, const void *bytes, size_t n ) {
+    if ( b->size + n > b->capacity ) {
+        b->capacity = ( b->size + n ) * 2;
+        b->data     = (uint8_t *) realloc( b->data, b->capacity );
+    }
+    memcpy( b->data + b->size, bytes, n );
+    b->size += n;
+}
+
+static void put_byte( ByteBuffer *b, uint8_t byte ) { put( b, &byte, 1 ); }
+
+static void put_vlq( ByteBuffer *b, uint32_t v ) {
+    uint8_t bytes[4];
+    int     n = 0;
+    do {
+        bytes[n++]  = v & 0x7F;
+        v         >>= 7;
+    } while ( v );
+    while ( n-- > 0 ) put_byte( b, bytes[n] | ( n ? 0x80 : 0 ) );
+}
+
+static void put_u32( ByteBuffer *b, uint32_t v ) {
+    uint8_t bytes[4] = { v >> 24, v >> 16, v >> 8, v };
+    put( b, bytes, 4 );
+}
+
+// one track of notes with running status, a bend, a SysEx and tempo changes on track 0
+static uint32_t put_track( ByteBuffer *b, uint32_t track, uint32_t *seed ) {
+    ByteBuffer chunk  = { 0 };
+    uint32_t   events = 0;
+    uint8_t    on     = 0x90 | ( track & 0x0F );
+    for ( uint32_t n = 0; n < BENCH_NOTES; n++ ) {
+        *seed       = *seed * 1664525u + 1013904223u;
+        uint8_t key = 36 + ( *seed >> 24 ) % 60;
+        if ( track == 0 && n % 500 == 0 ) {
+            uint32_t tempo   = 400000 + ( *seed >> 8 ) % 200000;
+            uint8_t  meta[6] = { 0xFF, 0x51, 3, tempo >> 16, tempo >> 8, tempo };
+            put_vlq( &chunk, 0 );
+            put( &chunk, meta, 6 );
+            events++;
+        }
+        if ( n % 700 == 3 ) {
+            uint8_t sysex[] = { 0xF0, 5, 0x7E, 0x7F, 0x09, 0x01, 0xF7 };
+            put_vlq( &chunk, 0 );
+            put( &chunk, sysex, sizeof( sysex ) );
+            events++;
+        }
+        if ( n % 97 == 0 ) {
+            uint8_t bend[] = { 0xE0 | ( track & 0x0F ), 0, 32 + n % 64 };
+            put_vlq( &chunk, 1 );
+            put( &chunk, bend, 3 );
+            events++;
+        }
+        // note on with its status byte, the off as a running status on with velocity 0
+        uint8_t note[] = { on, key, 64 + n % 63 };
+        put_vlq( &chunk, ( *seed >> 4 ) % 120 );
+        put( &chunk, note, 3 );
+        put_vlq( &chunk, 60 + ( *seed >> 12 ) % 240 );
+        put( &chunk, note + 1, 1 );
+        put_byte( &chunk, 0 );
+        events += 2;
+    }
+    uint8_t end[] = { 0xFF, 0x2F, 0 };
+    put_vlq( &chunk, 0 );
+    put( &chunk, end, 3 );
+    events++;
+
+    put( b, "MTrk", 4 );
+    put_u32( b, (uint32_t) chunk.size );
+    put( b, chunk.data, chunk.size );
+    free( chunk.data );
+    return events;
+}
+
+static uint64_t generate_corpus( const char *dir ) {
+    uint64_t events = 0;
+    uint32_t seed   = 1;
+    for ( int f = 0; f < BENCH_FILES; f++ ) {
+        ByteBuffer b         = { 0 };
+        uint8_t    header[6] = { 0, 1, 0, BENCH_TRACKS, 480 >> 8, 480 & 0xFF };
+        put( &b, "MThd", 4 );
+        put_u32( &b, 6 );
+        put( &b, header, 6 );
+        for ( uint32_t t = 0; t < BENCH_TRACKS; t++ ) events += put_track( &b, t, &seed );
+
+        char path[BENCH_PATH_MAX];
+        snprintf( path, sizeof( path ), "%s/%03d.mid", dir, f );
+        FILE *file = fopen( path, "wb" );
+        if ( file ) {
+            fwrite( b.data, 1, b.size, file );
+            fclose( file );
+        }
+        free( b.data );
+    }
+    return events;
+}
+
+/*************
+ * MEASURING *
+ ************/
+typedef struct {
+    char   **paths;
+    uint32_t count;
+    uint64_t bytes;
+} Corpus;
+
+static void load_corpus( Corpus *corpus, const char *dir ) {
+    DIR           *d = opendir( dir );
+    struct dirent *entry;
+    memset( corpus, 0, sizeof( *corpus ) );
+    if ( !d ) return;
+    while ( ( entry = readdir( d ) ) ) {
+        size_t n = strlen( entry->d_name );
+        if ( n < 4 || n > 255 || strcmp( entry->d_name + n - 4, ".mid" ) != 0 ) continue;
+        size_t bytes  = sizeof( char * ) * ( corpus->count + 1 );
+        corpus->paths = (char **) realloc( corpus->paths, bytes );
+        corpus->paths[corpus->count] = (char *) malloc( BENCH_PATH_MAX );
+        snprintf( corpus->paths[corpus->count++], BENCH_PATH_MAX, "%s/%s", dir, entry->d_name );
+    }
+    closedir( d );
+}
+
+// read a whole file, checking the merged order, returns its events
+static uint64_t read_events( MidiFile *file, bool *ordered ) {
+    MidiEvent event;
+    uint64_t  events = 0, last = 0;
+    while ( midi_file_next( file, &event ) ) {
+        if ( event.tick < last ) *ordered = false;
+        last = event.tick;
+        events++;
+    }
+    return events;
+}
+
+static double time_mapped( const Corpus *corpus, uint64_t *events, uint64_t *errors, bool *ok ) {
+    double best = 1e9;
+    for ( int pass = 0; pass < BENCH_PASSES; pass++ ) {
+        *events = *errors = 0;
+        double start      = now_seconds();
+        for ( uint32_t i = 0; i < corpus->count; i++ ) {
+            MidiFile file;
+            if ( midi_file_open( &file, corpus->paths[i] ) != SYNTH_ACK ) {
+                (*errors)++;
+                continue;
+            }
+            *events += read_events( &file, ok );
+            *errors += file.errors;
+            midi_file_close( &file );
+        }
+        double elapsed = now_seconds() - start;
+        if ( elapsed < best ) best = elapsed;
+    }
+    return best;
+}
+
+static double time_fread( Corpus *corpus ) {
+    double best = 1e9;
+    for ( int pass = 0; pass < BENCH_PASSES; pass++ ) {
+        bool   ordered = true;
+        double start   = now_seconds();
+        corpus->bytes  = 0;
+        for ( uint32_t i = 0; i < corpus->count; i++ ) {
+            FILE *f = fopen( corpus->paths[i], "rb" );
+            if ( !f ) continue;
+            fseek( f, 0, SEEK_END );
+            long size = ftell( f );
+            fseek( f, 0, SEEK_SET );
+            uint8_t *data = (uint8_t *) malloc( (size_t) size );
+            MidiFile file;
+            if ( fread( data, 1, (size_t) size, f ) == (size_t) size &&
+                 midi_file_load( &file, data, (size_t) size ) == SYNTH_ACK ) {
+                read_events( &file, &ordered );
+                midi_file_close( &file );
+            }
+            corpus->bytes += (uint64_t) size;
+            free( data );
+            fclose( f );
+        }
+        double elapsed = now_seconds() - start;
+        if ( elapsed < best ) best = elapsed;
+    }
+    return best;
+}
+
+// empty both command queues the way the render thread would, without rendering
+static void drain( Synthesizer *synth ) {
+    while ( command_queue_peek( synth->live ) ) command_queue_pop( synth->live );
+    while ( command_queue_peek( synth->commands ) ) command_queue_pop( synth->commands );
+}
+
+// schedule every file into a synth, draining the queue as the render thread would
+static double time_sequencer( const Corpus *corpus, uint64_t *commands ) {
+    Synthesizer synth;
+    if ( synth_init( &synth, MAX_VOICES, 1 ) != SYNTH_ACK ) return 0.0;
+    *commands    = 0;
+    double start = now_seconds();
+    for ( uint32_t i = 0; i < corpus->count; i++ ) {
+        MidiFile      file;
+        MidiSequencer sequencer;
+        if ( midi_file_open( &file, corpus->paths[i] ) != SYNTH_ACK ) continue;
+        midi_sequencer_init( &sequencer, &file, &synth, 0 );
+        for ( uint64_t until = BENCH_WINDOW; !sequencer.finished; until += BENCH_WINDOW ) {
+            // a call that queued nothing stopped at the window, not at a full queue
+            while ( midi_sequencer_schedule( &sequencer, until ) > 0 ) {
+                drain( &synth );
+            }
+        }
+        midi_sequencer_stop( &sequencer, SYNTH_TIME_NOW );
+        drain( &synth );
+        *commands += sequencer.channels.commands;
+        midi_file_close( &file );
+    }
+    double elapsed = now_seconds() - start;
+    arena_destroy( &synth.arena );
+    return elapsed;
+}
+
+int main( int argc, char **argv ) {
+    char     dir[BENCH_PATH_MAX / 2];    // leaves room for the file names
+    uint64_t expected = 0;
+    if ( argc > 1 ) {
+        snprintf( dir, sizeof( dir ), "%s", argv[1] );
+    } else {
+        snprintf( dir, sizeof( dir ), "/tmp/bench_midi_corpus" );
+        mkdir( dir, 0755 );
+        expected = generate_corpus( dir );
+    }
+
+    Corpus corpus;
+    load_corpus( &corpus, dir );
+    if ( corpus.count == 0 ) {
+        printf( "no .mid files in %s\n", dir );
+        return 1;
+    }
+
+    uint64_t events, errors, commands;
+    bool     ordered = true;
+    double   fread_s = time_fread( &corpus );
+    double   mapped  = time_mapped( &corpus, &events, &errors, &ordered );
+    printf( "%u files, %.1f MB, %llu events, %llu damaged tracks\n", corpus.count,
+            (double) corpus.bytes / 1e6, (unsigned long long) events,
+            (unsigned long long) errors );
+    printf( "%-12s %10.2f Mevents/s %8.1f MB/s\n", "fread", (double) events / fread_s * 1e-6,
+            (double) corpus.bytes / fread_s * 1e-6 );
+    printf( "%-12s %10.2f Mevents/s %8.1f MB/s\n", "mmap", (double) events / mapped * 1e-6,
+            (double) corpus.bytes / mapped * 1e-6 );
+    printf( "merged order %s", ordered ? "ok" : "BROKEN" );
+    if ( expected ) printf( ", %s event count", events == expected ? "exact" : "WRONG" );
+    printf( "\n" );
+
+    double sequenced = time_sequencer( &corpus, &commands );
+    printf( "%-12s %10.2f Mcommands/s, %llu commands\n", "sequencer",
+            (double) commands / sequenced * 1e-6, (unsigned long long) commands );
+    return ordered && ( !expected || events == expected ) ? 0 : 1;
+}
@@ -0,0 +1,362 @@
+// fuzz and benchmark: raw MIDI byte stream decoding and batch dispatch
+//
+// Round trip: random messages are encoded the way a port sends them, with running status where
+// allowed, system common messages, SysEx (some cut short by a status byte) and realtime bytes
+// dropped in anywhere, inside other messages and SysEx too. Decoding must give back exactly the
+// encoded messages, whatever the split of the stream into runs and however small the message
+// array. Garbage: random bytes, heavy in status bytes, must decode the same in one call and in
+// random pieces, with every message well formed and every SysEx payload inside the input. Run it
+// under -fsanitize=address,undefined as well. Last, decoding throughput in MB of MIDI per second
+// and batch dispatch into a synth in messages per second.
+//
+// build: gcc -O2 -Isrc temp/bench_midi_stream.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "command.h"
+#include "midi.h"
+
+#include <time.h>
+
+#define FUZZ_ROUNDS   2000             // streams per fuzz test
+#define FUZZ_MESSAGES 400              // messages per round trip stream
+#define FUZZ_GARBAGE  4096             // bytes per garbage stream
+#define BENCH_BYTES   ( 64u << 20 )    // bytes per throughput stream
+#define BENCH_BATCH   4096             // messages per decode call
+#define BENCH_PASSES  5
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+static uint32_t seed = 12345;
+
+static uint32_t next_random( void ) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static uint32_t random_below( uint32_t n ) { return next_random() % n; }
+
+typedef struct {
+    uint8_t *data;
+    size_t   size;
+    size_t   capacity;
+} ByteBuffer;
+
+static void put_byte( ByteBuffer *b, uint8_t byte ) {
+    if ( b->size == b->capacity ) {
+        b->capacity = b->capacity ? b->capacity * 2 : 4096;
+        b->data     = (uint8_t *) realloc( b->data, b->capacity );
+    }
+    b->data[b->size++] = byte;
+}
+
+static void put_bytes( ByteBuffer *b, const uint8_t *bytes, size_t n ) {
+    for ( size_t i = 0; i < n; i++ ) put_byte( b, bytes[i] );
+}
+
+/******************
+ * CANONICAL FORM *
+ *****************/
+// messages as records: status and two data bytes, or a whole SysEx once its last piece is in
+typedef struct {
+    ByteBuffer records;
+    ByteBuffer sysex;    // SysEx payload gathered from its pieces
+    bool       open;     // a SysEx message has started
+    bool       broken;   // a piece arrived out of order or pointed outside the input
+} Canonical;
+
+static void record( ByteBuffer *b, uint8_t status, uint8_t data0, uint8_t data1 ) {
+    put_byte( b, status );
+    put_byte( b, data0 );
+    put_byte( b, data1 );
+}
+
+static void record_sysex( ByteBuffer *b, const ByteBuffer *payload, uint8_t flags ) {
+    record( b, MIDI_SYSEX, flags, 0 );
+    for ( int s = 0; s < 32; s += 8 ) put_byte( b, (uint8_t) ( payload->size >> s ) );
+    put_bytes( b, payload->data, payload->size );
+}
+
+static void canonical_add(
+  Canonical *c, const MidiMessage *messages, uint32_t n, const uint8_t *input, size_t size
+) {
+    for ( uint32_t i = 0; i < n; i++ ) {
+        const MidiMessage *m = &messages[i];
+        if ( m->status != MIDI_SYSEX ) {
+            if ( m->status < 0x80 || ( m->data[0] | m->data[1] ) & 0x80 ) c->broken = true;
+            record( &c->records, m->status, m->data[0], m->data[1] );
+            continue;
+        }
+        if ( m->length && ( m->payload < input || m->payload + m->length > input + size ) ) {
+            c->broken = true;
+            continue;
+        }
+        if ( ( m->sysex & MIDI_SYSEX_FIRST ) == c->open ) c->broken = true;
+        if ( m->sysex & MIDI_SYSEX_FIRST ) c->sysex.size = 0;
+        for ( uint32_t j = 0; j < m->length; j++ ) {
+            if ( m->payload[j] & 0x80 ) c->broken = true;
+            put_byte( &c->sysex, m->payload[j] );
+        }
+        c->open = !( m->sysex & MIDI_SYSEX_LAST );
+        if ( !c->open ) {
+            record_sysex( &c->records, &c->sysex, m->sysex & ~MIDI_SYSEX_FIRST );
+        }
+    }
+}
+
+// decode a stream in random runs into a random sized array
+static uint64_t decode_pieces( Canonical *c, const uint8_t *input, size_t size, bool random ) {
+    static MidiMessage messages[BENCH_BATCH];
+    MidiDecoder        decoder;
+    midi_decoder_init( &decoder );
+    memset( c, 0, sizeof( *c ) );
+    for ( size_t done = 0; done < size; ) {
+        size_t   run      = random ? 1 + random_below( 64 ) : size - done;
+        uint32_t capacity = random ? 1 + random_below( 8 ) : BENCH_BATCH;
+        if ( run > size - done ) run = size - done;
+        size_t   consumed;
+        uint32_t n = midi_decode( &decoder, input + done, run, &consumed, messages, capacity );
+        canonical_add( c, messages, n, input, size );
+        if ( consumed == 0 && n == 0 ) {
+            c->broken = true;    // no progress
+            break;
+        }
+        done += consumed;
+    }
+    if ( c->open ) record_sysex( &c->records, &c->sysex, 0 );    // still open at the end
+    return decoder.dropped;
+}
+
+static void canonical_free( Canonical *c ) {
+    free( c->records.data );
+    free( c->sysex.data );
+}
+
+/**************
+ * ROUND TRIP *
+ *************/
+// a realtime byte now and then, wherever the encoder is
+static void maybe_realtime( ByteBuffer *stream, ByteBuffer *expected ) {
+    static const uint8_t realtime[] = { 0xF8, 0xFA, 0xFB, 0xFC, 0xFE, 0xFF };
+    if ( random_below( 16 ) ) return;
+    uint8_t byte = realtime[random_below( sizeof( realtime ) )];
+    put_byte( stream, byte );
+    record( expected, byte, 0, 0 );
+}
+
+static void encode_stream( ByteBuffer *stream, ByteBuffer *expected ) {
+    static const uint8_t common[] = { 0xF1, 0xF2, 0xF3, 0xF6 };
+    uint8_t              running  = 0;
+    for ( int m = 0; m < FUZZ_MESSAGES; m++ ) {
+        uint32_t kind = random_below( 10 );
+        if ( kind < 7 ) {
+            uint8_t status = 0x80 | random_below( 0x70 );
+            uint8_t data[] = { random_below( 128 ), random_below( 128 ) };
+            if ( random_below( 3 ) && running ) status = running;    // reuse the running status
+            int     bytes  = ( status & 0xE0 ) == 0xC0 ? 1 : 2;
+            if ( status != running || random_below( 4 ) == 0 ) put_byte( stream, status );
+            running = status;
+            for ( int d = 0; d < bytes; d++ ) {
+                maybe_realtime( stream, expected );
+                put_byte( stream, data[d] );
+            }
+            record( expected, status, data[0], bytes == 2 ? data[1] : 0 );
+        } else if ( kind == 7 ) {
+            uint8_t status = common[random_below( sizeof( common ) )];
+            int     bytes  = status == 0xF2 ? 2 : status == 0xF6 ? 0 : 1;
+            uint8_t data[] = { 0, 0 };
+            put_byte( stream, status );
+            for ( int d = 0; d < bytes; d++ ) {
+                data[d] = random_below( 128 );
+                maybe_realtime( stream, expected );
+                put_byte( stream, data[d] );
+            }
+            record( expected, status, data[0], data[1] );
+            running = 0;
+        } else if ( kind == 8 ) {
+            ByteBuffer payload = { 0 };
+            uint32_t   length  = random_below( 300 );
+            put_byte( stream, MIDI_SYSEX );
+            for ( uint32_t j = 0; j < length; j++ ) {
+                maybe_realtime( stream, expected );
+                uint8_t byte = random_below( 128 );
+                put_byte( stream, byte );
+                put_byte( &payload, byte );
+            }
+            // now and then cut short by the status of the next message instead of F7
+            bool cut = random_below( 5 ) == 0;
+            if ( !cut ) put_byte( stream, MIDI_SYSEX_ESCAPE );
+            record_sysex(
+              expected, &payload, MIDI_SYSEX_LAST | ( cut ? MIDI_SYSEX_CUT : 0 )
+            );
+            free( payload.data );
+            running = 0;
+            if ( cut ) {
+                uint8_t status = 0x90 | random_below( 16 );
+                uint8_t key    = random_below( 128 );
+                put_byte( stream, status );
+                put_byte( stream, key );
+                put_byte( stream, 0 );
+                record( expected, status, key, 0 );
+                running = status;
+            }
+        } else {
+            maybe_realtime( stream, expected );
+        }
+    }
+}
+
+static bool fuzz_round_trip( void ) {
+    for ( int round = 0; round < FUZZ_ROUNDS; round++ ) {
+        ByteBuffer stream = { 0 }, expected = { 0 };
+        encode_stream( &stream, &expected );
+        for ( int pass = 0; pass < 2; pass++ ) {
+            Canonical c;
+            uint64_t  dropped = decode_pieces( &c, stream.data, stream.size, pass == 1 );
+            bool      same    = c.records.size == expected.size &&
+                         memcmp( c.records.data, expected.data, expected.size ) == 0;
+            canonical_free( &c );
+            if ( !same || c.broken || dropped ) {
+                printf( "round trip %d (%s) differs\n", round, pass ? "pieces" : "whole" );
+                return false;
+            }
+        }
+        free( stream.data );
+        free( expected.data );
+    }
+    return true;
+}
+
+static bool fuzz_garbage( void ) {
+    static uint8_t input[FUZZ_GARBAGE];
+    for ( int round = 0; round < FUZZ_ROUNDS; round++ ) {
+        for ( int i = 0; i < FUZZ_GARBAGE; i++ ) {
+            uint32_t r = next_random();
+            input[i]   = ( r >> 8 ) % 3 == 0 ? 0x80 | ( r & 0x7F ) : r & 0x7F;
+        }
+        Canonical whole, pieces;
+        uint64_t  a    = decode_pieces( &whole, input, FUZZ_GARBAGE, false );
+        uint64_t  b    = decode_pieces( &pieces, input, FUZZ_GARBAGE, true );
+        bool      same = a == b && whole.records.size == pieces.records.size &&
+                    memcmp( whole.records.data, pieces.records.data, whole.records.size ) == 0;
+        bool      ok   = same && !whole.broken && !pieces.broken;
+        canonical_free( &whole );
+        canonical_free( &pieces );
+        if ( !ok ) {
+            printf( "garbage %d decodes differently in pieces\n", round );
+            return false;
+        }
+    }
+    return true;
+}
+
+/**************
+ * THROUGHPUT *
+ *************/
+// notes with running status and a bend now and then, or mostly SysEx
+static void make_stream( ByteBuffer *stream, bool sysex ) {
+    stream->size = 0;
+    while ( stream->size < BENCH_BYTES ) {
+        uint8_t channel = random_below( 16 );
+        if ( sysex ) {
+            put_byte( stream, MIDI_SYSEX );
+            for ( int j = 0; j < 250; j++ ) put_byte( stream, random_below( 128 ) );
+            put_byte( stream, MIDI_SYSEX_ESCAPE );
+        } else {
+            put_byte( stream, 0x90 | channel );
+            for ( int n = 0; n < 8; n++ ) {
+                put_byte( stream, 36 + random_below( 60 ) );
+                put_byte( stream, n & 1 ? 0 : 1 + random_below( 127 ) );
+            }
+            if ( channel == 0 ) {
+                uint8_t bend[] = { 0xE0, random_below( 128 ), random_below( 128 ) };
+                put_bytes( stream, bend, 3 );
+            }
+        }
+        if ( random_below( 64 ) == 0 ) put_byte( stream, 0xF8 );
+    }
+}
+
+static double time_decode( const ByteBuffer *stream, uint64_t *total ) {
+    static MidiMessage messages[BENCH_BATCH];
+    double             best = 1e9;
+    for ( int pass = 0; pass < BENCH_PASSES; pass++ ) {
+        MidiDecoder decoder;
+        midi_decoder_init( &decoder );
+        *total       = 0;
+        double start = now_seconds();
+        for ( size_t done = 0; done < stream->size; ) {
+            size_t consumed;
+            *total += midi_decode(
+              &decoder, stream->data + done, stream->size - done, &consumed, messages, BENCH_BATCH
+            );
+            done   += consumed;
+        }
+        double elapsed = now_seconds() - start;
+        if ( elapsed < best ) best = elapsed;
+    }
+    return best;
+}
+
+// empty both command queues the way the render thread would, without rendering
+static void drain( Synthesizer *synth ) {
+    while ( command_queue_peek( synth->live ) ) command_queue_pop( synth->live );
+    while ( command_queue_peek( synth->commands ) ) command_queue_pop( synth->commands );
+}
+
+// decode and play a stream, draining the command queue as the render thread would
+static double time_dispatch( const ByteBuffer *stream, uint64_t *total, uint64_t *commands ) {
+    static MidiMessage messages[BENCH_BATCH];
+    Synthesizer        synth;
+    MidiChannels       channels;
+    MidiDecoder        decoder;
+    if ( synth_init( &synth, MAX_VOICES, 1 ) != SYNTH_ACK ) return 0.0;
+    midi_channels_init( &channels, &synth );
+    midi_decoder_init( &decoder );
+    *total       = 0;
+    double start = now_seconds();
+    for ( size_t done = 0; done < stream->size; ) {
+        size_t   consumed;
+        uint32_t n = midi_decode(
+          &decoder, stream->data + done, stream->size - done, &consumed, messages, BENCH_BATCH
+        );
+        for ( uint32_t sent = 0; sent < n; ) {
+            sent += midi_channels_dispatch( &channels, messages + sent, n - sent );
+            drain( &synth );
+        }
+        *total += n;
+        done   += consumed;
+    }
+    double elapsed = now_seconds() - start;
+    *commands      = channels.commands;
+    arena_destroy( &synth.arena );
+    return elapsed;
+}
+
+int main( void ) {
+    bool trip    = fuzz_round_trip();
+    bool garbage = fuzz_garbage();
+    printf( "round trip %s, garbage %s, %d streams each\n", trip ? "ok" : "FAILED",
+            garbage ? "ok" : "FAILED", FUZZ_ROUNDS );
+
+    ByteBuffer stream = { 0 };
+    uint64_t   messages, commands;
+    for ( int kind = 0; kind < 2; kind++ ) {
+        make_stream( &stream, kind == 1 );
+        double elapsed = time_decode( &stream, &messages );
+        printf( "%-7s decode %8.1f MB/s %8.1f Mmessages/s\n", kind ? "sysex" : "notes",
+                (double) stream.size / elapsed * 1e-6, (double) messages / elapsed * 1e-6 );
+    }
+    make_stream( &stream, false );
+    double elapsed = time_dispatch( &stream, &messages, &commands );
+    printf( "%-7s dispatch %6.1f MB/s %8.1f Mmessages/s, %llu commands\n", "notes",
+            (double) stream.size / elapsed * 1e-6, (double) messages / elapsed * 1e-6,
+            (unsigned long long) commands );
+    free( stream.data );
+    return trip && garbage ? 0 : 1;
+}
@@ -0,0 +1,220 @@
+// benchmark: scale and chord lookup tables against the procedural versions they replace
+//
+// The procedural versions below compute every interval per call: the mode by rotating the major
+// scale, the notes by summing steps, the chord by building the triad and stacking extensions on
+// it, the pitch-class set by or-ing in each note. Every table result must be bit-for-bit what they
+// give, for every tonic, octave, mode, quality and extension. Then calls per second of each.
+//
+// build: gcc -O2 -Isrc temp/bench_music.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "music.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_CALLS 20000000
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/**************
+ * PROCEDURAL *
+ *************/
+static void ref_modal_intervals( Modus modus, int *intervals ) {
+    const int major[7] = MAJOR_SCALE_INTERVALS;
+    for ( int i = 0; i < 7; i++ ) intervals[i] = major[( i + (int) modus ) % 7];
+}
+
+static void ref_scalae( const Nota *tonic, Modus modus, Scalae *scalae ) {
+    int intervals[7];
+    ref_modal_intervals( modus, intervals );
+    scalae->tonic = *tonic;
+    scalae->modus = modus;
+    int offset    = 0;
+    for ( int i = 0; i < 7; i++ ) {
+        int s                    = (int) tonic->nome + offset;
+        scalae->notas[i].nome     = (NotaNomen) ( s % DIAPASON );
+        scalae->notas[i].diapason = tonic->diapason + s / DIAPASON;
+        offset                   += intervals[i];
+    }
+}
+
+static uint16_t ref_scalae_mask( NotaNomen tonic, Modus modus ) {
+    Nota   n = { tonic, 4 };
+    Scalae scalae;
+    ref_scalae( &n, modus, &scalae );
+    uint16_t mask = 0;
+    for ( int i = 0; i < 7; i++ ) mask |= (uint16_t) ( 1u << scalae.notas[i].nome );
+    return mask;
+}
+
+static void ref_intervalla( Qualitas quality, Extensio extension, int *intervals, int *count ) {
+    int third = quality == MINOR || quality == DIMINISHED ? 3 : 4;
+    int fifth = quality == DIMINISHED ? 6 : quality == AUGMENTED ? 8 : 7;
+    if ( quality == SUS2 ) third = 2;
+    if ( quality == SUS4 ) third = 5;
+    int n          = 0;
+    intervals[n++] = 0;
+    intervals[n++] = third;
+    intervals[n++] = fifth;
+    if ( extension == MAJ7TH ) {
+        intervals[n++] = 11;
+    } else if ( extension != TRIAD ) {
+        intervals[n++] = quality == DIMINISHED ? 9 : 10;
+        if ( extension >= NINTH ) intervals[n++] = 14;
+        if ( extension >= ELEVENTH ) intervals[n++] = 17;
+        if ( extension >= THIRTEENTH ) intervals[n++] = 21;
+    }
+    *count = n;
+}
+
+static void ref_chorda( const Nota *root, Qualitas quality, Extensio extension, Chorda *chord ) {
+    int intervals[MAX_CHORD_NOTES];
+    ref_intervalla( quality, extension, intervals, &chord->num_notes );
+    chord->root            = *root;
+    chord->quality         = quality;
+    chord->extension       = extension;
+    chord->inversion       = false;
+    chord->inversion_grade = 0;
+    for ( int i = 0; i < chord->num_notes; i++ ) {
+        int s                   = (int) root->nome + intervals[i];
+        chord->notas[i].nome     = (NotaNomen) ( s % DIAPASON );
+        chord->notas[i].diapason = root->diapason + s / DIAPASON;
+    }
+}
+
+static uint16_t ref_chorda_mask( NotaNomen root, Qualitas quality, Extensio extension ) {
+    int intervals[MAX_CHORD_NOTES], count;
+    ref_intervalla( quality, extension, intervals, &count );
+    uint16_t mask = 0;
+    for ( int i = 0; i < count; i++ ) mask |= (uint16_t) ( 1u << ( ( root + intervals[i] ) % 12 ) );
+    return mask;
+}
+
+/*********
+ * CHECK *
+ ********/
+static bool check_tables( void ) {
+    bool ok = true;
+    for ( int m = 0; m < MODUS_COUNT; m++ ) {
+        int a[7], b[7];
+        ref_modal_intervals( (Modus) m, a );
+        generate_modal_intervals( (Modus) m, b );
+        ok = ok && memcmp( a, b, sizeof( a ) ) == 0;
+        for ( int t = 0; t < DIAPASON; t++ ) {
+            ok = ok && ref_scalae_mask( (NotaNomen) t, (Modus) m ) ==
+                         scalae_mask( (NotaNomen) t, (Modus) m );
+            for ( int o = DIAPASON_MIN; o <= DIAPASON_MAX; o++ ) {
+                Nota   tonic = { (NotaNomen) t, o };
+                Scalae x, y;
+                memset( &x, 0, sizeof( x ) );
+                memset( &y, 0, sizeof( y ) );
+                ref_scalae( &tonic, (Modus) m, &x );
+                generate_scalae( &tonic, (Modus) m, &y );
+                ok = ok && memcmp( &x, &y, sizeof( x ) ) == 0;
+            }
+        }
+    }
+    for ( int q = 0; q < QUALITAS_COUNT; q++ ) {
+        for ( int e = 0; e < EXTENSIO_COUNT; e++ ) {
+            int a[MAX_CHORD_NOTES], b[MAX_CHORD_NOTES], na, nb;
+            ref_intervalla( (Qualitas) q, (Extensio) e, a, &na );
+            consortium_intervalla( (Qualitas) q, (Extensio) e, b, &nb );
+            ok = ok && na == nb && memcmp( a, b, sizeof( int ) * na ) == 0;
+            for ( int r = 0; r < DIAPASON; r++ ) {
+                ok = ok && ref_chorda_mask( (NotaNomen) r, (Qualitas) q, (Extensio) e ) ==
+                             chorda_mask( (NotaNomen) r, (Qualitas) q, (Extensio) e );
+                for ( int o = DIAPASON_MIN; o <= DIAPASON_MAX; o++ ) {
+                    Nota   root = { (NotaNomen) r, o };
+                    Chorda x, y;
+                    memset( &x, 0, sizeof( x ) );
+                    memset( &y, 0, sizeof( y ) );
+                    ref_chorda( &root, (Qualitas) q, (Extensio) e, &x );
+                    generate_chorda( &root, (Qualitas) q, (Extensio) e, &y );
+                    ok = ok && memcmp( &x, &y, sizeof( x ) ) == 0;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+/**********
+ * TIMING *
+ *********/
+static volatile uint32_t sink;
+
+// called through pointers the compiler cannot see through, so neither side gets inlined
+typedef void ( *ScalaeFunction )( const Nota *, Modus, Scalae * );
+typedef void ( *ChordaFunction )( const Nota *, Qualitas, Extensio, Chorda * );
+typedef uint16_t ( *ScalaeMaskFunction )( NotaNomen, Modus );
+typedef uint16_t ( *ChordaMaskFunction )( NotaNomen, Qualitas, Extensio );
+
+// each loop walks every root and mode or chord type so no one entry stays hot in a predictor
+static double time_scalae( volatile ScalaeFunction scale ) {
+    Scalae   scalae;
+    uint32_t sum   = 0;
+    double   start = now_seconds();
+    for ( int i = 0; i < BENCH_CALLS; i++ ) {
+        Nota tonic = { (NotaNomen) ( i % DIAPASON ), 4 };
+        scale( &tonic, (Modus) ( i % MODUS_COUNT ), &scalae );
+        sum += scalae.notas[i % 7].nome;
+    }
+    sink = sum;
+    return BENCH_CALLS / ( now_seconds() - start );
+}
+
+static double time_chorda( volatile ChordaFunction chorda ) {
+    Chorda   chord;
+    uint32_t sum   = 0;
+    double   start = now_seconds();
+    for ( int i = 0; i < BENCH_CALLS; i++ ) {
+        Nota root = { (NotaNomen) ( i % DIAPASON ), 4 };
+        chorda( &root, (Qualitas) ( i % QUALITAS_COUNT ), (Extensio) ( i / 7 % EXTENSIO_COUNT ),
+                &chord );
+        sum += chord.notas[chord.num_notes - 1].nome;
+    }
+    sink = sum;
+    return BENCH_CALLS / ( now_seconds() - start );
+}
+
+static double time_chorda_mask( volatile ChordaMaskFunction mask ) {
+    uint32_t sum   = 0;
+    double   start = now_seconds();
+    for ( int i = 0; i < BENCH_CALLS; i++ ) {
+        sum += mask( (NotaNomen) ( i % DIAPASON ), (Qualitas) ( i % QUALITAS_COUNT ),
+                     (Extensio) ( i / 7 % EXTENSIO_COUNT ) );
+    }
+    sink = sum;
+    return BENCH_CALLS / ( now_seconds() - start );
+}
+
+static double time_scalae_mask( volatile ScalaeMaskFunction mask ) {
+    uint32_t sum   = 0;
+    double   start = now_seconds();
+    for ( int i = 0; i < BENCH_CALLS; i++ ) {
+        sum += mask( (NotaNomen) ( i % DIAPASON ), (Modus) ( i % MODUS_COUNT ) );
+    }
+    sink = sum;
+    return BENCH_CALLS / ( now_seconds() - start );
+}
+
+int main( void ) {
+    printf( "tables match the procedural versions: %s\n", check_tables() ? "yes" : "NO" );
+    printf( "%-16s %14s %14s\n", "Mcalls/s", "procedural", "table" );
+    printf( "%-16s %14.1f %14.1f\n", "generate_scalae", time_scalae( ref_scalae ) * 1e-6,
+            time_scalae( generate_scalae ) * 1e-6 );
+    printf( "%-16s %14.1f %14.1f\n", "scalae_mask", time_scalae_mask( ref_scalae_mask ) * 1e-6,
+            time_scalae_mask( scalae_mask ) * 1e-6 );
+    printf( "%-16s %14.1f %14.1f\n", "generate_chorda", time_chorda( ref_chorda ) * 1e-6,
+            time_chorda( generate_chorda ) * 1e-6 );
+    printf( "%-16s %14.1f %14.1f\n", "chorda_mask", time_chorda_mask( ref_chorda_mask ) * 1e-6,
+            time_chorda_mask( chorda_mask ) * 1e-6 );
+    return check_tables() ? 0 : 1;
+}
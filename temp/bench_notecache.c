@@ -0,0 +1,227 @@
+// benchmark: pre-rendered note loops, cold and hot note-on latency and LRU behaviour
+//
+// Every note's loop must play within a quarter of a cent of its pitch, the loops of low notes at
+// high rates having room for a single cycle only. A small cache runs a random stream of acquires
+// and releases next to a plain model of least recently used eviction that skips held loops, and
+// both must agree on every hit. Then the latency of a note-on, acquiring the loop and copying its
+// first block, when the loop has to be rendered and when it is cached, and the time to warm every
+// (note, waveform, sample rate, format) combination into a capped cache.
+//
+// build: gcc -O2 -Isrc temp/bench_notecache.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "music.h"
+#include "notecache.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_SLOTS    16    // slots of the cache the model is checked against
+#define BENCH_KEYS     48    // notes the random stream picks from
+#define BENCH_STEPS    200000
+#define BENCH_BLOCK    64    // frames copied by a note-on
+#define BENCH_CAPACITY ( 64u << 20 )
+
+static const uint32_t bench_rates[] = { 44100, 48000, 96000, 192000 };
+#define BENCH_RATES ( (int) ( sizeof( bench_rates ) / sizeof( bench_rates[0] ) ) )
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+static uint32_t bench_random( uint32_t *state ) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+/**********
+ * CHECKS *
+ *********/
+static bool check_pitch( NoteCache *cache ) {
+    double worst = 0.0;
+    int    loops = 0;
+    for ( int r = 0; r < BENCH_RATES; r++ ) {
+        for ( int note = NOTA_MIN; note <= NOTA_MAX; note++ ) {
+            const NoteLoop *loop = notecache_acquire(
+              cache, note, WAVEFORM_SAW, bench_rates[r], SAMPLE_FORMAT_FLOAT32
+            );
+            if ( !loop ) continue;    // above nyquist
+            float  expected = nota_frequency( note, BASE_TUNING, BASE_INDICE, 0.0f );
+            double cents    = 1200.0 * log2( loop->frequency / expected );
+            worst = fmax( worst, fabs( cents ) );
+            loops++;
+            notecache_release( cache, loop );
+        }
+    }
+    printf( "%d loops at %d rates, worst pitch error %.4f cents: %s\n", loops, BENCH_RATES, worst,
+            worst < 0.25 ? "ok" : "WRONG" );
+    return worst < 0.25;
+}
+
+// least recently used eviction as a list of keys by last use, held keys skipped
+typedef struct {
+    int      keys[BENCH_SLOTS];
+    uint64_t used[BENCH_SLOTS];
+    int      holds[BENCH_SLOTS];
+    int      count;
+} Model;
+
+static bool model_acquire( Model *m, int key, uint64_t now ) {
+    int victim = -1;
+    for ( int i = 0; i < m->count; i++ ) {
+        if ( m->keys[i] == key ) {
+            m->used[i] = now;
+            m->holds[i]++;
+            return true;
+        }
+    }
+    if ( m->count < BENCH_SLOTS ) {
+        victim = m->count++;
+    } else {
+        for ( int i = 0; i < m->count; i++ ) {
+            if ( m->holds[i] == 0 && ( victim < 0 || m->used[i] < m->used[victim] ) ) victim = i;
+        }
+    }
+    m->keys[victim]  = key;
+    m->used[victim]  = now;
+    m->holds[victim] = 1;
+    return false;
+}
+
+static void model_release( Model *m, int key ) {
+    for ( int i = 0; i < m->count; i++ ) {
+        if ( m->keys[i] == key ) m->holds[i]--;
+    }
+}
+
+static bool check_lru( void ) {
+    NoteCache cache;
+    if ( notecache_init( &cache, BENCH_SLOTS * NOTECACHE_SLOT_BYTES, NULL ) != SYNTH_ACK ) {
+        return false;
+    }
+    Model           model       = { { 0 }, { 0 }, { 0 }, 0 };
+    const NoteLoop *held[4]     = { NULL };
+    int             heldKeys[4] = { -1, -1, -1, -1 };
+    uint32_t        state       = 12345;
+    uint64_t        hits        = 0;
+    bool            ok          = true;
+
+    for ( uint64_t step = 1; step <= BENCH_STEPS && ok; step++ ) {
+        // a skewed stream, low notes come up far more often
+        uint32_t draw = bench_random( &state );
+        int      key  = (int) ( draw % BENCH_KEYS * ( ( draw >> 8 ) % BENCH_KEYS ) / BENCH_KEYS );
+        int      hold = ( draw >> 20 ) % 16 < 4 ? (int) ( ( draw >> 24 ) % 4 ) : -1;
+
+        uint64_t        before = cache.hits;
+        const NoteLoop *loop =
+          notecache_acquire( &cache, key + 20, WAVEFORM_SINE, 48000, SAMPLE_FORMAT_PCM16 );
+        bool hit  = model_acquire( &model, key, step );
+        ok        = loop && hit == ( cache.hits > before );
+        hits     += hit;
+
+        // some acquires are kept for a while, replacing one kept before
+        if ( hold >= 0 ) {
+            if ( held[hold] ) {
+                notecache_release( &cache, held[hold] );
+                model_release( &model, heldKeys[hold] );
+            }
+            held[hold]     = loop;
+            heldKeys[hold] = key;
+        } else {
+            notecache_release( &cache, loop );
+            model_release( &model, key );
+        }
+    }
+    printf( "%d acquires on %d slots, %.1f%% hits, %llu evictions, same as the model: %s\n",
+            BENCH_STEPS, BENCH_SLOTS, 100.0 * (double) hits / BENCH_STEPS,
+            (unsigned long long) cache.evictions, ok ? "yes" : "NO" );
+
+    // once every slot is held nothing can be evicted
+    for ( int h = 0; h < 4; h++ ) {
+        if ( held[h] ) notecache_release( &cache, held[h] );
+    }
+    const NoteLoop *all[BENCH_SLOTS];
+    for ( int i = 0; i < BENCH_SLOTS; i++ ) {
+        all[i] = notecache_acquire( &cache, 60 + i, WAVEFORM_SQUARE, 48000, SAMPLE_FORMAT_PCM16 );
+        ok     = ok && all[i];
+    }
+    bool full = !notecache_acquire( &cache, 90, WAVEFORM_SQUARE, 48000, SAMPLE_FORMAT_PCM16 );
+    printf( "a full cache of held loops refuses a new one: %s\n", full ? "yes" : "NO" );
+    notecache_destroy( &cache );
+    return ok && full;
+}
+
+/**********
+ * TIMING *
+ *********/
+// a note-on: get the loop and copy its first block
+static double note_on( NoteCache *cache, int note, BaseWaveform type, uint32_t rate,
+                       SampleFormat format ) {
+    static uint8_t  block[BENCH_BLOCK * 4];
+    uint32_t        position = 0;
+    double          start    = now_seconds();
+    const NoteLoop *loop     = notecache_acquire( cache, note, type, rate, format );
+    if ( loop ) notecache_play( loop, block, BENCH_BLOCK, &position );
+    double elapsed = now_seconds() - start;
+    if ( loop ) notecache_release( cache, loop );
+    return elapsed;
+}
+
+int main( void ) {
+    if ( wavetable_init_defaults() != SYNTH_ACK ) return 1;
+    NoteCache cache;
+    if ( notecache_init( &cache, BENCH_CAPACITY, NULL ) != SYNTH_ACK ) return 1;
+
+    bool ok = check_pitch( &cache );
+    ok      = check_lru() && ok;
+
+    // cold: nothing rendered yet; hot: the same note-ons again
+    notecache_destroy( &cache );
+    notecache_init( &cache, BENCH_CAPACITY, NULL );
+    double cold = 0.0, coldWorst = 0.0, hot = 0.0, hotWorst = 0.0;
+    int    count = 0;
+    for ( int pass = 0; pass < 2; pass++ ) {
+        for ( int w = 0; w < WAVEFORM_COUNT; w++ ) {
+            for ( int note = NOTA_MIN; note <= 100; note++ ) {
+                double t = note_on( &cache, note, (BaseWaveform) w, 48000, SAMPLE_FORMAT_PCM16 );
+                if ( pass == 0 ) {
+                    cold      += t;
+                    coldWorst  = fmax( coldWorst, t );
+                    count++;
+                } else {
+                    hot      += t;
+                    hotWorst  = fmax( hotWorst, t );
+                }
+            }
+        }
+    }
+    printf( "\nnote-on, loop and first %d frames at 48 kHz pcm16, %d notes\n", BENCH_BLOCK, count );
+    printf( "  cold  %8.2f us mean %8.2f us worst\n", cold / count * 1e6, coldWorst * 1e6 );
+    printf( "  hot   %8.2f us mean %8.2f us worst\n", hot / count * 1e6, hotWorst * 1e6 );
+
+    // warm every combination into the capped cache, the oldest going once it is full
+    size_t combos = 0, bytes = 0;
+    double start  = now_seconds();
+    for ( int f = 0; f < SAMPLE_FORMAT_COUNT; f++ ) {
+        for ( int r = 0; r < BENCH_RATES; r++ ) {
+            for ( int w = 0; w < WAVEFORM_COUNT; w++ ) {
+                int warmed  = notecache_warm( &cache, (BaseWaveform) w, bench_rates[r],
+                                              (SampleFormat) f );
+                combos     += (size_t) warmed;
+                bytes      += (size_t) warmed * NOTECACHE_SLOT_BYTES;
+            }
+        }
+    }
+    double warming = now_seconds() - start;
+    printf( "\nwarming %zu loops, %zu MB, through %u slots, %u MB: %.0f ms, %.1f us a loop, "
+            "%llu evicted\n",
+            combos, bytes >> 20, cache.numSlots, BENCH_CAPACITY >> 20, warming * 1e3,
+            warming / (double) combos * 1e6, (unsigned long long) cache.evictions );
+
+    notecache_destroy( &cache );
+    return ok ? 0 : 1;
+}
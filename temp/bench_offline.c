@@ -0,0 +1,118 @@
+// benchmark: offline render of MAX_VOICES voices to disk, realtime factor per output format
+//
+// usage: bench_offline [seconds] [directory]    defaults to 600 seconds in /tmp, 3600 for an hour
+// A fresh chord of MAX_VOICES notes replaces the last one every second. For comparison, the same
+// audio is also written the old way, as text CSV through fprintf, for a few seconds.
+//
+// build: gcc -O2 -Isrc temp/bench_offline.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "offline.h"
+
+#include <time.h>
+
+#define BENCH_CSV_SECONDS 10
+
+typedef struct {
+    int notes[MAX_VOICES];
+    int chord;
+} Score;
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// release the previous chord and start a new one on every second boundary inside the chunk
+static void score_chunk( void *user, Synthesizer *synth, uint64_t frame, uint32_t frames ) {
+    Score   *score = (Score *) user;
+    uint64_t next  = ( frame + SAMPLE_RATE - 1 ) / SAMPLE_RATE * SAMPLE_RATE;
+    for ( ; next < frame + frames; next += SAMPLE_RATE ) {
+        for ( int v = 0; v < MAX_VOICES; v++ ) {
+            if ( score->notes[v] >= 0 ) synth_release_note_at( synth, next, score->notes[v] );
+            synth->waveform = (BaseWaveform) ( v % WAVEFORM_COUNT );
+            float frequency = 55.0f * powf( 2.0f, (float) ( ( v + score->chord ) % 72 ) / 12.0f );
+            score->notes[v] = synth_trigger_note_at( synth, next, frequency, 1.0f / MAX_VOICES );
+        }
+        score->chord++;
+    }
+}
+
+static bool fresh_synth( Synthesizer *synth, Score *score ) {
+    if ( synth_init( synth, MAX_VOICES * 2, 1 ) != SYNTH_ACK ) return false;
+    for ( int v = 0; v < MAX_VOICES; v++ ) score->notes[v] = -1;
+    score->chord = 0;
+    return true;
+}
+
+int main( int argc, char **argv ) {
+    static const char *names[SAMPLE_FORMAT_COUNT] = { "pcm16", "pcm24", "pcm32", "float32" };
+    double             seconds = argc > 1 ? atof( argv[1] ) : 600.0;
+    const char        *dir     = argc > 2 ? argv[2] : "/tmp";
+    uint64_t           frames  = (uint64_t) ( seconds * SAMPLE_RATE );
+    char               path[512];
+
+    printf(
+      "%-8s %-7s %10s %10s %10s %8s\n", "format", "mode", "audio s", "render s", "MB/s", "x rt"
+    );
+    for ( int f = 0; f < SAMPLE_FORMAT_COUNT; f++ ) {
+        for ( int direct = 0; direct < 2; direct++ ) {
+            Synthesizer      synth;
+            Score            score;
+            AudioFileWriter  writer;
+            OfflineStats     stats;
+            AudioFileOptions options = {
+                .format     = (SampleFormat) f,
+                .channels   = 1,
+                .sampleRate = SAMPLE_RATE,
+                .direct     = direct,
+            };
+
+            if ( !fresh_synth( &synth, &score ) ) return 1;
+            snprintf( path, sizeof( path ), "%s/bench_offline_%s.wav", dir, names[f] );
+            if ( audio_file_open( &writer, path, &options ) != SYNTH_ACK ) {
+                printf( "cannot create %s\n", path );
+                return 1;
+            }
+            SynthError err =
+              synth_render_offline( &synth, &writer, frames, score_chunk, &score, &stats );
+            if ( audio_file_close( &writer ) != SYNTH_ACK || err != SYNTH_ACK ) {
+                printf( "write to %s failed\n", path );
+                return 1;
+            }
+            printf(
+              "%-8s %-7s %10.0f %10.2f %10.1f %8.0f\n", names[f], direct ? "direct" : "cached",
+              stats.audioSeconds, stats.renderSeconds,
+              (double) stats.bytes / stats.renderSeconds / 1e6, stats.realtimeFactor
+            );
+            arena_destroy( &synth.arena );
+        }
+    }
+
+    // the old path: one fprintf per sample into a CSV
+    Synthesizer synth;
+    Score       score;
+    float       chunk[OFFLINE_CHUNK_FRAMES];
+    if ( !fresh_synth( &synth, &score ) ) return 1;
+    snprintf( path, sizeof( path ), "%s/bench_offline.csv", dir );
+    FILE *csv = fopen( path, "w" );
+    if ( !csv ) return 1;
+    double   start = now_seconds();
+    uint64_t total = (uint64_t) BENCH_CSV_SECONDS * SAMPLE_RATE;
+    for ( uint64_t done = 0; done < total; done += OFFLINE_CHUNK_FRAMES ) {
+        score_chunk( &score, &synth, synth.frame, OFFLINE_CHUNK_FRAMES );
+        synth_process_buffer( &synth, chunk, OFFLINE_CHUNK_FRAMES );
+        for ( int i = 0; i < OFFLINE_CHUNK_FRAMES; i++ ) {
+            fprintf( csv, "%llu,%f\n", (unsigned long long) ( done + i ), chunk[i] );
+        }
+    }
+    double elapsed = now_seconds() - start;
+    printf(
+      "%-8s %-7s %10d %10.2f %10.1f %8.0f\n", "csv", "fprintf", BENCH_CSV_SECONDS, elapsed,
+      (double) ftell( csv ) / elapsed / 1e6, BENCH_CSV_SECONDS / elapsed
+    );
+    fclose( csv );
+    arena_destroy( &synth.arena );
+    return 0;
+}
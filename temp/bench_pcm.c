@@ -0,0 +1,111 @@
+// benchmark: float to PCM conversion per kernel, format and channel spread, in GB/s written
+//
+// Each kernel is timed without dither, the NULL path, and with it. Every kernel has to write the
+// same bytes as the scalar one either way, and the integer formats must saturate instead of
+// wrapping on out of range input. The naive row is the old platform loop, (short)(x * 32767) with
+// no clipping, no dither and no interleaving, to compare with the undithered column.
+//
+// build: gcc -O2 -Isrc temp/bench_pcm.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "render.h"
+
+#include <time.h>
+
+#define BENCH_SAMPLES ( 1 << 16 )       // source samples per call, a second and a half of audio
+#define BENCH_BYTES   ( 64u << 20 )     // bytes written per run
+#define BENCH_REPEATS 5                  // runs per measurement, the fastest is kept
+
+static const char    *kernel_names[] = { "scalar", "sse2", "avx2" };
+static const char    *format_names[] = { "pcm16", "pcm24", "pcm32", "float32" };
+static const uint32_t spreads[]      = { 1, 2 };
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// best rate of BENCH_REPEATS runs, the machine is rarely quiet for all of them
+static double time_kernel(
+  PcmKernel convert, const float *input, uint8_t *output, size_t bytes, uint32_t spread,
+  PcmDither *dither
+) {
+    uint32_t calls = (uint32_t) ( BENCH_BYTES / bytes );
+    double   best  = 0.0;
+    for ( int r = 0; r < BENCH_REPEATS; r++ ) {
+        double start = now_seconds();
+        for ( uint32_t c = 0; c < calls; c++ ) {
+            convert( output, input, BENCH_SAMPLES, spread, dither );
+        }
+        best = fmax( best, (double) bytes * calls / ( now_seconds() - start ) * 1e-9 );
+    }
+    return best;
+}
+
+static void naive_s16( short *out, const float *in, uint32_t count ) {
+    for ( uint32_t i = 0; i < count; i++ ) out[i] = (short) ( in[i] * 32767.0f );
+}
+
+int main( void ) {
+    static float   input[BENCH_SAMPLES];
+    static uint8_t reference[BENCH_SAMPLES * 2 * 4];
+    static uint8_t plain[BENCH_SAMPLES * 2 * 4];
+    static uint8_t output[BENCH_SAMPLES * 2 * 4];
+
+    // a loud sine that clips now and then, plus values right at the edges
+    for ( uint32_t i = 0; i < BENCH_SAMPLES; i++ ) {
+        input[i] = 1.2f * sinf( (float) i * 0.013f );
+    }
+    input[0] = 1.0f, input[1] = -1.0f, input[2] = 0.0f, input[3] = 1e9f, input[4] = -1e9f;
+
+    printf( "%-8s %-8s %-7s %10s %10s %8s\n", "format", "kernel", "spread", "GB/s", "dithered",
+            "match" );
+    for ( int f = 0; f < SAMPLE_FORMAT_COUNT; f++ ) {
+        for ( size_t s = 0; s < sizeof( spreads ) / sizeof( *spreads ); s++ ) {
+            uint32_t spread = spreads[s];
+            size_t   bytes  = (size_t) BENCH_SAMPLES * spread * sample_format_bytes( f );
+            for ( size_t k = 0; k < sizeof( kernel_names ) / sizeof( *kernel_names ); k++ ) {
+                const RenderKernels *kernels = render_get_kernels( kernel_names[k] );
+                if ( !kernels ) continue;
+                PcmKernel convert = kernels->pcm[f];
+
+                // same seed and position as the reference, so the dither has to match too
+                PcmDither dither = { 0x5eed, 0 };
+                convert( k ? output : reference, input, BENCH_SAMPLES, spread, &dither );
+                bool match = k == 0 || memcmp( output, reference, bytes ) == 0;
+                convert( k ? output : plain, input, BENCH_SAMPLES, spread, NULL );
+                match = match && ( k == 0 || memcmp( output, plain, bytes ) == 0 );
+
+                double plainRate  = time_kernel( convert, input, output, bytes, spread, NULL );
+                double ditherRate = time_kernel( convert, input, output, bytes, spread, &dither );
+                printf( "%-8s %-8s %-7u %10.2f %10.2f %8s\n", format_names[f], kernel_names[k],
+                        spread, plainRate, ditherRate, match ? "exact" : "DIFFERS" );
+                if ( !match ) return 1;
+            }
+        }
+    }
+
+    // the conversion this replaces, for scale
+    uint32_t calls = BENCH_BYTES / ( BENCH_SAMPLES * 2 );
+    double   naive = 0.0;
+    for ( int r = 0; r < BENCH_REPEATS; r++ ) {
+        double start = now_seconds();
+        for ( uint32_t c = 0; c < calls; c++ ) {
+            naive_s16( (short *) output, input, BENCH_SAMPLES );
+            __asm__ volatile( "" ::: "memory" );    // keep the stores from being folded away
+        }
+        double rate = (double) BENCH_SAMPLES * 2 * calls / ( now_seconds() - start ) * 1e-9;
+        naive       = fmax( naive, rate );
+    }
+    printf( "%-8s %-8s %-7u %10.2f %10s %8s\n", "pcm16", "naive", 1, naive, "-", "-" );
+
+    // saturation, not wrap around, at both ends; -1 scales to -32767, like +1 to 32767
+    const RenderKernels *best = render_select_kernels();
+    int16_t              s16[8];
+    int32_t              s32[8];
+    best->pcm[SAMPLE_FORMAT_PCM16]( s16, input + 3, 2, 1, NULL );
+    best->pcm[SAMPLE_FORMAT_PCM32]( s32, input + 3, 2, 1, NULL );
+    printf( "saturate pcm16 %d %d, pcm32 %d %d\n", s16[0], s16[1], s32[0], s32[1] );
+    return s16[0] == 32767 && s16[1] == -32767 && s32[0] > 0 && s32[1] == INT32_MIN ? 0 : 1;
+}
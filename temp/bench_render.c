@@ -0,0 +1,77 @@
+// benchmark: cost of mixing MAX_VOICES voices in SYNTH_BLOCK_SIZE blocks, per render kernel
+//
+// build: gcc -O2 -Isrc temp/bench_render.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "render.h"
+#include "synth.h"
+#include "wavetable.h"
+
+#include <time.h>
+
+#define BENCH_SECONDS 10    // seconds of audio rendered per kernel
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+int main( void ) {
+    static const char *names[] = { "scalar", "sse2", "avx2" };
+    static float       reference[SAMPLE_RATE];
+    static float       buffer[SAMPLE_RATE];
+    Synthesizer        synth;
+
+    if ( synth_init( &synth, MAX_VOICES, 1 ) != SYNTH_ACK ) {
+        printf( "failed to initialize synth\n" );
+        return 1;
+    }
+
+    printf( "%-8s %10s %12s\n", "kernel", "cpu load", "max error" );
+    for ( int k = 0; k < 3; k++ ) {
+        const RenderKernels *kernels = render_get_kernels( names[k] );
+        if ( !kernels ) {
+            printf( "%-8s %10s\n", names[k], "n/a" );
+            continue;
+        }
+        synth.kernels = kernels;
+
+        // spread voices over the keyboard and all base waveforms
+        synth_silence( &synth );
+        for ( int v = 0; v < MAX_VOICES; v++ ) {
+            synth.waveform = (BaseWaveform) ( v % WAVEFORM_COUNT );
+            float frequency = 55.0f * powf( 2.0f, (float) v / 12.0f );
+            synth_trigger_note( &synth, frequency, 1.0f / MAX_VOICES );
+        }
+
+        // first second doubles as a correctness check against the scalar kernel
+        synth_process_buffer( &synth, buffer, SAMPLE_RATE );
+        float error = 0.0f;
+        for ( int i = 0; i < SAMPLE_RATE; i++ ) {
+            if ( k == 0 ) reference[i] = buffer[i];
+            error = fmaxf( error, fabsf( buffer[i] - reference[i] ) );
+        }
+
+        double start = now_seconds();
+        for ( int s = 0; s < BENCH_SECONDS; s++ ) {
+            for ( int offset = 0; offset < SAMPLE_RATE; offset += SYNTH_BLOCK_SIZE ) {
+                int length = SAMPLE_RATE - offset < SYNTH_BLOCK_SIZE ? SAMPLE_RATE - offset
+                                                                     : SYNTH_BLOCK_SIZE;
+                synth_process_buffer( &synth, buffer + offset, length );
+            }
+        }
+        double load = ( now_seconds() - start ) / BENCH_SECONDS;
+        printf( "%-8s %9.2f%% %12g\n", kernels->name, load * 100.0, error );
+    }
+
+    // high-water marks, for sizing SYNTH_ARENA_SIZE and SYNTH_SCRATCH_SIZE
+    ArenaStats arena, scratch;
+    arena_stats( &synth.arena, &arena );
+    arena_stats( &synth.scratch, &scratch );
+    printf(
+      "arena peak %zu of %zu bytes, scratch peak %zu of %zu bytes\n", arena.peak, arena.size,
+      scratch.peak, scratch.size
+    );
+    return 0;
+}
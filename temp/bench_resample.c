@@ -0,0 +1,214 @@
+// benchmark: polyphase resampler per quality preset, rate pair and FIR kernel
+//
+// For every preset the filter bank is checked against its spec: the prototype's response is
+// evaluated across the stopband for the attenuation actually reached and across the passband for
+// the ripple. A 1 kHz tone is then streamed through resampler_pull() in uneven pieces and fitted
+// with a sine at the output rate; what the fit leaves over is the noise and distortion the
+// streaming adds. Last, the cost per output sample of each kernel, and a full synth rendered at
+// 96 kHz against one rendered at 48 kHz and upsampled.
+//
+// build: gcc -O2 -Isrc temp/bench_resample.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "resample.h"
+
+#include <time.h>
+
+#define BENCH_SECONDS 2         // seconds of output per timing run
+#define BENCH_TONE    1000.0    // Hz, fitted after the resampler
+#define BENCH_GRID    2000      // frequencies the response is evaluated at per band
+#define BENCH_PI      3.14159265358979323846
+
+typedef struct {
+    uint32_t in;
+    uint32_t out;
+} RatePair;
+
+static const RatePair pairs[] = {
+  { 48000, 96000 }, { 44100, 48000 }, { 96000, 48000 }, { 176400, 44100 }
+};
+
+static const char *const quality_names[] = { "fast", "standard", "high", "best" };
+static const char *const kernel_names[]  = { "scalar", "sse2", "avx2" };
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// prototype magnitude at f Hz, rebuilt from the phase rows
+static double response( const Resampler *resampler, double f ) {
+    const FirBank *bank  = &resampler->bank;
+    double         omega = 2.0 * BENCH_PI * f / ( (double) resampler->inRate * bank->phases );
+    double         cr = cos( omega ), ci = -sin( omega ), pr = 1.0, pi = 0.0, re = 0.0, im = 0.0;
+    for ( uint32_t j = 0; j < bank->taps; j++ ) {
+        for ( uint32_t p = 0; p < bank->phases; p++ ) {
+            double h  = bank->coeffs[(size_t) p * bank->taps + bank->taps - 1 - j];
+            re       += h * pr;
+            im       += h * pi;
+            double t  = pr * cr - pi * ci;
+            pi        = pr * ci + pi * cr;
+            pr        = t;
+        }
+    }
+    return sqrt( re * re + im * im );
+}
+
+// ResampleSource: a sine at the input rate
+typedef struct {
+    double   step;
+    uint64_t n;
+} Tone;
+
+static void tone_source( void *user, float *buffer, uint32_t frames ) {
+    Tone *tone = (Tone *) user;
+    for ( uint32_t i = 0; i < frames; i++ ) {
+        buffer[i] = 0.5f * (float) sin( tone->step * (double) tone->n++ );
+    }
+}
+
+// ResampleSource: the same block of input over and over, so the timing is the resampler's
+static void block_source( void *user, float *buffer, uint32_t frames ) {
+    memcpy( buffer, user, sizeof( float ) * frames );
+}
+
+// least squares fit of a sine at a known frequency, returns the residual in dB below the fit
+static double fit_residual( const float *y, uint32_t count, double step ) {
+    double ss = 0, cc = 0, sc = 0, ys = 0, yc = 0;
+    for ( uint32_t i = 0; i < count; i++ ) {
+        double s = sin( step * i ), c = cos( step * i );
+        ss += s * s, cc += c * c, sc += s * c, ys += y[i] * s, yc += y[i] * c;
+    }
+    double det = ss * cc - sc * sc;
+    double a = ( ys * cc - yc * sc ) / det, b = ( yc * ss - ys * sc ) / det;
+    double signal = 0, noise = 0;
+    for ( uint32_t i = 0; i < count; i++ ) {
+        double fit  = a * sin( step * i ) + b * cos( step * i );
+        signal     += fit * fit;
+        noise      += ( y[i] - fit ) * ( y[i] - fit );
+    }
+    return 10.0 * log10( noise / signal );
+}
+
+static void check_quality( Resampler *resampler, const char *name, const RatePair *pair ) {
+    // stopband: everything the zero-stuffed rate can hold above the lower Nyquist frequency
+    double top   = 0.5 * resampler->inRate * resampler->bank.phases;
+    double dc    = response( resampler, 0.0 );
+    double worst = 0.0, ripple = 0.0;
+    for ( int g = 0; g <= BENCH_GRID; g++ ) {
+        double stop = resampler->stopband + ( top - resampler->stopband ) * g / BENCH_GRID;
+        double pass = resampler->passband * g / BENCH_GRID;
+        double m    = response( resampler, stop ) / dc;
+        double q    = fabs( 20.0 * log10( response( resampler, pass ) / dc ) );
+        if ( m > worst ) worst = m;
+        if ( q > ripple ) ripple = q;
+    }
+
+    // a tone streamed in uneven pieces, skipping the filter's run-in
+    static float out[1 << 16];
+    Tone         tone  = { 2.0 * BENCH_PI * BENCH_TONE / pair->in, 0 };
+    uint32_t     skip  = (uint32_t) resampler->latency * 2 + 64, done = 0, piece = 1;
+    resampler_reset( resampler );
+    while ( done < skip ) {
+        uint32_t n = skip - done < piece ? skip - done : piece;
+        resampler_pull( resampler, out, n, tone_source, &tone );
+        done  += n;
+        piece  = piece * 3 % 997 + 1;
+    }
+    for ( done = 0; done < sizeof( out ) / sizeof( *out ); ) {
+        uint32_t n = (uint32_t) ( sizeof( out ) / sizeof( *out ) ) - done;
+        n          = n < piece ? n : piece;
+        resampler_pull( resampler, out + done, n, tone_source, &tone );
+        done  += n;
+        piece  = piece * 3 % 997 + 1;
+    }
+    double noise = fit_residual( out, done, 2.0 * BENCH_PI * BENCH_TONE / pair->out );
+
+    printf( "%-9s %6u>%-6u %5u %5u %9.0f %9.1f %9.4f %9.1f %8.1f\n", name, pair->in, pair->out,
+            resampler->bank.taps, resampler->bank.phases, resampler->passband,
+            -20.0 * log10( worst ), ripple, noise, resampler->latency );
+}
+
+static void time_kernels( Resampler *resampler, const char *name, const RatePair *pair ) {
+    static float out[4096], in[RESAMPLE_BLOCK];
+    for ( int i = 0; i < RESAMPLE_BLOCK; i++ ) in[i] = 0.5f * sinf( 0.01f * (float) i );
+    printf( "%-9s %6u>%-6u", name, pair->in, pair->out );
+    for ( size_t k = 0; k < sizeof( kernel_names ) / sizeof( *kernel_names ); k++ ) {
+        const RenderKernels *kernels = render_get_kernels( kernel_names[k] );
+        if ( !kernels ) {
+            printf( " %10s", "n/a" );
+            continue;
+        }
+        resampler->fir = kernels->fir;
+        uint64_t total = (uint64_t) pair->out * BENCH_SECONDS;
+        double   start = now_seconds();
+        for ( uint64_t done = 0; done < total; done += 4096 ) {
+            resampler_pull( resampler, out, 4096, block_source, in );
+        }
+        double elapsed = now_seconds() - start;
+        printf( " %10.2f", elapsed * 1e9 / (double) total );
+    }
+    printf( "\n" );
+    resampler->fir = render_select_kernels()->fir;
+}
+
+// best time for a second of output at 96 kHz, rendered natively or at 48 kHz and upsampled
+static double time_synth( uint32_t renderRate, ResampleQuality quality ) {
+    static float buffer[256];
+    Synthesizer  synth;
+    if ( synth_init( &synth, MAX_VOICES, 1 ) != SYNTH_ACK ) return 0.0;
+    synth_set_sample_rate( &synth, renderRate, 96000, quality );
+    for ( int v = 0; v < MAX_VOICES; v++ ) {
+        synth.waveform = (BaseWaveform) ( v % WAVEFORM_COUNT );
+        synth_trigger_pitch_at( &synth, 0, 36.0f + (float) v, 1.0f / MAX_VOICES );
+    }
+    double best = 1e9;
+    for ( int run = 0; run < 3; run++ ) {
+        double start = now_seconds();
+        for ( int n = 0; n < 96000; n += 256 ) synth_process_buffer( &synth, buffer, 256 );
+        double elapsed = now_seconds() - start;
+        if ( elapsed < best ) best = elapsed;
+    }
+    synth_set_sample_rate( &synth, SAMPLE_RATE, SAMPLE_RATE, quality );
+    arena_destroy( &synth.arena );
+    return best;
+}
+
+int main( void ) {
+    Resampler resamplers[RESAMPLE_QUALITY_COUNT][sizeof( pairs ) / sizeof( *pairs )];
+
+    printf( "%-9s %13s %5s %5s %9s %9s %9s %9s %8s\n", "quality", "rates", "taps", "L",
+            "pass Hz", "stop dB", "ripple", "tone dB", "latency" );
+    for ( int q = 0; q < RESAMPLE_QUALITY_COUNT; q++ ) {
+        for ( size_t p = 0; p < sizeof( pairs ) / sizeof( *pairs ); p++ ) {
+            if ( resampler_init( &resamplers[q][p], pairs[p].in, pairs[p].out, q ) != SYNTH_ACK ) {
+                printf( "cannot make a %s resampler for %u>%u\n", quality_names[q], pairs[p].in,
+                        pairs[p].out );
+                return 1;
+            }
+            check_quality( &resamplers[q][p], quality_names[q], &pairs[p] );
+        }
+    }
+
+    printf( "\nns per output sample\n%-9s %13s", "quality", "rates" );
+    for ( size_t k = 0; k < sizeof( kernel_names ) / sizeof( *kernel_names ); k++ ) {
+        printf( " %10s", kernel_names[k] );
+    }
+    printf( "\n" );
+    for ( int q = 0; q < RESAMPLE_QUALITY_COUNT; q++ ) {
+        for ( size_t p = 0; p < sizeof( pairs ) / sizeof( *pairs ); p++ ) {
+            time_kernels( &resamplers[q][p], quality_names[q], &pairs[p] );
+            resampler_destroy( &resamplers[q][p] );
+        }
+    }
+
+    printf( "\n%d voices, one second at 96 kHz\n", MAX_VOICES );
+    printf( "%-26s %8.2f ms\n", "rendered at 96 kHz", time_synth( 96000, 0 ) * 1e3 );
+    for ( int q = 0; q < RESAMPLE_QUALITY_COUNT; q++ ) {
+        char label[64];
+        snprintf( label, sizeof( label ), "48 kHz + %s upsample", quality_names[q] );
+        printf( "%-26s %8.2f ms\n", label, time_synth( 48000, q ) * 1e3 );
+    }
+    return 0;
+}
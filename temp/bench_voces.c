@@ -0,0 +1,226 @@
+// benchmark: streaming chord voicing search with pruning, serial and threaded
+//
+// A brute force pass puts every pitch class of the chord on every key it has, sorts the keys and
+// tests the limits afterwards. chorda_voces_quaere() must find exactly as many voicings for every
+// set of limits, on one thread in ascending order and on several threads in the same number. Then
+// voicings per second for a 13th chord over the whole keyboard, 0 to 127, with and without
+// pruning, on one thread and on every core.
+//
+// usage: ./a.out [threads], without it as many as there are cores
+//
+// build: gcc -O2 -Isrc temp/bench_voces.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "music.h"
+#include "synth.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_THREADS_MAX 16
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/***************
+ * BRUTE FORCE *
+ **************/
+typedef struct {
+    const VocesLimites *limits;
+    int                 tones[MAX_CHORD_NOTES];    // pitch classes, in the chord's order
+    int                 count;
+    int                 keys[MAX_CHORD_NOTES];
+    uint64_t            found;
+} BruteForce;
+
+static int key_nome( int key ) { return ( key + A ) % DIAPASON; }
+
+static int nearest_motion( const VocesLimites *limits, int key ) {
+    int nearest = limits->numPrevious > 0 ? 1 << 30 : 0;
+    for ( int i = 0; i < limits->numPrevious; i++ ) {
+        int moved = abs( key - nota_to_indice( &limits->previous[i] ) );
+        if ( moved < nearest ) nearest = moved;
+    }
+    return nearest;
+}
+
+static void brute_check( BruteForce *b ) {
+    const VocesLimites *l = b->limits;
+    int                 sorted[MAX_CHORD_NOTES], bass = 0, motion = 0;
+    for ( int i = 0; i < b->count; i++ ) {
+        sorted[i] = b->keys[i];
+        if ( b->keys[i] < b->keys[bass] ) bass = i;
+        motion += nearest_motion( l, b->keys[i] );
+    }
+    for ( int i = 1; i < b->count; i++ ) {
+        for ( int j = i; j > 0 && sorted[j] < sorted[j - 1]; j-- ) {
+            int t         = sorted[j];
+            sorted[j]     = sorted[j - 1];
+            sorted[j - 1] = t;
+        }
+    }
+    if ( l->basses && !( l->basses >> bass & 1 ) ) return;
+    if ( l->maxSpan && sorted[b->count - 1] - sorted[0] > l->maxSpan ) return;
+    if ( l->maxMotion && motion > l->maxMotion ) return;
+    for ( int i = 1; i < b->count; i++ ) {
+        int gap = i == 1 ? l->maxBassSpacing : l->maxSpacing;
+        if ( gap && sorted[i] - sorted[i - 1] > gap ) return;
+    }
+    b->found++;
+}
+
+static void brute_place( BruteForce *b, int tone ) {
+    if ( tone == b->count ) {
+        brute_check( b );
+        return;
+    }
+    int high = b->limits->high ? b->limits->high : NOTA_MAX;
+    for ( int key = b->limits->low; key <= high; key++ ) {
+        if ( key_nome( key ) != b->tones[tone] ) continue;
+        b->keys[tone] = key;
+        brute_place( b, tone + 1 );
+    }
+}
+
+static uint64_t brute_force( const Chorda *chord, const VocesLimites *limits ) {
+    BruteForce b = { limits, { 0 }, chord->num_notes, { 0 }, 0 };
+    for ( int i = 0; i < chord->num_notes; i++ ) b.tones[i] = chord->notas[i].nome;
+    brute_place( &b, 0 );
+    return b.found;
+}
+
+/*************
+ * CALLBACKS *
+ ************/
+typedef struct {
+    int      last[MAX_CHORD_NOTES];    // previous voicing, to check the serial order
+    bool     ordered;
+    bool     valid;
+    uint64_t sums[BENCH_THREADS_MAX];    // per thread, so threads share no cache line
+} Check;
+
+static bool check_voicing( void *user, uint32_t thread, const Chorda *voicing, int motion ) {
+    Check *check = (Check *) user;
+    int    keys[MAX_CHORD_NOTES];
+    for ( int i = 0; i < voicing->num_notes; i++ ) {
+        keys[i] = nota_to_indice( &voicing->notas[i] );
+        if ( i > 0 && keys[i] <= keys[i - 1] ) check->valid = false;
+    }
+    if ( thread == 0 ) {
+        int cmp = 0;
+        for ( int i = 0; i < voicing->num_notes && cmp == 0; i++ ) {
+            cmp = keys[i] - check->last[i];
+        }
+        if ( cmp <= 0 ) check->ordered = false;
+        for ( int i = 0; i < voicing->num_notes; i++ ) check->last[i] = keys[i];
+    }
+    check->sums[thread] += (uint64_t) motion;
+    return true;
+}
+
+static bool count_voicing( void *user, uint32_t thread, const Chorda *voicing, int motion ) {
+    uint64_t *sums  = (uint64_t *) user;
+    sums[thread * 8] += (uint64_t) voicing->notas[voicing->num_notes - 1].nome + (uint64_t) motion;
+    return true;
+}
+
+/**********
+ * CHECKS *
+ *********/
+static bool check_limits(
+  const char *name, const Chorda *chord, VocesLimites limits, uint32_t threads
+) {
+    Check check = { { -1, -1, -1, -1, -1, -1, -1 }, true, true, { 0 } };
+    limits.threads = 1;
+    uint64_t serial   = chorda_voces_quaere( chord, &limits, check_voicing, &check );
+    limits.threads    = threads;
+    Check    parallel = { { 0 }, true, true, { 0 } };
+    uint64_t found    = chorda_voces_quaere( chord, &limits, check_voicing, &parallel );
+    uint64_t expected = brute_force( chord, &limits );
+    uint64_t motion   = 0;
+    for ( int t = 0; t < BENCH_THREADS_MAX; t++ ) motion += parallel.sums[t];
+    bool ok = serial == expected && found == expected && check.ordered && check.valid &&
+              parallel.valid && motion == check.sums[0];
+    printf( "  %-40s %10llu voicings %s\n", name, (unsigned long long) found, ok ? "ok" : "WRONG" );
+    return ok;
+}
+
+/**********
+ * TIMING *
+ *********/
+static double time_search( const Chorda *chord, VocesLimites limits, uint32_t threads,
+                           uint64_t *found ) {
+    static uint64_t sums[BENCH_THREADS_MAX * 8];    // a cache line per thread
+    limits.threads = threads;
+    double start   = now_seconds();
+    *found         = chorda_voces_quaere( chord, &limits, count_voicing, sums );
+    return now_seconds() - start;
+}
+
+int main( int argc, char **argv ) {
+    long     cores   = sysconf( _SC_NPROCESSORS_ONLN );
+    uint32_t threads = argc > 1 ? (uint32_t) atoi( argv[1] ) : (uint32_t) ( cores > 0 ? cores : 1 );
+    threads          = CLAMP( threads, 1u, (uint32_t) BENCH_THREADS_MAX );
+
+    Nota   root = { C, 4 }, previousRoot = { A, 3 };
+    Chorda thirteenth, seventh, previous;
+    generate_chorda( &root, MAJOR, THIRTEENTH, &thirteenth );
+    generate_chorda( &root, MINOR, SEVENTH, &seventh );
+    generate_chorda( &previousRoot, MINOR, NINTH, &previous );
+
+    VocesLimites whole   = { 0 };
+    VocesLimites spaced  = { .low = 15, .high = 75, .maxSpan = 36, .maxSpacing = 12,
+                             .maxBassSpacing = 19 };
+    VocesLimites basses  = spaced;
+    basses.basses        = 0x3;
+    VocesLimites leading = spaced;
+    leading.previous     = previous.notas;
+    leading.numPrevious  = previous.num_notes;
+    leading.maxMotion    = 12;
+
+    bool ok = true;
+    printf( "m7 against brute force, %u threads\n", threads );
+    ok = check_limits( "whole keyboard", &seventh, whole, threads ) && ok;
+    ok = check_limits( "spacing, span and range", &seventh, spaced, threads ) && ok;
+    ok = check_limits( "voice leading", &seventh, leading, threads ) && ok;
+    printf( "13 against brute force, %u threads\n", threads );
+    ok = check_limits( "whole keyboard", &thirteenth, whole, threads ) && ok;
+    ok = check_limits( "spacing, span and range", &thirteenth, spaced, threads ) && ok;
+    ok = check_limits( "root or third in the bass", &thirteenth, basses, threads ) && ok;
+    ok = check_limits( "voice leading", &thirteenth, leading, threads ) && ok;
+
+    Chorda voces[64];
+    int    count = 64;
+    chorda_voces( &seventh, voces, &count );
+    ok = ok && count == 64;
+    printf( "chorda_voces fills its array: %s\n", count == 64 ? "yes" : "NO" );
+
+    printf( "\n13th chord, keys 0 to 127        voicings  1 thread Mv/s  %2u threads Mv/s\n",
+            threads );
+    const struct {
+        const char   *name;
+        VocesLimites *limits;
+    } rows[] = {
+      { "whole keyboard", &whole },
+      { "spacing 12, span 36", &spaced },
+      { "voice leading within 12", &leading },
+    };
+    for ( size_t r = 0; r < sizeof( rows ) / sizeof( rows[0] ); r++ ) {
+        VocesLimites limits = *rows[r].limits;
+        limits.low          = 0;
+        limits.high         = NOTA_MAX;
+        uint64_t found, again;
+        double   serial   = time_search( &thirteenth, limits, 1, &found );
+        double   parallel = time_search( &thirteenth, limits, threads, &again );
+        ok                = ok && found == again;
+        printf( "%-28s %12llu %16.1f %16.1f   %.2f ms\n", rows[r].name, (unsigned long long) found,
+                (double) found / serial * 1e-6, (double) found / parallel * 1e-6,
+                parallel * 1e3 );
+    }
+    return ok ? 0 : 1;
+}
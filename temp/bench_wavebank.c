@@ -0,0 +1,221 @@
+// benchmark: startup from a memory mapped waveform bank against parsing CSV dumps
+//
+// Writes a bank of BENCH_ENTRIES float32 octave table sets, blends of the base waveforms, some
+// 300 MB. Opening it is timed with its pages dropped from the page cache and again with them
+// cached, then a lookup of every name, registering a registry's worth of waveforms and the first
+// block of a note from a table that was never read. The same samples as CSV text in the layout of
+// temp/sin.c are parsed for a slice of the bank, and the time to parse all of it is extrapolated
+// from that. Last, the bank must verify, a changed sample must fail wavebank_verify() and a
+// changed index entry must fail wavebank_open().
+//
+// usage: bench_wavebank [directory]    (default /tmp, needs room for the bank)
+//
+// build: gcc -O2 -Isrc temp/bench_wavebank.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "wavebank.h"
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_ENTRIES 3328    // about 300 MB of octave tables
+#define BENCH_SLICE   16      // entries written and parsed as CSV
+#define BENCH_REPEATS 7       // timings per figure, the fastest is kept
+#define BENCH_BLOCK   256
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// entry n blends two base waveforms in a proportion of its own
+static void bench_blend( int n, float *out ) {
+    BaseWaveform from = (BaseWaveform) ( n % WAVEFORM_COUNT );
+    BaseWaveform to   = (BaseWaveform) ( n / WAVEFORM_COUNT % WAVEFORM_COUNT );
+    const float *a    = wavetable_get( from )->samples;
+    const float *b    = wavetable_get( to )->samples;
+    float        t    = (float) ( n % 97 ) / 96.0f;
+    for ( int i = 0; i < WAVEBANK_TABLES; i++ ) out[i] = a[i] + ( b[i] - a[i] ) * t;
+}
+
+// evicts a file from the page cache, as if the machine had just started
+static void bench_drop( const char *path ) {
+    int fd = open( path, O_RDONLY );
+    if ( fd < 0 ) return;
+    fdatasync( fd );
+    posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+    close( fd );
+}
+
+static double bench_open( const char *path, bool cold ) {
+    double best = 1e9;
+    for ( int repeat = 0; repeat < BENCH_REPEATS; repeat++ ) {
+        WaveBank bank;
+        if ( cold ) bench_drop( path );
+        double     start = now_seconds();
+        SynthError err   = wavebank_open( &bank, path );
+        best             = fmin( best, now_seconds() - start );
+        if ( err != SYNTH_ACK ) return -1.0;
+        wavebank_close( &bank );
+    }
+    return best;
+}
+
+// time,amplitude lines the way temp/sin.c writes them, parsed back with fgets and strtol
+static double bench_csv( const char *path, float *table, size_t *bytes ) {
+    FILE *csv = fopen( path, "w" );
+    if ( !csv ) return -1.0;
+    fprintf( csv, "time,amplitude\n" );
+    for ( int n = 0; n < BENCH_SLICE; n++ ) {
+        bench_blend( n, table );
+        for ( int i = 0; i < WAVEBANK_TABLES; i++ ) {
+            fprintf( csv, "%f,%d\n", (float) i / 44100.0f, (int) lrintf( table[i] * 32767.0f ) );
+        }
+    }
+    *bytes = (size_t) ftell( csv );
+    fclose( csv );
+
+    double best = 1e9;
+    for ( int repeat = 0; repeat < BENCH_REPEATS; repeat++ ) {
+        char   line[128];
+        long   sum   = 0;
+        FILE  *in    = fopen( path, "r" );
+        double start = now_seconds();
+        while ( in && fgets( line, sizeof( line ), in ) ) {
+            char *comma = strchr( line, ',' );
+            if ( comma ) sum += strtol( comma + 1, NULL, 10 );
+        }
+        best = fmin( best, now_seconds() - start );
+        if ( in ) fclose( in );
+        if ( sum == 1 ) printf( " " );    // keeps the parse
+    }
+    return best;
+}
+
+// flips one bit of a file in place
+static void bench_flip( const char *path, uint64_t offset ) {
+    int     fd   = open( path, O_RDWR );
+    uint8_t byte = 0;
+    if ( fd < 0 ) return;
+    if ( pread( fd, &byte, 1, (off_t) offset ) == 1 ) {
+        byte ^= 0x10;
+        if ( pwrite( fd, &byte, 1, (off_t) offset ) != 1 ) printf( "flip failed\n" );
+    }
+    close( fd );
+}
+
+int main( int argc, char **argv ) {
+    const char *dir = argc > 1 ? argv[1] : "/tmp";
+    char        path[512], csvPath[512];
+    snprintf( path, sizeof( path ), "%s/bench_wavebank.bank", dir );
+    snprintf( csvPath, sizeof( csvPath ), "%s/bench_wavebank.csv", dir );
+    if ( wavetable_init_defaults() != SYNTH_ACK ) return 1;
+    float *table = (float *) malloc( sizeof( float ) * WAVEBANK_TABLES );
+    if ( !table ) return 1;
+    bool ok = sizeof( WaveBankHeader ) == WAVEBANK_ALIGN && sizeof( WaveBankEntry ) == 64;
+
+    WaveBankWriter writer;
+    double         start = now_seconds();
+    if ( wavebank_writer_open( &writer, path ) != SYNTH_ACK ) return 1;
+    for ( int n = 0; n < BENCH_ENTRIES; n++ ) {
+        char name[WAVEBANK_NAME];
+        snprintf( name, sizeof( name ), "blend_%04d", n );
+        bench_blend( n, table );
+        wavebank_write( &writer, name, WAVEBANK_FLOAT32, table, WAVEBANK_TABLES, 0, 0.0f, 1.0f );
+    }
+    if ( wavebank_writer_close( &writer ) != SYNTH_ACK ) return 1;
+    double writing = now_seconds() - start;
+
+    WaveBank bank;
+    if ( wavebank_open( &bank, path ) != SYNTH_ACK ) return 1;
+    printf( "bank of %u octave table sets, %.1f MB, written in %.0f ms\n", bank.count,
+            bank.bytes / 1048576.0, writing * 1e3 );
+    wavebank_close( &bank );
+
+    double cold = bench_open( path, true ), warm = bench_open( path, false );
+    printf( "\nopen, map and check the index\n" );
+    printf( "  page cache dropped %10.3f ms\n", cold * 1e3 );
+    printf( "  page cache warm    %10.3f ms\n", warm * 1e3 );
+    ok = ok && cold >= 0.0 && warm >= 0.0;
+
+    // from a bank nothing of which has been read yet
+    bench_drop( path );
+    wavebank_open( &bank, path );
+    WaveformRegistry registry;
+    SynthArena       arena;
+    arena_init( &arena, SYNTH_ARENA_SIZE );
+    wavetable_registry_init( &registry, &arena );
+    int found = 0;
+    start     = now_seconds();
+    for ( int n = 0; n < BENCH_ENTRIES; n++ ) {
+        char name[WAVEBANK_NAME];
+        snprintf( name, sizeof( name ), "blend_%04d", n );
+        found += wavebank_find( &bank, name ) != NULL;
+    }
+    double       finding = now_seconds() - start;
+    BaseWaveform last    = INVALID_WAVEFORM;
+    start                = now_seconds();
+    for ( int n = 0; n < SYNTH_WAVEFORMS; n++ ) {
+        last = wavebank_register( &bank, &bank.entries[n], &registry );
+    }
+    double registering = now_seconds() - start;
+
+    // the first block of a note reads the table's pages for the first time
+    float              block[BENCH_BLOCK];
+    uint32_t           phase = 0;
+    const WaveformSet *set   = wavetable_registry_acquire( &registry );
+    start                    = now_seconds();
+    wavetable_render( wavetable_lookup( set, last ), block, BENCH_BLOCK, &phase,
+                      wavetable_increment( 110.0f, 48000.0f ) );
+    double first = now_seconds() - start;
+    wavetable_registry_release( &registry, set );
+    printf( "  find every name    %10.3f ms, %.0f ns each, %d found\n", finding * 1e3,
+            finding / BENCH_ENTRIES * 1e9, found );
+    printf( "  register %4d      %10.3f ms\n", SYNTH_WAVEFORMS, registering * 1e3 );
+    printf( "  first note block   %10.3f ms, from a table never read\n", first * 1e3 );
+    ok = ok && found == BENCH_ENTRIES && last == WAVEFORM_COUNT + SYNTH_WAVEFORMS - 1;
+
+    // what the registry hands out is the bank's own memory
+    bench_blend( SYNTH_WAVEFORMS - 1, table );
+    set                 = wavetable_registry_acquire( &registry );
+    const uint8_t *mine = (const uint8_t *) wavetable_lookup( set, last )->samples;
+    ok = ok && mine >= bank.base && mine < bank.base + bank.bytes &&
+         memcmp( mine, table, sizeof( float ) * WAVEBANK_TABLES ) == 0;
+    wavetable_registry_release( &registry, set );
+    wavetable_registry_destroy( &registry );
+    arena_destroy( &arena );
+
+    // the alternative: the same samples as text
+    size_t csvBytes = 0;
+    double parsing  = bench_csv( csvPath, table, &csvBytes );
+    double scale    = (double) BENCH_ENTRIES / BENCH_SLICE;
+    printf( "\nCSV of %d table sets, %.1f MB of text, parsed in %.1f ms\n", BENCH_SLICE,
+            csvBytes / 1048576.0, parsing * 1e3 );
+    printf( "  the whole bank as CSV would be %.0f MB and take %.2f s\n",
+            csvBytes * scale / 1048576.0, parsing * scale );
+    remove( csvPath );
+
+    start            = now_seconds();
+    bool   clean     = wavebank_verify( &bank ) == SYNTH_ACK;
+    double verifying = now_seconds() - start;
+    printf( "\nverify every checksum %.0f ms, %.1f GB/s: %s\n", verifying * 1e3,
+            bank.bytes / verifying / 1e9, clean ? "ok" : "FAILED" );
+    uint64_t sample = bank.entries[BENCH_ENTRIES / 2].offset + 1000;
+    uint64_t index  = (uint64_t) ( (const uint8_t *) &bank.entries[7].frames - bank.base );
+    wavebank_close( &bank );
+
+    bench_flip( path, sample );
+    bool caught = wavebank_open( &bank, path ) == SYNTH_ACK &&
+                  wavebank_verify( &bank ) == SYNTH_ERROR_INVALID_PARAM;
+    wavebank_close( &bank );
+    bench_flip( path, sample );
+    bench_flip( path, index );
+    caught = caught && wavebank_open( &bank, path ) == SYNTH_ERROR_INVALID_PARAM;
+    printf( "a changed sample and a changed index entry are caught: %s\n", caught ? "yes" : "NO" );
+    remove( path );
+
+    free( table );
+    return ok && clean && caught ? 0 : 1;
+}
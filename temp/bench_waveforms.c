@@ -0,0 +1,168 @@
+// benchmark: per-synth custom waveform registry, registration cost and render cost against base
+//
+// Hundreds of custom waveforms, each a different number of saw partials, are registered with one
+// synth. Each table's first octave must hold its generator's cycle, and get_sample() must reach the
+// generator by type. A render thread then plays the synth nonstop while this thread keeps
+// registering waveforms and starting notes on them, so sets are swapped under a live reader.
+// Last, the mix cost per voice sample of custom waveforms against a base waveform, the same for one
+// table since both only read tables; 64 different ones add the cache misses of 64 tables.
+//
+// build: gcc -O2 -Isrc temp/bench_waveforms.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "synth.h"
+#include "wavetable.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_WAVEFORMS 256     // registered before the render thread starts
+#define BENCH_LIVE      128     // registered while it runs
+#define BENCH_VOICES    64
+#define BENCH_FRAMES    ( 1 << 20 )
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// WaveformFunction has no user pointer; registration renders on the spot, so a global will do
+static int bench_partials = 1;
+
+static float partial_wave( float phase ) {
+    float sum = 0.0f;
+    for ( int k = 1; k <= bench_partials; k++ ) sum += sinf( 2.0f * PI * k * phase ) / (float) k;
+    return sum * 0.5f;
+}
+
+static BaseWaveform register_partials( Synthesizer *synth, int partials ) {
+    bench_partials = partials;
+    return register_custom_waveform( synth, partial_wave, "partials" );
+}
+
+/**********
+ * CHECKS *
+ *********/
+// octave 0 keeps 1024 harmonics, so a generator with fewer comes back as it went in
+static bool check_tables( Synthesizer *synth, const BaseWaveform *types, int count ) {
+    const WaveformSet *set   = wavetable_registry_acquire( synth->waveforms );
+    float              worst = 0.0f;
+    bool               ok    = set->count == (uint32_t) count;
+    for ( int w = 0; w < count && ok; w++ ) {
+        const WaveTable *table = wavetable_lookup( set, types[w] );
+        bench_partials         = 1 + w % 64;
+        ok                     = table != NULL && set->slots[w].entry.type == types[w];
+        for ( int i = 0; ok && i < WAVETABLE_SIZE; i += 7 ) {
+            float phase = (float) i / (float) WAVETABLE_SIZE;
+            float error = fabsf( table->samples[i] - partial_wave( phase ) );
+            float naive = fabsf( get_sample( synth, types[w], phase ) - partial_wave( phase ) );
+            if ( error > worst ) worst = error;
+            ok = naive == 0.0f;
+        }
+    }
+    wavetable_registry_release( synth->waveforms, set );
+    printf( "%d tables hold their generators: %s, worst error %.2g\n", count,
+            ok && worst < 1e-4f ? "yes" : "NO", worst );
+    return ok && worst < 1e-4f;
+}
+
+/*************
+ * LIVE SWAP *
+ ************/
+typedef struct {
+    Synthesizer *synth;
+    SynthAtomic  running;
+    uint64_t     blocks;
+    bool         finite;
+    double       energy;
+} RenderLoop;
+
+static void render_loop( void *arg ) {
+    RenderLoop *loop = (RenderLoop *) arg;
+    float       buffer[SYNTH_BLOCK_SIZE * 4];
+    while ( synth_atomic_load( &loop->running ) ) {
+        synth_process_buffer( loop->synth, buffer, SYNTH_BLOCK_SIZE * 4 );
+        for ( int i = 0; i < SYNTH_BLOCK_SIZE * 4; i++ ) {
+            loop->finite  = loop->finite && buffer[i] == buffer[i];
+            loop->energy += (double) buffer[i] * buffer[i];
+        }
+        loop->blocks++;
+    }
+}
+
+static bool check_live( Synthesizer *synth, int registered ) {
+    RenderLoop  loop = { synth, 1, 0, true, 0.0 };
+    SynthThread thread;
+    synth_atomic_store( &loop.running, 1 );
+    if ( !synth_thread_start( &thread, render_loop, &loop, -1 ) ) return false;
+
+    // each new waveform takes over from the last one's note
+    int    added = 0, playing = -1;
+    double start = now_seconds();
+    for ( int w = 0; w < BENCH_LIVE; w++ ) {
+        BaseWaveform type = register_partials( synth, 1 + w % 32 );
+        if ( type == INVALID_WAVEFORM || synth_set_waveform( synth, type ) != SYNTH_ACK ) break;
+        added++;
+        if ( playing >= 0 ) synth_release_note( synth, playing );
+        playing = synth_trigger_note( synth, 110.0f + (float) w, 0.05f );
+    }
+    double elapsed = now_seconds() - start;
+    if ( playing >= 0 ) synth_release_note( synth, playing );
+    synth_atomic_store( &loop.running, 0 );
+    synth_thread_join( &thread );
+
+    bool ok = added == BENCH_LIVE && loop.finite && loop.energy > 0.0 &&
+              synth_set_waveform( synth, (BaseWaveform) ( WAVEFORM_COUNT + registered + added ) ) ==
+                SYNTH_ERROR_INVALID_PARAM;
+    printf( "%d registered while rendering %llu spans, %.2f ms each: %s\n", added,
+            (unsigned long long) loop.blocks, elapsed / added * 1e3, ok ? "ok" : "FAILED" );
+    return ok;
+}
+
+/**********
+ * TIMING *
+ *********/
+// ns per voice sample with every voice on the given waveforms, one after the other
+static double time_mix( Synthesizer *synth, const BaseWaveform *types, int count ) {
+    static float buffer[BENCH_FRAMES];
+    for ( int v = 0; v < BENCH_VOICES; v++ ) {
+        synth_set_waveform( synth, types[v % count] );
+        synth_trigger_note( synth, 55.0f * (float) ( 1 + v % 24 ), 0.01f );
+    }
+    synth_process_buffer( synth, buffer, SYNTH_BLOCK_SIZE );    // start them
+    double start   = now_seconds();
+    synth_process_buffer( synth, buffer, BENCH_FRAMES );
+    double elapsed = now_seconds() - start;
+    for ( int note = 0; note < 4096; note++ ) synth_release_note( synth, note );
+    for ( int i = 0; i < 64; i++ ) synth_process_buffer( synth, buffer, BENCH_FRAMES / 64 );
+    return elapsed / ( (double) BENCH_FRAMES * BENCH_VOICES ) * 1e9;
+}
+
+int main( void ) {
+    static BaseWaveform types[BENCH_WAVEFORMS];
+    Synthesizer         synth;
+    if ( synth_init( &synth, MAX_VOICES, 1 ) != SYNTH_ACK ) return 1;
+    Envelope flat = { 0.001f, 0.001f, 1.0f, 0.001f, ENVELOPE_CURVE_LINEAR };
+    synth_set_envelope( &synth, &flat );
+
+    double start = now_seconds();
+    for ( int w = 0; w < BENCH_WAVEFORMS; w++ ) types[w] = register_partials( &synth, 1 + w % 64 );
+    double registering = now_seconds() - start;
+    printf( "%d waveforms registered, %.2f ms and %zu kB of tables each\n", BENCH_WAVEFORMS,
+            registering / BENCH_WAVEFORMS * 1e3,
+            sizeof( float ) * WAVETABLE_OCTAVES * WAVETABLE_STRIDE / 1024 );
+
+    bool ok = check_tables( &synth, types, BENCH_WAVEFORMS );
+    ok      = check_live( &synth, BENCH_WAVEFORMS ) && ok;
+
+    BaseWaveform saw  = WAVEFORM_SAW;
+    double       base = time_mix( &synth, &saw, 1 );
+    double       one  = time_mix( &synth, types, 1 );
+    double       many = time_mix( &synth, types, BENCH_WAVEFORMS );
+    printf( "%d voice mix, ns per voice sample: base saw %.2f, one custom %.2f, %d customs %.2f\n",
+            BENCH_VOICES, base, one, BENCH_VOICES, many );
+
+    synth_destroy( &synth );
+    return ok ? 0 : 1;
+}
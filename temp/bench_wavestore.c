@@ -0,0 +1,207 @@
+// benchmark: compact symmetric wavetables, memory against speed and accuracy
+//
+// Each base waveform is kept as a WaveStore in float32 and int16 and rendered next to its
+// WaveTable for every note, 0 to 127, at several sample rates; the largest difference relative to
+// the waveform's peak is reported with the bytes each way takes. The per-note tables of
+// temp/sin.c, sampleRate / frequency + 1 floats for every note at every rate, are counted for
+// comparison. Last, ns per sample rendering a low, a middle and a high note from the tables, from
+// each store directly and through a WaveStoreCache on it, how many times as long each takes as the
+// tables, and how long the cache takes to decode a full octave.
+//
+// build: gcc -O2 -Isrc temp/bench_wavestore.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "music.h"
+#include "wavestore.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_BLOCK   512
+#define BENCH_SAMPLES ( 1 << 22 )    // rendered per timing
+#define BENCH_REPEATS 15             // timings per figure, the fastest is kept
+
+static const float bench_rates[] = { 44100.0f, 48000.0f, 96000.0f, 192000.0f };
+#define BENCH_RATES ( (int) ( sizeof( bench_rates ) / sizeof( bench_rates[0] ) ) )
+
+static const char *const bench_names[WAVEFORM_COUNT] = { "sine", "square", "saw", "triangle" };
+static const char *const bench_symmetry[WAVESTORE_SYMMETRY_COUNT] = {
+  "none", "mirror", "half", "quarter"
+};
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/************
+ * ACCURACY *
+ ***********/
+// largest difference from the tables over every note and rate, read directly and through a cache,
+// relative to the peak
+static float worst_error( const WaveTable *table, const WaveStore *store ) {
+    static WaveStoreCache cache;
+    float                 expected[BENCH_BLOCK], got[BENCH_BLOCK], cached[BENCH_BLOCK];
+    float                 worst = 0.0f, peak = 0.0f;
+    wavestore_cache_init( &cache, store );
+    for ( int r = 0; r < BENCH_RATES; r++ ) {
+        for ( int note = NOTA_MIN; note <= NOTA_MAX; note++ ) {
+            float    frequency = nota_frequency( note, BASE_TUNING, BASE_INDICE, 0.0f );
+            uint32_t increment = wavetable_increment( frequency, bench_rates[r] );
+            uint32_t start     = (uint32_t) note * 0x9E3779B9u, a = start, b = start, c = start;
+            wavetable_render( table, expected, BENCH_BLOCK, &a, increment );
+            wavestore_render( store, got, BENCH_BLOCK, &b, increment );
+            wavestore_cache_render( &cache, cached, BENCH_BLOCK, &c, increment );
+            if ( b != a || c != a ) return INFINITY;
+            for ( int i = 0; i < BENCH_BLOCK; i++ ) {
+                worst = fmaxf( worst, fabsf( got[i] - expected[i] ) );
+                worst = fmaxf( worst, fabsf( cached[i] - expected[i] ) );
+                peak  = fmaxf( peak, fabsf( expected[i] ) );
+            }
+        }
+    }
+    return worst / peak;
+}
+
+/**********
+ * TIMING *
+ *********/
+typedef void ( *RenderFunction )( const void *source, float *out, int length, uint32_t *phase,
+                                  uint32_t increment );
+
+static void render_table( const void *source, float *out, int length, uint32_t *phase,
+                          uint32_t increment ) {
+    wavetable_render( (const WaveTable *) source, out, length, phase, increment );
+}
+
+static void render_store( const void *source, float *out, int length, uint32_t *phase,
+                          uint32_t increment ) {
+    wavestore_render( (const WaveStore *) source, out, length, phase, increment );
+}
+
+static void render_cache( const void *source, float *out, int length, uint32_t *phase,
+                          uint32_t increment ) {
+    wavestore_cache_render( (WaveStoreCache *) source, out, length, phase, increment );
+}
+
+// ns per sample of each source, timed in turn within every repeat so that the host's load
+// falls on all of them alike, the fastest repeat of each kept
+static void time_render(
+  RenderFunction const *render, const void *const *source, int sources, int note, double *ns
+) {
+    static float   block[BENCH_BLOCK];
+    volatile float sink      = 0.0f;
+    float          frequency = nota_frequency( note, BASE_TUNING, BASE_INDICE, 0.0f );
+    uint32_t       increment = wavetable_increment( frequency, 48000.0f );
+    for ( int s = 0; s < sources; s++ ) ns[s] = 1e9;
+    for ( int repeat = 0; repeat < BENCH_REPEATS; repeat++ ) {
+        for ( int s = 0; s < sources; s++ ) {
+            uint32_t phase = 0;
+            double   start = now_seconds();
+            for ( int done = 0; done < BENCH_SAMPLES; done += BENCH_BLOCK ) {
+                render[s]( source[s], block, BENCH_BLOCK, &phase, increment );
+                sink += block[BENCH_BLOCK - 1];
+            }
+            ns[s] = fmin( ns[s], ( now_seconds() - start ) / BENCH_SAMPLES * 1e9 );
+        }
+    }
+    (void) sink;
+}
+
+int main( void ) {
+    static WaveStore stores[WAVESTORE_FORMAT_COUNT][WAVEFORM_COUNT];
+    if ( wavetable_init_defaults() != SYNTH_ACK ) return 1;
+
+    // sin.c's layout: a cycle per note and rate, for every waveform
+    size_t perNote = 0;
+    for ( int r = 0; r < BENCH_RATES; r++ ) {
+        for ( int note = NOTA_MIN; note <= NOTA_MAX; note++ ) {
+            float frequency  = nota_frequency( note, BASE_TUNING, BASE_INDICE, 0.0f );
+            perNote         += sizeof( float ) * (size_t) ( bench_rates[r] / frequency + 1.0f );
+        }
+    }
+    size_t tables = sizeof( float ) * WAVETABLE_OCTAVES * WAVETABLE_STRIDE;
+
+    size_t totals[WAVESTORE_FORMAT_COUNT] = { 0 };
+    bool   ok                             = true;
+    printf( "%-9s %-8s %10s %10s %10s %12s %12s\n", "waveform", "symmetry", "tables", "float32",
+            "int16", "float32 err", "int16 err" );
+    for ( int w = 0; w < WAVEFORM_COUNT; w++ ) {
+        const WaveTable *table = wavetable_get( (BaseWaveform) w );
+        float            errors[WAVESTORE_FORMAT_COUNT];
+        for ( int f = 0; f < WAVESTORE_FORMAT_COUNT; f++ ) {
+            WaveStoreFormat format = (WaveStoreFormat) f;
+            if ( wavestore_init( &stores[f][w], table, format ) != SYNTH_ACK ) return 1;
+            errors[f]  = worst_error( table, &stores[f][w] );
+            totals[f] += stores[f][w].bytes;
+        }
+        ok = ok && errors[WAVESTORE_FLOAT32] < 1e-3f && errors[WAVESTORE_INT16] < 1e-3f;
+        printf( "%-9s %-8s %9zuk %9.1fk %9.1fk %12.2g %12.2g\n", bench_names[w],
+                bench_symmetry[stores[0][w].symmetry], tables / 1024,
+                stores[WAVESTORE_FLOAT32][w].bytes / 1024.0,
+                stores[WAVESTORE_INT16][w].bytes / 1024.0, errors[WAVESTORE_FLOAT32],
+                errors[WAVESTORE_INT16] );
+    }
+
+    long l2 = sysconf( _SC_LEVEL2_CACHE_SIZE );
+    l2      = l2 > 0 ? l2 : 256 * 1024;
+    printf( "\nevery note at %d rates, all %d waveforms, against %ld kB of L2:\n", BENCH_RATES,
+            WAVEFORM_COUNT, l2 / 1024 );
+    const struct {
+        const char *name;
+        size_t      bytes;
+    } layouts[] = {
+      { "cycle per note and rate", perNote * WAVEFORM_COUNT },
+      { "octave tables", tables * WAVEFORM_COUNT },
+      { "store, float32", totals[WAVESTORE_FLOAT32] },
+      { "store, int16", totals[WAVESTORE_INT16] },
+    };
+    for ( size_t i = 0; i < sizeof( layouts ) / sizeof( layouts[0] ); i++ ) {
+        printf( "  %-24s %9.1f kB  %s\n", layouts[i].name, layouts[i].bytes / 1024.0,
+                layouts[i].bytes <= (size_t) l2 ? "fits" : "does not fit" );
+    }
+
+    static const int      notes[] = { 0, 48, 100 };
+    static RenderFunction render[] = { render_table, render_store, render_store, render_cache,
+                                       render_cache };
+    static WaveStoreCache caches[WAVESTORE_FORMAT_COUNT];
+    double                direct = 0.0, cached = 0.0;
+    printf( "\nns per sample at 48 kHz   note     tables    float32      int16   f32 cache" );
+    printf( "  i16 cache  float32 x  int16 x  f32 cache x  i16 cache x\n" );
+    for ( int w = 0; w < WAVEFORM_COUNT; w++ ) {
+        for ( int f = 0; f < WAVESTORE_FORMAT_COUNT; f++ ) {
+            wavestore_cache_init( &caches[f], &stores[f][w] );
+        }
+        const void *sources[] = { wavetable_get( (BaseWaveform) w ),
+                                  &stores[WAVESTORE_FLOAT32][w], &stores[WAVESTORE_INT16][w],
+                                  &caches[WAVESTORE_FLOAT32], &caches[WAVESTORE_INT16] };
+        for ( size_t n = 0; n < sizeof( notes ) / sizeof( notes[0] ); n++ ) {
+            double ns[5];
+            time_render( render, sources, 5, notes[n], ns );
+            printf( "%-24s %5d %10.2f %10.2f %10.2f %11.2f %10.2f %10.2f %8.2f %12.2f %12.2f\n",
+                    n == 0 ? bench_names[w] : "", notes[n], ns[0], ns[1], ns[2], ns[3], ns[4],
+                    ns[1] / ns[0], ns[2] / ns[0], ns[3] / ns[0], ns[4] / ns[0] );
+            direct = fmax( direct, fmax( ns[1], ns[2] ) / ns[0] );
+            cached = fmax( cached, fmax( ns[3], ns[4] ) / ns[0] );
+        }
+    }
+    printf( "slowest store against its tables: %.2fx directly, %.2fx through a cache\n", direct,
+            cached );
+
+    // a decode of the largest octave, as a cache does when its note changes octave
+    static float cycle[WAVETABLE_STRIDE];
+    double       decode = 1e9;
+    for ( int repeat = 0; repeat < BENCH_REPEATS; repeat++ ) {
+        double start = now_seconds();
+        for ( int i = 0; i < 1000; i++ ) wavestore_decode( &stores[WAVESTORE_INT16][2], 0, cycle );
+        decode = fmin( decode, ( now_seconds() - start ) * 1e3 );
+    }
+    printf( "decoding a %d sample octave of the int16 saw: %.2f us\n\n", WAVETABLE_SIZE, decode );
+
+    for ( int f = 0; f < WAVESTORE_FORMAT_COUNT; f++ ) {
+        for ( int w = 0; w < WAVEFORM_COUNT; w++ ) wavestore_destroy( &stores[f][w] );
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+// benchmark: voices per core, naive waveform_functions path vs band-limited wavetables
+//
+// build: gcc -O2 -Isrc temp/bench_wavetable.c $(ls src/*.c | grep -v 'main\|platform\|driver') -lm
+
+#include "synth.h"
+#include "wavetable.h"
+
+#include <time.h>
+
+#define BENCH_BLOCK   256
+#define BENCH_SECONDS 2    // seconds of audio rendered per measurement
+
+static const float bench_rates[] = { 44100.0f, 96000.0f, 192000.0f };
+
+static double      now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// the previous per-sample path: absolute index, divide, fmodf and a function pointer call
+static void naive_render(
+  float *out, int length, BaseWaveform type, float frequency, float rate, long start
+) {
+    for ( int i = 0; i < length; i++ ) {
+        float phase = fmodf( ( frequency * (float) ( start + i ) ) / rate, 1.0f );
+        out[i]      = get_sample( NULL, type, phase );
+    }
+}
+
+// returns how many voices of this waveform one core can render in realtime
+static double bench_voices( BaseWaveform type, float rate, bool tables ) {
+    static float     block[BENCH_BLOCK];
+    const WaveTable *table     = wavetable_get( type );
+    uint32_t         phase     = 0;
+    uint32_t         increment = wavetable_increment( 440.0f, rate );
+    long             total     = (long) rate * BENCH_SECONDS;
+    volatile float   sink      = 0.0f;
+
+    double           start     = now_seconds();
+    for ( long done = 0; done < total; done += BENCH_BLOCK ) {
+        if ( tables ) wavetable_render( table, block, BENCH_BLOCK, &phase, increment );
+        else naive_render( block, BENCH_BLOCK, type, 440.0f, rate, done );
+        sink += block[BENCH_BLOCK - 1];
+    }
+    double elapsed = now_seconds() - start;
+    (void) sink;
+    return (double) BENCH_SECONDS / elapsed;
+}
+
+int main( void ) {
+    static const char *names[WAVEFORM_COUNT] = { "sine", "square", "saw", "triangle" };
+
+    if ( wavetable_init_defaults() != SYNTH_ACK ) {
+        printf( "failed to build wavetables\n" );
+        return 1;
+    }
+
+    printf(
+      "%-10s %8s %14s %14s %8s\n", "waveform", "rate", "naive voices", "table voices", "gain"
+    );
+    for ( int r = 0; r < (int) ( sizeof( bench_rates ) / sizeof( bench_rates[0] ) ); r++ ) {
+        for ( int type = 0; type < WAVEFORM_COUNT; type++ ) {
+            double naive = bench_voices( (BaseWaveform) type, bench_rates[r], false );
+            double table = bench_voices( (BaseWaveform) type, bench_rates[r], true );
+            printf(
+              "%-10s %8.0f %14.1f %14.1f %7.1fx\n", names[type], bench_rates[r], naive, table,
+              table / naive
+            );
+        }
+    }
+    return 0;
+}
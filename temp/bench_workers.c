@@ -0,0 +1,98 @@
+// benchmark: multi-threaded voice mixing at 256, 1024 and 4096 voices on 1 to 16 threads
+//
+// Every thread count renders the same notes from the same start; the output has to match the
+// single threaded render bit for bit. Speedup is against one thread. Scaling needs the cores: a
+// machine with fewer cores than threads only shows the cost of waking the workers.
+//
+// build: gcc -O2 -Isrc temp/bench_workers.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "synth.h"
+#include "voice.h"
+#include "workers.h"
+
+#include <time.h>
+
+#define BENCH_FRAMES ( SAMPLE_RATE / 2 )    // frames rendered per measurement
+#define BENCH_BUFFER 256                    // frames per synth_process_buffer() call
+
+static const uint32_t voice_counts[]  = { 256, 1024, 4096 };
+static const uint32_t thread_counts[] = { 1, 2, 4, 8, 16 };
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// restart the synth on the same chord, spread over the keyboard and all base waveforms
+static void bench_reset( Synthesizer *synth, uint32_t voices ) {
+    float drain;
+    synth_silence( synth );
+    for ( uint32_t v = 0; v < voices; v++ ) {
+        synth->waveform = (BaseWaveform) ( v % WAVEFORM_COUNT );
+        // more notes than the command queue holds, let the renderer take some first
+        while ( synth_trigger_pitch_at(
+                  synth, 0, 24.0f + (float) ( v % 84 ), 1.0f / (float) voices
+                ) < 0 ) {
+            synth_process_buffer( synth, &drain, 1 );
+        }
+    }
+    synth_process_buffer( synth, &drain, 1 );
+}
+
+int main( void ) {
+    static float reference[BENCH_FRAMES];
+    static float buffer[BENCH_FRAMES];
+    Synthesizer  synth;
+
+    printf( "%-7s %-7s %12s %9s %9s %8s\n", "voices", "threads", "ns/voice", "speedup", "steals",
+            "match" );
+    for ( size_t c = 0; c < sizeof( voice_counts ) / sizeof( *voice_counts ); c++ ) {
+        uint32_t voices = voice_counts[c];
+        if ( synth_init( &synth, voices, 1 ) != SYNTH_ACK ) {
+            printf( "cannot make a synth with %u voices\n", voices );
+            return 1;
+        }
+        // a long sustain so every voice stays live for the whole measurement
+        Envelope pad = { 0.01f, 0.1f, 0.8f, 0.2f, ENVELOPE_CURVE_EXPONENTIAL };
+        synth_set_envelope( &synth, &pad );
+
+        double single = 0.0;
+        for ( size_t t = 0; t < sizeof( thread_counts ) / sizeof( *thread_counts ); t++ ) {
+            uint32_t threads = thread_counts[t];
+            if ( synth_set_threads( &synth, threads, -1 ) != SYNTH_ACK ) {
+                printf( "%-7u %-7u cannot start the workers\n", voices, threads );
+                continue;
+            }
+            uint64_t steals = synth.workers ? synth_atomic_load( &synth.workers->steals ) : 0;
+
+            bench_reset( &synth, voices );
+            if ( synth.voices->numActive != voices ) {
+                printf( "only %u of %u voices started\n", synth.voices->numActive, voices );
+                return 1;
+            }
+            double start = now_seconds();
+            for ( int offset = 0; offset < BENCH_FRAMES; offset += BENCH_BUFFER ) {
+                int length = BENCH_FRAMES - offset < BENCH_BUFFER ? BENCH_FRAMES - offset
+                                                                  : BENCH_BUFFER;
+                synth_process_buffer( &synth, buffer + offset, length );
+            }
+            double elapsed = now_seconds() - start;
+            if ( threads == 1 ) {
+                single = elapsed;
+                memcpy( reference, buffer, sizeof( reference ) );
+            }
+            steals = synth.workers ? synth_atomic_load( &synth.workers->steals ) - steals : 0;
+
+            bool match = memcmp( buffer, reference, sizeof( reference ) ) == 0;
+            printf( "%-7u %-7u %12.3f %8.2fx %9llu %8s\n", voices, threads,
+                    elapsed * 1e9 / ( (double) BENCH_FRAMES * voices ), single / elapsed,
+                    (unsigned long long) steals, match ? "exact" : "DIFFERS" );
+            if ( !match ) return 1;
+        }
+        synth_set_threads( &synth, 1, -1 );
+        arena_destroy( &synth.arena );
+    }
+    return 0;
+}
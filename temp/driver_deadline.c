@@ -0,0 +1,54 @@
+// check: run the realtime driver with every voice playing and fail if the deadline is ever missed
+//
+// usage: driver_deadline [seconds] [period frames] [periods] [device]
+// Runs against the AUDIO_DEVICE_LOOPBACK device by default, so it needs no sound card and can
+// gate a CI box. Exits 1 when the device underran at least once.
+//
+// build: gcc -O2 -Isrc temp/driver_deadline.c $(ls src/*.c | grep -v main.c) -lm -lpthread -lasound
+//    or: add -DSYNTH_AUDIO_NULL and drop -lasound, the loopback device needs no audio headers
+
+#include "driver.h"
+
+int main( int argc, char **argv ) {
+    double       seconds = argc > 1 ? atof( argv[1] ) : 5.0;
+    DriverConfig config  = {
+      .audio.device       = argc > 4 ? argv[4] : AUDIO_DEVICE_LOOPBACK,
+      .audio.periodFrames = argc > 2 ? (uint32_t) atoi( argv[2] ) : 0,
+      .audio.periods      = argc > 3 ? (uint32_t) atoi( argv[3] ) : 0,
+    };
+    Synthesizer synth;
+    AudioDriver driver;
+    DriverStats stats;
+
+    if ( synth_init( &synth, MAX_VOICES, 1 ) != SYNTH_ACK ) return 1;
+    if ( audio_driver_start( &driver, &synth, &config ) != SYNTH_ACK ) {
+        printf( "cannot open %s\n", config.audio.device );
+        return 1;
+    }
+
+    // keep the pool full from the control thread while the driver renders
+    uint64_t retrigger = 0;
+    for ( double start = audio_clock(); audio_clock() - start < seconds; retrigger++ ) {
+        for ( int i = 0; i < MAX_VOICES; i++ ) {
+            synth_trigger_pitch_at( &synth, 0, 36.0f + (float) ( ( i * 7 ) % 60 ), 0.1f );
+        }
+        audio_sleep( 0.05 );
+    }
+    audio_driver_stats( &driver, &stats );
+    audio_driver_stop( &driver );
+
+    printf( "device          %s\n", config.audio.device );
+    printf( "voices          %d, retriggered %llu times\n", MAX_VOICES,
+            (unsigned long long) retrigger );
+    printf( "realtime        %s, memory %s\n", stats.realtime ? "SCHED_FIFO" : "no",
+            stats.locked ? "locked" : "not locked" );
+    printf( "period          %.2f ms\n", stats.periodSeconds * 1e3 );
+    printf( "render          mean %.3f ms, max %.3f ms, headroom %.1f%%\n",
+            stats.meanRenderSeconds * 1e3, stats.maxRenderSeconds * 1e3, stats.headroom * 1e2 );
+    printf( "output latency  %.2f ms\n", stats.latencySeconds * 1e3 );
+    printf( "periods         %llu, late %llu\n", (unsigned long long) stats.periods,
+            (unsigned long long) stats.late );
+    printf( "underruns       %llu\n", (unsigned long long) stats.underruns );
+    arena_destroy( &synth.arena );
+    return stats.failed || stats.underruns ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+// check: what the MIDI layer queues stays in time order, and live input is not held back by it
+//
+// A short file is scheduled a second ahead of the render thread and stopped at SYNTH_TIME_NOW
+// before anything has played. The commands waiting in the queue must not go back in time, the
+// releases must come at or after every note of the window, and once the window has played no
+// voice may be left sounding. Then a live note is dispatched while a sequencer has a window
+// queued ahead and must sound after a single block. Exits non-zero if any of that does not hold.
+//
+// build: gcc -O2 -Isrc temp/midi_order.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "command.h"
+#include "midi.h"
+#include "voice.h"
+
+#define ORDER_NOTES  64       // sixteenth notes in the file
+#define ORDER_WINDOW 44100    // frames scheduled ahead, a second at SAMPLE_RATE
+#define ORDER_BLOCK  256
+
+static float order_buffer[ORDER_BLOCK];
+
+// a type 0 file of ORDER_NOTES sixteenth notes at 480 ticks per quarter and the default tempo
+static bool order_write( const char *path ) {
+    static const uint8_t head[] = { 'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, 1, 0xE0 };
+    static const uint8_t end[]  = { 0, 0xFF, 0x2F, 0 };
+    uint32_t             length = ORDER_NOTES * 7 + sizeof( end );
+    FILE                *file   = fopen( path, "wb" );
+    if ( !file ) return false;
+    fwrite( head, 1, sizeof( head ), file );
+    fwrite( "MTrk", 1, 4, file );
+    for ( int shift = 24; shift >= 0; shift -= 8 ) fputc( (int) ( length >> shift & 0xFF ), file );
+    for ( int n = 0; n < ORDER_NOTES; n++ ) {
+        uint8_t key     = (uint8_t) ( 48 + n % 24 );
+        uint8_t note[7] = { 0, 0x90, key, 100, 120, key, 0 };    // on, 120 ticks later off
+        fwrite( note, 1, sizeof( note ), file );
+    }
+    fwrite( end, 1, sizeof( end ), file );
+    return fclose( file ) == 0;
+}
+
+// empties both queues into a copy in the order the render thread applies them, true if the
+// times never went back
+static bool order_drain( Synthesizer *synth, SynthCommand *out, uint32_t *count ) {
+    CommandQueue       *queues[2] = { synth->live, synth->commands };
+    bool                ordered   = true;
+    const SynthCommand *command;
+    *count = 0;
+    for ( int q = 0; q < 2; q++ ) {
+        while ( ( command = command_queue_peek( queues[q] ) ) ) {
+            if ( *count > 0 && command->time < out[*count - 1].time ) ordered = false;
+            out[( *count )++] = *command;
+            command_queue_pop( queues[q] );
+        }
+    }
+    return ordered;
+}
+
+int main( void ) {
+    static SynthCommand queued[2 * SYNTH_QUEUE_SIZE];
+    const char         *path = "/tmp/midi_order.mid";
+    Synthesizer         synth;
+    MidiFile            file;
+    MidiSequencer       sequencer;
+    if ( !order_write( path ) || midi_file_open( &file, path ) != SYNTH_ACK ) return 1;
+    if ( synth_init( &synth, MAX_VOICES, 1 ) != SYNTH_ACK ) return 1;
+
+    // a window ahead, then stopped before the render thread has played any of it
+    midi_sequencer_init( &sequencer, &file, &synth, 0 );
+    uint32_t scheduled = midi_sequencer_schedule( &sequencer, ORDER_WINDOW );
+    midi_sequencer_stop( &sequencer, SYNTH_TIME_NOW );
+
+    uint32_t count   = 0;
+    bool     ordered = order_drain( &synth, queued, &count );
+    uint64_t lastOn  = 0, firstOff = UINT64_MAX;
+    for ( uint32_t i = 0; i < count; i++ ) {
+        if ( i < scheduled && queued[i].type == SYNTH_CMD_NOTE_ON ) lastOn = queued[i].time;
+        if ( i >= scheduled && queued[i].time < firstOff ) firstOff = queued[i].time;
+    }
+    bool after = count > scheduled && firstOff >= lastOn;
+    printf( "%u commands scheduled, %u releases, in time order: %s\n", scheduled,
+            count - scheduled, ordered ? "ok" : "WRONG" );
+    printf( "releases at frame %llu, after the last note of the window at %llu: %s\n",
+            (unsigned long long) firstOff, (unsigned long long) lastOn, after ? "ok" : "WRONG" );
+
+    // the same again, played through the render thread
+    midi_file_close( &file );
+    midi_file_open( &file, path );
+    midi_sequencer_init( &sequencer, &file, &synth, synth_frame_time( &synth ) );
+    midi_sequencer_schedule( &sequencer, synth_frame_time( &synth ) + ORDER_WINDOW );
+    midi_sequencer_stop( &sequencer, SYNTH_TIME_NOW );
+    for ( int done = 0; done < 2 * ORDER_WINDOW; done += ORDER_BLOCK ) {
+        synth_process_buffer( &synth, order_buffer, ORDER_BLOCK );
+    }
+    uint32_t left = synth.voices->numActive;
+    printf( "voices left once the window has played: %u: %s\n", left, left == 0 ? "ok" : "WRONG" );
+
+    // live input on channels of its own, next to a sequencer half a window into the future
+    MidiChannels live;
+    MidiMessage  on    = { .status = 0x90, .data = { 60, 100 } };
+    uint64_t     start = synth_frame_time( &synth ) + ORDER_WINDOW / 2;
+    midi_file_close( &file );
+    midi_file_open( &file, path );
+    midi_sequencer_init( &sequencer, &file, &synth, start );
+    midi_sequencer_schedule( &sequencer, start + ORDER_WINDOW );
+    midi_channels_init( &live, &synth );
+    bool sent = midi_channels_dispatch( &live, &on, 1 ) == 1;
+    synth_process_buffer( &synth, order_buffer, SYNTH_BLOCK_SIZE );
+    bool prompt = sent && synth.voices->numActive == 1;
+    printf( "live note sounding after one block, a sequencer queued ahead: %s\n",
+            prompt ? "ok" : "WRONG" );
+    midi_sequencer_stop( &sequencer, SYNTH_TIME_NOW );
+    midi_channels_release( &live, SYNTH_TIME_NOW );
+    for ( int done = 0; done < 2 * ORDER_WINDOW; done += ORDER_BLOCK ) {
+        synth_process_buffer( &synth, order_buffer, ORDER_BLOCK );
+    }
+    bool quiet = synth.voices->numActive == 0;
+    printf( "and silent once both are released: %s\n", quiet ? "ok" : "WRONG" );
+
+    midi_file_close( &file );
+    synth_destroy( &synth );
+    remove( path );
+    return ordered && after && left == 0 && prompt && quiet ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+// check: a note handle finds its voice however many notes were played since it started
+//
+// A pedal note is held while NOTE_HANDLES_BETWEEN short notes are played and released, far more
+// than a power of two table of handles would hold, then the pedal is released and must fall
+// silent. Then every voice is held at once and released in a scrambled order, and more notes are
+// started than there are voices, so the oldest are stolen, and all are released. Each part must
+// end with no voice left playing. Exits non-zero if any does not.
+//
+// build: gcc -O2 -Isrc temp/note_handles.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "synth.h"
+#include "voice.h"
+
+#define NOTE_HANDLES_VOICES  64
+#define NOTE_HANDLES_BETWEEN 20000    // notes played while the pedal is held
+#define NOTE_HANDLES_BLOCK   256
+
+static float note_handles_buffer[NOTE_HANDLES_BLOCK];
+
+static void render( Synthesizer *synth, double seconds ) {
+    for ( int done = 0; done < (int) ( seconds * SAMPLE_RATE ); done += NOTE_HANDLES_BLOCK ) {
+        synth_process_buffer( synth, note_handles_buffer, NOTE_HANDLES_BLOCK );
+    }
+}
+
+static bool report( const char *what, Synthesizer *synth ) {
+    uint32_t left = synth->voices->numActive;
+    printf( "%-48s %u voices left: %s\n", what, left, left == 0 ? "ok" : "WRONG" );
+    return left == 0;
+}
+
+int main( void ) {
+    Synthesizer    synth;
+    const Envelope pluck = { 0.001f, 0.001f, 0.8f, 0.002f, ENVELOPE_CURVE_EXPONENTIAL };
+    if ( synth_init( &synth, NOTE_HANDLES_VOICES, 1 ) != SYNTH_ACK ) return 1;
+    synth_set_envelope( &synth, &pluck );
+    bool ok = true;
+
+    // a pedal tone under a long run of short notes
+    int pedal = synth_trigger_note( &synth, 55.0f, 0.5f );
+    for ( int n = 0; n < NOTE_HANDLES_BETWEEN; n++ ) {
+        int note = synth_trigger_note( &synth, 440.0f, 0.1f );
+        synth_process_buffer( &synth, note_handles_buffer, NOTE_HANDLES_BLOCK );
+        synth_release_note( &synth, note );
+        synth_process_buffer( &synth, note_handles_buffer, NOTE_HANDLES_BLOCK );
+    }
+    bool held = synth.voices->numActive == 1;
+    synth_release_note( &synth, pedal );
+    render( &synth, 10.0 );
+    printf( "pedal still held after %d notes: %s\n", NOTE_HANDLES_BETWEEN, held ? "ok" : "WRONG" );
+    ok = report( "pedal released", &synth ) && held && ok;
+
+    // every voice at once, released in a scrambled order
+    int notes[2 * NOTE_HANDLES_VOICES];
+    for ( int n = 0; n < NOTE_HANDLES_VOICES; n++ ) {
+        notes[n] = synth_trigger_note( &synth, 110.0f + (float) n, 0.01f );
+    }
+    render( &synth, 0.1 );
+    for ( int n = 0; n < NOTE_HANDLES_VOICES; n++ ) {
+        synth_release_note( &synth, notes[( n * 37 ) % NOTE_HANDLES_VOICES] );
+    }
+    render( &synth, 1.0 );
+    ok = report( "every voice released out of order", &synth ) && ok;
+
+    // twice as many notes as voices, the oldest stolen, the stolen handles released too
+    for ( int n = 0; n < 2 * NOTE_HANDLES_VOICES; n++ ) {
+        notes[n] = synth_trigger_note( &synth, 110.0f + (float) n, 0.01f );
+    }
+    render( &synth, 0.1 );
+    for ( int n = 0; n < 2 * NOTE_HANDLES_VOICES; n++ ) synth_release_note( &synth, notes[n] );
+    render( &synth, 1.0 );
+    ok = report( "stolen voices and their notes released", &synth ) && ok;
+
+    synth_destroy( &synth );
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+// check: oscillator phase error after 10^9 samples, 32.32 accumulator vs a plain 32 bit one
+//
+// The exact phase of a frequency that divides the sample rate evenly is a rational number, so it
+// is tracked in integers. Exits non-zero if the oscillator is off by more than OSC_DRIFT_LIMIT.
+//
+// build: gcc -O2 -Isrc temp/osc_drift.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "oscillator.h"
+
+#include <time.h>
+
+#define OSC_DRIFT_SAMPLES 1000000000ull
+#define OSC_DRIFT_BLOCK   4096
+#define OSC_DRIFT_LIMIT   1e-6    // cycles
+
+typedef struct {
+    uint32_t numerator;    // cycles per sample = numerator / denominator
+    uint32_t denominator;
+} Pitch;
+
+static const Pitch drift_pitches[] = {
+    { 440, 44100 },    // A4
+    { 1000, 48000 },
+    { 17, 96000 },    // a slow LFO-like rate
+    { 19999, 44100 },
+};
+
+static double now_seconds( void ) {
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+// distance between two phases in cycles, wrapping around the cycle
+static double phase_error( double a, double b ) {
+    double d = fabs( a - b );
+    return d > 0.5 ? 1.0 - d : d;
+}
+
+int main( void ) {
+    static float block[OSC_DRIFT_BLOCK];
+    bool         failed = false;
+
+    if ( wavetable_init_defaults() != SYNTH_ACK ) {
+        printf( "failed to build wavetables\n" );
+        return 1;
+    }
+
+    printf( "%8s %8s %16s %16s %10s\n", "freq", "rate", "osc error", "32 bit error", "seconds" );
+    for ( int p = 0; p < (int) ( sizeof( drift_pitches ) / sizeof( drift_pitches[0] ) ); p++ ) {
+        Pitch      pitch = drift_pitches[p];
+        Oscillator osc;
+        osc_init( &osc, WAVEFORM_SINE, (float) pitch.denominator );
+        osc_set_frequency( &osc, (float) pitch.numerator );
+        uint32_t plain = 0;    // accumulator without the fractional increment
+
+        // render every sample through osc_render so block boundaries are exercised too
+        double start = now_seconds();
+        for ( uint64_t done = 0; done < OSC_DRIFT_SAMPLES; done += OSC_DRIFT_BLOCK ) {
+            osc_render( &osc, block, OSC_DRIFT_BLOCK );
+        }
+        double elapsed = now_seconds() - start;
+        uint64_t samples = ( OSC_DRIFT_SAMPLES + OSC_DRIFT_BLOCK - 1 ) / OSC_DRIFT_BLOCK *
+                           OSC_DRIFT_BLOCK;
+        plain += (uint32_t) ( samples * osc.phaseIncrement );
+
+        uint64_t cycles = ( samples * pitch.numerator ) % pitch.denominator;
+        double   exact  = (double) cycles / (double) pitch.denominator;
+        double   actual = ( (double) osc.phase + (double) osc.phaseFraction / 4294967296.0 ) /
+                        4294967296.0;
+        double   err    = phase_error( actual, exact );
+        double   naive  = phase_error( (double) plain / 4294967296.0, exact );
+
+        printf(
+          "%8u %8u %16.3g %16.3g %10.2f\n", pitch.numerator, pitch.denominator, err, naive, elapsed
+        );
+        if ( err > OSC_DRIFT_LIMIT ) failed = true;
+    }
+
+    printf( "%s\n", failed ? "FAIL" : "ok" );
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,104 @@
+// check: SynthPool hands out aligned, distinct slots and catches misuse in SYNTH_DEBUG builds
+//
+// A pool of odd-sized objects on cache line slots is drained, every slot must be aligned, inside
+// the pool and handed out once, and one more allocation must fail. Freed slots come back last in,
+// first out, pointers that are no slot are refused and pool_reset() makes every slot free again.
+// Built with -DSYNTH_DEBUG it also checks the fill patterns of fresh and freed slots, that a double
+// free is refused and that a write after free is counted when the slot is handed out again. Last,
+// a synth registers custom waveforms, each of which must take a WaveTable slot of the registry's
+// pool. Exits non-zero if anything is off.
+//
+// build: gcc -O2 -Isrc temp/pool_check.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+//   and again with -DSYNTH_DEBUG for the poisoning
+
+#include "pool.h"
+#include "wavetable.h"
+
+#define CHECK_SLOTS 37
+#define CHECK_SIZE  40    // bytes per object, not a multiple of the alignment
+#define CHECK_WAVES 8     // custom waveforms registered
+
+typedef struct {
+    uint8_t bytes[CHECK_SIZE];
+} CheckObject;
+
+static bool check( const char *what, bool ok ) {
+    printf( "%-56s %s\n", what, ok ? "ok" : "WRONG" );
+    return ok;
+}
+
+static float check_wave( float phase ) { return sinf( 2.0f * PI * phase ) * phase; }
+
+int main( void ) {
+    SynthArena arena;
+    SynthPool  pool;
+    bool       ok = true;
+    arena_init( &arena, 64 * 1024 );
+    if ( POOL_INIT( &pool, &arena, CheckObject, POOL_CACHE_LINE, CHECK_SLOTS ) != SYNTH_ACK ) {
+        return 1;
+    }
+
+    // drain the pool
+    CheckObject *objects[CHECK_SLOTS];
+    bool         aligned = true, inside = true, distinct = true;
+    for ( int n = 0; n < CHECK_SLOTS; n++ ) {
+        objects[n]  = POOL_NEW( &pool, CheckObject );
+        uint8_t *at = (uint8_t *) objects[n];
+        aligned     = aligned && at && (uintptr_t) at % POOL_CACHE_LINE == 0;
+        inside      = inside && at >= pool.slots && at < pool.slots + pool.stride * CHECK_SLOTS;
+        for ( int m = 0; m < n; m++ ) distinct = distinct && objects[m] != objects[n];
+        memset( objects[n], n, sizeof( CheckObject ) );
+    }
+    ok = check( "every slot on a cache line", aligned ) && ok;
+    ok = check( "every slot inside the pool", inside ) && ok;
+    ok = check( "no slot handed out twice", distinct ) && ok;
+    ok = check( "exhausted pool returns NULL", !pool_alloc( &pool ) && pool.numFree == 0 ) && ok;
+
+    // free and take back
+    pool_free( &pool, objects[5] );
+    pool_free( &pool, objects[9] );
+    ok = check( "last freed slot comes back first", pool_alloc( &pool ) == objects[9] ) && ok;
+    ok = check( "then the one before it", pool_alloc( &pool ) == objects[5] ) && ok;
+    int  foreign = 0;
+    bool refused = pool_free( &pool, &foreign ) == SYNTH_ERROR_INVALID_PARAM;
+    refused      = refused && pool_free( &pool, (uint8_t *) objects[3] + 8 ) != SYNTH_ACK;
+    refused      = refused && pool_free( &pool, NULL ) == SYNTH_ACK && pool.numFree == 0;
+    ok           = check( "pointers that are no slot are refused", refused ) && ok;
+    pool_reset( &pool );
+    ok = check( "reset frees every slot", pool.numFree == CHECK_SLOTS ) && ok;
+    ok = check( "and hands them out in address order", pool_alloc( &pool ) == pool.slots ) && ok;
+
+#ifdef SYNTH_DEBUG
+    // fill patterns, double free and write after free
+    uint8_t *slot  = (uint8_t *) pool_alloc( &pool );
+    bool     fresh = true, poisoned = true;
+    for ( size_t i = 0; i < CHECK_SIZE; i++ ) fresh = fresh && slot[i] == POOL_POISON_NEW;
+    pool_free( &pool, slot );
+    for ( size_t i = sizeof( void * ); i < CHECK_SIZE; i++ ) {
+        poisoned = poisoned && slot[i] == POOL_POISON_FREE;
+    }
+    ok = check( "fresh slots hold POOL_POISON_NEW", fresh ) && ok;
+    ok = check( "freed slots hold POOL_POISON_FREE", poisoned ) && ok;
+    ok = check( "double free refused", pool_free( &pool, slot ) != SYNTH_ACK ) && ok;
+    slot[CHECK_SIZE - 1] = 0;    // a write after free, reported on stderr when handed out
+    bool counted         = pool_alloc( &pool ) == slot && pool.corrupted == 1;
+    ok                   = check( "write after free counted", counted ) && ok;
+#else
+    printf( "%-56s %s\n", "poisoning", "skipped, build with -DSYNTH_DEBUG" );
+#endif
+    arena_destroy( &arena );
+
+    // the registry's WaveTable slots, one per custom waveform
+    Synthesizer synth;
+    if ( synth_init( &synth, MAX_VOICES, 1 ) != SYNTH_ACK ) return 1;
+    int registered = 0;
+    for ( int n = 0; n < CHECK_WAVES; n++ ) {
+        registered += register_custom_waveform( &synth, check_wave, "check" ) != INVALID_WAVEFORM;
+    }
+    uint32_t taken = SYNTH_WAVEFORMS - synth.waveforms->tables.numFree;
+    ok = check( "each custom waveform takes a WaveTable slot", taken == (uint32_t) registered ) &&
+         registered == CHECK_WAVES && ok;
+    synth_destroy( &synth );
+    return ok ? 0 : 1;
+}
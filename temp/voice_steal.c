@@ -0,0 +1,181 @@
+// check: voice stealing picks the victim its policy names and fades it out without a click
+//
+// Four voices play notes of different levels, priorities and pitches, then a fifth note comes in
+// under each VoiceStealPolicy and must take the voice the policy names: the oldest, the quietest,
+// the lowest priority, or the voice already playing its pitch. The victim must keep sounding in a
+// spare slot for the fade and be gone after it. Then a lone sine is stolen by a note a fifth up
+// and the largest step between samples across the steal must stay near the steady slope of either
+// note, where restarting the phase jumped by up to the note amplitude. Last, thousands of voices
+// are triggered, released and stolen under VOICE_STEAL_QUIETEST and the steal heap is checked
+// after every block. Exits non-zero if anything is off.
+//
+// build: gcc -O2 -Isrc temp/voice_steal.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "envelope.h"
+#include "synth.h"
+#include "voice.h"
+
+#define STEAL_VOICES     4
+#define STEAL_BLOCK      64
+#define STEAL_HEAP       4096    // voices of the heap run
+#define STEAL_HEAP_NOTES 200000
+
+static float steal_buffer[SAMPLE_RATE];
+
+static void render( Synthesizer *synth, int samples ) {
+    for ( int done = 0; done < samples; done += STEAL_BLOCK ) {
+        synth_process_buffer( synth, steal_buffer, STEAL_BLOCK );
+    }
+}
+
+// whether a note handle still has a sounding voice, a fading one does not count
+static bool sounds( const Synthesizer *synth, int note ) {
+    const VoicePool *pool = synth->voices;
+    for ( uint32_t a = 0; a < pool->numActive; a++ ) {
+        uint32_t v = pool->active[a];
+        if ( pool->heapSlot[v] != VOICE_NONE && pool->voices[v].note == (uint32_t) note ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// play four notes, steal with a fifth and check that exactly the expected one went
+static bool policy_case(
+  const char *name, VoiceStealPolicy policy, const float amplitude[STEAL_VOICES],
+  const uint8_t priority[STEAL_VOICES], float fifth, int victim, bool fades
+) {
+    Synthesizer    synth;
+    const Envelope organ = { 0.002f, 0.05f, 1.0f, 0.5f, ENVELOPE_CURVE_EXPONENTIAL };
+    if ( synth_init( &synth, STEAL_VOICES, 1 ) != SYNTH_ACK ) return false;
+    synth_set_envelope( &synth, &organ );
+    synth_set_steal_policy( &synth, policy );
+
+    int notes[STEAL_VOICES + 1];
+    for ( int n = 0; n < STEAL_VOICES; n++ ) {
+        synth_set_note_priority( &synth, priority[n] );
+        notes[n] = synth_trigger_pitch_at(
+          &synth, SYNTH_TIME_NOW, 60.0f + (float) n, amplitude[n]
+        );
+        render( &synth, STEAL_BLOCK );
+    }
+    render( &synth, SAMPLE_RATE / 10 );
+    synth_set_note_priority( &synth, 255 );
+    notes[STEAL_VOICES] = synth_trigger_pitch_at( &synth, SYNTH_TIME_NOW, fifth, 0.2f );
+    render( &synth, STEAL_BLOCK );
+
+    bool     ok     = sounds( &synth, notes[STEAL_VOICES] );
+    uint32_t during = synth.voices->numActive;
+    for ( int n = 0; n < STEAL_VOICES; n++ ) {
+        ok = ok && sounds( &synth, notes[n] ) == ( n != victim );
+    }
+    render( &synth, (int) ( 2.0f * ENVELOPE_FADE * SAMPLE_RATE ) );
+    uint32_t after = synth.voices->numActive;
+    ok             = ok && during == STEAL_VOICES + (uint32_t) fades && after == STEAL_VOICES;
+    printf(
+      "%-10s victim note %d, %u voices during the fade, %u after: %s\n", name, victim, during,
+      after, ok ? "ok" : "WRONG"
+    );
+    synth_destroy( &synth );
+    return ok;
+}
+
+// largest step between neighbouring samples
+static float max_step( const float *x, int count ) {
+    float step = 0.0f;
+    for ( int i = 1; i < count; i++ ) step = fmaxf( step, fabsf( x[i] - x[i - 1] ) );
+    return step;
+}
+
+// one voice, stolen by a note a fifth up, compared against both notes held steady
+static bool click_case( void ) {
+    Synthesizer    synth;
+    const Envelope organ = { 0.005f, 0.05f, 1.0f, 0.5f, ENVELOPE_CURVE_LINEAR };
+    if ( synth_init( &synth, 1, 1 ) != SYNTH_ACK ) return false;
+    synth_set_envelope( &synth, &organ );
+
+    int window = SAMPLE_RATE / 20;
+    synth_trigger_note( &synth, 440.0f, 0.8f );
+    render( &synth, SAMPLE_RATE / 10 );
+    synth_process_buffer( &synth, steal_buffer, window );
+    float before = max_step( steal_buffer, window );
+
+    synth_trigger_note( &synth, 660.0f, 0.8f );
+    synth_process_buffer( &synth, steal_buffer, window );
+    float across = max_step( steal_buffer, window );
+    render( &synth, SAMPLE_RATE / 10 );
+    synth_process_buffer( &synth, steal_buffer, window );
+    float after = max_step( steal_buffer, window );
+
+    // the two notes briefly sum, the fade and the attack add a little slope on top
+    bool ok = across <= 1.1f * fmaxf( before, after );
+    printf(
+      "steal step %.4f, steady steps %.4f and %.4f, a phase restart jumps up to 0.8: %s\n",
+      across, before, after, ok ? "ok" : "WRONG"
+    );
+    synth_destroy( &synth );
+    return ok;
+}
+
+// every parent's key is at most its children's and every voice knows its heap position
+static bool heap_valid( const VoicePool *pool ) {
+    uint32_t sounding = 0;
+    for ( uint32_t s = 0; s < pool->numSounding; s++ ) {
+        uint32_t v = pool->heap[s];
+        if ( pool->heapSlot[v] != s || !voice_pool_is_active( pool, v ) ) return false;
+        if ( s && pool->stealKey[pool->heap[( s - 1 ) / 2]] > pool->stealKey[v] ) return false;
+    }
+    for ( uint32_t a = 0; a < pool->numActive; a++ ) {
+        sounding += pool->heapSlot[pool->active[a]] != VOICE_NONE;
+    }
+    return sounding == pool->numSounding && pool->numSounding <= pool->limit;
+}
+
+static bool heap_case( void ) {
+    Synthesizer    synth;
+    const Envelope pluck = { 0.001f, 0.02f, 0.3f, 0.01f, ENVELOPE_CURVE_EXPONENTIAL };
+    if ( synth_init( &synth, STEAL_HEAP, 1 ) != SYNTH_ACK ) return false;
+    synth_set_envelope( &synth, &pluck );
+    synth_set_steal_policy( &synth, VOICE_STEAL_QUIETEST );
+
+    static int notes[STEAL_HEAP];
+    uint32_t   seed = 1, blocks = 0, bad = 0;
+    for ( int n = 0; n < STEAL_HEAP; n++ ) notes[n] = -1;
+    for ( int n = 0; n < STEAL_HEAP_NOTES; n++ ) {
+        seed        = seed * 1664525u + 1013904223u;
+        int   slot  = (int) ( seed >> 20 ) % STEAL_HEAP;
+        float level = 0.001f + 0.01f * (float) ( seed & 0xFFFF ) / 65536.0f;
+        if ( notes[slot] >= 0 ) synth_release_note( &synth, notes[slot] );
+        notes[slot] = synth_trigger_pitch_at(
+          &synth, SYNTH_TIME_NOW, (float) ( seed >> 25 ), level
+        );
+        if ( n % 256 == 255 ) {    // a release and a note on each, within SYNTH_QUEUE_SIZE
+            synth_process_buffer( &synth, steal_buffer, STEAL_BLOCK );
+            bad += !heap_valid( synth.voices );
+            blocks++;
+        }
+    }
+    printf(
+      "quietest heap over %u blocks of %d voices: %u broken, %s\n", blocks, STEAL_HEAP, bad,
+      bad ? "WRONG" : "ok"
+    );
+    synth_destroy( &synth );
+    return bad == 0;
+}
+
+int main( void ) {
+    const float   levels[STEAL_VOICES] = { 0.5f, 0.1f, 0.4f, 0.3f };
+    const uint8_t ranks[STEAL_VOICES]  = { 3, 1, 1, 2 };
+    const uint8_t same[STEAL_VOICES]   = { 0, 0, 0, 0 };
+    bool          ok                   = true;
+
+    ok = policy_case( "oldest", VOICE_STEAL_OLDEST, levels, same, 72.0f, 0, true ) && ok;
+    ok = policy_case( "quietest", VOICE_STEAL_QUIETEST, levels, same, 72.0f, 1, true ) && ok;
+    ok = policy_case( "priority", VOICE_STEAL_PRIORITY, levels, ranks, 72.0f, 1, true ) && ok;
+    ok = policy_case( "same note", VOICE_STEAL_SAME_NOTE, levels, same, 62.0f, 2, false ) && ok;
+    ok = policy_case( "new note", VOICE_STEAL_SAME_NOTE, levels, same, 72.0f, 0, true ) && ok;
+    ok = click_case() && ok;
+    ok = heap_case() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+// tool: convert the time,amplitude CSV dumps of temp/sin.c into a waveform bank
+//
+// usage: wavebank_export [-r rate] BANK CSV...
+// Each CSV becomes an int16 entry named after its file without the extension, note_69_wave.csv
+// becoming note_69_wave, with the frequency of its note when the name carries one, as a MIDI key
+// the way sin.c numbers them or as a name like a4. The sample rate is the one the dumps were taken
+// at, 44100 unless given; the time column follows from it and is dropped. Then the bank is opened
+// and verified as the synth would.
+//
+// build: gcc -O2 -Isrc temp/wavebank_export.c
+//          $(ls src/*.c | grep -v 'main\|platform\|driver') -lm -lpthread
+
+#include "wavebank.h"
+
+#define EXPORT_RATE 44100    // temp/sin.c's SampleRates[0]
+
+typedef struct {
+    int16_t *samples;
+    uint32_t frames;
+    uint32_t capacity;
+} Dump;
+
+// the amplitude column, after a header line of time,amplitude
+static bool export_read( const char *path, Dump *dump ) {
+    FILE *csv = fopen( path, "r" );
+    char  line[128];
+    if ( !csv ) return false;
+    dump->frames = 0;
+    while ( fgets( line, sizeof( line ), csv ) ) {
+        char *comma = strchr( line, ',' );
+        char *end   = NULL;
+        long  value = comma ? strtol( comma + 1, &end, 10 ) : 0;
+        if ( !comma || end == comma + 1 ) continue;    // the header or a blank line
+        if ( dump->frames == dump->capacity ) {
+            uint32_t capacity = dump->capacity ? dump->capacity * 2 : 4096;
+            int16_t *samples  = (int16_t *) realloc( dump->samples, sizeof( int16_t ) * capacity );
+            if ( !samples ) break;
+            dump->samples  = samples;
+            dump->capacity = capacity;
+        }
+        value                        = value > INT16_MAX ? INT16_MAX : value;
+        dump->samples[dump->frames++] = (int16_t) ( value < INT16_MIN ? INT16_MIN : value );
+    }
+    bool ok = !ferror( csv ) && feof( csv );
+    fclose( csv );
+    return ok;
+}
+
+// the frequency of note_69 or note_a4, 0 for a name with no note in it
+static float export_frequency( const char *name ) {
+    static const int classes[7] = { 9, 11, 0, 2, 4, 5, 7 };    // a to g
+    int              key = -1, octave = 0;
+    char             letter = 0;
+    if ( sscanf( name, "note_%d", &key ) != 1 &&
+         sscanf( name, "note_%c%d", &letter, &octave ) == 2 && letter >= 'a' && letter <= 'g' ) {
+        key = ( octave + 1 ) * 12 + classes[letter - 'a'];
+    }
+    if ( key < 0 || key > 127 ) return 0.0f;
+    return 440.0f * powf( 2.0f, (float) ( key - 69 ) / 12.0f );
+}
+
+// the file name without directories and extension
+static void export_name( const char *path, char *name ) {
+    const char *base   = strrchr( path, '/' );
+    const char *back   = strrchr( path, '\\' );
+    base               = back && ( !base || back > base ) ? back : base;
+    base               = base ? base + 1 : path;
+    const char *dot    = strrchr( base, '.' );
+    size_t      length = dot ? (size_t) ( dot - base ) : strlen( base );
+    length             = length < WAVEBANK_NAME - 1 ? length : WAVEBANK_NAME - 1;
+    memcpy( name, base, length );
+    name[length] = '\0';
+}
+
+int main( int argc, char **argv ) {
+    uint32_t rate  = EXPORT_RATE;
+    int      first = 1;
+    if ( argc > 2 && strcmp( argv[1], "-r" ) == 0 ) {
+        rate   = (uint32_t) atoi( argv[2] );
+        first += 2;
+    }
+    if ( argc - first < 2 || rate == 0 ) {
+        fprintf( stderr, "usage: %s [-r rate] BANK CSV...\n", argv[0] );
+        return 2;
+    }
+
+    WaveBankWriter writer;
+    if ( wavebank_writer_open( &writer, argv[first] ) != SYNTH_ACK ) {
+        fprintf( stderr, "cannot create %s\n", argv[first] );
+        return 1;
+    }
+    Dump dump = { NULL, 0, 0 };
+    for ( int i = first + 1; i < argc; i++ ) {
+        char name[WAVEBANK_NAME];
+        export_name( argv[i], name );
+        float frequency = export_frequency( name );
+        if ( !export_read( argv[i], &dump ) ) {
+            fprintf( stderr, "cannot read %s\n", argv[i] );
+            continue;
+        }
+        SynthError err = wavebank_write(
+          &writer, name, WAVEBANK_INT16, dump.samples, dump.frames, rate, frequency, 1.0f / 32767.0f
+        );
+        printf( "%-24s %8u frames %10.3f Hz%s\n", name, dump.frames, frequency,
+                err == SYNTH_ACK ? "" : "  not written" );
+    }
+    free( dump.samples );
+    if ( wavebank_writer_close( &writer ) != SYNTH_ACK ) {
+        fprintf( stderr, "writing %s failed, are the names unique?\n", argv[first] );
+        return 1;
+    }
+
+    WaveBank   bank;
+    SynthError err = wavebank_open( &bank, argv[first] );
+    if ( err != SYNTH_ACK || wavebank_verify( &bank ) != SYNTH_ACK ) {
+        fprintf( stderr, "%s does not read back\n", argv[first] );
+        return 1;
+    }
+    printf( "%s: %u entries, %zu bytes\n", argv[first], bank.count, bank.bytes );
+    wavebank_close( &bank );
+    return 0;
+}